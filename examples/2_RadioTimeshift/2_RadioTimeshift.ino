@@ -86,7 +86,7 @@ void startRadioStream() {
 
   // Wait for first chunk to be ready (max 10 seconds)
   uint32_t start_wait = millis();
-  while (ts->buffered_bytes() == 0) {
+  while (ts->playable_bytes() == 0) {  // Live head: bastano i primi byte scaricati
     if (millis() - start_wait > 10000) {
       Serial.println("ERROR: Timeout waiting for stream data!");
       delete ts;
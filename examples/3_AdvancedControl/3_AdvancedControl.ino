@@ -104,7 +104,7 @@ void startTimeshiftRadio(const char* url) {
 
   Serial.println("Waiting for first chunk...");
   uint32_t start_wait = millis();
-  while (ts->buffered_bytes() == 0) {
+  while (ts->playable_bytes() == 0) {  // Live head: bastano i primi byte scaricati
     if (millis() - start_wait > 10000) {
       Serial.println("ERROR: Timeout!");
       delete ts;
@@ -0,0 +1,94 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: fs::FS / fs::File di Arduino-ESP32 su una directory dell'host.
+// I path sono relativi alla root del filesystem ("/music/a.mp3" → <root>/music/a.mp3).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+
+#include "WString.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct HostFileImpl;
+
+class File {
+public:
+    File() = default;
+    explicit File(std::shared_ptr<HostFileImpl> impl) : impl_(std::move(impl)) {}
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t size);
+    size_t write(const char* buf, size_t size) { return write(reinterpret_cast<const uint8_t*>(buf), size); }
+    int available();
+    int read();
+    int peek();
+    size_t read(uint8_t* buf, size_t size);
+    size_t readBytes(char* buf, size_t size) { return read(reinterpret_cast<uint8_t*>(buf), size); }
+    void flush();
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    bool setBufferSize(size_t) { return true; }
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char* path() const;
+    const char* name() const;
+    bool isDirectory();
+    File openNextFile(const char* mode = FILE_READ);
+    void rewindDirectory();
+
+private:
+    std::shared_ptr<HostFileImpl> impl_;
+};
+
+class FS {
+public:
+    explicit FS(const char* label) : label_(label) {}
+    virtual ~FS() = default;
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+    bool rmdir(const String& path) { return rmdir(path.c_str()); }
+
+    // Root host del filesystem (default da env OPENESPAUDIO_<LABEL>_ROOT o ./host_fs/<label>)
+    void set_host_root(const char* root);
+    const std::string& host_root();
+    std::string host_path(const char* path);
+
+protected:
+    const char* label_;
+    std::string root_;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekSet;
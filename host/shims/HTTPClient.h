@@ -0,0 +1,70 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: HTTPClient minimale.
+//  - http://host:port/path  → HTTP/1.0 su socket TCP reale (es. server loopback di test)
+//  - file:///path/x.mp3      → file locale servito come stream (Range supportato).
+//    Parametro opzionale "?kbps=N" per cadenzare la lettura come una radio live,
+//    "&burst=KB" per anticipare i primi KB come il burst-on-connect di Icecast,
+//    "&connect_ms=N" per simulare la latenza di connessione prima della risposta.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "WString.h"
+#include "WiFiClient.h"
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_PARTIAL_CONTENT 206
+#define HTTP_CODE_NOT_FOUND 404
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+typedef enum {
+    HTTPC_DISABLE_FOLLOW_REDIRECTS,
+    HTTPC_STRICT_FOLLOW_REDIRECTS,
+    HTTPC_FORCE_FOLLOW_REDIRECTS
+} followRedirects_t;
+
+class HTTPClient {
+public:
+    HTTPClient() = default;
+    ~HTTPClient() { end(); }
+
+    bool begin(const String& url);
+    bool begin(WiFiClient& client, const String& url) { (void)client; return begin(url); }
+    void end();
+    void setFollowRedirects(followRedirects_t) {}
+    void setTimeout(uint16_t timeout_ms) { timeout_ms_ = timeout_ms; }
+    void setConnectTimeout(int32_t timeout_ms) { timeout_ms_ = (uint16_t)timeout_ms; }
+    void setUserAgent(const String& ua) { user_agent_ = ua.c_str(); }
+    void setReuse(bool) {}
+    void addHeader(const String& name, const String& value) { request_headers_[name.c_str()] = value.c_str(); }
+    void collectHeaders(const char* headers[], size_t count) { (void)headers; (void)count; }
+
+    int GET() { return sendRequest("GET"); }
+    int sendRequest(const char* method);
+
+    bool hasHeader(const char* name);
+    String header(const char* name);
+    int getSize() { return content_length_; }
+    WiFiClient* getStreamPtr() { return client_.get(); }
+    WiFiClient& getStream() { return *client_; }
+    String getString();
+    static String errorToString(int error);
+
+private:
+    std::string url_;
+    std::string user_agent_ = "openESPaudio-host";
+    std::map<std::string, std::string> request_headers_;
+    std::map<std::string, std::string> response_headers_;
+    std::unique_ptr<WiFiClient> client_;
+    int content_length_ = -1;
+    uint16_t timeout_ms_ = 5000;
+};
@@ -0,0 +1,30 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#pragma once
+
+#include "FS.h"
+
+typedef enum { CARD_NONE, CARD_MMC, CARD_SD, CARD_SDHC, CARD_UNKNOWN } sdcard_type_t;
+
+namespace fs {
+
+class SDMMCFS : public FS {
+public:
+    SDMMCFS() : FS("sdcard") {}
+    bool setPins(int clk, int cmd, int d0, int d1 = -1, int d2 = -1, int d3 = -1);
+    bool begin(const char* mountpoint = "/sdcard", bool mode1bit = false, bool format_if_mount_failed = false,
+               int sdmmc_frequency = 20000, uint8_t max_open_files = 5);
+    void end();
+    sdcard_type_t cardType();
+    uint64_t cardSize();
+    uint64_t totalBytes();
+    uint64_t usedBytes();
+
+private:
+    bool mounted_ = false;
+};
+
+} // namespace fs
+
+extern fs::SDMMCFS SD_MMC;
@@ -0,0 +1,26 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: la rete dell'host è sempre "connessa".
+
+#pragma once
+
+#include "WString.h"
+#include "WiFiClient.h"
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+
+class WiFiClass {
+public:
+    wl_status_t status() { return WL_CONNECTED; }
+    bool isConnected() { return true; }
+    bool mode(wifi_mode_t) { return true; }
+    wl_status_t begin(const char*, const char* = nullptr) { return WL_CONNECTED; }
+    bool disconnect(bool = false) { return true; }
+    bool setSleep(bool) { return true; }
+    int8_t RSSI() { return -40; }
+    String localIP() { return String("127.0.0.1"); }
+};
+
+extern WiFiClass WiFi;
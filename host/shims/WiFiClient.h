@@ -0,0 +1,50 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Stream di byte lato client: socket TCP oppure file locale cadenzato.
+class WiFiClient {
+public:
+    WiFiClient() = default;
+    virtual ~WiFiClient() { stop(); }
+
+    bool connect_socket(const std::string& host, uint16_t port, uint32_t timeout_ms);
+    // pace_kbps > 0: byte disponibili al ritmo del bitrate, più burst_bytes subito (come il
+    // burst-on-connect di Icecast)
+    bool open_file(const std::string& path, size_t offset, uint32_t pace_kbps, size_t burst_bytes = 0);
+    bool send_all(const std::string& data);
+    // Legge una riga terminata da \n (per il parsing degli header HTTP)
+    bool read_line(std::string& line);
+
+    int available();
+    int read();
+    int read(uint8_t* buf, size_t size);
+    size_t readBytes(uint8_t* buf, size_t size);
+    size_t readBytes(char* buf, size_t size) { return readBytes(reinterpret_cast<uint8_t*>(buf), size); }
+    uint8_t connected();
+    void stop();
+    void setTimeout(uint32_t timeout_ms) { timeout_ms_ = timeout_ms; }
+    operator bool() { return connected() != 0; }
+
+private:
+    bool fill(uint32_t wait_ms);
+    bool file_budget_wait();
+
+    int fd_ = -1;
+    FILE* file_ = nullptr;
+    bool eof_ = false;
+    uint32_t timeout_ms_ = 5000;
+    uint32_t pace_kbps_ = 0;
+    uint64_t pace_start_us_ = 0;
+    uint64_t pace_burst_ = 0;
+    uint64_t pace_bytes_ = 0;
+    uint8_t rx_[4096];
+    size_t rx_pos_ = 0;
+    size_t rx_len_ = 0;
+};
@@ -0,0 +1,26 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+        (void)sda; (void)scl; (void)frequency;
+        return true;
+    }
+    bool end() { return true; }
+    bool setClock(uint32_t) { return true; }
+    void beginTransmission(uint8_t) {}
+    uint8_t endTransmission(bool = true) { return 0; }
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t*, size_t len) { return len; }
+    uint8_t requestFrom(uint8_t, size_t len, bool = true) { return (uint8_t)len; }
+    int available() { return 0; }
+    int read() { return 0; }
+};
+
+extern TwoWire Wire;
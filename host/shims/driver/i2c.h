@@ -0,0 +1,26 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: bus I2C senza periferiche. Le scritture riescono, le letture ritornano 0.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "esp_bit_defs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef int i2c_port_t;
+#define I2C_NUM_0 0
+#define I2C_NUM_1 1
+
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t addr, const uint8_t* data, size_t len, TickType_t ticks);
+esp_err_t i2c_master_write_read_device(i2c_port_t port,
+                                       uint8_t addr,
+                                       const uint8_t* wr,
+                                       size_t wr_len,
+                                       uint8_t* rd,
+                                       size_t rd_len,
+                                       TickType_t ticks);
@@ -0,0 +1,9 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#pragma once
+
+#include <cstdint>
+
+// Microsecondi da avvio processo (clock monotono)
+int64_t esp_timer_get_time();
@@ -0,0 +1,8 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: incluso da audio_player.h ma non usato.
+
+#pragma once
+
+#include "FreeRTOS.h"
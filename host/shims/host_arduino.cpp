@@ -0,0 +1,356 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: core Arduino (tempo, Serial, GPIO/I2C fittizi) e heap_caps con contabilità.
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include "Wire.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "esp_heap_caps.h"
+#include "host_runtime.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+const Clock::time_point g_boot = Clock::now();
+std::mutex g_serial_mutex;
+std::atomic<bool> g_serial_stderr{false};
+} // namespace
+
+HardwareSerial Serial;
+TwoWire Wire;
+WiFiClass WiFi;
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - g_boot).count();
+}
+
+uint32_t millis() {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+uint32_t micros() {
+    return (uint32_t)esp_timer_get_time();
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return 0;
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+
+esp_err_t gpio_set_pull_mode(gpio_num_t, gpio_pull_mode_t) { return ESP_OK; }
+esp_err_t gpio_set_level(gpio_num_t, uint32_t) { return ESP_OK; }
+
+esp_err_t i2c_master_write_to_device(i2c_port_t, uint8_t, const uint8_t*, size_t, TickType_t) {
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_read_device(i2c_port_t, uint8_t, const uint8_t*, size_t, uint8_t* rd, size_t rd_len,
+                                       TickType_t) {
+    if (rd && rd_len) {
+        memset(rd, 0, rd_len);
+    }
+    return ESP_OK;
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Serial → stdout / stdin
+// ---------------------------------------------------------------------------
+
+size_t Print::printf(const char* fmt, ...) {
+    char stack_buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(stack_buf, sizeof(stack_buf), fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return 0;
+    }
+    if ((size_t)len < sizeof(stack_buf)) {
+        return write(reinterpret_cast<const uint8_t*>(stack_buf), (size_t)len);
+    }
+    std::string big((size_t)len + 1, '\0');
+    va_start(args, fmt);
+    vsnprintf(&big[0], big.size(), fmt, args);
+    va_end(args);
+    return write(reinterpret_cast<const uint8_t*>(big.data()), (size_t)len);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+    std::lock_guard<std::mutex> lock(g_serial_mutex);
+    FILE* out = g_serial_stderr ? stderr : stdout;
+    size_t n = fwrite(buf, 1, len, out);
+    fflush(out);
+    return n;
+}
+
+void HardwareSerial::flush() {
+    std::lock_guard<std::mutex> lock(g_serial_mutex);
+    fflush(g_serial_stderr ? stderr : stdout);
+}
+
+void host::serial_to_stderr(bool enable) {
+    g_serial_stderr = enable;
+}
+
+int HardwareSerial::available() {
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    return (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) ? 1 : 0;
+}
+
+int HardwareSerial::read() {
+    if (!available()) {
+        return -1;
+    }
+    unsigned char c;
+    return (::read(STDIN_FILENO, &c, 1) == 1) ? c : -1;
+}
+
+String HardwareSerial::readStringUntil(char terminator) {
+    String out;
+    int c;
+    while ((c = read()) >= 0 && c != terminator) {
+        out += (char)c;
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// heap_caps_*: malloc con contabilità per regione (compatibile con free())
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct HeapRegion {
+    size_t capacity;
+    size_t used;
+    size_t peak;
+    size_t min_free;
+};
+
+struct HeapState {
+    std::mutex m;
+    // Valori tipici ESP32-S3 N16R8 con Arduino: ~320 KB interni liberi, 8 MB PSRAM
+    HeapRegion internal{320 * 1024, 0, 0, 320 * 1024};
+    HeapRegion psram{8 * 1024 * 1024, 0, 0, 8 * 1024 * 1024};
+    std::unordered_map<void*, std::pair<size_t, bool>> blocks;  // ptr → (size, is_psram)
+};
+
+HeapState& heap_state() {
+    static HeapState* state = new HeapState();
+    return *state;
+}
+
+HeapRegion* pick_region(HeapState& st, size_t size, uint32_t caps, bool* is_psram) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        *is_psram = true;
+        return &st.psram;
+    }
+    if ((caps & MALLOC_CAP_INTERNAL) || (caps & MALLOC_CAP_DMA)) {
+        *is_psram = false;
+        return &st.internal;
+    }
+    // Come malloc() su ESP32 con SPIRAM_USE_MALLOC: interna se c'è spazio, altrimenti PSRAM
+    *is_psram = (st.internal.used + size > st.internal.capacity);
+    return *is_psram ? &st.psram : &st.internal;
+}
+
+void account_alloc(HeapState& st, HeapRegion* region, void* ptr, size_t size, bool is_psram) {
+    region->used += size;
+    if (region->used > region->peak) region->peak = region->used;
+    size_t free_now = region->capacity > region->used ? region->capacity - region->used : 0;
+    if (free_now < region->min_free) region->min_free = free_now;
+    st.blocks[ptr] = std::make_pair(size, is_psram);
+}
+
+void account_free(HeapState& st, void* ptr) {
+    auto it = st.blocks.find(ptr);
+    if (it == st.blocks.end()) {
+        return;
+    }
+    HeapRegion& region = it->second.second ? st.psram : st.internal;
+    region.used -= it->second.first;
+    st.blocks.erase(it);
+}
+
+} // namespace
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    HeapState& st = heap_state();
+    std::lock_guard<std::mutex> lock(st.m);
+    bool is_psram = false;
+    HeapRegion* region = pick_region(st, size, caps, &is_psram);
+    if (region->used + size > region->capacity) {
+        return nullptr;
+    }
+    void* ptr = malloc(size ? size : 1);
+    if (ptr) {
+        account_alloc(st, region, ptr, size, is_psram);
+    }
+    return ptr;
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    void* ptr = heap_caps_malloc(n * size, caps);
+    if (ptr) {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    if (!ptr) {
+        return heap_caps_malloc(size, caps);
+    }
+    HeapState& st = heap_state();
+    std::lock_guard<std::mutex> lock(st.m);
+    size_t old_size = 0;
+    auto it = st.blocks.find(ptr);
+    if (it != st.blocks.end()) {
+        old_size = it->second.first;
+    }
+    bool is_psram = false;
+    HeapRegion* region = pick_region(st, size, caps, &is_psram);
+    if (region->used - (it != st.blocks.end() && it->second.second == is_psram ? old_size : 0) + size > region->capacity) {
+        return nullptr;
+    }
+    void* out = realloc(ptr, size ? size : 1);
+    if (!out) {
+        return nullptr;
+    }
+    account_free(st, ptr);
+    account_alloc(st, region, out, size, is_psram);
+    return out;
+}
+
+void heap_caps_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    HeapState& st = heap_state();
+    {
+        std::lock_guard<std::mutex> lock(st.m);
+        account_free(st, ptr);
+    }
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    HeapState& st = heap_state();
+    std::lock_guard<std::mutex> lock(st.m);
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return st.psram.capacity - st.psram.used;
+    }
+    if (caps & MALLOC_CAP_INTERNAL) {
+        return st.internal.capacity - st.internal.used;
+    }
+    return (st.internal.capacity - st.internal.used) + (st.psram.capacity - st.psram.used);
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    HeapState& st = heap_state();
+    std::lock_guard<std::mutex> lock(st.m);
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return st.psram.min_free;
+    }
+    if (caps & MALLOC_CAP_INTERNAL) {
+        return st.internal.min_free;
+    }
+    return st.internal.min_free + st.psram.min_free;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    HeapState& st = heap_state();
+    std::lock_guard<std::mutex> lock(st.m);
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return st.psram.capacity;
+    }
+    if (caps & MALLOC_CAP_INTERNAL) {
+        return st.internal.capacity;
+    }
+    return st.internal.capacity + st.psram.capacity;
+}
+
+uint32_t esp_get_free_heap_size() {
+    return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+namespace host {
+
+void heap_set_capacity(size_t internal_bytes, size_t psram_bytes) {
+    HeapState& st = heap_state();
+    std::lock_guard<std::mutex> lock(st.m);
+    st.internal.capacity = internal_bytes;
+    st.psram.capacity = psram_bytes;
+    st.internal.min_free = internal_bytes > st.internal.used ? internal_bytes - st.internal.used : 0;
+    st.psram.min_free = psram_bytes > st.psram.used ? psram_bytes - st.psram.used : 0;
+}
+
+HeapStats heap_stats() {
+    HeapState& st = heap_state();
+    std::lock_guard<std::mutex> lock(st.m);
+    HeapStats out;
+    out.internal_used = st.internal.used;
+    out.internal_peak = st.internal.peak;
+    out.psram_used = st.psram.used;
+    out.psram_peak = st.psram.peak;
+    return out;
+}
+
+void heap_reset_peak() {
+    HeapState& st = heap_state();
+    std::lock_guard<std::mutex> lock(st.m);
+    st.internal.peak = st.internal.used;
+    st.psram.peak = st.psram.used;
+    st.internal.min_free = st.internal.capacity - st.internal.used;
+    st.psram.min_free = st.psram.capacity - st.psram.used;
+}
+
+} // namespace host
@@ -0,0 +1,561 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: kernel FreeRTOS emulato con std::thread / mutex / condition_variable.
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HostTask {
+    std::string name;
+    UBaseType_t priority = 0;
+    int core = 0;
+    std::mutex m;
+    std::condition_variable cv;
+    uint32_t notify_value = 0;
+    bool notify_pending = false;
+    bool abort_delay = false;
+};
+
+struct HostSemaphore {
+    std::mutex m;
+    std::condition_variable cv;
+    UBaseType_t count = 0;
+    UBaseType_t max_count = 1;
+    // Solo per mutex ricorsivi
+    std::thread::id owner;
+    UBaseType_t depth = 0;
+};
+
+struct HostQueue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length = 0;
+    UBaseType_t item_size = 0;
+};
+
+struct HostEventGroup {
+    std::mutex m;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point g_boot = Clock::now();
+thread_local HostTask* t_current = nullptr;
+std::recursive_mutex g_critical;
+
+// Eccezione usata da vTaskDelete(NULL) per terminare il thread del task
+struct TaskExit {};
+
+Clock::time_point deadline_for(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        return Clock::time_point::max();
+    }
+    return Clock::now() + std::chrono::milliseconds(ticks);
+}
+
+template <typename Lock, typename Pred>
+bool wait_until(std::condition_variable& cv, Lock& lock, Clock::time_point deadline, Pred pred) {
+    if (deadline == Clock::time_point::max()) {
+        cv.wait(lock, pred);
+        return true;
+    }
+    return cv.wait_until(lock, deadline, pred);
+}
+
+HostTask* current_task() {
+    if (!t_current) {
+        // Thread non creato via xTaskCreate (es. main): registrato al primo uso, mai liberato
+        t_current = new HostTask();
+        t_current->name = "host";
+    }
+    return t_current;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Task
+// ---------------------------------------------------------------------------
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn,
+                                   const char* name,
+                                   uint32_t stack_depth,
+                                   void* param,
+                                   UBaseType_t priority,
+                                   TaskHandle_t* handle,
+                                   BaseType_t core_id) {
+    (void)stack_depth;
+    // Come il kernel reale, l'handle è valido per tutta la vita del processo host
+    HostTask* task = new HostTask();
+    task->name = name ? name : "task";
+    task->priority = priority;
+    task->core = (core_id == tskNO_AFFINITY) ? 0 : (int)core_id;
+    if (handle) {
+        *handle = task;
+    }
+    std::thread([task, fn, param]() {
+        t_current = task;
+        try {
+            fn(param);
+        } catch (const TaskExit&) {
+        }
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn,
+                       const char* name,
+                       uint32_t stack_depth,
+                       void* param,
+                       UBaseType_t priority,
+                       TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, param, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == t_current) {
+        throw TaskExit();
+    }
+    // Un thread non può essere terminato dall'esterno: il task continuerà fino alla sua uscita
+    fprintf(stderr, "[host] vTaskDelete(%s) from another task is not supported, ignoring\n", task->name.c_str());
+}
+
+void vTaskDelay(TickType_t ticks) {
+    HostTask* self = current_task();
+    if (ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(self->m);
+    wait_until(self->cv, lock, deadline_for(ticks), [self]() { return self->abort_delay; });
+    self->abort_delay = false;
+}
+
+BaseType_t xTaskAbortDelay(TaskHandle_t task) {
+    if (!task) {
+        return pdFAIL;
+    }
+    {
+        std::lock_guard<std::mutex> lock(task->m);
+        task->abort_delay = true;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - g_boot).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return current_task();
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    if (!task) {
+        task = current_task();
+    }
+    return task->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 0;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    return task ? task->priority : current_task()->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+    (task ? task : current_task())->priority = priority;
+}
+
+void taskYIELD() {
+    std::this_thread::yield();
+}
+
+BaseType_t xPortGetCoreID() {
+    return t_current ? t_current->core : 0;
+}
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    (void)mux;
+    g_critical.lock();
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    (void)mux;
+    g_critical.unlock();
+}
+
+// ---------------------------------------------------------------------------
+// Task notifications
+// ---------------------------------------------------------------------------
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    HostTask* self = current_task();
+    std::unique_lock<std::mutex> lock(self->m);
+    if (self->notify_value == 0 && ticks > 0) {
+        wait_until(self->cv, lock, deadline_for(ticks),
+                   [self]() { return self->notify_value > 0 || self->abort_delay; });
+    }
+    self->abort_delay = false;
+    uint32_t value = self->notify_value;
+    if (value > 0) {
+        self->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    self->notify_pending = false;
+    return value;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (!task) {
+        return pdFAIL;
+    }
+    {
+        std::lock_guard<std::mutex> lock(task->m);
+        switch (action) {
+            case eSetBits: task->notify_value |= value; break;
+            case eIncrement: task->notify_value++; break;
+            case eSetValueWithOverwrite: task->notify_value = value; break;
+            case eSetValueWithoutOverwrite:
+                if (task->notify_pending) {
+                    return pdFAIL;
+                }
+                task->notify_value = value;
+                break;
+            case eNoAction:
+            default: break;
+        }
+        task->notify_pending = true;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    xTaskNotifyGive(task);
+    if (woken) {
+        *woken = pdFALSE;
+    }
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t* value, TickType_t ticks) {
+    HostTask* self = current_task();
+    std::unique_lock<std::mutex> lock(self->m);
+    if (!self->notify_pending) {
+        self->notify_value &= ~clear_on_entry;
+        if (ticks > 0) {
+            wait_until(self->cv, lock, deadline_for(ticks),
+                       [self]() { return self->notify_pending || self->abort_delay; });
+        }
+    }
+    self->abort_delay = false;
+    if (value) {
+        *value = self->notify_value;
+    }
+    if (!self->notify_pending) {
+        return pdFALSE;
+    }
+    self->notify_value &= ~clear_on_exit;
+    self->notify_pending = false;
+    return pdTRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Semaphores / mutex
+// ---------------------------------------------------------------------------
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    HostSemaphore* sem = new HostSemaphore();
+    sem->count = 1;
+    sem->max_count = 1;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return xSemaphoreCreateMutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    HostSemaphore* sem = new HostSemaphore();
+    sem->count = 0;
+    sem->max_count = 1;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    HostSemaphore* sem = new HostSemaphore();
+    sem->count = initial_count;
+    sem->max_count = max_count;
+    return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    if (!sem) {
+        return pdFALSE;
+    }
+    std::unique_lock<std::mutex> lock(sem->m);
+    if (!wait_until(sem->cv, lock, deadline_for(ticks), [sem]() { return sem->count > 0; })) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (!sem) {
+        return pdFALSE;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sem->m);
+        if (sem->count >= sem->max_count) {
+            return pdFALSE;
+        }
+        sem->count++;
+    }
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks) {
+    if (!sem) {
+        return pdFALSE;
+    }
+    std::thread::id me = std::this_thread::get_id();
+    {
+        std::lock_guard<std::mutex> lock(sem->m);
+        if (sem->depth > 0 && sem->owner == me) {
+            sem->depth++;
+            return pdTRUE;
+        }
+    }
+    if (xSemaphoreTake(sem, ticks) != pdTRUE) {
+        return pdFALSE;
+    }
+    std::lock_guard<std::mutex> lock(sem->m);
+    sem->owner = me;
+    sem->depth = 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+    if (!sem) {
+        return pdFALSE;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sem->m);
+        if (sem->depth == 0 || sem->owner != std::this_thread::get_id()) {
+            return pdFALSE;
+        }
+        if (--sem->depth > 0) {
+            return pdTRUE;
+        }
+        sem->owner = std::thread::id();
+    }
+    return xSemaphoreGive(sem);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem) {
+    if (!sem) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(sem->m);
+    return sem->count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    delete sem;
+}
+
+// ---------------------------------------------------------------------------
+// Queues
+// ---------------------------------------------------------------------------
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    HostQueue* q = new HostQueue();
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void* item, TickType_t ticks, bool front) {
+    if (!q) {
+        return pdFALSE;
+    }
+    std::unique_lock<std::mutex> lock(q->m);
+    if (!wait_until(q->cv, lock, deadline_for(ticks), [q]() { return q->items.size() < q->length; })) {
+        return errQUEUE_FULL;
+    }
+    const uint8_t* p = static_cast<const uint8_t*>(item);
+    std::vector<uint8_t> data(p, p + q->item_size);
+    if (front) {
+        q->items.push_front(std::move(data));
+    } else {
+        q->items.push_back(std::move(data));
+    }
+    lock.unlock();
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return queue_send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return queue_send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return queue_send(queue, item, ticks, true);
+}
+
+static BaseType_t queue_receive(QueueHandle_t q, void* item, TickType_t ticks, bool remove) {
+    if (!q) {
+        return pdFALSE;
+    }
+    std::unique_lock<std::mutex> lock(q->m);
+    if (!wait_until(q->cv, lock, deadline_for(ticks), [q]() { return !q->items.empty(); })) {
+        return errQUEUE_EMPTY;
+    }
+    memcpy(item, q->items.front().data(), q->item_size);
+    if (remove) {
+        q->items.pop_front();
+        lock.unlock();
+        q->cv.notify_all();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    return queue_receive(queue, item, ticks, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks) {
+    return queue_receive(queue, item, ticks, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    if (!queue) {
+        return pdFALSE;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue->m);
+        queue->items.clear();
+    }
+    queue->cv.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    if (!queue) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(queue->m);
+    return (UBaseType_t)queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    if (!queue) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(queue->m);
+    return queue->length - (UBaseType_t)queue->items.size();
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+// ---------------------------------------------------------------------------
+// Event groups
+// ---------------------------------------------------------------------------
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    if (!group) {
+        return 0;
+    }
+    EventBits_t result;
+    {
+        std::lock_guard<std::mutex> lock(group->m);
+        group->bits |= bits;
+        result = group->bits;
+    }
+    group->cv.notify_all();
+    return result;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    if (!group) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(group->m);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    if (!group) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(group->m);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group,
+                                EventBits_t bits,
+                                BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all,
+                                TickType_t ticks) {
+    if (!group) {
+        return 0;
+    }
+    std::unique_lock<std::mutex> lock(group->m);
+    auto satisfied = [group, bits, wait_for_all]() {
+        return wait_for_all ? ((group->bits & bits) == bits) : ((group->bits & bits) != 0);
+    };
+    bool ok = satisfied();
+    if (!ok && ticks > 0) {
+        ok = wait_until(group->cv, lock, deadline_for(ticks), satisfied);
+    }
+    EventBits_t result = group->bits;
+    if (ok && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
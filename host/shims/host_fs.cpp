@@ -0,0 +1,346 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: LittleFS / SD_MMC su directory dell'host (stdio + POSIX).
+
+#include "FS.h"
+#include "LittleFS.h"
+#include "SD_MMC.h"
+#include "host_runtime.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <vector>
+
+fs::LittleFSFS LittleFS;
+fs::SDMMCFS SD_MMC;
+
+namespace fs {
+
+struct HostFileImpl {
+    std::string path;        // Path lato FS (es. "/timeshift/ready_1.bin")
+    std::string host_path;   // Path reale
+    std::string name;        // Ultimo componente
+    FILE* fp = nullptr;
+    bool is_dir = false;
+    std::vector<std::string> dir_entries;
+    size_t dir_index = 0;
+    FS* owner = nullptr;
+
+    ~HostFileImpl() {
+        if (fp) {
+            fclose(fp);
+        }
+    }
+};
+
+namespace {
+
+std::string join_path(const std::string& a, const std::string& b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    if (a.back() == '/' && b.front() == '/') return a + b.substr(1);
+    if (a.back() != '/' && b.front() != '/') return a + "/" + b;
+    return a + b;
+}
+
+std::string base_name(const std::string& p) {
+    size_t pos = p.find_last_of('/');
+    return pos == std::string::npos ? p : p.substr(pos + 1);
+}
+
+bool mkdirs(const std::string& path) {
+    if (path.empty()) return true;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) return S_ISDIR(st.st_mode);
+    size_t pos = path.find_last_of('/');
+    if (pos != std::string::npos && pos > 0) {
+        mkdirs(path.substr(0, pos));
+    }
+    return ::mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+uint64_t dir_usage(const std::string& path) {
+    uint64_t total = 0;
+    DIR* d = opendir(path.c_str());
+    if (!d) return 0;
+    while (struct dirent* e = readdir(d)) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+        std::string child = join_path(path, e->d_name);
+        struct stat st;
+        if (stat(child.c_str(), &st) != 0) continue;
+        total += S_ISDIR(st.st_mode) ? dir_usage(child) : (uint64_t)st.st_size;
+    }
+    closedir(d);
+    return total;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// File
+// ---------------------------------------------------------------------------
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!impl_ || !impl_->fp) return 0;
+    return fwrite(buf, 1, size, impl_->fp);
+}
+
+int File::available() {
+    if (!impl_ || !impl_->fp) return 0;
+    long pos = ftell(impl_->fp);
+    size_t sz = size();
+    return (pos >= 0 && (size_t)pos < sz) ? (int)(sz - (size_t)pos) : 0;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!impl_ || !impl_->fp) return -1;
+    int c = fgetc(impl_->fp);
+    if (c != EOF) ungetc(c, impl_->fp);
+    return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if (!impl_ || !impl_->fp) return 0;
+    return fread(buf, 1, size, impl_->fp);
+}
+
+void File::flush() {
+    if (impl_ && impl_->fp) fflush(impl_->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!impl_ || !impl_->fp) return false;
+    int whence = (mode == SeekCur) ? SEEK_CUR : (mode == SeekEnd) ? SEEK_END : SEEK_SET;
+    return fseek(impl_->fp, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!impl_ || !impl_->fp) return 0;
+    long pos = ftell(impl_->fp);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!impl_) return 0;
+    if (impl_->fp) {
+        fflush(impl_->fp);
+        struct stat st;
+        if (fstat(fileno(impl_->fp), &st) == 0) return (size_t)st.st_size;
+        return 0;
+    }
+    struct stat st;
+    return stat(impl_->host_path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+    impl_.reset();
+}
+
+File::operator bool() const {
+    return impl_ && (impl_->fp || impl_->is_dir);
+}
+
+time_t File::getLastWrite() {
+    if (!impl_) return 0;
+    if (impl_->fp) fflush(impl_->fp);
+    struct stat st;
+    return stat(impl_->host_path.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+const char* File::path() const {
+    return impl_ ? impl_->path.c_str() : nullptr;
+}
+
+const char* File::name() const {
+    return impl_ ? impl_->name.c_str() : nullptr;
+}
+
+bool File::isDirectory() {
+    return impl_ && impl_->is_dir;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!impl_ || !impl_->is_dir || !impl_->owner) return File();
+    while (impl_->dir_index < impl_->dir_entries.size()) {
+        std::string child = join_path(impl_->path, impl_->dir_entries[impl_->dir_index++]);
+        File f = impl_->owner->open(child.c_str(), mode);
+        if (f) return f;
+    }
+    return File();
+}
+
+void File::rewindDirectory() {
+    if (impl_) impl_->dir_index = 0;
+}
+
+// ---------------------------------------------------------------------------
+// FS
+// ---------------------------------------------------------------------------
+
+void FS::set_host_root(const char* root) {
+    root_ = root ? root : "";
+    mkdirs(root_);
+}
+
+const std::string& FS::host_root() {
+    if (root_.empty()) {
+        std::string env_name = std::string("OPENESPAUDIO_") + label_ + "_ROOT";
+        for (auto& c : env_name) c = (char)toupper((unsigned char)c);
+        const char* env = getenv(env_name.c_str());
+        set_host_root(env && *env ? env : (std::string("host_fs/") + label_).c_str());
+    }
+    return root_;
+}
+
+std::string FS::host_path(const char* path) {
+    return join_path(host_root(), path ? path : "");
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+    if (!path) return File();
+    std::string hp = host_path(path);
+    struct stat st;
+    bool exists = stat(hp.c_str(), &st) == 0;
+    std::string m = mode ? mode : "r";
+
+    auto impl = std::make_shared<HostFileImpl>();
+    impl->path = path;
+    impl->host_path = hp;
+    impl->name = base_name(path);
+    impl->owner = this;
+
+    if (exists && S_ISDIR(st.st_mode)) {
+        impl->is_dir = true;
+        DIR* d = opendir(hp.c_str());
+        if (d) {
+            while (struct dirent* e = readdir(d)) {
+                if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+                impl->dir_entries.push_back(e->d_name);
+            }
+            closedir(d);
+        }
+        return File(impl);
+    }
+
+    if (m[0] == 'r' && !exists) {
+        return File();
+    }
+    if (m[0] != 'r' || create) {
+        size_t pos = hp.find_last_of('/');
+        if (pos != std::string::npos) mkdirs(hp.substr(0, pos));
+    }
+    std::string fmode = m;
+    if (fmode.find('b') == std::string::npos) fmode += "b";
+    impl->fp = fopen(hp.c_str(), fmode.c_str());
+    if (!impl->fp) return File();
+    return File(impl);
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return path && stat(host_path(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return path && ::unlink(host_path(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    return from && to && ::rename(host_path(from).c_str(), host_path(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return path && (::mkdir(host_path(path).c_str(), 0755) == 0 || errno == EEXIST);
+}
+
+bool FS::rmdir(const char* path) {
+    return path && ::rmdir(host_path(path).c_str()) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// LittleFS / SD_MMC
+// ---------------------------------------------------------------------------
+
+bool LittleFSFS::begin(bool, const char*, uint8_t, const char*) {
+    return mkdirs(host_root());
+}
+
+bool LittleFSFS::format() {
+    return true;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return 16u * 1024 * 1024;
+}
+
+size_t LittleFSFS::usedBytes() {
+    return (size_t)dir_usage(host_root());
+}
+
+bool SDMMCFS::setPins(int, int, int, int, int, int) {
+    return true;
+}
+
+bool SDMMCFS::begin(const char*, bool, bool, int, uint8_t) {
+    mounted_ = mkdirs(host_root());
+    return mounted_;
+}
+
+void SDMMCFS::end() {
+    mounted_ = false;
+}
+
+sdcard_type_t SDMMCFS::cardType() {
+    return mounted_ ? CARD_SDHC : CARD_NONE;
+}
+
+uint64_t SDMMCFS::cardSize() {
+    return totalBytes();
+}
+
+uint64_t SDMMCFS::totalBytes() {
+    struct statvfs vfs;
+    if (statvfs(host_root().c_str(), &vfs) != 0) return 0;
+    return (uint64_t)vfs.f_blocks * vfs.f_frsize;
+}
+
+uint64_t SDMMCFS::usedBytes() {
+    return dir_usage(host_root());
+}
+
+} // namespace fs
+
+namespace host {
+
+fs::FS& cache_fs() {
+    static fs::FS cache("cache");
+    static bool rooted = [] {
+        const char* env = getenv("OPENESPAUDIO_CACHE_ROOT");
+        if (!env || !*env) {
+            const char* tmp = getenv("TMPDIR");
+            cache.set_host_root((std::string(tmp && *tmp ? tmp : "/tmp") + "/openespaudio-cache").c_str());
+        }
+        return true;
+    }();
+    (void)rooted;
+    return cache;
+}
+
+} // namespace host
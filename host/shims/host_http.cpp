@@ -0,0 +1,362 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: HTTPClient/WiFiClient su socket POSIX o file locali.
+
+#include "HTTPClient.h"
+#include "WiFi.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+uint64_t now_us() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string lower(std::string s) {
+    for (auto& c : s) c = (char)tolower((unsigned char)c);
+    return s;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// WiFiClient
+// ---------------------------------------------------------------------------
+
+bool WiFiClient::connect_socket(const std::string& host, uint16_t port, uint32_t timeout_ms) {
+    stop();
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    std::string port_str = std::to_string(port);
+    if (getaddrinfo(host.c_str(), port_str.c_str(), &hints, &res) != 0 || !res) {
+        return false;
+    }
+    for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        struct timeval tv;
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            fd_ = fd;
+            break;
+        }
+        ::close(fd);
+    }
+    freeaddrinfo(res);
+    eof_ = false;
+    return fd_ >= 0;
+}
+
+bool WiFiClient::open_file(const std::string& path, size_t offset, uint32_t pace_kbps, size_t burst_bytes) {
+    stop();
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        return false;
+    }
+    if (offset > 0) {
+        fseek(file_, (long)offset, SEEK_SET);
+    }
+    pace_kbps_ = pace_kbps;
+    pace_start_us_ = now_us();
+    pace_burst_ = burst_bytes;
+    pace_bytes_ = 0;
+    eof_ = false;
+    return true;
+}
+
+bool WiFiClient::send_all(const std::string& data) {
+    if (fd_ < 0) return false;
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+// Per i file cadenzati: quanti byte sono "arrivati" finora
+bool WiFiClient::file_budget_wait() {
+    if (pace_kbps_ == 0) {
+        return true;
+    }
+    uint64_t elapsed = now_us() - pace_start_us_;
+    uint64_t budget = elapsed * pace_kbps_ / 8000 + pace_burst_;  // kbps → byte/us * 1000
+    return budget > pace_bytes_;
+}
+
+bool WiFiClient::fill(uint32_t wait_ms) {
+    if (rx_pos_ < rx_len_) return true;
+    if (eof_) return false;
+    rx_pos_ = rx_len_ = 0;
+
+    if (file_) {
+        uint64_t deadline = now_us() + (uint64_t)wait_ms * 1000;
+        while (!file_budget_wait()) {
+            if (now_us() >= deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        size_t want = sizeof(rx_);
+        if (pace_kbps_ > 0) {
+            uint64_t budget = (now_us() - pace_start_us_) * pace_kbps_ / 8000 + pace_burst_ - pace_bytes_;
+            if (budget < want) want = (size_t)budget;
+        }
+        size_t n = fread(rx_, 1, want, file_);
+        if (n == 0) {
+            eof_ = true;
+            return false;
+        }
+        pace_bytes_ += n;
+        rx_len_ = n;
+        return true;
+    }
+
+    if (fd_ < 0) return false;
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    int pr = poll(&pfd, 1, (int)wait_ms);
+    if (pr <= 0) return false;
+    ssize_t n = ::recv(fd_, rx_, sizeof(rx_), 0);
+    if (n <= 0) {
+        eof_ = true;
+        return false;
+    }
+    rx_len_ = (size_t)n;
+    return true;
+}
+
+bool WiFiClient::read_line(std::string& line) {
+    line.clear();
+    for (;;) {
+        if (!fill(timeout_ms_)) return !line.empty();
+        char c = (char)rx_[rx_pos_++];
+        if (c == '\n') {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        line += c;
+    }
+}
+
+int WiFiClient::available() {
+    if (rx_pos_ < rx_len_) return (int)(rx_len_ - rx_pos_);
+    if (fill(0)) return (int)(rx_len_ - rx_pos_);
+    return 0;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+    if (!fill(0)) return -1;
+    size_t n = rx_len_ - rx_pos_;
+    if (n > size) n = size;
+    memcpy(buf, rx_ + rx_pos_, n);
+    rx_pos_ += n;
+    return (int)n;
+}
+
+size_t WiFiClient::readBytes(uint8_t* buf, size_t size) {
+    size_t total = 0;
+    uint64_t deadline = now_us() + (uint64_t)timeout_ms_ * 1000;
+    while (total < size) {
+        uint64_t now = now_us();
+        if (now >= deadline) break;
+        if (!fill((uint32_t)((deadline - now) / 1000))) {
+            if (eof_) break;
+            continue;
+        }
+        size_t n = rx_len_ - rx_pos_;
+        if (n > size - total) n = size - total;
+        memcpy(buf + total, rx_ + rx_pos_, n);
+        rx_pos_ += n;
+        total += n;
+    }
+    return total;
+}
+
+uint8_t WiFiClient::connected() {
+    if (rx_pos_ < rx_len_) return 1;
+    if (file_) return eof_ ? 0 : 1;
+    return (fd_ >= 0 && !eof_) ? 1 : 0;
+}
+
+void WiFiClient::stop() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+    rx_pos_ = rx_len_ = 0;
+    eof_ = true;
+}
+
+// ---------------------------------------------------------------------------
+// HTTPClient
+// ---------------------------------------------------------------------------
+
+bool HTTPClient::begin(const String& url) {
+    end();
+    url_ = url.c_str();
+    return url_.compare(0, 7, "http://") == 0 || url_.compare(0, 7, "file://") == 0;
+}
+
+void HTTPClient::end() {
+    client_.reset();
+    response_headers_.clear();
+    request_headers_.clear();
+    content_length_ = -1;
+}
+
+int HTTPClient::sendRequest(const char* method) {
+    response_headers_.clear();
+    content_length_ = -1;
+    client_.reset(new WiFiClient());
+    client_->setTimeout(timeout_ms_);
+    bool head_only = strcmp(method, "HEAD") == 0;
+
+    size_t range_start = 0;
+    auto range_it = request_headers_.find("Range");
+    if (range_it != request_headers_.end()) {
+        const char* eq = strchr(range_it->second.c_str(), '=');
+        if (eq) range_start = strtoul(eq + 1, nullptr, 10);
+    }
+
+    if (url_.compare(0, 7, "file://") == 0) {
+        std::string path = url_.substr(7);
+        uint32_t kbps = 0;
+        size_t burst = 0;
+        uint32_t connect_ms = 0;
+        size_t q = path.find('?');
+        if (q != std::string::npos) {
+            std::string query = path.substr(q + 1);
+            path = path.substr(0, q);
+            size_t k = query.find("kbps=");
+            if (k != std::string::npos) kbps = (uint32_t)strtoul(query.c_str() + k + 5, nullptr, 10);
+            size_t b = query.find("burst=");
+            if (b != std::string::npos) burst = strtoul(query.c_str() + b + 6, nullptr, 10) * 1024;
+            size_t c = query.find("connect_ms=");
+            if (c != std::string::npos) connect_ms = (uint32_t)strtoul(query.c_str() + c + 11, nullptr, 10);
+        }
+        if (connect_ms > 0) {
+            // DNS + TCP/TLS + risposta del server di una radio reale
+            std::this_thread::sleep_for(std::chrono::milliseconds(connect_ms));
+        }
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return HTTP_CODE_NOT_FOUND;
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fclose(f);
+        if (kbps == 0) {
+            // File "statico": dimensione nota, Range supportato
+            content_length_ = (int)(size - (long)range_start);
+            response_headers_["content-length"] = std::to_string(content_length_);
+            response_headers_["accept-ranges"] = "bytes";
+        } else {
+            response_headers_["icy-br"] = std::to_string(kbps);
+        }
+        response_headers_["content-type"] = "audio/mpeg";
+        if (!head_only && !client_->open_file(path, range_start, kbps, kbps ? burst : 0)) {
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+        return (range_start > 0 && kbps == 0) ? HTTP_CODE_PARTIAL_CONTENT : HTTP_CODE_OK;
+    }
+
+    // http://host[:port]/path
+    std::string rest = url_.substr(7);
+    size_t slash = rest.find('/');
+    std::string hostport = rest.substr(0, slash);
+    std::string path = slash == std::string::npos ? "/" : rest.substr(slash);
+    std::string host = hostport;
+    uint16_t port = 80;
+    size_t colon = hostport.find(':');
+    if (colon != std::string::npos) {
+        host = hostport.substr(0, colon);
+        port = (uint16_t)atoi(hostport.c_str() + colon + 1);
+    }
+    if (!client_->connect_socket(host, port, timeout_ms_)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    std::string req = std::string(method) + " " + path + " HTTP/1.0\r\nHost: " + hostport +
+                      "\r\nUser-Agent: " + user_agent_ + "\r\nConnection: close\r\n";
+    for (const auto& h : request_headers_) {
+        req += h.first + ": " + h.second + "\r\n";
+    }
+    req += "\r\n";
+    if (!client_->send_all(req)) {
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+
+    std::string line;
+    if (!client_->read_line(line)) {
+        return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    size_t sp = line.find(' ');
+    int code = sp == std::string::npos ? 0 : atoi(line.c_str() + sp + 1);
+    while (client_->read_line(line) && !line.empty()) {
+        size_t c = line.find(':');
+        if (c == std::string::npos) continue;
+        std::string value = line.substr(c + 1);
+        while (!value.empty() && value.front() == ' ') value.erase(value.begin());
+        response_headers_[lower(line.substr(0, c))] = value;
+    }
+    auto cl = response_headers_.find("content-length");
+    if (cl != response_headers_.end()) {
+        content_length_ = atoi(cl->second.c_str());
+    }
+    return code > 0 ? code : HTTPC_ERROR_CONNECTION_LOST;
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+    return response_headers_.count(lower(name)) > 0;
+}
+
+String HTTPClient::header(const char* name) {
+    auto it = response_headers_.find(lower(name));
+    return it == response_headers_.end() ? String() : String(it->second.c_str());
+}
+
+String HTTPClient::getString() {
+    std::string out;
+    if (!client_) return String();
+    uint8_t buf[1024];
+    size_t n;
+    while ((n = client_->readBytes(buf, sizeof(buf))) > 0) {
+        out.append(reinterpret_cast<char*>(buf), n);
+    }
+    return String(out);
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+        case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+        case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+        case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+        case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+        default: return String("HTTP error ") + String(error);
+    }
+}
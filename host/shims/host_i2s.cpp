@@ -0,0 +1,228 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Host shim: I2S legacy → sink in memoria/file. In modalità realtime i2s_write
+// blocca finché la "coda DMA" (dma_buf_count * dma_buf_len frame) non ha spazio,
+// così l'AudioPlayer gira con le stesse tempistiche del device.
+
+#include "driver/i2s.h"
+#include "host_runtime.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct SinkState {
+    std::mutex m;
+    bool installed = false;
+    bool realtime = false;
+    uint32_t sample_rate = 0;
+    uint32_t frame_bytes = 4;
+    size_t dma_bytes = 0;
+    // Clock virtuale di riproduzione (solo realtime)
+    Clock::time_point play_start;
+    uint64_t queued_bytes_at_start = 0;
+    uint64_t submitted_bytes = 0;
+    size_t capture_limit = 0;
+    std::vector<uint8_t> capture;
+    FILE* capture_file = nullptr;
+    host::I2sSinkStats stats;
+};
+
+SinkState& sink() {
+    static SinkState* state = new SinkState();
+    return *state;
+}
+
+// Byte già "suonati" dal DMA virtuale
+uint64_t played_bytes(SinkState& st) {
+    if (st.sample_rate == 0) {
+        return st.submitted_bytes;
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - st.play_start).count();
+    uint64_t played = st.queued_bytes_at_start + (uint64_t)(secs * st.sample_rate) * st.frame_bytes;
+    return played < st.submitted_bytes ? played : st.submitted_bytes;
+}
+
+void restart_clock(SinkState& st) {
+    st.play_start = Clock::now();
+    st.queued_bytes_at_start = st.submitted_bytes;
+}
+
+} // namespace
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int, void*) {
+    if (port != I2S_NUM_0 || !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    if (st.installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t channels = (config->channel_format == I2S_CHANNEL_FMT_RIGHT_LEFT) ? 2 : 1;
+    st.installed = true;
+    st.sample_rate = config->sample_rate;
+    st.frame_bytes = channels * (uint32_t)config->bits_per_sample / 8;
+    st.dma_bytes = (size_t)config->dma_buf_count * (size_t)config->dma_buf_len * st.frame_bytes;
+    st.submitted_bytes = 0;
+    restart_clock(st);
+    st.stats.installs++;
+    st.stats.sample_rate = st.sample_rate;
+    st.stats.bits_per_sample = (uint32_t)config->bits_per_sample;
+    st.stats.dma_bytes = st.dma_bytes;
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port) {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    if (port != I2S_NUM_0 || !st.installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    st.installed = false;
+    if (st.capture_file) {
+        fflush(st.capture_file);
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t*) {
+    return port == I2S_NUM_0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, uint32_t bits, uint32_t channels) {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    if (port != I2S_NUM_0 || !st.installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    st.sample_rate = rate;
+    st.frame_bytes = channels * bits / 8;
+    st.stats.sample_rate = rate;
+    restart_clock(st);
+    return ESP_OK;
+}
+
+esp_err_t i2s_write(i2s_port_t port, const void* src, size_t size, size_t* bytes_written, TickType_t ticks) {
+    SinkState& st = sink();
+    std::unique_lock<std::mutex> lock(st.m);
+    if (port != I2S_NUM_0 || !st.installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (st.realtime && st.dma_bytes > 0) {
+        // Attendi che la coda DMA virtuale abbia spazio per il blocco
+        Clock::time_point deadline = (ticks == portMAX_DELAY)
+            ? Clock::time_point::max()
+            : Clock::now() + std::chrono::milliseconds(ticks);
+        for (;;) {
+            uint64_t queued = st.submitted_bytes - played_bytes(st);
+            if (queued == 0) {
+                // Coda vuota: il DMA ha "suonato" tutto (underrun), riparti da adesso
+                restart_clock(st);
+            }
+            if (queued + size <= st.dma_bytes || queued == 0) {
+                break;
+            }
+            if (Clock::now() >= deadline) {
+                if (bytes_written) *bytes_written = 0;
+                return ESP_ERR_TIMEOUT;
+            }
+            uint64_t excess = queued + size - st.dma_bytes;
+            double wait_s = (double)excess / ((double)st.sample_rate * st.frame_bytes);
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait_s > 0.0005 ? wait_s : 0.0005));
+            lock.lock();
+        }
+    }
+
+    st.submitted_bytes += size;
+    st.stats.bytes_written += size;
+    st.stats.write_calls++;
+    if (st.capture_limit > st.capture.size()) {
+        size_t room = st.capture_limit - st.capture.size();
+        const uint8_t* p = static_cast<const uint8_t*>(src);
+        st.capture.insert(st.capture.end(), p, p + (size < room ? size : room));
+    }
+    if (st.capture_file) {
+        fwrite(src, 1, size, st.capture_file);
+    }
+    if (bytes_written) {
+        *bytes_written = size;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port) {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    if (port != I2S_NUM_0 || !st.installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Scarta ciò che era in coda nel DMA virtuale
+    st.submitted_bytes = played_bytes(st);
+    restart_clock(st);
+    st.stats.zero_dma_calls++;
+    return ESP_OK;
+}
+
+namespace host {
+
+void i2s_sink_set_realtime(bool realtime) {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    st.realtime = realtime;
+    restart_clock(st);
+}
+
+void i2s_sink_capture(size_t max_bytes) {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    st.capture_limit = max_bytes;
+    st.capture.clear();
+    st.capture.reserve(max_bytes < (64u << 20) ? max_bytes : (64u << 20));
+}
+
+bool i2s_sink_capture_to_file(const char* path) {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    if (st.capture_file) {
+        fclose(st.capture_file);
+        st.capture_file = nullptr;
+    }
+    if (!path) {
+        return true;
+    }
+    st.capture_file = fopen(path, "wb");
+    return st.capture_file != nullptr;
+}
+
+std::vector<uint8_t> i2s_sink_take_capture() {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    std::vector<uint8_t> out;
+    out.swap(st.capture);
+    return out;
+}
+
+I2sSinkStats i2s_sink_stats() {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    return st.stats;
+}
+
+void i2s_sink_reset_stats() {
+    SinkState& st = sink();
+    std::lock_guard<std::mutex> lock(st.m);
+    st.stats = I2sSinkStats();
+}
+
+} // namespace host
@@ -0,0 +1,57 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// API solo-host per controllare i shim (sink I2S, heap simulato, filesystem).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fs { class FS; }
+
+namespace host {
+
+// --- Serial ---
+// true: Serial (e quindi i LOG_*) scrive su stderr, lasciando stdout ai report dei tool
+void serial_to_stderr(bool enable);
+
+// --- Sink I2S ---
+struct I2sSinkStats {
+    uint64_t bytes_written = 0;
+    uint32_t write_calls = 0;
+    uint32_t zero_dma_calls = 0;
+    uint32_t installs = 0;
+    uint32_t sample_rate = 0;
+    uint32_t bits_per_sample = 0;
+    size_t dma_bytes = 0;
+};
+
+// true: i2s_write blocca come il DMA reale (coda di dma_buf_count * dma_buf_len frame)
+void i2s_sink_set_realtime(bool realtime);
+// Cattura in memoria fino a max_bytes (0 = nessuna cattura)
+void i2s_sink_capture(size_t max_bytes);
+// Dump raw PCM s16le su file (nullptr per disabilitare)
+bool i2s_sink_capture_to_file(const char* path);
+std::vector<uint8_t> i2s_sink_take_capture();
+I2sSinkStats i2s_sink_stats();
+void i2s_sink_reset_stats();
+
+// --- Heap simulato (contabilità per regione) ---
+struct HeapStats {
+    size_t internal_used = 0;
+    size_t internal_peak = 0;
+    size_t psram_used = 0;
+    size_t psram_peak = 0;
+};
+void heap_set_capacity(size_t internal_bytes, size_t psram_bytes);
+HeapStats heap_stats();
+void heap_reset_peak();
+
+// --- Filesystem ---
+// FS per le cache dei tool (seek table MP3), fuori dalle directory dei media: root
+// $OPENESPAUDIO_CACHE_ROOT, altrimenti $TMPDIR/openespaudio-cache (o /tmp)
+fs::FS& cache_fs();
+
+} // namespace host
@@ -0,0 +1,196 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Benchmark host dei decoder: esegue run_decode_benchmark() su un corpus di file
+// e/o directory e stampa una riga JSON (o CSV) per file, diffabile tra commit.
+//
+//   openespaudio_decode_bench [--csv] [--block N] [--max-blocks N] [--seek-table]
+//                             [--fixtures DIR] <file|dir>...
+//
+// --fixtures DIR genera in DIR WAV sintetici (mono/stereo, 22.05/44.1/48 kHz) e li
+// aggiunge al corpus; gli MP3 vanno forniti come file (es. data/sample-rich.mp3).
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "decode_benchmark.h"
+#include "host_runtime.h"
+#include "logger.h"
+#include "mp3_seek_cache.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--csv] [--block N] [--max-blocks N] [--seek-table]\n"
+            "          [--fixtures DIR] <file|dir>...\n",
+            argv0);
+}
+
+bool has_audio_extension(const std::string& name) {
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string ext = name.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == "mp3" || ext == "wav";
+}
+
+void collect(const std::string& path, std::vector<std::string>& out) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "skip %s: not found\n", path.c_str());
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        out.push_back(path);
+        return;
+    }
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return;
+    }
+    std::vector<std::string> entries;
+    while (struct dirent* e = readdir(dir)) {
+        std::string name = e->d_name;
+        if (name != "." && name != ".." && has_audio_extension(name)) {
+            entries.push_back(path + "/" + name);
+        }
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    out.insert(out.end(), entries.begin(), entries.end());
+}
+
+void put_le(FILE* f, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        fputc((v >> (8 * i)) & 0xFF, f);
+    }
+}
+
+// WAV PCM 16 bit: sweep 200 Hz..8 kHz + rumore leggero, così il contenuto non è banale
+bool write_wav_fixture(const std::string& path, uint32_t rate, uint32_t channels, uint32_t seconds) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    uint32_t frames = rate * seconds;
+    uint32_t data_bytes = frames * channels * 2;
+    fwrite("RIFF", 1, 4, f);
+    put_le(f, 36 + data_bytes, 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put_le(f, 16, 4);
+    put_le(f, 1, 2);
+    put_le(f, channels, 2);
+    put_le(f, rate, 4);
+    put_le(f, rate * channels * 2, 4);
+    put_le(f, channels * 2, 2);
+    put_le(f, 16, 2);
+    fwrite("data", 1, 4, f);
+    put_le(f, data_bytes, 4);
+
+    double phase = 0.0;
+    uint32_t noise = 0x12345678u;
+    for (uint32_t i = 0; i < frames; ++i) {
+        double t = (double)i / frames;
+        double freq = 200.0 * std::pow(40.0, t);
+        phase += 2.0 * M_PI * freq / rate;
+        for (uint32_t c = 0; c < channels; ++c) {
+            noise = noise * 1664525u + 1013904223u;
+            double s = 0.5 * std::sin(phase + c * 0.5) + ((int32_t)(noise >> 16) - 32768) / 327680.0;
+            put_le(f, (uint16_t)(int16_t)(s * 32767.0), 2);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+void generate_fixtures(const std::string& dir, std::vector<std::string>& out) {
+    mkdir(dir.c_str(), 0755);
+    static const struct {
+        uint32_t rate;
+        uint32_t channels;
+    } kFixtures[] = {{22050, 1}, {44100, 1}, {44100, 2}, {48000, 2}};
+    for (const auto& fx : kFixtures) {
+        char name[64];
+        snprintf(name, sizeof(name), "/fixture_%u_%s.wav", (unsigned)fx.rate, fx.channels == 1 ? "mono" : "stereo");
+        std::string path = dir + name;
+        if (write_wav_fixture(path, fx.rate, fx.channels, 10)) {
+            out.push_back(path);
+        } else {
+            fprintf(stderr, "cannot write fixture %s\n", path.c_str());
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DecodeBenchOptions options;
+    DecodeBenchFormat format = DecodeBenchFormat::JSON;
+    std::vector<std::string> corpus;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--csv")) {
+            format = DecodeBenchFormat::CSV;
+        } else if (!strcmp(argv[i], "--block") && i + 1 < argc) {
+            options.frames_per_block = (size_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-blocks") && i + 1 < argc) {
+            options.max_blocks = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seek-table")) {
+            options.build_seek_table = true;
+        } else if (!strcmp(argv[i], "--fixtures") && i + 1 < argc) {
+            generate_fixtures(argv[++i], corpus);
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            collect(argv[i], corpus);
+        }
+    }
+    if (corpus.empty() || options.frames_per_block == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // I log del decoder finiscono su stderr: stdout resta solo il report
+    host::serial_to_stderr(true);
+    openespaudio::set_log_level(openespaudio::LogLevel::WARN);
+    Mp3SeekCache::set_location(&host::cache_fs(), "/seekcache");
+
+    if (format == DecodeBenchFormat::CSV) {
+        printf("%s\n", decode_bench_csv_header());
+    }
+
+    int failures = 0;
+    char line[768];
+    for (const std::string& path : corpus) {
+        size_t slash = path.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+        std::string name = "/" + (slash == std::string::npos ? path : path.substr(slash + 1));
+        LittleFS.set_host_root(dir.c_str());
+        LittleFS.begin();
+
+        DecodeBenchResult result;
+        if (!run_decode_benchmark_on_task(name.c_str(), options, result)) {
+            ++failures;
+        }
+        snprintf(result.label, sizeof(result.label), "%s", path.c_str());
+        format_decode_bench(result, format, line, sizeof(line));
+        printf("%s\n", line);
+        fflush(stdout);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Simulazione host della compensazione di deriva sugli stream live, in tempo virtuale.
+// Un produttore sintetico genera audio col proprio clock (rate nominale ± drift ppm) e lo
+// consegna a burst irregolari, come la rete; il consumatore lo legge col Resampler reale
+// a rate nominale, come I2S, e ogni 250 ms passa la distanza dal live edge al
+// DriftCompensator. Stampa una riga JSON per scenario: exit code 1 se la distanza non
+// resta centrata sul target, se il buffer si svuota o se il trim non converge sulla deriva.
+//
+//   openespaudio_drift_sim [--seconds N] [--prefill-ms N] [--drift PPM]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "drift_compensator.h"
+#include "host_runtime.h"
+#include "logger.h"
+#include "resampler.h"
+
+namespace {
+
+constexpr uint32_t kRate = 44100;
+constexpr size_t kChunkFrames = 256;           // Ingresso per giro del consumatore
+constexpr uint32_t kServoIntervalMs = 250;     // Come l'output task
+constexpr uint32_t kBurstMinMs = 100;          // Intervallo tra due consegne di rete
+constexpr uint32_t kBurstMaxMs = 900;
+constexpr double kSettleFraction = 0.75;       // Trim medio e scarto sull'ultimo quarto
+constexpr double kMaxDeviationMs = 250.0;      // Distanza filtrata rispetto al target
+constexpr double kMaxSettledDevMs = 100.0;   // Rumore dei burst nella media
+constexpr double kMaxTrimErrorPpm = 15.0;
+
+struct SimResult {
+    double drift_ppm = 0.0;
+    double mean_trim_ppm = 0.0;          // Media sull'ultimo quarto
+    double trim_jitter_ppm = 0.0;        // Deviazione standard sull'ultimo quarto
+    double target_ms = 0.0;
+    double max_dev_ms = 0.0;
+    double settled_dev_ms = 0.0;
+    double uncompensated_ms = 0.0;
+    uint32_t underruns = 0;
+    bool pass = false;
+};
+
+uint32_t next_random(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+bool run_scenario(double drift_ppm, uint32_t seconds, uint32_t prefill_ms, SimResult& r) {
+    r = SimResult();
+    r.drift_ppm = drift_ppm;
+    r.uncompensated_ms = drift_ppm * 1e-6 * seconds * 1000.0;
+
+    Resampler resampler;
+    if (!resampler.configure(kRate, kRate, 1, ResamplerQuality::FAST)) {
+        return false;
+    }
+    // Parametri di default del player: target = distanza misurata all'aggancio
+    DriftCompensator servo;
+    servo.reset();
+
+    // Il contenuto non conta: serve solo il consumo d'ingresso del resampler
+    std::vector<int16_t> in(kChunkFrames, 0);
+    std::vector<int16_t> out(resampler.max_output_frames(kChunkFrames));
+
+    const double producer_rate = kRate * (1.0 + drift_ppm * 1e-6);
+    uint32_t seed = 0x1234567u ^ (uint32_t)(int32_t)drift_ppm;
+    double produced = producer_rate * prefill_ms / 1000.0;
+    double delivered_until_ms = 0.0;
+    double next_delivery_ms = 0.0;
+    double buffered = produced;                              // Frame consegnati non letti
+    uint64_t played = 0;                                     // Frame d'uscita (clock I2S)
+    uint32_t next_servo_ms = 0;
+    double trim_sum = 0.0, trim_sq = 0.0;
+    uint32_t trim_count = 0;
+    const double end_ms = seconds * 1000.0;
+
+    for (;;) {
+        const double now_ms = (double)played * 1000.0 / kRate;
+        if (now_ms >= end_ms) {
+            break;
+        }
+        // Consegne di rete: tutto quanto prodotto dall'ultima consegna, a burst irregolari
+        while (next_delivery_ms <= now_ms) {
+            buffered += producer_rate * (next_delivery_ms - delivered_until_ms) / 1000.0;
+            delivered_until_ms = next_delivery_ms;
+            next_delivery_ms += kBurstMinMs + next_random(seed) % (kBurstMaxMs - kBurstMinMs);
+        }
+
+        if (buffered < kChunkFrames) {
+            // Underrun: I2S suona silenzio per un chunk
+            ++r.underruns;
+            played += kChunkFrames;
+            servo.relock();
+            continue;
+        }
+        buffered -= kChunkFrames;
+        played += resampler.process(in.data(), kChunkFrames, out.data(), out.size());
+
+        if ((uint32_t)now_ms >= next_servo_ms) {
+            next_servo_ms += kServoIntervalMs;
+            const int32_t distance = (int32_t)(buffered * 1000.0 / kRate);
+            resampler.set_ratio_trim(servo.update(distance, (uint32_t)now_ms));
+            if (servo.locked()) {
+                const double dev = fabs(servo.filtered_ms() - servo.target_ms());
+                r.max_dev_ms = std::max(r.max_dev_ms, dev);
+                if (now_ms >= end_ms * kSettleFraction) {
+                    const double trim = resampler.ratio_trim();
+                    r.settled_dev_ms = std::max(r.settled_dev_ms, dev);
+                    trim_sum += trim;
+                    trim_sq += trim * trim;
+                    ++trim_count;
+                }
+            }
+        }
+    }
+
+    if (trim_count > 0) {
+        r.mean_trim_ppm = trim_sum / trim_count;
+        r.trim_jitter_ppm = sqrt(std::max(0.0, trim_sq / trim_count - r.mean_trim_ppm * r.mean_trim_ppm));
+    }
+    r.target_ms = servo.target_ms();
+    r.pass = servo.locked() && trim_count > 0 && r.underruns == 0 && r.max_dev_ms <= kMaxDeviationMs &&
+             r.settled_dev_ms <= kMaxSettledDevMs && fabs(r.mean_trim_ppm - drift_ppm) <= kMaxTrimErrorPpm;
+    return r.pass;
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--seconds N] [--prefill-ms N] [--drift PPM]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t seconds = 3600;
+    uint32_t prefill_ms = 3000;
+    bool single = false;
+    double single_drift = 0.0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--prefill-ms") && i + 1 < argc) {
+            prefill_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--drift") && i + 1 < argc) {
+            single = true;
+            single_drift = strtod(argv[++i], nullptr);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (seconds == 0 || prefill_ms == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    openespaudio::set_log_level(openespaudio::LogLevel::WARN);
+
+    static const double kDrifts[] = {-500.0, -200.0, -50.0, 0.0, 50.0, 200.0, 500.0};
+    const double* drifts = single ? &single_drift : kDrifts;
+    const size_t count = single ? 1 : sizeof(kDrifts) / sizeof(kDrifts[0]);
+
+    int failures = 0;
+    for (size_t i = 0; i < count; ++i) {
+        SimResult r;
+        if (!run_scenario(drifts[i], seconds, prefill_ms, r)) {
+            ++failures;
+        }
+        printf("{\"drift_ppm\":%.1f,\"trim_ppm\":%.2f,\"trim_jitter_ppm\":%.1f,\"target_ms\":%.0f,"
+               "\"max_dev_ms\":%.1f,\"settled_dev_ms\":%.1f,\"uncompensated_ms\":%.0f,\"underruns\":%u,"
+               "\"pass\":%s}\n",
+               r.drift_ppm, r.mean_trim_ppm, r.trim_jitter_ppm, r.target_ms, r.max_dev_ms, r.settled_dev_ms,
+               r.uncompensated_ms, (unsigned)r.underruns, r.pass ? "true" : "false");
+        fflush(stdout);
+    }
+    return failures ? 1 : 0;
+}
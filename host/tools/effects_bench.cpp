@@ -0,0 +1,145 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Benchmark host della EffectsChain: esegue run_effects_benchmark() per ogni
+// combinazione di effetti e stampa una riga JSON (o CSV) per caso, diffabile tra commit.
+// Con --kernels confronta invece i kernel biquad dell'EQ (riferimento scalare vs due lane):
+// exit code 1 se le uscite non coincidono bit a bit.
+// Con --resampler misura qualità (THD+N, ripple, banda di stop) e costo del Resampler
+// verso --rate per ogni preset e rate d'ingresso comune: exit code 1 se un limite salta.
+//
+//   openespaudio_effects_bench [--csv] [--kernels] [--resampler] [--rate N] [--channels N] [--block N] [--blocks N]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "effects_benchmark.h"
+#include "host_runtime.h"
+#include "logger.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--csv] [--kernels] [--resampler] [--rate N] [--channels N] [--block N] [--blocks N]\n",
+            argv0);
+}
+
+int run_kernels(const EffectsBenchOptions& base, EffectsBenchFormat format) {
+    if (format == EffectsBenchFormat::CSV) {
+        printf("%s\n", eq_kernel_bench_csv_header());
+    }
+    static const uint32_t kBands[] = {1, 3, 8};
+    int failures = 0;
+    char line[512];
+    for (uint32_t bands : kBands) {
+        EqKernelBenchResult result;
+        if (!run_eq_kernel_benchmark(base, bands, result)) {
+            ++failures;
+        }
+        format_eq_kernel_bench(result, format, line, sizeof(line));
+        printf("%s\n", line);
+        fflush(stdout);
+    }
+    return failures ? 1 : 0;
+}
+
+int run_resampler(const EffectsBenchOptions& base, EffectsBenchFormat format) {
+    if (format == EffectsBenchFormat::CSV) {
+        printf("%s\n", resampler_bench_csv_header());
+    }
+    static const uint32_t kInRates[] = {22050, 32000, 44100, 48000, 96000};
+    static const ResamplerQuality kQualities[] = {ResamplerQuality::FAST, ResamplerQuality::BALANCED,
+                                                  ResamplerQuality::BEST};
+    int failures = 0;
+    char line[512];
+    for (ResamplerQuality quality : kQualities) {
+        for (uint32_t in_rate : kInRates) {
+            if (in_rate == base.sample_rate) {
+                continue;
+            }
+            ResamplerBenchResult result;
+            if (!run_resampler_benchmark(base, in_rate, quality, result)) {
+                ++failures;
+            }
+            format_resampler_bench(result, format, line, sizeof(line));
+            printf("%s\n", line);
+            fflush(stdout);
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    EffectsBenchOptions base;
+    EffectsBenchFormat format = EffectsBenchFormat::JSON;
+    bool kernels = false;
+    bool resampler = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--csv")) {
+            format = EffectsBenchFormat::CSV;
+        } else if (!strcmp(argv[i], "--kernels")) {
+            kernels = true;
+        } else if (!strcmp(argv[i], "--resampler")) {
+            resampler = true;
+        } else if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+            base.sample_rate = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--channels") && i + 1 < argc) {
+            base.channels = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--block") && i + 1 < argc) {
+            base.frames_per_block = (size_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--blocks") && i + 1 < argc) {
+            base.blocks = (uint32_t)atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    host::serial_to_stderr(true);
+    openespaudio::set_log_level(openespaudio::LogLevel::WARN);
+
+    if (kernels) {
+        return run_kernels(base, format);
+    }
+    if (resampler) {
+        return run_resampler(base, format);
+    }
+
+    if (format == EffectsBenchFormat::CSV) {
+        printf("%s\n", effects_bench_csv_header());
+    }
+
+    // Ogni stadio da solo, poi la catena completa
+    static const struct {
+        bool eq;
+        bool reverb;
+        bool echo;
+    } kCases[] = {
+        {true, false, false},
+        {false, true, false},
+        {false, false, true},
+        {true, true, true},
+    };
+
+    int failures = 0;
+    char line[1024];
+    for (const auto& c : kCases) {
+        EffectsBenchOptions options = base;
+        options.eq = c.eq;
+        options.reverb = c.reverb;
+        options.echo = c.echo;
+
+        EffectsBenchResult result;
+        if (!run_effects_benchmark(options, result)) {
+            ++failures;
+        }
+        format_effects_bench(result, format, line, sizeof(line));
+        printf("%s\n", line);
+        fflush(stdout);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Player host: riproduce un file/URL con AudioPlayer verso il sink I2S simulato.
+//
+//   openespaudio_host <file|http://...|file://...> [--out pcm.raw] [--realtime]
+//                     [--seek SEC] [--volume PCT] [--max-sec SEC] [--output-rate HZ]
+//                     [--psram] [--sd-ring-mb MB] [--no-live-head]
+//
+// I file locali vengono serviti da LittleFS con root nella loro directory (la seek cache
+// va invece in host::cache_fs(), nel temp dell'host);
+// gli URL passano dal TimeshiftManager (file://path?kbps=128 simula una radio live),
+// su SD (file ring, --sd-ring-mb per provarne uno piccolo che ricicla le regioni) o,
+// con --psram, con i chunk tenuti negli slab in memoria. Per gli URL stampa i tempi di avvio
+// fino al primo campione; --no-live-head aspetta il primo chunk READY come prima.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <SD_MMC.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "audio_player.h"
+#include "host_runtime.h"
+#include "mp3_seek_cache.h"
+#include "timeshift_manager.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s <file|http://...|file://...> [--out pcm.raw] [--realtime]\n"
+            "          [--seek SEC] [--volume PCT] [--max-sec SEC] [--output-rate HZ]\n"
+            "          [--psram] [--sd-ring-mb MB] [--no-live-head]\n",
+            argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::string input = argv[1];
+    const char* out_path = nullptr;
+    bool realtime = false;
+    int seek_sec = -1;
+    int volume = -1;
+    int max_sec = 0;
+    bool psram = false;
+    size_t sd_ring_mb = 0;
+    bool live_head = true;
+    AudioConfig cfg = default_audio_config();
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (!strcmp(argv[i], "--realtime")) {
+            realtime = true;
+        } else if (!strcmp(argv[i], "--seek") && i + 1 < argc) {
+            seek_sec = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--volume") && i + 1 < argc) {
+            volume = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-sec") && i + 1 < argc) {
+            max_sec = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--output-rate") && i + 1 < argc) {
+            cfg.output_sample_rate = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--psram")) {
+            psram = true;
+        } else if (!strcmp(argv[i], "--sd-ring-mb") && i + 1 < argc) {
+            sd_ring_mb = (size_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--no-live-head")) {
+            live_head = false;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    host::i2s_sink_set_realtime(realtime);
+    if (out_path && !host::i2s_sink_capture_to_file(out_path)) {
+        fprintf(stderr, "cannot open %s\n", out_path);
+        return 1;
+    }
+
+    // Seek table in cache nella directory temporanea dell'host, non accanto ai file
+    Mp3SeekCache::set_location(&host::cache_fs(), "/seekcache");
+
+    AudioPlayer player(cfg);
+    TimeshiftManager* ts = nullptr;
+    bool selected = false;
+    if (input.compare(0, 7, "http://") == 0 || input.compare(0, 7, "file://") == 0) {
+        // Come src/main.cpp: download avviato e primo chunk READY prima dell'arm
+        SD_MMC.begin();
+        ts = new TimeshiftManager();
+        if (psram) {
+            ts->setStorageMode(StorageMode::PSRAM_ONLY);
+        }
+        ts->setSdRingCapacity(sd_ring_mb * 1024 * 1024);
+        ts->setLiveHeadEnabled(live_head);
+        if (!ts->open(input.c_str()) || !ts->start()) {
+            fprintf(stderr, "cannot start timeshift for %s\n", input.c_str());
+            delete ts;
+            return 1;
+        }
+        uint32_t wait_start = millis();
+        while (ts->playable_bytes() == 0 && millis() - wait_start < 30000) {
+            delay(20);
+        }
+        player.select_source(std::unique_ptr<IDataSource>(ts));
+        selected = true;
+    } else {
+        size_t slash = input.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "." : input.substr(0, slash);
+        std::string name = "/" + (slash == std::string::npos ? input : input.substr(slash + 1));
+        LittleFS.set_host_root(dir.c_str());
+        LittleFS.begin();
+        selected = player.select_source(name.c_str(), SourceType::LITTLEFS);
+    }
+    if (!selected || !player.arm_source()) {
+        fprintf(stderr, "cannot open %s\n", input.c_str());
+        return 1;
+    }
+    if (volume >= 0) {
+        player.set_volume(volume);
+    }
+
+    uint32_t start_ms = millis();
+    player.start();
+    bool seek_done = seek_sec < 0;
+    bool startup_reported = ts == nullptr;
+    while (player.state() == PlayerState::PLAYING || player.state() == PlayerState::PAUSED) {
+        delay(20);
+        player.tick_housekeeping();
+        if (!startup_reported && player.first_audio_at_ms() != 0) {
+            // Il TimeshiftManager resta del player: letto solo mentre suona
+            TimeshiftStartupStats st = ts->startup_stats();
+            fprintf(stderr,
+                    "startup: connect %u ms, first byte %u ms, first read %u ms (%s), first sample %u ms\n",
+                    (unsigned)st.connect_ms, (unsigned)st.first_byte_ms, (unsigned)st.first_read_ms,
+                    st.live_head ? "live head" : "ready chunk",
+                    (unsigned)(player.first_audio_at_ms() - st.start_at_ms));
+            startup_reported = true;
+        }
+        if (!seek_done && player.played_frames() > 0) {
+            player.request_seek(seek_sec);
+            seek_done = true;
+        }
+        if (max_sec > 0 && millis() - start_ms >= (uint32_t)max_sec * 1000) {
+            player.print_status();
+            player.stop();
+            break;
+        }
+    }
+    bool ok = player.state() != PlayerState::ERROR;
+    if (player.state() != PlayerState::STOPPED) {
+        player.stop();
+    }
+
+    host::I2sSinkStats stats = host::i2s_sink_stats();
+    host::HeapStats heap = host::heap_stats();
+    fprintf(stderr,
+            "played %llu frames @ %u Hz in %u ms, i2s bytes %llu, underruns %u, peak heap int %u / psram %u\n",
+            (unsigned long long)player.played_frames(), (unsigned)stats.sample_rate,
+            (unsigned)(millis() - start_ms), (unsigned long long)stats.bytes_written,
+            (unsigned)player.ring_underruns(), (unsigned)heap.internal_peak, (unsigned)heap.psram_peak);
+    host::i2s_sink_capture_to_file(nullptr);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Registrazione multi-stream host: N TimeshiftManager su un RecordingHub (un writer, un
+// budget). Ogni --report-sec stampa una riga JSON con throughput aggregato e, per stream,
+// chunk scritti, coda, lag e byte non ancora READY; in fondo il riepilogo. Con --play K il
+// player riproduce la registrazione K da una vista dell'hub, e con --switch-sec passa alla
+// successiva senza fermare nessuna registrazione.
+//
+//   openespaudio_multi_record <url> [<url>...] [--seconds S] [--report-sec S] [--psram]
+//                             [--psram-budget-kb KB] [--sd-budget-mb MB] [--play K]
+//                             [--switch-sec S]
+
+#include <Arduino.h>
+#include <SD_MMC.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_player.h"
+#include "host_runtime.h"
+#include "recording_hub.h"
+#include "timeshift_manager.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s <url> [<url>...] [--seconds S] [--report-sec S] [--psram]\n"
+            "          [--psram-budget-kb KB] [--sd-budget-mb MB] [--play K] [--switch-sec S]\n",
+            argv0);
+}
+
+void print_report(const RecordingHubStats& st, bool summary) {
+    printf("{%s\"elapsed_ms\":%u,\"chunks\":%u,\"bytes\":%llu,\"throughput_kbps\":%u,\"write_kbps\":%u,"
+           "\"busy_ms\":%u,\"streams\":[",
+           summary ? "\"summary\":true," : "", (unsigned)st.elapsed_ms, (unsigned)st.chunks_written,
+           (unsigned long long)st.bytes_written, (unsigned)st.throughput_kbps, (unsigned)st.write_kbps,
+           (unsigned)st.busy_ms);
+    for (size_t i = 0; i < st.recorders.size(); ++i) {
+        const RecorderLagStats& r = st.recorders[i];
+        printf("%s{\"slot\":%d,\"chunks\":%u,\"kb\":%u,\"queued\":%u,\"lag_ms\":%u,\"max_lag_ms\":%u,"
+               "\"deferrals\":%u,\"unwritten_kb\":%u}",
+               i ? "," : "", r.slot, (unsigned)r.chunks_written, (unsigned)(r.bytes_written / 1024),
+               (unsigned)r.queued_chunks, (unsigned)r.lag_ms, (unsigned)r.max_lag_ms, (unsigned)r.deferrals,
+               (unsigned)(r.unwritten_bytes / 1024));
+    }
+    printf("]}\n");
+    fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> urls;
+    uint32_t seconds = 20;
+    uint32_t report_sec = 5;
+    uint32_t switch_sec = 0;
+    int play = -1;
+    bool psram = false;
+    RecordingHubConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--report-sec") && i + 1 < argc) {
+            report_sec = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--switch-sec") && i + 1 < argc) {
+            switch_sec = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--play") && i + 1 < argc) {
+            play = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--psram-budget-kb") && i + 1 < argc) {
+            cfg.psram_budget_bytes = (size_t)atoi(argv[++i]) * 1024;
+        } else if (!strcmp(argv[i], "--sd-budget-mb") && i + 1 < argc) {
+            cfg.sd_budget_bytes = (size_t)atoi(argv[++i]) * 1024 * 1024;
+        } else if (!strcmp(argv[i], "--psram")) {
+            psram = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            urls.push_back(argv[i]);
+        }
+    }
+    if (urls.empty() || play >= (int)urls.size() || report_sec == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    host::serial_to_stderr(true);
+    host::i2s_sink_set_realtime(true);
+    SD_MMC.begin();
+
+    cfg.max_recorders = (uint8_t)urls.size();
+    RecordingHub hub(cfg);
+    if (!hub.begin()) {
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<TimeshiftManager>> recorders;
+    for (const std::string& url : urls) {
+        std::unique_ptr<TimeshiftManager> rec(new TimeshiftManager());
+        rec->setStorageMode(psram ? StorageMode::PSRAM_ONLY : StorageMode::SD_CARD);
+        if (!rec->set_recording_hub(&hub) || !rec->open(url.c_str()) || !rec->start()) {
+            fprintf(stderr, "cannot record %s\n", url.c_str());
+            return 1;
+        }
+        recorders.push_back(std::move(rec));
+    }
+
+    AudioPlayer player;
+    int playing = -1;
+    uint32_t switches = 0;
+    uint32_t first_audio_max = 0;
+    auto play_recorder = [&](int index) {
+        uint32_t t0 = millis();
+        player.stop();
+        while (recorders[index]->playable_bytes() == 0 && millis() - t0 < 10000) {
+            delay(5);
+        }
+        player.select_source(RecordingHub::make_reader(*recorders[index]));
+        if (!player.arm_source()) {
+            return false;
+        }
+        player.start();
+        while (player.first_audio_at_ms() == 0 && millis() - t0 < 10000) {
+            delay(2);
+        }
+        uint32_t first_audio = player.first_audio_at_ms() ? player.first_audio_at_ms() - t0 : 0;
+        fprintf(stderr, "playing recorder %d, first audio after %u ms\n", index, (unsigned)first_audio);
+        if (first_audio == 0) {
+            return false;
+        }
+        first_audio_max = std::max(first_audio_max, first_audio);
+        playing = index;
+        return true;
+    };
+
+    bool ok = true;
+    const uint32_t start_ms = millis();
+    uint32_t next_report = start_ms + report_sec * 1000;
+    uint32_t next_switch = start_ms + switch_sec * 1000;
+    if (play >= 0 && !play_recorder(play)) {
+        ok = false;
+    }
+    while (ok && millis() - start_ms < seconds * 1000) {
+        delay(20);
+        player.tick_housekeeping();
+        uint32_t now = millis();
+        if ((int32_t)(now - next_report) >= 0) {
+            print_report(hub.stats(), false);
+            next_report += report_sec * 1000;
+        }
+        if (playing >= 0 && switch_sec > 0 && (int32_t)(now - next_switch) >= 0) {
+            if (!play_recorder((playing + 1) % (int)recorders.size())) {
+                ok = false;
+            }
+            switches++;
+            next_switch = millis() + switch_sec * 1000;
+        }
+    }
+
+    player.stop();
+    RecordingHubStats st = hub.stats();
+    for (auto& rec : recorders) {
+        rec->stop();
+    }
+    recorders.clear();
+    hub.end();
+
+    print_report(st, true);
+    host::HeapStats heap = host::heap_stats();
+    printf("{\"playback\":%s,\"switches\":%u,\"first_audio_max_ms\":%u,\"underruns\":%u,\"peak_psram\":%u}\n",
+           playing >= 0 ? "true" : "false", (unsigned)switches, (unsigned)first_audio_max,
+           (unsigned)player.ring_underruns(), (unsigned)heap.psram_peak);
+    for (const RecorderLagStats& r : st.recorders) {
+        if (r.chunks_written == 0) {
+            ok = false; // Una registrazione senza chunk READY: il writer non l'ha servita
+        }
+    }
+    return ok ? 0 : 1;
+}
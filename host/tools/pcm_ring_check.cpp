@@ -0,0 +1,301 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Verifica host di PcmRingBuffer (src/pcm_ring_buffer.h): scritture e letture a cavallo del
+// bordo, isteresi dei watermark lato producer e consumer, discard_all(), conteggio degli
+// underrun e un giro producer/consumer su due thread con verifica del contenuto. Stampa una
+// riga JSON per caso; exit code 1 se un controllo fallisce.
+//
+//   openespaudio_pcm_ring_check [--capacity BYTES] [--rounds N]
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+#include "pcm_ring_buffer.h"
+
+namespace {
+
+struct CaseResult {
+    const char* name = "";
+    uint32_t checks = 0;
+    uint32_t failures = 0;
+    uint64_t bytes = 0;
+};
+
+void check(CaseResult& r, bool ok, const char* what) {
+    r.checks++;
+    if (!ok) {
+        r.failures++;
+        fprintf(stderr, "%s: FAIL %s\n", r.name, what);
+    }
+}
+
+// Byte i-esimo di una sequenza pseudo-casuale: ogni posizione dello stream ha un valore noto
+uint8_t pattern(uint64_t i) {
+    uint32_t x = (uint32_t)(i * 2654435761u) ^ (uint32_t)(i >> 32);
+    return (uint8_t)(x >> 24);
+}
+
+void fill(std::vector<uint8_t>& buf, size_t n, uint64_t from) {
+    for (size_t i = 0; i < n; ++i) {
+        buf[i] = pattern(from + i);
+    }
+}
+
+bool matches(const std::vector<uint8_t>& buf, size_t n, uint64_t from) {
+    for (size_t i = 0; i < n; ++i) {
+        if (buf[i] != pattern(from + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Blocchi di dimensione dispari e diversa tra i due lati: write_pos_ e read_pos_ attraversano
+// il bordo in tutti i punti, anche con la copia spezzata in due memcpy
+CaseResult run_wrap(size_t capacity, uint32_t rounds) {
+    CaseResult r;
+    r.name = "wrap";
+    PcmRingBuffer ring;
+    check(r, ring.allocate(capacity + 3, MALLOC_CAP_8BIT), "allocate");
+    check(r, ring.capacity() == capacity, "capacity rounded down to 4 bytes");
+
+    std::vector<uint8_t> in(capacity);
+    std::vector<uint8_t> out(capacity);
+    uint64_t written = 0;
+    uint64_t read = 0;
+    const size_t write_sizes[] = {capacity / 3 + 1, capacity / 16 + 5, capacity - 4, 13};
+    const size_t read_sizes[] = {capacity / 23 + 7, capacity / 2 + 5, 4, capacity};
+    for (uint32_t i = 0; i < rounds && r.failures == 0; ++i) {
+        size_t want = write_sizes[i % 4];
+        size_t expect = std::min(want, ring.free_bytes());
+        fill(in, want, written);
+        size_t w = ring.write(in.data(), want);
+        check(r, w == expect, "write clamped to free space");
+        written += w;
+        check(r, ring.used_bytes() == written - read, "used after write");
+
+        want = read_sizes[(i / 2) % 4];
+        expect = std::min(want, ring.used_bytes());
+        size_t got = ring.read(out.data(), want);
+        check(r, got == expect, "read clamped to available");
+        check(r, matches(out, got, read), "read content");
+        read += got;
+        check(r, ring.free_bytes() == capacity - (written - read), "free after read");
+    }
+    // Ring pieno esattamente: nessuna scrittura in più, poi svuotato tutto in un colpo
+    fill(in, capacity, written);
+    written += ring.write(in.data(), capacity);
+    check(r, ring.free_bytes() == 0, "ring full");
+    check(r, ring.write(in.data(), 4) == 0, "write on full ring");
+    size_t got = ring.read(out.data(), capacity);
+    check(r, got == written - read && matches(out, got, read), "drain full ring");
+    read += got;
+    check(r, ring.read(out.data(), 4) == 0, "read on empty ring");
+    r.bytes = read;
+    return r;
+}
+
+// Producer: fermo quando manca un blocco, riparte solo con resume_free_bytes liberi.
+// Consumer: buffering fino a start_threshold, underrun (e di nuovo buffering) se il fill
+// scende sotto il minimo mentre il producer è attivo
+CaseResult run_watermarks(size_t capacity) {
+    CaseResult r;
+    r.name = "watermarks";
+    PcmRingBuffer ring;
+    check(r, ring.allocate(capacity, MALLOC_CAP_8BIT), "allocate");
+    const size_t block = capacity / 8;
+    const size_t start = capacity / 2;
+    const size_t resume = capacity / 4;
+    ring.configure_watermarks(start, resume);
+    check(r, ring.start_threshold() == start && ring.resume_free_bytes() == resume, "watermarks stored");
+
+    std::vector<uint8_t> buf(capacity);
+    fill(buf, capacity, 0);
+
+    // --- Consumer in prefill: nessun dato fino alla soglia, senza contare underrun ---
+    ring.write(buf.data(), start - 4);
+    check(r, !ring.consumer_has_data(block, false), "buffering below start threshold");
+    check(r, ring.underruns() == 0, "prefill is not an underrun");
+    ring.write(buf.data(), 4);
+    check(r, ring.consumer_has_data(block, false), "start threshold reached");
+    // Sotto la soglia ma sopra il minimo: il consumer è partito e continua
+    ring.read(buf.data(), start - block);
+    check(r, ring.consumer_has_data(block, false), "playing below start threshold");
+
+    // --- Underrun: fill sotto il minimo con producer attivo ---
+    ring.read(buf.data(), 4);
+    check(r, !ring.consumer_has_data(block, false), "underrun below min bytes");
+    check(r, ring.underruns() == 1, "underrun counted");
+    ring.write(buf.data(), block);
+    check(r, !ring.consumer_has_data(block, false), "rebuffering after underrun");
+    check(r, ring.underruns() == 1, "rebuffering is not a second underrun");
+    ring.write(buf.data(), start - ring.used_bytes());
+    check(r, ring.consumer_has_data(block, false), "resume after refill");
+
+    // --- Producer finito: si consuma anche sotto soglia, il vuoto non è un underrun ---
+    ring.discard_all();
+    ring.rearm_consumer();
+    ring.write(buf.data(), block);
+    check(r, ring.consumer_has_data(block, true), "producer done skips prefill");
+    ring.read(buf.data(), block);
+    check(r, !ring.consumer_has_data(block, true), "empty after producer done");
+    check(r, ring.underruns() == 1, "end of stream is not an underrun");
+    ring.rearm_consumer();
+    check(r, !ring.consumer_has_data(block, false) && ring.underruns() == 1, "rearm is not an underrun");
+
+    // --- Producer: latch sotto un blocco, ripresa a resume_free_bytes ---
+    ring.discard_all();
+    ring.write(buf.data(), capacity - block);
+    check(r, ring.producer_has_room(block), "room for last block");
+    ring.write(buf.data(), block);
+    check(r, !ring.producer_has_room(block), "blocked on full ring");
+    ring.read(buf.data(), block);
+    check(r, ring.free_bytes() >= block && !ring.producer_has_room(block), "still blocked below resume");
+    ring.set_producer_waiting(true);
+    check(r, !ring.consumer_should_wake_producer(), "no wake below resume");
+    ring.read(buf.data(), resume - block);
+    check(r, ring.consumer_should_wake_producer(), "wake at resume");
+    check(r, !ring.consumer_should_wake_producer(), "wake only once");
+    check(r, ring.producer_has_room(block), "unblocked at resume");
+    ring.write(buf.data(), resume - block);
+    check(r, ring.producer_has_room(block), "no latch while a block fits");
+
+    // Soglie oltre la capacità: limitate alla capacità
+    ring.configure_watermarks(capacity * 2, capacity * 2);
+    check(r, ring.start_threshold() == capacity && ring.resume_free_bytes() == capacity, "watermarks clamped");
+
+    ring.reset();
+    check(r, ring.used_bytes() == 0 && ring.underruns() == 0, "reset clears fill and underruns");
+    return r;
+}
+
+// Flush per seek: scarta il contenuto anche a cavallo del bordo, la scrittura successiva
+// riparte coerente dalla stessa posizione
+CaseResult run_discard(size_t capacity) {
+    CaseResult r;
+    r.name = "discard";
+    PcmRingBuffer ring;
+    check(r, ring.allocate(capacity, MALLOC_CAP_8BIT), "allocate");
+    std::vector<uint8_t> in(capacity);
+    std::vector<uint8_t> out(capacity);
+
+    check(r, ring.discard_all() == 0, "discard on empty ring");
+    fill(in, capacity, 0);
+    ring.write(in.data(), capacity * 3 / 4);
+    ring.read(out.data(), capacity / 2);
+    ring.write(in.data(), capacity / 2);      // Attraversa il bordo
+    const size_t pending = ring.used_bytes();
+    check(r, ring.discard_all() == pending, "discard returns pending bytes");
+    check(r, ring.used_bytes() == 0 && ring.free_bytes() == capacity, "ring empty after discard");
+
+    fill(in, capacity, 1000);
+    check(r, ring.write(in.data(), capacity) == capacity, "full write after discard");
+    check(r, ring.read(out.data(), capacity) == capacity && matches(out, capacity, 1000), "content after discard");
+    r.bytes = pending;
+
+    ring.release();
+    check(r, !ring.allocated() && ring.discard_all() == 0 && ring.write(in.data(), 4) == 0, "released ring");
+    return r;
+}
+
+// Decode e output task veri: i due lati su thread diversi, con le stesse attese a watermark
+// del player. Il consumer verifica ogni byte contro la sequenza
+CaseResult run_spsc(size_t capacity, uint64_t total) {
+    CaseResult r;
+    r.name = "spsc";
+    PcmRingBuffer ring;
+    check(r, ring.allocate(capacity, MALLOC_CAP_8BIT), "allocate");
+    const size_t block = capacity / 8;
+    ring.configure_watermarks(capacity / 2, capacity / 4);
+
+    std::atomic<bool> producer_done{false};
+    std::thread producer([&]() {
+        std::vector<uint8_t> in(block);
+        uint64_t written = 0;
+        while (written < total) {
+            if (!ring.producer_has_room(block)) {
+                std::this_thread::yield();
+                continue;
+            }
+            size_t n = (size_t)std::min<uint64_t>(block - (written % 7) * 4, total - written);
+            fill(in, n, written);
+            written += ring.write(in.data(), n);
+        }
+        producer_done.store(true);
+    });
+
+    std::vector<uint8_t> out(block);
+    uint64_t read = 0;
+    bool content_ok = true;
+    while (read < total) {
+        bool done = producer_done.load();
+        if (!ring.consumer_has_data(4, done)) {
+            std::this_thread::yield();
+            continue;
+        }
+        size_t got = ring.read(out.data(), block - (read % 5) * 4);
+        content_ok = content_ok && matches(out, got, read);
+        read += got;
+    }
+    producer.join();
+    check(r, content_ok, "content across threads");
+    check(r, read == total && ring.used_bytes() == 0, "all bytes delivered");
+    r.bytes = read;
+    return r;
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--capacity BYTES] [--rounds N]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t capacity = 16384;
+    uint32_t rounds = 10000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--capacity") && i + 1 < argc) {
+            capacity = (size_t)strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) {
+            rounds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    capacity &= ~(size_t)3;
+    if (capacity < 256 || rounds == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    openespaudio::set_log_level(openespaudio::LogLevel::WARN);
+
+    const CaseResult results[] = {
+        run_wrap(capacity, rounds),
+        run_watermarks(capacity),
+        run_discard(capacity),
+        run_spsc(capacity, (uint64_t)rounds * capacity / 4),
+    };
+    int failures = 0;
+    for (const CaseResult& r : results) {
+        if (r.failures) {
+            ++failures;
+        }
+        printf("{\"case\":\"%s\",\"capacity\":%u,\"checks\":%u,\"failures\":%u,\"bytes\":%llu,\"pass\":%s}\n",
+               r.name, (unsigned)capacity, (unsigned)r.checks, (unsigned)r.failures,
+               (unsigned long long)r.bytes, r.failures ? "false" : "true");
+    }
+    return failures ? 1 : 0;
+}
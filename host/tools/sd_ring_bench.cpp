@@ -0,0 +1,253 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Benchmark host dello storage SD del timeshift: confronta lo schema storico a un file per
+// chunk (open/write/close, riapertura per validare la dimensione, rename pending→ready,
+// remove al cleanup) con il file ring preallocato di SdChunkRing (seek + write, indice in
+// memoria). Per entrambi registra N chunk con una finestra di W chunk, rilegge ogni chunk
+// come farebbe il preload e verifica il contenuto. Stampa una riga JSON per schema;
+// exit code 1 se una rilettura non coincide.
+//
+// Il filesystem host (page cache, nessuna FAT) non modella il costo reale di create,
+// rename e unlink su SD: i tempi vanno letti come limite inferiore, il dato che conta è
+// meta_ops (operazioni di directory/FAT per chunk), che sulla scheda domina la latenza.
+//
+//   openespaudio_sd_ring_bench [--dir PATH] [--chunks N] [--chunk-kb N] [--window N]
+
+#include <Arduino.h>
+#include <SD_MMC.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "host_runtime.h"
+#include "logger.h"
+#include "sd_chunk_ring.h"
+
+namespace {
+
+constexpr const char* kBenchRoot = "/sdbench";
+constexpr const char* kRingPath = "/sdbench/ring.bin";
+
+struct BenchResult {
+    const char* scheme = "";
+    uint32_t chunks = 0;
+    double write_mean_us = 0.0;
+    uint32_t write_p99_us = 0;
+    uint32_t write_max_us = 0;
+    double read_mean_us = 0.0;
+    double evict_mean_us = 0.0;
+    double meta_ops_per_chunk = 0.0;   // create/open/close/rename/remove per chunk
+    uint32_t total_ms = 0;
+    uint32_t mismatches = 0;
+};
+
+void fill_chunk(std::vector<uint8_t>& buf, uint32_t id) {
+    uint32_t state = id * 2654435761u + 1;
+    for (size_t i = 0; i < buf.size(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        buf[i] = (uint8_t)(state >> 24);
+    }
+}
+
+void summarize(std::vector<uint32_t>& write_us, uint64_t read_us, uint32_t reads, uint64_t evict_us,
+               uint32_t evicts, uint64_t meta_ops, BenchResult& r) {
+    r.chunks = (uint32_t)write_us.size();
+    if (write_us.empty()) {
+        return;
+    }
+    uint64_t sum = 0;
+    for (uint32_t us : write_us) {
+        sum += us;
+    }
+    r.write_mean_us = (double)sum / write_us.size();
+    std::sort(write_us.begin(), write_us.end());
+    r.write_p99_us = write_us[std::min(write_us.size() - 1, write_us.size() * 99 / 100)];
+    r.write_max_us = write_us.back();
+    r.read_mean_us = reads ? (double)read_us / reads : 0.0;
+    r.evict_mean_us = evicts ? (double)evict_us / evicts : 0.0;
+    r.meta_ops_per_chunk = (double)meta_ops / write_us.size();
+}
+
+std::string chunk_path(const char* prefix, uint32_t id) {
+    return std::string(kBenchRoot) + "/" + prefix + std::to_string(id) + ".bin";
+}
+
+// Schema storico di TimeshiftManager in modalità SD_CARD
+bool run_per_file(uint32_t chunks, size_t chunk_bytes, uint32_t window, BenchResult& r) {
+    r = BenchResult();
+    r.scheme = "per_file";
+    std::vector<uint8_t> data(chunk_bytes), back(chunk_bytes);
+    std::vector<uint32_t> write_us;
+    std::deque<uint32_t> ready;
+    uint64_t read_us = 0, evict_us = 0, meta_ops = 0;
+    uint32_t reads = 0, evicts = 0;
+    const uint32_t start_ms = millis();
+
+    for (uint32_t id = 0; id < chunks; ++id) {
+        fill_chunk(data, id);
+        const std::string pending = chunk_path("pending_", id);
+        const std::string ready_name = chunk_path("ready_", id);
+
+        uint32_t t0 = micros();
+        File file = SD_MMC.open(pending.c_str(), FILE_WRITE);
+        bool ok = file && file.write(data.data(), chunk_bytes) == chunk_bytes;
+        file.close();
+        File check = SD_MMC.open(pending.c_str(), FILE_READ);
+        ok = ok && check && check.size() == chunk_bytes;
+        check.close();
+        if (SD_MMC.exists(ready_name.c_str())) {
+            SD_MMC.remove(ready_name.c_str());
+        }
+        ok = ok && SD_MMC.rename(pending.c_str(), ready_name.c_str());
+        write_us.push_back(micros() - t0);
+        meta_ops += 6;   // create, close, open, close, exists, rename
+        if (!ok) {
+            ++r.mismatches;
+            continue;
+        }
+        ready.push_back(id);
+
+        // Preload: riapre il chunk e lo rilegge intero
+        t0 = micros();
+        File in = SD_MMC.open(ready_name.c_str(), FILE_READ);
+        size_t got = in ? in.read(back.data(), chunk_bytes) : 0;
+        in.close();
+        read_us += micros() - t0;
+        ++reads;
+        meta_ops += 2;
+        if (got != chunk_bytes || memcmp(back.data(), data.data(), chunk_bytes) != 0) {
+            ++r.mismatches;
+        }
+
+        while (ready.size() > window) {
+            t0 = micros();
+            SD_MMC.remove(chunk_path("ready_", ready.front()).c_str());
+            evict_us += micros() - t0;
+            ++evicts;
+            ++meta_ops;
+            ready.pop_front();
+        }
+    }
+    for (uint32_t id : ready) {
+        SD_MMC.remove(chunk_path("ready_", id).c_str());
+    }
+    r.total_ms = millis() - start_ms;
+    summarize(write_us, read_us, reads, evict_us, evicts, meta_ops, r);
+    return r.mismatches == 0;
+}
+
+bool run_ring(uint32_t chunks, size_t chunk_bytes, uint32_t window, BenchResult& r) {
+    r = BenchResult();
+    r.scheme = "ring";
+    // Preallocazione fuori dal tempo misurato: sul device avviene una volta per scheda
+    SdChunkRing ring;
+    if (!ring.open(SD_MMC, kRingPath, (window + 2) * SdChunkRing::span_for(chunk_bytes))) {
+        return false;
+    }
+    std::vector<uint8_t> data(chunk_bytes), back(chunk_bytes);
+    std::vector<uint32_t> write_us;
+    std::deque<uint32_t> ready;   // Offset delle regioni, dal più vecchio
+    uint64_t read_us = 0, evict_us = 0;
+    uint32_t reads = 0, evicts = 0;
+    const uint32_t start_ms = millis();
+
+    for (uint32_t id = 0; id < chunks; ++id) {
+        fill_chunk(data, id);
+
+        uint32_t t0 = micros();
+        while (!ready.empty() && (ready.size() >= window || !ring.fits(chunk_bytes))) {
+            const uint32_t e0 = micros();
+            ring.release(ready.front());
+            evict_us += micros() - e0;
+            ++evicts;
+            ready.pop_front();
+        }
+        uint32_t offset = 0;
+        bool ok = ring.reserve(chunk_bytes, offset) && ring.write(offset, data.data(), chunk_bytes);
+        write_us.push_back(micros() - t0);
+        if (!ok) {
+            ++r.mismatches;
+            continue;
+        }
+        ready.push_back(offset);
+
+        t0 = micros();
+        ok = ring.read(offset, back.data(), chunk_bytes);
+        read_us += micros() - t0;
+        ++reads;
+        if (!ok || memcmp(back.data(), data.data(), chunk_bytes) != 0) {
+            ++r.mismatches;
+        }
+    }
+    r.total_ms = millis() - start_ms;
+    ring.close();
+    summarize(write_us, read_us, reads, evict_us, evicts, 0, r);
+    return r.mismatches == 0;
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--dir PATH] [--chunks N] [--chunk-kb N] [--window N]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* dir = nullptr;
+    uint32_t chunks = 400;
+    size_t chunk_kb = 128;
+    uint32_t window = 32;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--dir") && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (!strcmp(argv[i], "--chunks") && i + 1 < argc) {
+            chunks = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--chunk-kb") && i + 1 < argc) {
+            chunk_kb = (size_t)strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--window") && i + 1 < argc) {
+            window = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (chunks == 0 || chunk_kb == 0 || window == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    openespaudio::set_log_level(openespaudio::LogLevel::WARN);
+    if (dir) {
+        SD_MMC.set_host_root(dir);
+    }
+    if (!SD_MMC.begin() || (!SD_MMC.exists(kBenchRoot) && !SD_MMC.mkdir(kBenchRoot))) {
+        fprintf(stderr, "cannot prepare %s under %s\n", kBenchRoot, SD_MMC.host_root().c_str());
+        return 1;
+    }
+
+    int failures = 0;
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        BenchResult r;
+        bool ok = scheme == 0 ? run_per_file(chunks, chunk_kb * 1024, window, r)
+                              : run_ring(chunks, chunk_kb * 1024, window, r);
+        if (!ok) {
+            ++failures;
+        }
+        printf("{\"scheme\":\"%s\",\"chunks\":%u,\"chunk_kb\":%u,\"window\":%u,\"write_mean_us\":%.1f,"
+               "\"write_p99_us\":%u,\"write_max_us\":%u,\"read_mean_us\":%.1f,\"evict_mean_us\":%.1f,"
+               "\"meta_ops_per_chunk\":%.1f,\"total_ms\":%u,\"mismatches\":%u}\n",
+               r.scheme, (unsigned)r.chunks, (unsigned)chunk_kb, (unsigned)window, r.write_mean_us,
+               (unsigned)r.write_p99_us, (unsigned)r.write_max_us, r.read_mean_us, r.evict_mean_us,
+               r.meta_ops_per_chunk, (unsigned)r.total_ms, (unsigned)r.mismatches);
+        fflush(stdout);
+    }
+    SD_MMC.remove(kRingPath);
+    SD_MMC.rmdir(kBenchRoot);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+// Cambio stazione host: StationPresetManager su due o più URL (file://path?kbps=N simula
+// una radio live), next() ogni --dwell-sec secondi con il sink I2S in tempo reale. Per ogni
+// cambio stampa una riga JSON con stazione, warm/cold, pre-roll consegnato, tempo fino al
+// player avviato e al primo campione su I2S, underrun nella permanenza; in fondo una riga
+// di riepilogo. --cold (nessuno standby) dà il riferimento del percorso senza standby.
+//
+//   openespaudio_station_switch <url> <url> [<url>...] [--dwell-sec S] [--rounds N]
+//                               [--neighbors K] [--sockets N] [--preroll-kb KB]
+//                               [--budget-kb KB] [--psram] [--cold]
+
+#include <Arduino.h>
+#include <SD_MMC.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "audio_player.h"
+#include "host_runtime.h"
+#include "station_preset_manager.h"
+#include "timeshift_manager.h"
+
+namespace {
+
+constexpr uint32_t kFirstAudioTimeoutMs = 15000;
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s <url> <url> [<url>...] [--dwell-sec S] [--rounds N]\n"
+            "          [--neighbors K] [--sockets N] [--preroll-kb KB] [--budget-kb KB] [--psram] [--cold]\n",
+            argv0);
+}
+
+struct Summary {
+    uint32_t count = 0;
+    uint64_t first_audio_sum = 0;
+    uint32_t first_audio_max = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> urls;
+    uint32_t dwell_sec = 4;
+    uint32_t rounds = 2;
+    bool psram = false;
+    StationStandbyConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--dwell-sec") && i + 1 < argc) {
+            dwell_sec = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) {
+            rounds = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--neighbors") && i + 1 < argc) {
+            cfg.neighbors = (uint8_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--sockets") && i + 1 < argc) {
+            cfg.max_sockets = (uint8_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--preroll-kb") && i + 1 < argc) {
+            cfg.preroll_bytes = (size_t)atoi(argv[++i]) * 1024;
+        } else if (!strcmp(argv[i], "--budget-kb") && i + 1 < argc) {
+            cfg.memory_budget_bytes = (size_t)atoi(argv[++i]) * 1024;
+        } else if (!strcmp(argv[i], "--psram")) {
+            psram = true;
+        } else if (!strcmp(argv[i], "--cold")) {
+            cfg.max_sockets = 0;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            urls.push_back(argv[i]);
+        }
+    }
+    if (urls.size() < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    host::serial_to_stderr(true);
+    host::i2s_sink_set_realtime(true);
+    SD_MMC.begin();
+
+    AudioPlayer player;
+    StationPresetManager stations(player, cfg);
+    for (size_t i = 0; i < urls.size(); ++i) {
+        std::string name = "station" + std::to_string(i);
+        stations.add_preset(name.c_str(), urls[i].c_str());
+    }
+    stations.set_timeshift_setup([psram](TimeshiftManager& ts) {
+        if (psram) {
+            ts.setStorageMode(StorageMode::PSRAM_ONLY);
+        }
+    });
+    if (!stations.begin()) {
+        return 1;
+    }
+    // Prima stazione: il tempo di scaldare gli standby iniziali
+    delay(dwell_sec * 1000);
+
+    Summary warm;
+    Summary cold;
+    bool ok = true;
+    const uint32_t switches = rounds * (uint32_t)urls.size();
+    for (uint32_t n = 0; n < switches; ++n) {
+        if (!stations.next()) {
+            fprintf(stderr, "switch %u failed\n", (unsigned)n);
+            ok = false;
+            break;
+        }
+        uint32_t switch_ms = millis();
+        StationSwitchStats st = stations.switch_stats();
+        while (st.last_first_audio_ms == 0 && millis() - switch_ms < kFirstAudioTimeoutMs) {
+            delay(2);
+            st = stations.switch_stats();
+        }
+        while (millis() - switch_ms < dwell_sec * 1000) {
+            delay(20);
+            player.tick_housekeeping();
+        }
+
+        printf("{\"switch\":%u,\"station\":%d,\"warm\":%s,\"preroll_bytes\":%u,\"ready_ms\":%u,"
+               "\"first_audio_ms\":%u,\"underruns\":%u,\"standby_kb\":%u,\"warm_standbys\":%u}\n",
+               (unsigned)n, stations.current_index(), st.last_warm ? "true" : "false",
+               (unsigned)st.last_preroll_bytes, (unsigned)st.last_ready_ms, (unsigned)st.last_first_audio_ms,
+               (unsigned)player.ring_underruns(), (unsigned)(stations.standby_memory_bytes() / 1024),
+               (unsigned)stations.warm_count());
+        fflush(stdout);
+        if (st.last_first_audio_ms == 0) {
+            ok = false;
+            continue;
+        }
+        Summary& s = st.last_warm ? warm : cold;
+        s.count++;
+        s.first_audio_sum += st.last_first_audio_ms;
+        s.first_audio_max = std::max(s.first_audio_max, st.last_first_audio_ms);
+    }
+
+    player.stop();
+    stations.end();
+
+    StationSwitchStats st = stations.switch_stats();
+    host::HeapStats heap = host::heap_stats();
+    printf("{\"summary\":true,\"switches\":%u,\"warm\":%u,\"warm_first_audio_avg_ms\":%u,"
+           "\"warm_first_audio_max_ms\":%u,\"cold\":%u,\"cold_first_audio_avg_ms\":%u,"
+           "\"cold_first_audio_max_ms\":%u,\"standby_connects\":%u,\"standby_failures\":%u,"
+           "\"peak_psram\":%u}\n",
+           (unsigned)st.switches, (unsigned)warm.count,
+           warm.count ? (unsigned)(warm.first_audio_sum / warm.count) : 0u, (unsigned)warm.first_audio_max,
+           (unsigned)cold.count, cold.count ? (unsigned)(cold.first_audio_sum / cold.count) : 0u,
+           (unsigned)cold.first_audio_max, (unsigned)st.standby_connects, (unsigned)st.standby_failures,
+           (unsigned)heap.psram_peak);
+    return ok ? 0 : 1;
+}
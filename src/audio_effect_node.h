@@ -0,0 +1,60 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Blocco audio planare float passato ai nodi effetto. left/right puntano allo scratch
+// della EffectsChain (max_block_frames ciascuno); con sorgente mono right è una copia
+// di left e in uscita viene usato solo left.
+struct AudioBlock {
+    float* left;
+    float* right;
+    size_t frames;
+    uint32_t channels;        // Canali del PCM sorgente (1 o 2)
+    uint32_t sample_rate;
+};
+
+// Statistiche CPU per nodo, aggiornate dal task audio (lettura best-effort dagli altri task)
+struct EffectNodeStats {
+    const char* name;
+    bool enabled;
+    uint32_t blocks;          // Chiamate a process()
+    uint64_t frames;
+    uint64_t total_us;
+    uint32_t last_us;
+    uint32_t max_us;
+};
+
+// Nodo della EffectsChain. Ogni nodo possiede il proprio stato (filtri, delay line).
+//  - prepare(): alloca per sample rate / blocco massimo; chiamato fuori dal task audio
+//    (configure() della catena o insertEffect()).
+//  - process(): elabora il blocco in-place nel task audio; non deve allocare né bloccare.
+//  - reset(): azzera lo stato; la catena lo chiama dal task audio quando il nodo passa
+//    da disabilitato ad abilitato, così un nodo riattivato non riproduce code vecchie.
+class IAudioEffect {
+public:
+    virtual ~IAudioEffect() = default;
+
+    virtual const char* name() const = 0;
+    virtual bool prepare(uint32_t sample_rate, size_t max_block_frames) = 0;
+    virtual void process(AudioBlock& block) = 0;
+    virtual void reset() = 0;
+
+    void setEnabled(bool enabled) { enabled_.store(enabled); }
+    bool isEnabled() const { return enabled_.load(); }
+
+private:
+    friend class EffectsChain;
+
+    std::atomic<bool> enabled_{false};
+
+    // Gestiti dalla EffectsChain
+    bool prepared_ = false;   // prepare() riuscita per la configurazione corrente
+    bool running_ = false;    // Abilitato nel blocco precedente (solo task audio)
+    EffectNodeStats stats_ = {};
+};
@@ -5,131 +5,469 @@
 #include "audio_effects.h"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include "logger.h"
 
-EffectsChain::EffectsChain() {
-    updateDelayBufferSize();
+namespace {
+
+float* alloc_floats(size_t count, uint32_t caps) {
+    float* p = static_cast<float*>(heap_caps_malloc(count * sizeof(float), caps));
+    if (!p) {
+        p = static_cast<float*>(heap_caps_malloc(count * sizeof(float), MALLOC_CAP_8BIT));
+    }
+    return p;
 }
 
-EffectsChain::~EffectsChain() = default;
+void free_floats(float*& p) {
+    if (p) {
+        heap_caps_free(p);
+        p = nullptr;
+    }
+}
 
-void EffectsChain::setSampleRate(uint32_t sample_rate) {
-    if (sample_rate_ != sample_rate) {
+class EditLock {
+public:
+    explicit EditLock(SemaphoreHandle_t mutex) : mutex_(mutex) {
+        if (mutex_) xSemaphoreTake(mutex_, portMAX_DELAY);
+    }
+    ~EditLock() {
+        if (mutex_) xSemaphoreGive(mutex_);
+    }
+private:
+    SemaphoreHandle_t mutex_;
+};
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// EchoEffect
+
+EchoEffect::~EchoEffect() {
+    free_floats(line_l_);
+    free_floats(line_r_);
+}
+
+bool EchoEffect::prepare(uint32_t sample_rate, size_t max_block_frames) {
+    (void)max_block_frames;
+    if (sample_rate == 0) {
+        return false;
+    }
+    // Allocate buffer for maximum delay (1 second)
+    if (sample_rate != sample_rate_ || !line_l_ || !line_r_) {
+        free_floats(line_l_);
+        free_floats(line_r_);
+        line_size_ = 0;
+        sample_rate_ = 0;
+        line_l_ = alloc_floats(sample_rate, MALLOC_CAP_SPIRAM);
+        line_r_ = alloc_floats(sample_rate, MALLOC_CAP_SPIRAM);
+        if (!line_l_ || !line_r_) {
+            LOG_ERROR("EchoEffect: cannot allocate delay line (%u frames)", (unsigned)sample_rate);
+            free_floats(line_l_);
+            free_floats(line_r_);
+            return false;
+        }
+        line_size_ = sample_rate;
         sample_rate_ = sample_rate;
-        // Reset filter states when sample rate changes
-        bass_filter_state_[0] = bass_filter_state_[1] = 0.0f;
-        treble_filter_state_[0] = treble_filter_state_[1] = 0.0f;
-        updateDelayBufferSize();
     }
+    reset();
+    return true;
+}
+
+void EchoEffect::reset() {
+    write_pos_ = 0;
+    valid_frames_ = 0;
+}
+
+void EchoEffect::process(AudioBlock& block) {
+    // Simple echo with single delay
+    const size_t size = line_size_;
+    size_t delay_samples = static_cast<size_t>(params_.delay_ms * sample_rate_ / 1000.0f);
+    if (delay_samples >= size) delay_samples = size - 1;
+    const float decay = params_.decay;
+    const float mix = params_.mix;
+    float* left = block.left;
+    float* right = block.right;
+    const size_t frames = block.frames;
+    float* dl = line_l_;
+    float* dr = line_r_;
+    size_t pos = write_pos_;
+
+    // Distanza effettiva del tap (0 rilegge lo slot scritto size frame fa) e quanti frame
+    // iniziali del blocco cadono prima dell'ultimo reset(): per quelli l'eco è silenzio
+    const size_t back = delay_samples ? delay_samples : size;
+    const size_t silent = valid_frames_ >= back ? 0 : std::min(frames, back - valid_frames_);
+
+    for (size_t i = 0; i < frames; ++i) {
+        size_t p = (pos >= delay_samples) ? pos - delay_samples : pos + size - delay_samples;
+        float echo_l = i < silent ? 0.0f : dl[p] * decay;
+        float echo_r = i < silent ? 0.0f : dr[p] * decay;
+
+        // Mix dry and echo
+        float l = left[i] * (1.0f - mix) + echo_l * mix;
+        float r = right[i] * (1.0f - mix) + echo_r * mix;
+        left[i] = l;
+        right[i] = r;
+
+        // Store current sample in delay buffer
+        dl[pos] = l;
+        dr[pos] = r;
+        if (++pos == size) pos = 0;
+    }
+    write_pos_ = pos;
+    valid_frames_ = std::min(size, valid_frames_ + frames);
 }
 
-void EffectsChain::process(int16_t* buffer, size_t samples) {
-    if (!eq_enabled_ && !reverb_enabled_ && !echo_enabled_) {
-        return; // No effects enabled
+// ---------------------------------------------------------------------------
+// EffectsChain
+
+EffectsChain::EffectsChain() {
+    edit_mutex_ = xSemaphoreCreateMutex();
+    setEQParams(eq_params_);
+    limiter_.setEnabled(true);
+    NodeList& list = lists_[0];
+    list.nodes[0] = &eq_;
+    list.nodes[1] = &reverb_;
+    list.nodes[2] = &echo_;
+    list.count = 3;
+    configure(sample_rate_, kDefaultMaxBlockFrames);
+}
+
+EffectsChain::~EffectsChain() {
+    releaseBuffers();
+    if (edit_mutex_) {
+        vSemaphoreDelete(edit_mutex_);
+        edit_mutex_ = nullptr;
     }
+}
 
-    // Convert to float for processing
-    std::unique_ptr<float[]> float_buffer(new float[samples * 2]);
-    for (size_t i = 0; i < samples * 2; ++i) {
-        float_buffer[i] = buffer[i] / 32768.0f;
+void EffectsChain::setEQParams(const EQParams& params) {
+    eq_params_ = params;
+    const float gains[3] = {params.bass_gain, params.mid_gain, params.treble_gain};
+    EqBand bands[3];
+    bands[0].type = EqBandType::LOW_SHELF;
+    bands[0].freq_hz = 200.0f;
+    bands[1].type = EqBandType::PEAKING;
+    bands[1].freq_hz = 1000.0f;
+    bands[1].q = 0.5f;
+    bands[2].type = EqBandType::HIGH_SHELF;
+    bands[2].freq_hz = 4000.0f;
+    for (int i = 0; i < 3; ++i) {
+        bands[i].gain_db = gains[i] > 0.0f ? 20.0f * log10f(gains[i]) : -24.0f;
     }
+    eq_.setBands(bands, 3);
+}
 
-    // Process in order: EQ -> Reverb -> Echo
-    if (eq_enabled_) {
-        for (size_t i = 0; i < samples; ++i) {
-            applyEQ(&float_buffer[i * 2], &float_buffer[i * 2 + 1]);
-        }
+void EffectsChain::releaseBuffers() {
+    free_floats(scratch_l_);
+    free_floats(scratch_r_);
+    max_block_frames_ = 0;
+}
+
+bool EffectsChain::configure(uint32_t sample_rate, size_t max_block_frames) {
+    if (sample_rate == 0 || max_block_frames == 0) {
+        return false;
     }
+    EditLock lock(edit_mutex_);
+    sample_rate_ = sample_rate;
 
-    if (reverb_enabled_) {
-        for (size_t i = 0; i < samples; ++i) {
-            applyReverb(&float_buffer[i * 2], &float_buffer[i * 2 + 1]);
-        }
+    if (max_block_frames != max_block_frames_ && !allocateScratch(max_block_frames)) {
+        return false;
     }
 
-    if (echo_enabled_) {
-        for (size_t i = 0; i < samples; ++i) {
-            applyEcho(&float_buffer[i * 2], &float_buffer[i * 2 + 1]);
+    // I nodi predefiniti rimossi dal grafo restano pronti per un reinserimento
+    bool ok = true;
+    IAudioEffect* builtin[] = {&eq_, &reverb_, &echo_, &limiter_};
+    for (IAudioEffect* effect : builtin) {
+        ok = prepareNode(effect) && ok;
+    }
+    const NodeList& list = lists_[active_list_.load()];
+    for (size_t i = 0; i < list.count; ++i) {
+        IAudioEffect* effect = list.nodes[i];
+        if (effect != &eq_ && effect != &reverb_ && effect != &echo_) {
+            ok = prepareNode(effect) && ok;
         }
     }
+    return ok;
+}
 
-    // Convert back to int16
-    for (size_t i = 0; i < samples * 2; ++i) {
-        float val = float_buffer[i] * 32767.0f;
-        buffer[i] = std::max(-32768, std::min(32767, static_cast<int>(val)));
+void EffectsChain::setSampleRate(uint32_t sample_rate) {
+    configure(sample_rate, max_block_frames_ ? max_block_frames_ : kDefaultMaxBlockFrames);
+}
+
+bool EffectsChain::allocateScratch(size_t max_block_frames) {
+    free_floats(scratch_l_);
+    free_floats(scratch_r_);
+    max_block_frames_ = 0;
+
+    // Scratch letto/scritto più volte per blocco: RAM interna se c'è spazio
+    scratch_l_ = alloc_floats(max_block_frames, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    scratch_r_ = alloc_floats(max_block_frames, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!scratch_l_ || !scratch_r_) {
+        LOG_ERROR("EffectsChain: cannot allocate scratch (%u frames)", (unsigned)max_block_frames);
+        free_floats(scratch_l_);
+        free_floats(scratch_r_);
+        return false;
     }
+    max_block_frames_ = max_block_frames;
+    return true;
 }
 
-void EffectsChain::applyEQ(float* left, float* right) {
-    // Simple bass/treble EQ using basic IIR filters
-    // Bass boost (low shelf)
-    const float bass_alpha = 0.1f;
-    float bass_l = *left * eq_params_.bass_gain + bass_filter_state_[0] * (1.0f - bass_alpha);
-    bass_filter_state_[0] = bass_l * bass_alpha + bass_filter_state_[0] * (1.0f - bass_alpha);
+bool EffectsChain::prepareNode(IAudioEffect* effect) {
+    effect->prepared_ = effect->prepare(sample_rate_, max_block_frames_);
+    effect->running_ = false;
+    if (!effect->prepared_) {
+        LOG_WARN("EffectsChain: prepare failed for '%s', node bypassed", effect->name());
+    }
+    return effect->prepared_;
+}
 
-    float bass_r = *right * eq_params_.bass_gain + bass_filter_state_[1] * (1.0f - bass_alpha);
-    bass_filter_state_[1] = bass_r * bass_alpha + bass_filter_state_[1] * (1.0f - bass_alpha);
+void EffectsChain::publishLocked(const NodeList& next) {
+    const int current = active_list_.load();
+    const int spare = 1 - current;
 
-    // Treble boost (high shelf)
-    const float treble_alpha = 0.05f;
-    float treble_l = *left * eq_params_.treble_gain + treble_filter_state_[0] * (1.0f - treble_alpha);
-    treble_filter_state_[0] = treble_l * treble_alpha + treble_filter_state_[0] * (1.0f - treble_alpha);
+    // La copia inattiva può ancora essere in uso solo se il task audio l'ha presa prima
+    // della pubblicazione precedente: attendere che la lasci
+    while (audio_list_.load() == spare) {
+        vTaskDelay(1);
+    }
+    lists_[spare] = next;
+    active_list_.store(spare);
 
-    float treble_r = *right * eq_params_.treble_gain + treble_filter_state_[1] * (1.0f - treble_alpha);
-    treble_filter_state_[1] = treble_r * treble_alpha + treble_filter_state_[1] * (1.0f - treble_alpha);
+    // Dopo il ritorno la lista vecchia (e i nodi rimossi) non sono più referenziati
+    while (audio_list_.load() == current) {
+        vTaskDelay(1);
+    }
+}
 
-    // Combine bass and treble, apply mid gain
-    *left = (bass_l + treble_l) * 0.5f * eq_params_.mid_gain;
-    *right = (bass_r + treble_r) * 0.5f * eq_params_.mid_gain;
+bool EffectsChain::insertEffect(IAudioEffect* effect, size_t index) {
+    if (!effect) {
+        return false;
+    }
+    EditLock lock(edit_mutex_);
+    NodeList next = lists_[active_list_.load()];
+    for (size_t i = 0; i < next.count; ++i) {
+        if (next.nodes[i] == effect) {
+            LOG_WARN("EffectsChain: '%s' already in chain", effect->name());
+            return false;
+        }
+    }
+    if (next.count >= kMaxEffects) {
+        LOG_ERROR("EffectsChain: chain full (%u nodes)", (unsigned)kMaxEffects);
+        return false;
+    }
+    if (max_block_frames_ && !prepareNode(effect)) {
+        return false;
+    }
+
+    if (index > next.count) {
+        index = next.count;
+    }
+    for (size_t i = next.count; i > index; --i) {
+        next.nodes[i] = next.nodes[i - 1];
+    }
+    next.nodes[index] = effect;
+    next.count++;
+    publishLocked(next);
+    LOG_DEBUG("EffectsChain: inserted '%s' at %u", effect->name(), (unsigned)index);
+    return true;
 }
 
-void EffectsChain::applyReverb(float* left, float* right) {
-    // Simple reverb using multiple delay taps
-    const size_t delays[] = {23, 41, 59, 73}; // Prime numbers for diffusion
-    float wet_l = 0.0f, wet_r = 0.0f;
+bool EffectsChain::removeEffect(IAudioEffect* effect) {
+    EditLock lock(edit_mutex_);
+    NodeList next = lists_[active_list_.load()];
+    size_t out = 0;
+    for (size_t i = 0; i < next.count; ++i) {
+        if (next.nodes[i] != effect) {
+            next.nodes[out++] = next.nodes[i];
+        }
+    }
+    if (out == next.count) {
+        return false;
+    }
+    next.count = out;
+    publishLocked(next);
+    return true;
+}
 
-    for (size_t tap : delays) {
-        size_t pos = (delay_write_pos_ - tap + delay_buffer_size_) % delay_buffer_size_;
-        wet_l += delay_buffer_[pos * 2] * reverb_params_.decay;
-        wet_r += delay_buffer_[pos * 2 + 1] * reverb_params_.decay;
+bool EffectsChain::moveEffect(IAudioEffect* effect, size_t index) {
+    EditLock lock(edit_mutex_);
+    NodeList next = lists_[active_list_.load()];
+    size_t from = next.count;
+    for (size_t i = 0; i < next.count; ++i) {
+        if (next.nodes[i] == effect) {
+            from = i;
+            break;
+        }
+    }
+    if (from == next.count) {
+        return false;
+    }
+    if (index >= next.count) {
+        index = next.count - 1;
+    }
+    if (index == from) {
+        return true;
+    }
+    if (index < from) {
+        for (size_t i = from; i > index; --i) next.nodes[i] = next.nodes[i - 1];
+    } else {
+        for (size_t i = from; i < index; ++i) next.nodes[i] = next.nodes[i + 1];
     }
+    next.nodes[index] = effect;
+    publishLocked(next);
+    return true;
+}
 
-    wet_l /= 4.0f;
-    wet_r /= 4.0f;
+size_t EffectsChain::effectCount() const {
+    EditLock lock(edit_mutex_);
+    return lists_[active_list_.load()].count;
+}
 
-    // Mix dry and wet
-    *left = *left * (1.0f - reverb_params_.mix) + wet_l * reverb_params_.mix;
-    *right = *right * (1.0f - reverb_params_.mix) + wet_r * reverb_params_.mix;
+IAudioEffect* EffectsChain::effectAt(size_t index) const {
+    EditLock lock(edit_mutex_);
+    const NodeList& list = lists_[active_list_.load()];
+    return index < list.count ? list.nodes[index] : nullptr;
+}
 
-    // Store current sample in delay buffer
-    delay_buffer_[delay_write_pos_ * 2] = *left;
-    delay_buffer_[delay_write_pos_ * 2 + 1] = *right;
-    delay_write_pos_ = (delay_write_pos_ + 1) % delay_buffer_size_;
+IAudioEffect* EffectsChain::findEffect(const char* name) const {
+    if (!name) {
+        return nullptr;
+    }
+    EditLock lock(edit_mutex_);
+    const NodeList& list = lists_[active_list_.load()];
+    for (size_t i = 0; i < list.count; ++i) {
+        if (strcmp(list.nodes[i]->name(), name) == 0) {
+            return list.nodes[i];
+        }
+    }
+    return nullptr;
 }
 
-void EffectsChain::applyEcho(float* left, float* right) {
-    // Simple echo with single delay
-    size_t delay_samples = static_cast<size_t>(echo_params_.delay_ms * sample_rate_ / 1000.0f);
-    if (delay_samples >= delay_buffer_size_) delay_samples = delay_buffer_size_ - 1;
+size_t EffectsChain::getStats(EffectNodeStats* out, size_t max_entries) const {
+    if (!out) {
+        return 0;
+    }
+    EditLock lock(edit_mutex_);
+    const NodeList& list = lists_[active_list_.load()];
+    size_t n = 0;
+    for (size_t i = 0; i <= list.count && n < max_entries; ++i) {
+        const IAudioEffect* effect = i < list.count ? list.nodes[i] : &limiter_;
+        out[n] = effect->stats_;
+        out[n].name = effect->name();
+        out[n].enabled = effect->isEnabled();
+        ++n;
+    }
+    return n;
+}
 
-    size_t pos = (delay_write_pos_ - delay_samples + delay_buffer_size_) % delay_buffer_size_;
-    float echo_l = delay_buffer_[pos * 2] * echo_params_.decay;
-    float echo_r = delay_buffer_[pos * 2 + 1] * echo_params_.decay;
+int EffectsChain::acquireList() {
+    // Pubblica la lista che si sta per usare e ricontrolla: se nel frattempo è stata
+    // scambiata, l'editor potrebbe non aver visto la prenotazione e si riprova
+    int idx = active_list_.load();
+    for (;;) {
+        audio_list_.store(idx);
+        int again = active_list_.load();
+        if (again == idx) {
+            return idx;
+        }
+        idx = again;
+    }
+}
 
-    // Mix dry and echo
-    *left = *left * (1.0f - echo_params_.mix) + echo_l * echo_params_.mix;
-    *right = *right * (1.0f - echo_params_.mix) + echo_r * echo_params_.mix;
+void EffectsChain::process(int16_t* buffer, size_t frames, uint32_t channels) {
+    if (!buffer || max_block_frames_ == 0 || (channels != 1 && channels != 2)) {
+        return; // configure() fallita: audio invariato
+    }
 
-    // Store current sample in delay buffer
-    delay_buffer_[delay_write_pos_ * 2] = *left;
-    delay_buffer_[delay_write_pos_ * 2 + 1] = *right;
-    delay_write_pos_ = (delay_write_pos_ + 1) % delay_buffer_size_;
+    const NodeList& list = lists_[acquireList()];
+    const bool reset_stats = stats_reset_requested_.exchange(false);
+    for (size_t i = 0; i < list.count; ++i) {
+        IAudioEffect* effect = list.nodes[i];
+        if (reset_stats) {
+            effect->stats_ = EffectNodeStats();
+        }
+        if (!effect->prepared_ || !effect->isEnabled()) {
+            effect->running_ = false;
+        }
+    }
+    if (reset_stats) {
+        limiter_.stats_ = EffectNodeStats();
+    }
+
+    // Anche senza nodi abilitati il blocco passa dal limiter: il look-ahead resta in linea
+    // e abilitare/disabilitare un effetto non sposta l'audio di 5 ms (click)
+    while (frames > 0) {
+        size_t n = std::min(frames, max_block_frames_);
+        processBlock(list, buffer, n, channels);
+        buffer += n * channels;
+        frames -= n;
+    }
+    audio_list_.store(-1);
 }
 
-void EffectsChain::updateDelayBufferSize() {
-    // Allocate buffer for maximum delay (1 second)
-    size_t max_delay_samples = sample_rate_;
-    delay_buffer_size_ = max_delay_samples;
-    delay_buffer_.reset(new float[delay_buffer_size_ * 2]);
-    std::fill_n(delay_buffer_.get(), delay_buffer_size_ * 2, 0.0f);
-    delay_write_pos_ = 0;
+void EffectsChain::runNode(IAudioEffect* effect, AudioBlock& block) {
+    // Il limiter disabilitato resta in linea come solo ritardo (OutputLimiter::process()):
+    // la sua linea di ritardo non si azzera mai a catena attiva
+    if (!effect->prepared_ || (!effect->isEnabled() && effect != &limiter_)) {
+        effect->running_ = false;
+        return;
+    }
+    if (!effect->running_) {
+        effect->reset();
+        effect->running_ = true;
+    }
+
+    int64_t start = esp_timer_get_time();
+    effect->process(block);
+    uint32_t elapsed = static_cast<uint32_t>(esp_timer_get_time() - start);
+
+    EffectNodeStats& stats = effect->stats_;
+    stats.blocks++;
+    stats.frames += block.frames;
+    stats.total_us += elapsed;
+    stats.last_us = elapsed;
+    if (elapsed > stats.max_us) stats.max_us = elapsed;
+}
+
+void EffectsChain::processBlock(const NodeList& list, int16_t* buffer, size_t frames, uint32_t channels) {
+    float* left = scratch_l_;
+    float* right = scratch_r_;
+    const float in_scale = 1.0f / 32768.0f;
+
+    // Deinterleave + conversione in un solo passaggio
+    if (channels == 2) {
+        for (size_t i = 0; i < frames; ++i) {
+            left[i] = buffer[2 * i] * in_scale;
+            right[i] = buffer[2 * i + 1] * in_scale;
+        }
+    } else {
+        for (size_t i = 0; i < frames; ++i) {
+            left[i] = right[i] = buffer[i] * in_scale;
+        }
+    }
+
+    AudioBlock block = {left, right, frames, channels, sample_rate_};
+    for (size_t i = 0; i < list.count; ++i) {
+        runNode(list.nodes[i], block);
+    }
+    // Stadio finale fisso: dopo di lui il clamp int16 non taglia più nulla
+    runNode(&limiter_, block);
+
+    // Convert back to int16
+    if (channels == 2) {
+        for (size_t i = 0; i < frames; ++i) {
+            int l = static_cast<int>(left[i] * 32767.0f);
+            int r = static_cast<int>(right[i] * 32767.0f);
+            buffer[2 * i] = static_cast<int16_t>(std::max(-32768, std::min(32767, l)));
+            buffer[2 * i + 1] = static_cast<int16_t>(std::max(-32768, std::min(32767, r)));
+        }
+    } else {
+        for (size_t i = 0; i < frames; ++i) {
+            int v = static_cast<int>(left[i] * 32767.0f);
+            buffer[i] = static_cast<int16_t>(std::max(-32768, std::min(32767, v)));
+        }
+    }
 }
@@ -4,80 +4,175 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <memory>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
-// Simple effects parameters
+#include "audio_effect_node.h"
+#include "parametric_eq.h"
+#include "output_limiter.h"
+#include "reverb_effect.h"
+
+// EQ a tre bande semplificato, mappato sul ParametricEqEffect "eq":
+// low shelf 200 Hz, peaking 1 kHz, high shelf 4 kHz; guadagni lineari (1.0 = piatto)
 struct EQParams {
     float bass_gain = 1.0f;
     float mid_gain = 1.0f;
     float treble_gain = 1.0f;
 };
 
-struct ReverbParams {
-    float decay = 0.5f;
-    float mix = 0.3f;
-};
-
 struct EchoParams {
     float delay_ms = 200.0f;
     float decay = 0.4f;
     float mix = 0.2f;
 };
 
+// Eco singolo fino a 1 s; delay line propria in PSRAM
+class EchoEffect : public IAudioEffect {
+public:
+    ~EchoEffect() override;
+
+    const char* name() const override { return "echo"; }
+    bool prepare(uint32_t sample_rate, size_t max_block_frames) override;
+    void process(AudioBlock& block) override;
+    void reset() override;
+
+    void setParams(const EchoParams& params) { params_ = params; }
+    const EchoParams& params() const { return params_; }
+
+private:
+    EchoParams params_;
+    uint32_t sample_rate_ = 0;
+    float* line_l_ = nullptr;
+    float* line_r_ = nullptr;
+    size_t line_size_ = 0;
+    size_t write_pos_ = 0;
+    // Frame scritti dall'ultimo reset(): le letture più vecchie valgono 0, così reset()
+    // non deve azzerare 1 s di PSRAM dal task audio
+    size_t valid_frames_ = 0;
+};
+
+// Catena effetti sul blocco PCM dell'output task: grafo lineare di IAudioEffect.
+// Tutta la memoria (scratch planare + stato dei nodi) è allocata in configure() /
+// insertEffect(): process() non alloca, converte int16 interleaved → float planare una
+// volta, passa il blocco a ogni nodo abilitato nell'ordine corrente e riconverte.
+//
+// Ordine e composizione si modificano a runtime da qualsiasi task tranne quello audio:
+// la lista dei nodi è doppia, le modifiche scrivono la copia inattiva e la pubblicano con
+// uno scambio atomico; il task audio prende la lista all'inizio di process() e la tiene
+// per tutto il blocco. insertEffect/removeEffect/moveEffect ritornano solo quando il
+// task audio non usa più la lista precedente: dopo removeEffect() il nodo può essere
+// distrutto dal chiamante.
+//
+// Di default contiene eq → reverb → echo (disabilitati), posseduti dalla catena; i nodi
+// inseriti dall'esterno restano del chiamante. Dopo l'ultimo nodo gira sempre
+// l'OutputLimiter (abilitato di default, non spostabile): anche senza effetti, o con il
+// limiter disabilitato, il suo look-ahead resta in linea, così la latenza della catena è
+// costante e abilitare un nodo non produce salti nell'audio.
 class EffectsChain {
 public:
+    static constexpr size_t kDefaultMaxBlockFrames = 2048;
+    static constexpr size_t kMaxEffects = 8;
+    static constexpr size_t kAppend = static_cast<size_t>(-1);
+
     EffectsChain();
     ~EffectsChain();
 
-    // Initialize with sample rate
+    EffectsChain(const EffectsChain&) = delete;
+    EffectsChain& operator=(const EffectsChain&) = delete;
+
+    // Alloca lo scratch (max_block_frames per canale) e richiama prepare() su tutti i
+    // nodi. Da chiamare a task audio fermo (es. in AudioPlayer::start()).
+    bool configure(uint32_t sample_rate, size_t max_block_frames);
+
+    // Initialize with sample rate (mantiene la dimensione di blocco corrente)
     void setSampleRate(uint32_t sample_rate);
 
+    // Composizione del grafo (non dal task audio)
+    bool insertEffect(IAudioEffect* effect, size_t index = kAppend);
+    bool removeEffect(IAudioEffect* effect);
+    bool moveEffect(IAudioEffect* effect, size_t index);
+    size_t effectCount() const;
+    IAudioEffect* effectAt(size_t index) const;
+    IAudioEffect* findEffect(const char* name) const;
+
+    // Statistiche CPU per nodo, nell'ordine corrente più il limiter finale; ritorna il
+    // numero di voci scritte
+    size_t getStats(EffectNodeStats* out, size_t max_entries) const;
+    // Azzeramento eseguito dal task audio all'inizio del prossimo blocco
+    void resetStats() { stats_reset_requested_.store(true); }
+
+    // Process PCM buffer interleaved (in-place). Blocchi più lunghi di max_block_frames
+    // vengono elaborati a tranche; channels = 1 o 2.
+    void process(int16_t* buffer, size_t frames, uint32_t channels = 2);
+
+    // Nodi predefiniti
+    ParametricEqEffect& eq() { return eq_; }
+    ReverbEffect& reverb() { return reverb_; }
+    EchoEffect& echo() { return echo_; }
+    OutputLimiter& limiter() { return limiter_; }
+
     // Enable/disable effects
-    void setEQEnabled(bool enabled) { eq_enabled_ = enabled; }
-    void setReverbEnabled(bool enabled) { reverb_enabled_ = enabled; }
-    void setEchoEnabled(bool enabled) { echo_enabled_ = enabled; }
+    void setEQEnabled(bool enabled) { eq_.setEnabled(enabled); }
+    void setReverbEnabled(bool enabled) { reverb_.setEnabled(enabled); }
+    void setEchoEnabled(bool enabled) { echo_.setEnabled(enabled); }
+    void setLimiterEnabled(bool enabled) { limiter_.setEnabled(enabled); }
 
     // Set parameters (preserves when sample rate changes)
-    void setEQParams(const EQParams& params) { eq_params_ = params; }
-    void setReverbParams(const ReverbParams& params) { reverb_params_ = params; }
-    void setEchoParams(const EchoParams& params) { echo_params_ = params; }
-
-    // Process stereo PCM buffer (in-place)
-    void process(int16_t* buffer, size_t samples);
+    void setEQParams(const EQParams& params);
+    void setReverbParams(const ReverbParams& params) { reverb_.setParams(params); }
+    void setEchoParams(const EchoParams& params) { echo_.setParams(params); }
+    void setLimiterParams(const LimiterParams& params) { limiter_.setParams(params); }
 
     // Get current params
     const EQParams& getEQParams() const { return eq_params_; }
-    const ReverbParams& getReverbParams() const { return reverb_params_; }
-    const EchoParams& getEchoParams() const { return echo_params_; }
+    const ReverbParams& getReverbParams() const { return reverb_.params(); }
+    const EchoParams& getEchoParams() const { return echo_.params(); }
+    const LimiterParams& getLimiterParams() const { return limiter_.params(); }
+    LimiterMeter getLimiterMeter() const { return limiter_.meter(); }
+
+    bool isEQEnabled() const { return eq_.isEnabled(); }
+    bool isReverbEnabled() const { return reverb_.isEnabled(); }
+    bool isEchoEnabled() const { return echo_.isEnabled(); }
+    bool isLimiterEnabled() const { return limiter_.isEnabled(); }
 
-    bool isEQEnabled() const { return eq_enabled_; }
-    bool isReverbEnabled() const { return reverb_enabled_; }
-    bool isEchoEnabled() const { return echo_enabled_; }
+    uint32_t sampleRate() const { return sample_rate_; }
+    size_t maxBlockFrames() const { return max_block_frames_; }
 
 private:
-    uint32_t sample_rate_ = 44100;
+    struct NodeList {
+        IAudioEffect* nodes[kMaxEffects];
+        size_t count;
+    };
 
-    bool eq_enabled_ = false;
-    bool reverb_enabled_ = false;
-    bool echo_enabled_ = false;
+    uint32_t sample_rate_ = 44100;
+    size_t max_block_frames_ = 0;
 
+    ParametricEqEffect eq_;
     EQParams eq_params_;
-    ReverbParams reverb_params_;
-    EchoParams echo_params_;
-
-    // Simple delay buffers for echo/reverb
-    std::unique_ptr<float[]> delay_buffer_;
-    size_t delay_buffer_size_ = 0;
-    size_t delay_write_pos_ = 0;
-
-    // Simple IIR filters for EQ
-    float bass_filter_state_[2] = {0.0f, 0.0f};
-    float treble_filter_state_[2] = {0.0f, 0.0f};
-
-    // Helper methods
-    void applyEQ(float* left, float* right);
-    void applyReverb(float* left, float* right);
-    void applyEcho(float* left, float* right);
-    void updateDelayBufferSize();
+    ReverbEffect reverb_;
+    EchoEffect echo_;
+    OutputLimiter limiter_;
+
+    // Doppia lista: active_list_ è quella pubblicata, audio_list_ quella in uso dal task
+    // audio (-1 fuori da process())
+    NodeList lists_[2] = {};
+    std::atomic<int> active_list_{0};
+    std::atomic<int> audio_list_{-1};
+    std::atomic<bool> stats_reset_requested_{false};
+    SemaphoreHandle_t edit_mutex_ = nullptr;
+
+    // Scratch planare (RAM interna se disponibile)
+    float* scratch_l_ = nullptr;
+    float* scratch_r_ = nullptr;
+
+    void runNode(IAudioEffect* effect, AudioBlock& block);
+    void processBlock(const NodeList& list, int16_t* buffer, size_t frames, uint32_t channels);
+    int acquireList();
+    void publishLocked(const NodeList& next);
+    bool prepareNode(IAudioEffect* effect);
+    bool allocateScratch(size_t max_block_frames);
+    void releaseBuffers();
 };
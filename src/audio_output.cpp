@@ -25,12 +25,23 @@ AudioOutput::~AudioOutput() {
 }
 
 bool AudioOutput::begin(const AudioConfig& cfg, uint32_t sample_rate, uint32_t channels) {
+    if (initialized_) {
+        // Rate fisso (output_sample_rate): codec e I2S restano aperti tra le tracce. Il
+        // player apre sempre in stereo e fa l'upmix delle tracce mono, quindi a riaprire
+        // è solo un cambio di rate
+        if (sample_rate == current_sample_rate_ && channels == current_channels_) {
+            return true;
+        }
+        end();
+    }
     i2s_write_timeout_ms_ = cfg.i2s_write_timeout_ms;
     current_sample_rate_ = sample_rate;
+    current_channels_ = channels;
 
     // ===== INIT CODEC =====
-    // Note: Codec init requires I2C.
-    if (!codec_.init(sample_rate, kApEnable, kI2cSda, kI2cScl, kI2cSpeed, cfg.default_volume_percent)) {
+    // Note: Codec init requires I2C. Il volume hardware resta fisso: volume utente, pausa
+    // e mute sono guadagno digitale (DigitalGain) nel percorso PCM.
+    if (!codec_.init(sample_rate, kApEnable, kI2cSda, kI2cScl, kI2cSpeed, cfg.codec_volume_percent)) {
         LOG_ERROR("Codec init failed");
         return false;
     }
@@ -19,7 +19,7 @@ public:
     void end();
     void stop(); // Clears DMA buffers
     size_t write(const int16_t* data, size_t frames, size_t channels);
-    void set_volume(int percent);
+    void set_volume(int percent); // Range hardware del codec (I2C), non per volume utente/pausa
     
     // Metodi di utilità
     size_t chunk_bytes() const { return i2s_driver_.chunk_bytes(); }
@@ -29,5 +29,6 @@ private:
     I2sDriver i2s_driver_;
     bool initialized_ = false;
     uint32_t current_sample_rate_ = 0;
+    uint32_t current_channels_ = 0;
     uint32_t i2s_write_timeout_ms_ = 0;
 };
@@ -6,6 +6,7 @@
 
 #include "esp_err.h"
 #include <esp_heap_caps.h>
+#include <algorithm>
 #include <cstring>
 
 namespace {
@@ -24,8 +25,8 @@ constexpr size_t kRingMin = 12 * 1024;
 constexpr uint32_t kTargetBufferMs = 250;
 constexpr size_t kProducerMinFree = 12 * 1024;
 constexpr size_t kFileChunk = 512;
-constexpr uint32_t kAudioTaskStack = 24576;
-constexpr uint32_t kFileTaskStack = 3072;
+constexpr uint32_t kAudioTaskStack = 6144;    // Output task (ring -> effetti -> I2S)
+constexpr uint32_t kFileTaskStack = 24576;    // Decode task (dr_mp3 usa molto stack)
 constexpr uint32_t kI2sWriteTimeout = 200;
 constexpr size_t kI2sChunkBytes = 1536;
 #else
@@ -36,13 +37,15 @@ constexpr size_t kRingMin = 16 * 1024;
 constexpr uint32_t kTargetBufferMs = 350;
 constexpr size_t kProducerMinFree = 24 * 1024;
 constexpr size_t kFileChunk = 1024;
-constexpr uint32_t kAudioTaskStack = 32768;
-constexpr uint32_t kFileTaskStack = 4096;
+constexpr uint32_t kAudioTaskStack = 8192;    // Output task (ring -> effetti -> I2S)
+constexpr uint32_t kFileTaskStack = 32768;    // Decode task (dr_mp3 usa molto stack)
 constexpr uint32_t kI2sWriteTimeout = 250;
 constexpr size_t kI2sChunkBytes = 2048;
 #endif
 
 constexpr EventBits_t AUDIO_TASK_DONE_BIT = BIT0;
+constexpr EventBits_t DECODE_TASK_DONE_BIT = BIT1;
+constexpr EventBits_t ALL_TASKS_DONE_BITS = AUDIO_TASK_DONE_BIT | DECODE_TASK_DONE_BIT;
 } // namespace
 
 AudioConfig default_audio_config() {
@@ -68,11 +71,16 @@ AudioConfig default_audio_config() {
         .audio_task_core = 1,
         .file_task_core = 0,
         .default_volume_percent = 75,
+        .codec_volume_percent = 100,
         .i2s_write_timeout_ms = kI2sWriteTimeout,
         .i2s_chunk_bytes = kI2sChunkBytes,
         .i2s_dma_buf_len = 256,
         .i2s_dma_buf_count = 12,
-        .i2s_use_apll = true};
+        .i2s_use_apll = true,
+        .output_sample_rate = 0,
+        .resampler_quality = ResamplerQuality::BALANCED,
+        .live_drift_compensation = true,
+        .live_target_ms = 0};
     return cfg;
 }
 
@@ -82,6 +90,7 @@ AudioPlayer::AudioPlayer(const AudioConfig &cfg)
       saved_volume_percent_(cfg.default_volume_percent),
       user_volume_percent_(cfg.default_volume_percent),
       current_volume_percent_(cfg.default_volume_percent) {
+    output_gain_.set_target(DigitalGain::volume_to_q15(cfg.default_volume_percent), 0);
     reset_memory_stats();
 }
 
@@ -156,20 +165,93 @@ void AudioPlayer::wait_for_task_shutdown(uint32_t timeout_ms) {
     while (waited < timeout_ms) {
         EventBits_t bits = playback_events_ ? xEventGroupGetBits(playback_events_) : 0;
         bool audio_done = (bits & AUDIO_TASK_DONE_BIT) || (audio_task_handle_ == NULL);
-        if (audio_done) {
+        bool decode_done = (bits & DECODE_TASK_DONE_BIT) || (decode_task_handle_ == NULL);
+        if (audio_done && decode_done) {
             if (playback_events_) {
-                xEventGroupClearBits(playback_events_, AUDIO_TASK_DONE_BIT);
+                xEventGroupClearBits(playback_events_, ALL_TASKS_DONE_BITS);
             }
             return;
         }
         if (audio_task_handle_) {
             xTaskAbortDelay(audio_task_handle_);
         }
+        if (decode_task_handle_) {
+            xTaskAbortDelay(decode_task_handle_);
+        }
         vTaskDelay(pdMS_TO_TICKS(20));
         waited += 20;
     }
 }
 
+bool AudioPlayer::allocate_pcm_ring() {
+    if (pcm_ring_.allocated()) {
+        return true;
+    }
+
+    // Regione preferita prima, poi l'altra; dimezza fino a ring_buffer_min_bytes
+    struct Candidate {
+        size_t bytes;
+        uint32_t caps;
+        const char* label;
+    };
+    const Candidate psram = {cfg_.ring_buffer_size_psram, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, "PSRAM"};
+    const Candidate dram = {cfg_.ring_buffer_size_dram, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, "DRAM"};
+    const Candidate order[2] = {
+        cfg_.prefer_dram_ring ? dram : psram,
+        cfg_.prefer_dram_ring ? psram : dram
+    };
+
+    for (const Candidate& c : order) {
+        for (size_t bytes = c.bytes; bytes >= cfg_.ring_buffer_min_bytes && bytes > 0; bytes /= 2) {
+            if (pcm_ring_.allocate(bytes, c.caps)) {
+                LOG_INFO("PCM ring allocated: %u bytes in %s", (unsigned)pcm_ring_.capacity(), c.label);
+                return true;
+            }
+        }
+    }
+
+    LOG_ERROR("PCM ring allocation failed (min %u bytes)", (unsigned)cfg_.ring_buffer_min_bytes);
+    return false;
+}
+
+void AudioPlayer::configure_pcm_ring(uint32_t sample_rate, uint32_t channels) {
+    const size_t frame_bytes = channels * kBytesPerSample;
+    const size_t block_bytes = kFramesPerBlock * frame_bytes;
+    const size_t capacity = pcm_ring_.capacity();
+
+    // Prefill: target_buffer_ms di audio, lasciando sempre spazio per un blocco
+    size_t start_threshold = (size_t)((uint64_t)sample_rate * frame_bytes * cfg_.target_buffer_ms / 1000);
+    start_threshold -= start_threshold % frame_bytes;
+    if (start_threshold + block_bytes > capacity) {
+        start_threshold = (capacity > block_bytes) ? capacity - block_bytes : frame_bytes;
+    }
+
+    // Il producer riparte solo quando c'è spazio per un blocco + isteresi
+    size_t resume_free = block_bytes + cfg_.producer_resume_hysteresis_min;
+    if (resume_free > capacity) {
+        resume_free = capacity;
+    }
+
+    pcm_ring_.reset();
+    pcm_ring_.configure_watermarks(start_threshold, resume_free);
+    LOG_INFO("PCM ring: %u bytes (%u ms), prefill %u bytes, producer resume at %u free",
+             (unsigned)capacity,
+             (unsigned)((uint64_t)capacity * 1000 / ((uint64_t)sample_rate * frame_bytes)),
+             (unsigned)start_threshold,
+             (unsigned)resume_free);
+}
+
+void AudioPlayer::request_output_flush() {
+    // Il flush va eseguito dal consumer (output task): il producer lo richiede e attende l'ack
+    flush_requested_ = true;
+    while (flush_requested_ && !stop_requested_) {
+        if (audio_task_handle_) {
+            xTaskNotifyGive(audio_task_handle_);
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+    }
+}
+
 
 
 void AudioPlayer::reset_memory_stats() {
@@ -308,62 +390,90 @@ bool AudioPlayer::arm_source() {
              current_source_to_arm_->is_seekable() ? "yes" : "no");
 
     if (current_source_to_arm_->is_seekable()) {
+        // Il parser legge da inizio/fine file: poi il reader torna dove l'ha messo il source
+        // (col timeshift ripreso dal journal è la sessione corrente, non la storia)
+        size_t read_pos = current_source_to_arm_->tell();
         if (id3_parser_.parse(current_source_to_arm_.get(), current_metadata_)) {
             LOG_INFO("Metadata: title=\"%s\" artist=\"%s\" album=\"%s\"", current_metadata_.title.c_str(), current_metadata_.artist.c_str(), current_metadata_.album.c_str());
         } else {
             LOG_INFO("Metadata ID3 not found or not parseable");
         }
+        current_source_to_arm_->seek(read_pos);
         notify_metadata(current_metadata_, current_source_to_arm_->uri());
     }
 
     return true;
 }
 
+void AudioPlayer::apply_output_gain(uint32_t ramp_ms) {
+    // Target del guadagno digitale: muto in pausa/mute, altrimenti il volume utente
+    int32_t target = (pause_flag_ || muted_) ? 0 : DigitalGain::volume_to_q15(user_volume_percent_);
+    uint32_t rate = output_rate_ ? output_rate_ : cfg_.default_sample_rate;
+    output_gain_.set_target(target, rate * ramp_ms / 1000);
+}
+
+size_t AudioPlayer::render_output(int16_t* pcm, size_t frames, uint32_t channels) {
+    // Resampler (se attivo) -> upmix -> effetti -> volume/dissolvenze -> I2S
+    if (resample_buffer_) {
+        frames = resampler_.process(pcm, frames, resample_buffer_, resample_capacity_);
+        pcm = resample_buffer_;
+        if (frames == 0) {
+            return 0;
+        }
+    }
+    if (channels == 1 && output_channels_ == 2) {
+        // In-place dall'ultimo frame: i buffer sono dimensionati per l'uscita stereo
+        for (size_t i = frames; i-- > 0;) {
+            pcm[2 * i] = pcm[2 * i + 1] = pcm[i];
+        }
+        channels = 2;
+    }
+    effects_chain_.process(pcm, frames, channels);
+    output_gain_.process(pcm, frames, channels);
+    return output_.write(pcm, frames, channels);
+}
+
+void AudioPlayer::update_drift(uint32_t now_ms) {
+    // Distanza dal live edge -> servo PI -> trim del resampler (output task)
+    const IDataSource* ds = data_source();
+    int32_t distance = ds ? ds->live_edge_distance_ms() : -1;
+    live_distance_ms_ = distance;
+    resampler_.set_ratio_trim(drift_.update(distance, now_ms));
+    drift_ppm_ = resampler_.ratio_trim();
+}
+
 void AudioPlayer::set_volume(int vol_pct) {
     if (vol_pct < 0) vol_pct = 0;
     if (vol_pct > 100) vol_pct = 100;
     user_volume_percent_ = vol_pct;
     saved_volume_percent_ = vol_pct;
-    output_.set_volume(vol_pct);
     current_volume_percent_ = vol_pct;
+    apply_output_gain(kVolumeRampMs);
 }
 
-void AudioPlayer::toggle_pause() {
-    if (player_state_ == PlayerState::PAUSED) {
-        output_.set_volume(user_volume_percent_);
-        pause_flag_ = false;
-        player_state_ = PlayerState::PLAYING;
-
-
-
-        LOG_INFO("Playback resumed");
-    } else if (player_state_ == PlayerState::PLAYING) {
-        pause_flag_ = true;
-        output_.set_volume(0);
-        player_state_ = PlayerState::PAUSED;
-
-
+void AudioPlayer::set_mute(bool mute) {
+    muted_ = mute;
+    apply_output_gain(kFadeMs);
+}
 
-        LOG_INFO("Playback paused");
-    }
+void AudioPlayer::toggle_pause() {
+    set_pause(player_state_ != PlayerState::PAUSED);
 }
 
 void AudioPlayer::set_pause(bool pause) {
+    // Il task audio sfuma a zero, poi smette di consumare il ring; la ripresa sfuma da zero
     if (pause && player_state_ == PlayerState::PLAYING) {
-        // Pause playback
         pause_flag_ = true;
-        output_.set_volume(0);
+        apply_output_gain(kFadeMs);
         player_state_ = PlayerState::PAUSED;
-
-
-
         LOG_INFO("Playback paused");
     } else if (!pause && player_state_ == PlayerState::PAUSED) {
-        // Resume playback
-        output_.set_volume(user_volume_percent_);
         pause_flag_ = false;
+        apply_output_gain(kFadeMs);
         player_state_ = PlayerState::PLAYING;
-
+        if (audio_task_handle_) {
+            xTaskNotifyGive(audio_task_handle_);
+        }
         LOG_INFO("Playback resumed");
     }
 }
@@ -386,6 +496,8 @@ void AudioPlayer::start() {
 
     LOG_INFO("Config profile: %s", kConfigProfile);
     reset_memory_stats();
+    start_called_ms_ = millis();
+    first_audio_at_ms_ = 0;
 
     stream_.reset(new AudioStream());
     if (!stream_->begin(std::move(current_source_to_arm_))) {
@@ -395,25 +507,65 @@ void AudioPlayer::start() {
         return;
     }
 
+    if (!allocate_pcm_ring()) {
+        player_state_ = PlayerState::ERROR;
+        stream_.reset();
+        return;
+    }
+
     stop_requested_ = false;
     pause_flag_ = false;
     seek_seconds_ = -1;
+    decode_finished_ = false;
+    flush_requested_ = false;
     current_played_frames_ = 0;
+    // La decodifica parte da dove il source posiziona il reader: inizio dei dati disponibili
+    // (il probe fa seek(0)) o, con storia ripresa dal journal, la sessione corrente
+    stream_frame_base_valid_ = stream_->data_source() &&
+                               stream_->data_source()->read_start_frame(&stream_frame_base_);
     total_pcm_frames_ = stream_->total_frames();
     current_sample_rate_ = stream_->sample_rate();
-    effects_chain_.setSampleRate(current_sample_rate_);
+    current_channels_ = stream_->channels();
+    // Con output_sample_rate fisso la traccia passa dal resampler e I2S resta aperto.
+    // Sugli stream live il resampler resta attivo anche a rate uguali: il suo trim
+    // segue il clock del broadcaster (DriftCompensator)
+    output_rate_ = cfg_.output_sample_rate ? cfg_.output_sample_rate : current_sample_rate_;
+    // A rate fisso anche i canali lo sono: le tracce mono vengono duplicate su L/R in
+    // render_output(), così un cambio mono/stereo non riapre codec e I2S
+    output_channels_ = cfg_.output_sample_rate ? 2 : current_channels_;
+    drift_active_ = cfg_.live_drift_compensation && stream_->data_source() &&
+                    stream_->data_source()->live_edge_distance_ms() >= 0;
+    resample_active_ = output_rate_ != current_sample_rate_ || drift_active_;
+    if (resample_active_ &&
+        !resampler_.configure(current_sample_rate_, output_rate_, current_channels_, cfg_.resampler_quality)) {
+        LOG_WARN("Resampler unavailable: output follows the track rate (%u Hz)", (unsigned)current_sample_rate_);
+        output_rate_ = current_sample_rate_;
+        resample_active_ = false;
+        drift_active_ = false;
+    }
+    resampler_.set_ratio_trim(0.0f);
+    if (drift_active_) {
+        DriftParams drift_params = drift_.params();
+        drift_params.target_ms = cfg_.live_target_ms;
+        drift_.set_params(drift_params);
+    }
+    drift_.reset();
+    drift_ppm_ = 0.0f;
+    live_distance_ms_ = -1;
+    effects_chain_.configure(output_rate_, kFramesPerBlock);
+    configure_pcm_ring(current_sample_rate_, current_channels_);
 
     if (!playback_events_) {
         playback_events_ = xEventGroupCreate();
     }
     if (playback_events_) {
-        xEventGroupClearBits(playback_events_, AUDIO_TASK_DONE_BIT);
+        xEventGroupClearBits(playback_events_, ALL_TASKS_DONE_BITS);
     }
 
     const char* uri = stream_->data_source()->uri();
     LOG_INFO("Starting playback: %s", uri);
 
-    // Crea SOLO audio task (no file task!)
+    // Output task (I2S) e decode task su core separati, uniti dal ring PCM
     BaseType_t created = create_task_with_affinity(
         audio_task_entry,
         "AudioTask",
@@ -430,6 +582,24 @@ void AudioPlayer::start() {
         return;
     }
 
+    created = create_task_with_affinity(
+        decode_task_entry,
+        "AudioDecode",
+        cfg_.file_task_stack,
+        this,
+        cfg_.file_task_priority,
+        &decode_task_handle_,
+        cfg_.file_task_core
+    );
+
+    if (created != pdPASS || decode_task_handle_ == NULL) {
+        LOG_ERROR("Failed to create decode task");
+        stop_requested_ = true;
+        wait_for_task_shutdown(2500);
+        player_state_ = PlayerState::ERROR;
+        return;
+    }
+
     playing_ = true;
     player_state_ = PlayerState::PLAYING;
 
@@ -468,7 +638,8 @@ void AudioPlayer::stop() {
 }
 
 void AudioPlayer::handle_recovery_if_needed() {
-    if (recovery_scheduled_ && !playing_ && player_state_ == PlayerState::ERROR && audio_task_handle_ == NULL) {
+    if (recovery_scheduled_ && !playing_ && player_state_ == PlayerState::ERROR &&
+        audio_task_handle_ == NULL && decode_task_handle_ == NULL) {
         LOG_INFO("Auto recovery attempt %u/%u after %s", recovery_attempts_, cfg_.max_recovery_attempts, failure_reason_to_str(last_failure_reason_));
         recovery_scheduled_ = false;
         player_state_ = PlayerState::STOPPED;
@@ -494,17 +665,36 @@ void AudioPlayer::print_status() const {
     }
 
     size_t ring_used = ring_buffer_used();
+    size_t ring_size = ring_buffer_size();
 
     LOG_INFO("=== Player Status ===");
     LOG_INFO("State: %s", state_str);
-    LOG_INFO("Volume: %d%% (saved: %d%%)", current_volume_percent_, saved_volume_percent_);
+    LOG_INFO("Volume: %d%% (saved: %d%%)%s", current_volume_percent_, saved_volume_percent_, muted_ ? " [muted]" : "");
     LOG_INFO("Sample Rate: %u Hz", current_sample_rate_);
+    LOG_INFO("Position: %u / %u ms", current_position_ms(), total_duration_ms());
+    if (resample_active_) {
+        LOG_INFO("Output: %u Hz via resampler (%u taps, %u KB)", output_rate_,
+                 (unsigned)resampler_.taps(), (unsigned)(resampler_.memory_bytes() / 1024));
+    }
+    if (drift_active_) {
+        LOG_INFO("Live drift: %+.1f ppm, live edge %d ms (target %.0f ms%s)", (double)drift_ppm_,
+                 (int)live_distance_ms_, (double)drift_.target_ms(), drift_.locked() ? "" : ", settling");
+    }
     const IDataSource* src = data_source();
     if (src) {
         LOG_INFO("Source: %s | open: %s | size: %u bytes",
                  src->uri(),
                  src->is_open() ? "yes" : "no",
                  (unsigned)src->size());
+        if (src->timeshift()) {
+            // Risvegli per evento vs timeout: con lo stream che scorre i timeout restano ~0
+            TimeshiftWaitStats w = src->timeshift()->wait_stats();
+            LOG_INFO("Timeshift waits: chunks ready %u, preload %u | preloader wake %u / timeout %u | "
+                     "reader waits %u (wake %u / timeout %u)",
+                     (unsigned)w.chunk_ready_events, (unsigned)w.preload_events,
+                     (unsigned)w.preloader_wakeups, (unsigned)w.preloader_timeouts,
+                     (unsigned)w.reader_waits, (unsigned)w.reader_wakeups, (unsigned)w.reader_timeouts);
+        }
     } else {
         LOG_INFO("Source: not selected");
     }
@@ -518,8 +708,15 @@ void AudioPlayer::print_status() const {
     const char *custom = current_metadata_.custom.length() ? current_metadata_.custom.c_str() : "n/a";
     LOG_INFO("Metadata: title=\"%s\" artist=\"%s\" album=\"%s\" genre=\"%s\" track=\"%s\" year=\"%s\" cover=%s", title, artist, album, genre, track, year, current_metadata_.cover_present ? "yes" : "no");
     LOG_INFO("Metadata extra: comment=\"%s\" custom=\"%s\"", comment, custom);
-    LOG_INFO("Task -> audio: %s", audio_task_handle_ ? "alive" : "none");
-    LOG_INFO("Frames played: %llu / %llu", current_played_frames_, total_pcm_frames_);
+    LOG_INFO("Task -> audio: %s, decode: %s",
+             audio_task_handle_ ? "alive" : "none",
+             decode_task_handle_ ? "alive" : "none");
+    LOG_INFO("PCM ring: %u / %u bytes (%u%%), underruns: %u",
+             (unsigned)ring_used,
+             (unsigned)ring_size,
+             ring_size ? (unsigned)(ring_used * 100 / ring_size) : 0u,
+             (unsigned)ring_underruns());
+    LOG_INFO("Frames played: %llu / %llu (decoded %llu)", played_frames(), total_pcm_frames_, current_played_frames_);
     LOG_INFO("Stop flag: %s, Pause flag: %s", stop_requested_ ? "true" : "false", pause_flag_ ? "true" : "false");
     LOG_INFO("Recovery: %s (reason: %s) attempts %u/%u",
              recovery_scheduled_ ? "scheduled" : "idle",
@@ -540,222 +737,187 @@ void AudioPlayer::audio_task_entry(void *param) {
     }
 }
 
+void AudioPlayer::decode_task_entry(void *param) {
+    auto *self = static_cast<AudioPlayer *>(param);
+    if (self) {
+        self->decode_task();
+    }
+}
+
 void AudioPlayer::audio_task() {
-    LOG_INFO("Audio task started (core %d)", (int)xPortGetCoreID());
+    LOG_INFO("Audio output task started (core %d)", (int)xPortGetCoreID());
 
     // Declare all variables before goto to avoid crossing initialization
     bool i2s_ready = false;
-    const uint32_t frames_per_chunk = 2048;
     uint32_t channels = 0;
     uint32_t sample_rate = 0;
+    size_t frame_bytes = 0;
+    size_t block_bytes = 0;
+    size_t fade_bytes = 0;
     int16_t* pcm_buffer = nullptr;
-    size_t pcm_buffer_size_frames = 2048;
     uint32_t last_progress_update_ms = 0;
     static constexpr uint32_t kProgressUpdateIntervalMs = 250;  // Update every 250ms
 
-    // Check is done below with stream check
-
     // Stream is already initialized in start()
     if (!stream_) {
         LOG_ERROR("Stream not initialized");
         goto cleanup;
     }
 
-    channels = stream_->channels();
-    sample_rate = stream_->sample_rate();
-    // total_pcm_frames_ is updated in start()
+    channels = current_channels_;
+    sample_rate = current_sample_rate_;
+    frame_bytes = channels * kBytesPerSample;
+    block_bytes = kFramesPerBlock * frame_bytes;
+    fade_bytes = std::max<size_t>(1, sample_rate * kFadeMs / 1000) * frame_bytes;
 
     // ===== INIT AUDIO OUTPUT (Codec & I2S) =====
-    if (!output_.begin(cfg_, sample_rate, channels)) {
+    // Nel frattempo il decode task sta già riempiendo il ring
+    if (!output_.begin(cfg_, output_rate_, output_channels_)) {
         LOG_ERROR("Audio output init failed");
         schedule_recovery(FailureReason::DECODER_INIT, "output init failed");
         goto cleanup;
     }
-    output_.set_volume(user_volume_percent_);
     i2s_ready = true;
-
-    // ===== ALLOCATE TEMP PCM BUFFER =====
-    // Using a heap buffer for PCM data
-    pcm_buffer = (int16_t*)heap_caps_malloc(pcm_buffer_size_frames * channels * sizeof(int16_t), MALLOC_CAP_8BIT);
+    // Primo blocco in dissolvenza da zero
+    output_gain_.set_target(0, 0);
+    output_gain_.snap();
+    apply_output_gain(kFadeMs);
+
+    // ===== ALLOCATE OUTPUT BLOCK BUFFER =====
+    // Buffer in DRAM: riceve il blocco dal ring, effetti applicati in-place (spazio per
+    // l'upmix a stereo)
+    pcm_buffer = (int16_t*)heap_caps_malloc(kFramesPerBlock * output_channels_ * kBytesPerSample, MALLOC_CAP_8BIT);
     if (!pcm_buffer) {
         LOG_ERROR("Failed to allocate PCM buffer");
         goto cleanup;
     }
-
-    // ===== MAIN PLAYBACK LOOP =====
-    LOG_INFO("Starting playback loop...");
-
-    while (!stop_requested_) {
-        // PAUSE handling
-        while (pause_flag_ && !stop_requested_) {
-                vTaskDelay(pdMS_TO_TICKS(20));
-                update_memory_min();
-            }
-        if (pause_flag_) {
-            vTaskDelay(pdMS_TO_TICKS(50));
-            update_memory_min();
-            continue; // Salta il resto del loop e ricontrolla le flag
+    if (resample_active_) {
+        resample_capacity_ = resampler_.max_output_frames(kFramesPerBlock);
+        resample_buffer_ = (int16_t*)heap_caps_malloc(resample_capacity_ * output_channels_ * kBytesPerSample,
+                                                      MALLOC_CAP_8BIT);
+        if (!resample_buffer_) {
+            LOG_ERROR("Failed to allocate resampler buffer");
+            goto cleanup;
         }
+    }
 
-            if (stop_requested_) break;
-        if (stop_requested_) break;
-
-            // SEEK handling - ORA FUNZIONA ANCHE IN PAUSA!
-            if (seek_seconds_ >= 0) {
-                uint64_t target_frame = (uint64_t)seek_seconds_ * sample_rate;
-                if (target_frame > total_pcm_frames_) {
-                    target_frame = total_pcm_frames_;
-                }
-
-                uint32_t seek_start_ms = millis();
-                uint64_t seek_distance = (target_frame > current_played_frames_)
-                    ? (target_frame - current_played_frames_)
-                    : (current_played_frames_ - target_frame);
-
-                LOG_INFO("=== SEEK START: from frame %llu to %llu (distance: %llu frames, %u sec) ===",
-                         current_played_frames_, target_frame, seek_distance, seek_seconds_);
-
-                // Pulisci buffer DMA I2S per evitare suoni ripetuti durante seek
-                output_.stop();
-                uint32_t after_i2s_clear_ms = millis();
-
-                bool seek_success = false;
-
-                // Prova il seek temporale se la sorgente lo supporta (es. TimeshiftManager)
-                IDataSource* ds_nc = const_cast<IDataSource*>(stream_->data_source());
-                if (ds_nc) {
-                    uint32_t target_ms = (uint32_t)seek_seconds_ * 1000;
-                    size_t byte_offset = ds_nc->seek_to_time(target_ms);
-
-                    if (byte_offset != SIZE_MAX) {
-                        // La sorgente supporta il seek temporale - usa il byte offset ritornato!
-                        LOG_INFO("Temporal seek to %u ms → byte offset %u", target_ms, (unsigned)byte_offset);
-
-                        // Seek diretto sulla datasource - NON chiamare stream_->seek(0)!
-                        // Il decoder ricomincerà automaticamente a leggere dal nuovo offset
-                        if (ds_nc->seek(byte_offset)) {
-                            // Il decoder è ora posizionato all'inizio del chunk seekato
-                            current_played_frames_ = target_frame;
-                            seek_success = true;
-                            LOG_INFO("Temporal seek successful");
-                        } else {
-                            LOG_WARN("Byte offset seek failed, trying frame seek");
-                            seek_success = stream_->seek(target_frame);
-                        }
-                    } else {
-                        // Seek temporale non supportato, usa seek a frame standard
-                        seek_success = stream_->seek(target_frame);
-                    }
-                } else {
-                    // Use standard frame-based seek for other sources
-                    seek_success = stream_->seek(target_frame);
-                }
-
-                uint32_t after_decoder_seek_ms = millis();
-
-                if (seek_success) {
-                    uint32_t seek_end_ms = millis();
-                    uint32_t total_time = seek_end_ms - seek_start_ms;
-                    uint32_t decoder_time = after_decoder_seek_ms - after_i2s_clear_ms;
-                    uint32_t i2s_clear_time = after_i2s_clear_ms - seek_start_ms;
+    LOG_INFO("Starting output loop...");
 
-                    LOG_INFO("=== SEEK COMPLETED: Total %u ms (I2S clear: %u ms, Decoder seek: %u ms) ===",
-                             total_time, i2s_clear_time, decoder_time);
-                    
-                    // CRITICAL FIX: Always update the frame counter after a successful seek
-                    // to prevent state desynchronization.
-                    current_played_frames_ = target_frame;
-                } else {
-                    LOG_WARN("Native seek failed, falling back to brute force");
-                    uint32_t brute_start_ms = millis();
-                    // Fallback a brute force per stream non-seekable
-                    while (current_played_frames_ < target_frame && !stop_requested_) {
-                         // Read small chunks to discard
-                        size_t frames_to_discard = 1024 / channels; // arbitrary small chunk
-                        size_t discard = stream_->read(pcm_buffer, frames_to_discard);
-                        if (discard == 0) break;
-                        current_played_frames_ += discard;
-                    }
-                    uint32_t brute_end_ms = millis();
-                    LOG_INFO("=== BRUTE FORCE SEEK completed in %u ms ===", brute_end_ms - brute_start_ms);
+    while (!stop_requested_) {
+        // FLUSH (seek): scarta l'audio vecchio e torna in prefill
+        if (flush_requested_) {
+            // Dissolvenza sull'ultimo tratto prima del salto; il DMA la suona e poi
+            // emette zeri (tx_desc_auto_clear), quindi non serve azzerarlo
+            if (!output_gain_.silent()) {
+                output_gain_.set_target(0, output_rate_ * kFadeMs / 1000);
+                size_t bytes = pcm_ring_.read(pcm_buffer, std::min(block_bytes, fade_bytes));
+                size_t frames = bytes / frame_bytes;
+                if (frames > 0) {
+                    render_output(pcm_buffer, frames, channels);
                 }
-
-                seek_seconds_ = -1;
+                output_gain_.snap();
+            }
+            size_t dropped = pcm_ring_.discard_all();
+            pcm_ring_.rearm_consumer();
+            resampler_.reset();
+            drift_.relock();
+            flush_requested_ = false;
+            apply_output_gain(kFadeMs);
+            if (decode_task_handle_) {
+                xTaskNotifyGive(decode_task_handle_);
             }
+            LOG_DEBUG("PCM ring flushed (%u bytes dropped)", (unsigned)dropped);
+            continue;
+        }
 
+        // PAUSE handling: a dissolvenza completata il ring resta pieno e il decoder si
+        // ferma per backpressure
+        if (pause_flag_ && output_gain_.silent()) {
+            // Alla ripresa la distanza dal live edge è cresciuta di proposito
+            drift_.relock();
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
             update_memory_min();
+            continue;
+        }
 
-            // Se un seek è stato appena eseguito, salta direttamente alla prossima iterazione
-            // per leggere i dati dalla nuova posizione, invece di entrare nel blocco 'no data'.
-         //   if (seek_seconds_ == -1 && stream_->read_ptr_updated_by_seek()) {
-         //       // non fare nulla, il seek è stato gestito, continua al prossimo read
-         //   }
-            // DECODE: DataSource → PCM
-            size_t frames_decoded = stream_->read(pcm_buffer, pcm_buffer_size_frames);
-
-            if (frames_decoded == 0) {
-                if (stop_requested_) {
-                    break;
-                }
-
-                // For live streams (timeshift), don't immediately end - wait for new chunks
-                IDataSource* ds = const_cast<IDataSource*>(stream_->data_source());
-                if (ds && ds->type() == SourceType::HTTP_STREAM) {
-                    // This is a live stream - check if it's still downloading
-                    TimeshiftManager* ts = static_cast<TimeshiftManager*>(ds);
-                    
-                    // If download is still running, wait for new chunks instead of ending
-                    if (ts && ts->is_running()) {
-                       // LOG_DEBUG("Live stream: no data available, waiting for next chunk...");
-                        // Use a shorter, more responsive delay to avoid getting stuck.
-                        // This allows the task to yield and quickly re-check for data,
-                        // making it more resilient to temporary buffer underruns in live streams.
-                     //   vTaskDelay(pdMS_TO_TICKS(50));
-                        continue; // Re-enter the loop to try reading again
-                    } else if (ts) {
-                        LOG_INFO("Live stream download has stopped. Ending playback.");
-                        // If the timeshift is no longer running, it's the end of the stream.
-                    }
+        if (!pcm_ring_.consumer_has_data(frame_bytes, decode_finished_)) {
+            if (decode_finished_ && pcm_ring_.used_bytes() == 0) {
+                if (resample_buffer_) {
+                    // Svuota la coda del filtro (latenza del resampler) con silenzio
+                    size_t tail = std::min<size_t>(resampler_.latency_frames(), kFramesPerBlock);
+                    memset(pcm_buffer, 0, tail * frame_bytes);
+                    render_output(pcm_buffer, tail, channels);
                 }
-
-                // For non-live streams or when download has stopped, this is end of stream
                 LOG_INFO("End of stream");
                 player_state_ = PlayerState::ENDED;
                 break;
             }
-
-            current_played_frames_ += frames_decoded;
-
-            // Progress callback (every 250ms)
-            uint32_t now = millis();
-            if (now - last_progress_update_ms >= kProgressUpdateIntervalMs) {
-                uint32_t pos_ms = current_position_ms();
-                uint32_t dur_ms = total_duration_ms();
-                notify_progress(pos_ms, dur_ms);
-                last_progress_update_ms = now;
+            if (pause_flag_) {
+                // Niente audio da sfumare: la pausa è immediata
+                output_gain_.snap();
+                continue;
             }
+            // Prefill o underrun: attendi che il producer scriva (il rebuffering sposta
+            // la distanza dal live edge, il servo ri-aggancia)
+            drift_.relock();
+            pcm_ring_.set_consumer_waiting(true);
+            if (!pcm_ring_.consumer_has_data(frame_bytes, decode_finished_)) {
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(cfg_.ringbuffer_receive_timeout_ms));
+            }
+            pcm_ring_.set_consumer_waiting(false);
+            continue;
+        }
 
-            if (!pause_flag_) {
-                // Apply effects chain
-                effects_chain_.process(pcm_buffer, frames_decoded);
+        // In pausa si legge solo la dissolvenza: il resto resta nel ring per la ripresa
+        size_t bytes = pcm_ring_.read(pcm_buffer, pause_flag_ ? std::min(block_bytes, fade_bytes) : block_bytes);
+        if (pcm_ring_.consumer_should_wake_producer() && decode_task_handle_) {
+            xTaskNotifyGive(decode_task_handle_);
+        }
+        size_t frames = bytes / frame_bytes;
+        if (frames == 0) {
+            continue;
+        }
 
-                size_t frames_written = output_.write(pcm_buffer, frames_decoded, channels);
-                if (frames_written < frames_decoded) {
-                     // Handle partial write or error if needed, but AudioOutput logs errors.
-                     // For now, we continue or could count dropped frames.
-                }
+        // Resampler, effetti e volume; AudioOutput logga gli errori di scrittura
+        render_output(pcm_buffer, frames, channels);
+        if (first_audio_at_ms_ == 0) {
+            first_audio_at_ms_ = std::max<uint32_t>(1, millis());
+            LOG_INFO("First audio out %u ms after start()", first_audio_at_ms_ - start_called_ms_);
+        }
+
+        // Progress callback e servo di deriva (every 250ms)
+        uint32_t now = millis();
+        if (now - last_progress_update_ms >= kProgressUpdateIntervalMs) {
+            if (drift_active_) {
+                update_drift(now);
             }
-        } // end while (!stop_requested_)
+            uint32_t pos_ms = current_position_ms();
+            uint32_t dur_ms = total_duration_ms();
+            notify_progress(pos_ms, dur_ms);
+            last_progress_update_ms = now;
+        }
+    }
 
+cleanup:
     if (pcm_buffer) {
         heap_caps_free(pcm_buffer);
         pcm_buffer = NULL;
     }
+    // Se l'output termina per primo (EOS/errore) ferma anche il decode task
+    stop_requested_ = true;
+    if (decode_task_handle_) {
+        xTaskNotifyGive(decode_task_handle_);
+    }
 
-cleanup:
     // Stream shutdown is handled by AudioPlayer::stop when resetting stream_
     // But we can end output here.
-    if (i2s_ready) {
+    if (resample_buffer_) {
+        heap_caps_free(resample_buffer_);
+        resample_buffer_ = nullptr;
+        resample_capacity_ = 0;
+    }
+    // A rate fisso I2S resta aperto per la traccia successiva (niente reinit né pop)
+    if (i2s_ready && cfg_.output_sample_rate == 0) {
         output_.end();
     }
 
@@ -765,7 +927,7 @@ cleanup:
     signal_task_done(AUDIO_TASK_DONE_BIT);
     audio_task_handle_ = NULL;
 
-    LOG_INFO("Audio task terminated");
+    LOG_INFO("Audio task terminated (underruns: %u)", (unsigned)pcm_ring_.underruns());
 
     if (final_state == PlayerState::ENDED) {
         notify_end(path_copy.c_str());
@@ -775,3 +937,178 @@ cleanup:
 
     vTaskDelete(NULL);
 }
+
+void AudioPlayer::decode_task() {
+    LOG_INFO("Decode task started (core %d)", (int)xPortGetCoreID());
+
+    const uint32_t channels = current_channels_;
+    const uint32_t sample_rate = current_sample_rate_;
+    const size_t frame_bytes = channels * kBytesPerSample;
+    const size_t block_bytes = kFramesPerBlock * frame_bytes;
+
+    // ===== ALLOCATE TEMP PCM BUFFER =====
+    int16_t* pcm_buffer = (int16_t*)heap_caps_malloc(block_bytes, MALLOC_CAP_8BIT);
+    if (!pcm_buffer) {
+        LOG_ERROR("Failed to allocate decode buffer");
+        schedule_recovery(FailureReason::DECODER_INIT, "decode buffer alloc failed");
+    }
+
+    // File senza header Xing/VBRI: total_frames() è una stima CBR finché l'indice in background
+    // non termina, poi diventa il conteggio esatto. Si rilegge qui (clamp del seek e durata)
+    uint32_t last_total_refresh_ms = millis();
+
+    while (pcm_buffer && stream_ && !stop_requested_) {
+        // SEEK handling - funziona anche in pausa
+        if (seek_seconds_ >= 0) {
+            uint64_t target_frame = (uint64_t)seek_seconds_ * sample_rate;
+            total_pcm_frames_ = stream_->total_frames();
+            if (target_frame > total_pcm_frames_) {
+                target_frame = total_pcm_frames_;
+            }
+
+            uint32_t seek_start_ms = millis();
+            uint64_t seek_distance = (target_frame > current_played_frames_)
+                ? (target_frame - current_played_frames_)
+                : (current_played_frames_ - target_frame);
+
+            LOG_INFO("=== SEEK START: from frame %llu to %llu (distance: %llu frames, %u sec) ===",
+                     current_played_frames_, target_frame, seek_distance, seek_seconds_);
+
+            // Svuota ring e DMA I2S per evitare suoni ripetuti durante seek
+            request_output_flush();
+            uint32_t after_flush_ms = millis();
+
+            bool seek_success = false;
+
+            // Prova il seek temporale se la sorgente lo supporta (es. TimeshiftManager)
+            IDataSource* ds_nc = const_cast<IDataSource*>(stream_->data_source());
+            uint64_t landed_frame = target_frame;
+            if (ds_nc) {
+                uint32_t target_ms = (uint32_t)seek_seconds_ * 1000;
+                TimeSeekPoint point;
+                size_t byte_offset = ds_nc->seek_to_time(target_ms, &point);
+
+                if (byte_offset != SIZE_MAX && point.exact) {
+                    // Frame esatto dalla seek table della sorgente: il decoder riparte dal confine
+                    // di frame (con pre-roll) e scarta i campioni fino al target
+                    LOG_INFO("Temporal seek to %u ms → frame %llu (landed at %u ms)",
+                             target_ms, point.stream_frame, point.landed_ms);
+                    seek_success = stream_->seek(point.stream_frame);
+                    if (seek_success) {
+                        landed_frame = point.landed_frame;
+                        stream_frame_base_ = point.stream_frame - point.landed_frame;
+                        stream_frame_base_valid_ = true;
+                    }
+                } else if (byte_offset != SIZE_MAX) {
+                    // Offset stimato: seek diretto sulla datasource, il decoder si risincronizza
+                    LOG_INFO("Temporal seek to %u ms → byte offset %u (estimated)", target_ms, (unsigned)byte_offset);
+                    if (ds_nc->seek(byte_offset)) {
+                        seek_success = true;
+                        landed_frame = (uint64_t)point.landed_ms * sample_rate / 1000;
+                        stream_frame_base_valid_ = false;
+                        LOG_INFO("Temporal seek successful");
+                    } else {
+                        LOG_WARN("Byte offset seek failed, trying frame seek");
+                        seek_success = stream_->seek(target_frame);
+                    }
+                } else {
+                    // Seek temporale non supportato, usa seek a frame standard
+                    seek_success = stream_->seek(target_frame);
+                }
+            } else {
+                // Use standard frame-based seek for other sources
+                seek_success = stream_->seek(target_frame);
+            }
+
+            uint32_t after_decoder_seek_ms = millis();
+
+            if (seek_success) {
+                LOG_INFO("=== SEEK COMPLETED: Total %u ms (ring flush: %u ms, Decoder seek: %u ms) ===",
+                         after_decoder_seek_ms - seek_start_ms,
+                         after_flush_ms - seek_start_ms,
+                         after_decoder_seek_ms - after_flush_ms);
+
+                // Il contatore riparte dal frame effettivamente raggiunto, non da quello chiesto
+                current_played_frames_ = landed_frame;
+            } else {
+                LOG_WARN("Native seek failed, falling back to brute force");
+                uint32_t brute_start_ms = millis();
+                // Fallback a brute force per stream non-seekable
+                while (current_played_frames_ < target_frame && !stop_requested_) {
+                    // Read small chunks to discard
+                    size_t frames_to_discard = 1024 / channels; // arbitrary small chunk
+                    size_t discard = stream_->read(pcm_buffer, frames_to_discard);
+                    if (discard == 0) break;
+                    current_played_frames_ += discard;
+                }
+                LOG_INFO("=== BRUTE FORCE SEEK completed in %u ms ===", millis() - brute_start_ms);
+            }
+
+            seek_seconds_ = -1;
+        }
+
+        // BACKPRESSURE: attendi spazio nel ring (watermark con isteresi)
+        if (!pcm_ring_.producer_has_room(block_bytes)) {
+            pcm_ring_.set_producer_waiting(true);
+            if (!pcm_ring_.producer_has_room(block_bytes)) {
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(cfg_.ringbuffer_send_timeout_ms));
+            }
+            pcm_ring_.set_producer_waiting(false);
+            continue;
+        }
+
+        // DECODE: DataSource → PCM
+        size_t frames_decoded = stream_->read(pcm_buffer, kFramesPerBlock);
+
+        if (frames_decoded == 0) {
+            if (stop_requested_) {
+                break;
+            }
+
+            // For live streams (timeshift), don't immediately end - wait for new chunks
+            const IDataSource* ds = stream_->data_source();
+            if (ds && ds->type() == SourceType::HTTP_STREAM) {
+                TimeshiftManager* ts = ds->timeshift();
+                if (ts && ts->is_running()) {
+                    // Il ring copre l'attesa: dormi fino al prossimo chunk READY (o stop)
+                    ts->wait_for_data(kLiveDataWaitMs);
+                    continue;
+                } else if (ts) {
+                    LOG_INFO("Live stream download has stopped. Ending playback.");
+                }
+            }
+
+            // End of stream: l'output task svuota il ring e chiude
+            LOG_INFO("Decoder reached end of stream");
+            break;
+        }
+
+        pcm_ring_.write(pcm_buffer, frames_decoded * frame_bytes);
+        current_played_frames_ += frames_decoded;
+
+        if (pcm_ring_.consumer_waiting() && audio_task_handle_) {
+            xTaskNotifyGive(audio_task_handle_);
+        }
+
+        if (millis() - last_total_refresh_ms >= kTotalFramesRefreshMs) {
+            total_pcm_frames_ = stream_->total_frames();
+            last_total_refresh_ms = millis();
+        }
+
+        update_memory_min();
+    }
+
+    if (pcm_buffer) {
+        heap_caps_free(pcm_buffer);
+    }
+
+    decode_finished_ = true;
+    if (audio_task_handle_) {
+        xTaskNotifyGive(audio_task_handle_);
+    }
+    signal_task_done(DECODE_TASK_DONE_BIT);
+    decode_task_handle_ = NULL;
+
+    LOG_INFO("Decode task terminated");
+    vTaskDelete(NULL);
+}
@@ -21,6 +21,10 @@
 #include "data_source_sdcard.h"
 #include "data_source_http.h"
 #include "audio_effects.h"
+#include "digital_gain.h"
+#include "resampler.h"
+#include "drift_compensator.h"
+#include "pcm_ring_buffer.h"
 
 enum class PlayerState {
     STOPPED,
@@ -62,6 +66,8 @@ bool select_source(std::unique_ptr<IDataSource> source);
     void set_pause(bool pause);  // Set pause state programmatically
     void request_seek(int seconds);
     void set_volume(int vol_pct);
+    void set_mute(bool mute);    // Sfuma a zero senza fermare la riproduzione
+    bool is_muted() const { return muted_; }
     void print_status() const;
     void handle_recovery_if_needed();
     void tick_housekeeping();
@@ -75,12 +81,24 @@ bool select_source(std::unique_ptr<IDataSource> source);
         return current_source_to_arm_.get(); 
     }
 
-    // ring buffer exposed for CLI status (legacy/unused)
-    size_t ring_buffer_used() const { return 0; }
-    size_t ring_buffer_size() const { return 0; }
+    // PCM ring tra decode task e output task
+    size_t ring_buffer_used() const { return pcm_ring_.used_bytes(); }
+    size_t ring_buffer_size() const { return pcm_ring_.capacity(); }
+    uint32_t ring_underruns() const { return pcm_ring_.underruns(); }
+    // millis() del primo blocco scritto su I2S dall'ultimo start() (0 = non ancora)
+    uint32_t first_audio_at_ms() const { return first_audio_at_ms_; }
     uint32_t current_sample_rate() const { return current_sample_rate_; }
+    uint32_t output_sample_rate() const { return output_rate_; }
+    // Stream live: trim corrente del resampler (ppm) e distanza dal live edge (-1 = non live)
+    float drift_ppm() const { return drift_ppm_; }
+    int32_t live_edge_distance_ms() const { return live_distance_ms_; }
     uint64_t total_frames() const { return total_pcm_frames_; }
-    uint64_t played_frames() const { return current_played_frames_; }
+    // Frame effettivamente inviati all'output: i frame decodificati meno quelli ancora nel ring
+    uint64_t played_frames() const {
+        uint64_t buffered = current_channels_ ? ring_buffer_used() / (current_channels_ * kBytesPerSample) : 0;
+        uint64_t decoded = current_played_frames_;
+        return decoded > buffered ? decoded - buffered : 0;
+    }
     int current_volume() const { return current_volume_percent_; }
     int saved_volume() const { return saved_volume_percent_; }
     int user_volume() const { return user_volume_percent_; }
@@ -89,13 +107,20 @@ bool select_source(std::unique_ptr<IDataSource> source);
     SourceType source_type() const;
     inline uint32_t current_position_ms() const {
         const IDataSource* ds = data_source();
+        uint64_t window_start = 0;
+        if (ds && stream_frame_base_valid_ && current_sample_rate_ > 0 && ds->window_start_frame(&window_start)) {
+            // Timeshift: frame riprodotti dall'ultimo punto esatto (avvio o seek), riportati
+            // all'inizio attuale del buffer che avanza con il riciclo dei chunk
+            uint64_t frame = stream_frame_base_ + played_frames();
+            return frame > window_start ? (uint32_t)((frame - window_start) * 1000 / current_sample_rate_) : 0;
+        }
         if (ds && ds->type() == SourceType::HTTP_STREAM) {
             // La sorgente (es. Timeshift) può riportare il tempo direttamente
             return ds->current_position_ms();
         }
         // Per file locali, calcoliamo dai frame
         if (current_sample_rate_ > 0) {
-            return (current_played_frames_ * 1000) / current_sample_rate_;
+            return (played_frames() * 1000) / current_sample_rate_;
         }
         return 0;
     }
@@ -124,6 +149,7 @@ bool select_source(std::unique_ptr<IDataSource> source);
 private:
     // Task
     static void audio_task_entry(void *param);
+    static void decode_task_entry(void *param);
     BaseType_t create_task_with_affinity(TaskFunction_t task_fn,
                                          const char *name,
                                          uint32_t stack_words,
@@ -137,6 +163,12 @@ private:
     const char *failure_reason_to_str(FailureReason reason) const;
     void schedule_recovery(FailureReason reason, const char *detail);
     void signal_task_done(EventBits_t bit);
+    bool allocate_pcm_ring();
+    void configure_pcm_ring(uint32_t sample_rate, uint32_t channels);
+    void request_output_flush();
+    void apply_output_gain(uint32_t ramp_ms);
+    size_t render_output(int16_t* pcm, size_t frames, uint32_t channels);
+    void update_drift(uint32_t now_ms);
     void wait_for_task_shutdown(uint32_t timeout_ms);
     void update_memory_min();
     void reset_memory_stats();
@@ -148,12 +180,18 @@ private:
     void notify_progress(uint32_t pos_ms, uint32_t dur_ms);
 
     // Task body
-    void audio_task();
+    void audio_task();   // Output: PCM ring -> effetti -> I2S
+    void decode_task();  // Decode: DataSource -> decoder -> PCM ring
 
     // Config/static values
     const AudioConfig cfg_;
     static constexpr uint32_t kBytesPerSample = sizeof(int16_t);
     static constexpr uint32_t kDefaultChannels = 2;
+    static constexpr uint32_t kFramesPerBlock = 2048;
+    static constexpr uint32_t kVolumeRampMs = 20;  // Rampa su cambio volume
+    static constexpr uint32_t kFadeMs = 10;        // Dissolvenza pausa/resume/mute/seek
+    static constexpr uint32_t kLiveDataWaitMs = 1000;  // Decoder sul live edge: attesa massima per giro
+    static constexpr uint32_t kTotalFramesRefreshMs = 1000;  // Durata stimata: ricontrollo dell'indice
 
     // State
     std::unique_ptr<IDataSource> current_source_to_arm_;
@@ -171,12 +209,23 @@ private:
     volatile bool stop_requested_ = false;
     volatile bool playing_ = false;
     volatile bool pause_flag_ = false;
+    volatile bool muted_ = false;
     volatile int seek_seconds_ = -1;
+    volatile bool decode_finished_ = false;
+    volatile bool flush_requested_ = false;
     PlayerState player_state_ = PlayerState::STOPPED;
 
     uint64_t total_pcm_frames_ = 0;
     uint64_t current_played_frames_ = 0;
+    // Frame, sull'asse della seek table della sorgente, a cui corrisponde current_played_frames_ = 0
+    uint64_t stream_frame_base_ = 0;
+    bool stream_frame_base_valid_ = false;
     uint32_t current_sample_rate_ = 0;
+    uint32_t current_channels_ = 0;
+    uint32_t output_rate_ = 0;              // Rate di I2S ed effetti (= traccia senza resampler)
+    uint32_t output_channels_ = 0;          // Canali di I2S ed effetti (stereo a rate fisso)
+    uint32_t start_called_ms_ = 0;
+    volatile uint32_t first_audio_at_ms_ = 0;
     int saved_volume_percent_ = 0;
     int user_volume_percent_ = 0;
     int current_volume_percent_ = 0;
@@ -186,10 +235,21 @@ private:
     volatile uint32_t recovery_attempts_ = 0;
 
     TaskHandle_t audio_task_handle_ = NULL;
+    TaskHandle_t decode_task_handle_ = NULL;
     EventGroupHandle_t playback_events_ = NULL;
 
     // Components
+    PcmRingBuffer pcm_ring_;
     AudioOutput output_;
     Id3Parser id3_parser_;
     EffectsChain effects_chain_;
+    DigitalGain output_gain_;
+    Resampler resampler_;
+    int16_t* resample_buffer_ = nullptr;    // Uscita del resampler, solo se attivo
+    size_t resample_capacity_ = 0;          // Frame
+    bool resample_active_ = false;          // Rate diversi o compensazione di deriva
+    DriftCompensator drift_;                // Solo output task
+    bool drift_active_ = false;
+    volatile float drift_ppm_ = 0.0f;
+    volatile int32_t live_distance_ms_ = -1;
 };
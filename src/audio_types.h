@@ -8,6 +8,13 @@
 #include <cstdint>
 #include "freertos/FreeRTOS.h"
 
+// Qualità del resampler verso output_sample_rate: CPU contro attenuazione in banda di stop
+enum class ResamplerQuality : uint8_t {
+    FAST,       // 16 tap, 60 dB misurati
+    BALANCED,   // 48 tap, 85 dB misurati
+    BEST,       // 96 tap, 88 dB misurati (HIGH è una macro Arduino)
+};
+
 struct AudioConfig {
     size_t ring_buffer_size_psram;
     size_t ring_buffer_size_dram;
@@ -30,9 +37,14 @@ struct AudioConfig {
     int8_t audio_task_core;
     int8_t file_task_core;
     int default_volume_percent;
+    int codec_volume_percent;      // Range hardware ES8311, impostato una volta in AudioOutput::begin()
     uint32_t i2s_write_timeout_ms;
     size_t i2s_chunk_bytes;
     uint32_t i2s_dma_buf_len;
     uint32_t i2s_dma_buf_count;
     bool i2s_use_apll;
+    uint32_t output_sample_rate;   // 0 = I2S al rate della traccia; altrimenti rate fisso + resampler
+    ResamplerQuality resampler_quality;
+    bool live_drift_compensation;  // Stream live: trim ±0.1% del resampler per seguire il clock del broadcaster
+    uint32_t live_target_ms;       // Distanza dal live edge da mantenere; 0 = quella misurata all'aggancio
 };
@@ -0,0 +1,157 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "chunk_slab_pool.h"
+#include <algorithm>
+#include <esp_heap_caps.h>
+#include "logger.h"
+
+ChunkSlabPool::~ChunkSlabPool() {
+    release_all();
+    if (lock_) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+}
+
+bool ChunkSlabPool::ensure_lock() {
+    if (!lock_) {
+        lock_ = xSemaphoreCreateMutex();
+    }
+    return lock_ != nullptr;
+}
+
+uint8_t* ChunkSlabPool::alloc_slab() const {
+    uint8_t* p = static_cast<uint8_t*>(heap_caps_malloc(slab_bytes_, MALLOC_CAP_SPIRAM));
+    if (!p) {
+        p = static_cast<uint8_t*>(heap_caps_malloc(slab_bytes_, MALLOC_CAP_8BIT));
+    }
+    return p;
+}
+
+bool ChunkSlabPool::init(size_t slab_bytes, size_t count) {
+    if (slab_bytes == 0 || !ensure_lock()) {
+        return false;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const bool in_use = free_.size() != slabs_.size();
+    xSemaphoreGive(lock_);
+    if (in_use) {
+        LOG_ERROR("ChunkSlabPool: init with %u slabs still in use",
+                  (unsigned)(slabs_.size() - free_.size()));
+        return false;
+    }
+
+    if (slab_bytes != slab_bytes_) {
+        release_all();
+        slab_bytes_ = slab_bytes;
+    }
+    shrink(count);
+    return grow(count);
+}
+
+bool ChunkSlabPool::grow(size_t count) {
+    if (slab_bytes_ == 0 || !ensure_lock()) {
+        return false;
+    }
+    bool ok = true;
+    while (total() < count) {
+        uint8_t* slab = alloc_slab();
+        if (!slab) {
+            LOG_ERROR("ChunkSlabPool: cannot allocate slab %u/%u (%u KB)",
+                      (unsigned)(total() + 1), (unsigned)count, (unsigned)(slab_bytes_ / 1024));
+            ok = false;
+            break;
+        }
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        slabs_.push_back(slab);
+        free_.push_back(slab);
+        xSemaphoreGive(lock_);
+    }
+    LOG_DEBUG("ChunkSlabPool: %u slabs x %u KB (%u free)",
+              (unsigned)total(), (unsigned)(slab_bytes_ / 1024), (unsigned)available());
+    return ok;
+}
+
+size_t ChunkSlabPool::shrink(size_t count) {
+    if (!lock_) {
+        return 0;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    while (slabs_.size() > count && !free_.empty()) {
+        uint8_t* slab = free_.back();
+        free_.pop_back();
+        slabs_.erase(std::find(slabs_.begin(), slabs_.end(), slab));
+        heap_caps_free(slab);
+    }
+    const size_t remaining = slabs_.size();
+    xSemaphoreGive(lock_);
+    return remaining;
+}
+
+void ChunkSlabPool::release_all() {
+    if (lock_) {
+        xSemaphoreTake(lock_, portMAX_DELAY);
+    }
+    for (uint8_t* slab : slabs_) {
+        heap_caps_free(slab);
+    }
+    slabs_.clear();
+    free_.clear();
+    if (lock_) {
+        xSemaphoreGive(lock_);
+    }
+}
+
+uint8_t* ChunkSlabPool::acquire() {
+    if (!lock_) {
+        return nullptr;
+    }
+    uint8_t* slab = nullptr;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (!free_.empty()) {
+        slab = free_.back();
+        free_.pop_back();
+    }
+    xSemaphoreGive(lock_);
+    return slab;
+}
+
+void ChunkSlabPool::release(uint8_t* slab) {
+    if (!slab || !lock_) {
+        return;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const bool owned = std::find(slabs_.begin(), slabs_.end(), slab) != slabs_.end();
+    const bool already_free = std::find(free_.begin(), free_.end(), slab) != free_.end();
+    if (owned && !already_free) {
+        free_.push_back(slab);
+    }
+    xSemaphoreGive(lock_);
+    if (!owned) {
+        LOG_WARN("ChunkSlabPool: release of foreign pointer %p", slab);
+    } else if (already_free) {
+        LOG_WARN("ChunkSlabPool: double release of slab %p", slab);
+    }
+}
+
+size_t ChunkSlabPool::total() const {
+    if (!lock_) {
+        return slabs_.size();
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const size_t n = slabs_.size();
+    xSemaphoreGive(lock_);
+    return n;
+}
+
+size_t ChunkSlabPool::available() const {
+    if (!lock_) {
+        return free_.size();
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const size_t n = free_.size();
+    xSemaphoreGive(lock_);
+    return n;
+}
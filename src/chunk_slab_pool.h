@@ -0,0 +1,55 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Pool di slab a dimensione fissa (un chunk di timeshift ciascuno), allocati una volta
+// sola e poi riciclati. Lo slab passa di mano senza copie: il download task ci scrive
+// direttamente i byte di rete, il writer task lo riceve dalla coda e lo scrive su SD
+// (poi lo rilascia) oppure lo tiene come storage del chunk READY in modalità PSRAM,
+// finché il cleanup non lo rilascia. Niente malloc/free per chunk: la PSRAM non si
+// frammenta anche su sessioni lunghe.
+//
+// acquire() e release() sono thread-safe; init/grow/shrink/release_all vanno chiamati
+// da un solo task alla volta.
+class ChunkSlabPool {
+public:
+    ChunkSlabPool() = default;
+    ~ChunkSlabPool();
+    ChunkSlabPool(const ChunkSlabPool&) = delete;
+    ChunkSlabPool& operator=(const ChunkSlabPool&) = delete;
+
+    // Fissa la dimensione degli slab e ne alloca count; fallisce se ci sono slab in uso
+    bool init(size_t slab_bytes, size_t count);
+    // Porta il totale ad almeno count slab (passaggio a PSRAM_ONLY)
+    bool grow(size_t count);
+    // Libera slab liberi finché il totale scende a count; restituisce il totale raggiunto
+    size_t shrink(size_t count);
+    // Libera tutti gli slab, compresi quelli ancora assegnati (solo a task fermi)
+    void release_all();
+
+    // nullptr se tutti gli slab sono in uso
+    uint8_t* acquire();
+    // Ignora nullptr; segnala puntatori estranei o doppi rilasci
+    void release(uint8_t* slab);
+
+    size_t slab_bytes() const { return slab_bytes_; }
+    size_t total() const;
+    size_t available() const;
+
+private:
+    SemaphoreHandle_t lock_ = nullptr;
+    size_t slab_bytes_ = 0;
+    std::vector<uint8_t*> slabs_;   // Tutti gli slab allocati
+    std::vector<uint8_t*> free_;    // Liberi, LIFO: si riusa lo slab toccato più di recente
+
+    uint8_t* alloc_slab() const;
+    bool ensure_lock();
+};
@@ -6,8 +6,10 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
 class Mp3SeekTable;
+class TimeshiftManager;
 
 enum class SourceType {
     LITTLEFS,
@@ -15,6 +17,15 @@ enum class SourceType {
     HTTP_STREAM
 };
 
+// Punto di arrivo di IDataSource::seek_to_time()
+struct TimeSeekPoint {
+    size_t byte_offset = SIZE_MAX;  // Confine di frame MPEG da cui riparte la lettura
+    uint64_t stream_frame = 0;      // Frame di arrivo sull'asse di get_seek_table() (per il decoder)
+    uint64_t landed_frame = 0;      // Lo stesso frame, relativo all'inizio dei dati disponibili
+    uint32_t landed_ms = 0;         // landed_frame in millisecondi
+    bool exact = false;             // false: offset stimato (nessuna seek table), frame non validi
+};
+
 class IDataSource {
 public:
     virtual ~IDataSource() = default;
@@ -35,11 +46,27 @@ public:
     virtual SourceType type() const = 0;
     virtual const char* uri() const = 0;
     
+    // Optional: timestamp di ultima modifica (epoch s), 0 se non disponibile
+    virtual uint32_t last_modified() const { return 0; }
+
+    // Optional: apre un secondo handle indipendente sulla stessa risorsa (es. per
+    // indicizzare il file in background senza toccare la posizione di lettura).
+    // nullptr se la sorgente non lo supporta (stream live).
+    virtual std::unique_ptr<IDataSource> duplicate() const { return nullptr; }
+
     // Optional: Provide a build-in seek table (e.g. for Timeshift)
     virtual const Mp3SeekTable* get_seek_table() const { return nullptr; }
 
-    // Optional: Temporal seek for streamable sources
-    virtual size_t seek_to_time(uint32_t target_ms) { return SIZE_MAX; }
+    // Optional: Temporal seek for streamable sources. target_ms è relativo all'inizio dei dati
+    // disponibili; ritorna il byte offset di arrivo (SIZE_MAX = non supportato) e, se point
+    // non è null, dove si atterra davvero
+    virtual size_t seek_to_time(uint32_t target_ms, TimeSeekPoint* point = nullptr) { return SIZE_MAX; }
+    // Optional: frame, sull'asse di get_seek_table(), dell'inizio dei dati disponibili (lo zero
+    // di seek_to_time() e current_position_ms()). Avanza quando il timeshift ricicla i chunk
+    virtual bool window_start_frame(uint64_t* frame) const { return false; }
+    // Optional: frame da cui parte la lettura di un reader nuovo. Coincide con l'inizio della
+    // finestra salvo quando la storia ripresa da una sessione precedente è solo rewind
+    virtual bool read_start_frame(uint64_t* frame) const { return window_start_frame(frame); }
 
     // Optional: allow cooperative stop when playback is interrupted
     virtual void request_stop() {}
@@ -47,4 +74,12 @@ public:
     // Optional: For sources that can report temporal progress
     virtual uint32_t current_position_ms() const { return 0; }
     virtual uint32_t total_duration_ms() const { return 0; }
+
+    // Optional: per le sorgenti live, ms di audio tra la posizione di lettura e la testa
+    // del download (live edge). -1 se la sorgente non è live. Chiamabile da altri task.
+    virtual int32_t live_edge_distance_ms() const { return -1; }
+
+    // Optional: il TimeshiftManager dietro la sorgente (lui stesso o una vista di lettura
+    // su una registrazione), per attese sul live edge e statistiche. nullptr altrimenti
+    virtual TimeshiftManager* timeshift() const { return nullptr; }
 };
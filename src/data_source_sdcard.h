@@ -34,6 +34,7 @@ public:
         if (file_) {
             uri_ = uri;
             size_ = file_.size();
+            last_write_ = static_cast<uint32_t>(file_.getLastWrite());
             return true;
         }
         return false;
@@ -45,6 +46,7 @@ public:
         }
         uri_.clear();
         size_ = 0;
+        last_write_ = 0;
     }
 
     size_t read(void* buffer, size_t size) override {
@@ -85,8 +87,21 @@ public:
         return uri_.c_str();
     }
 
+    uint32_t last_modified() const override {
+        return last_write_;
+    }
+
+    std::unique_ptr<IDataSource> duplicate() const override {
+        std::unique_ptr<IDataSource> copy(new SDCardSource());
+        if (uri_.length() == 0 || !copy->open(uri_.c_str())) {
+            return nullptr;
+        }
+        return copy;
+    }
+
 private:
     File file_;
     String uri_;
     size_t size_ = 0;
+    uint32_t last_write_ = 0;
 };
@@ -0,0 +1,284 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#include "decode_benchmark.h"
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "audio_decoder_factory.h"
+#include "data_source_littlefs.h"
+#include "data_source_sdcard.h"
+#include "logger.h"
+
+namespace {
+
+// Proxy che conta i byte effettivamente letti dal decoder
+class CountingSource : public IDataSource {
+public:
+    explicit CountingSource(IDataSource* inner) : inner_(inner) {}
+
+    size_t read(void* buffer, size_t size) override {
+        size_t n = inner_->read(buffer, size);
+        bytes_read_ += n;
+        return n;
+    }
+    bool seek(size_t position) override { return inner_->seek(position); }
+    size_t tell() const override { return inner_->tell(); }
+    size_t size() const override { return inner_->size(); }
+    bool open(const char* uri) override { return inner_->open(uri); }
+    void close() override { inner_->close(); }
+    bool is_open() const override { return inner_->is_open(); }
+    bool is_seekable() const override { return inner_->is_seekable(); }
+    SourceType type() const override { return inner_->type(); }
+    const char* uri() const override { return inner_->uri(); }
+    const Mp3SeekTable* get_seek_table() const override { return inner_->get_seek_table(); }
+    std::unique_ptr<IDataSource> duplicate() const override { return inner_->duplicate(); }
+
+    uint64_t bytes_read() const { return bytes_read_; }
+    void reset_count() { bytes_read_ = 0; }
+
+private:
+    IDataSource* inner_;
+    uint64_t bytes_read_ = 0;
+};
+
+struct HeapProbe {
+    size_t base_internal;
+    size_t base_psram;
+    size_t min_internal;
+    size_t min_psram;
+
+    void begin() {
+        base_internal = min_internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        base_psram = min_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    }
+    void sample() {
+        min_internal = std::min(min_internal, heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+        min_psram = std::min(min_psram, heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    }
+};
+
+constexpr size_t kMaxPresizedSamples = 65536;
+
+void* alloc_work(size_t bytes) {
+    void* ptr = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (!ptr) {
+        ptr = heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    }
+    return ptr;
+}
+
+struct BenchTaskContext {
+    const char* uri;
+    const DecodeBenchOptions* options;
+    DecodeBenchResult* result;
+    TaskHandle_t caller;
+    bool ok;
+};
+
+void bench_task_entry(void* arg) {
+    BenchTaskContext* ctx = static_cast<BenchTaskContext*>(arg);
+    ctx->ok = run_decode_benchmark(ctx->uri, *ctx->options, *ctx->result);
+    xTaskNotifyGive(ctx->caller);
+    vTaskDelete(NULL);
+}
+
+uint32_t percentile(uint32_t* sorted, uint32_t count, uint32_t pct) {
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t idx = (uint32_t)(((uint64_t)(count - 1) * pct + 50) / 100);
+    return sorted[idx];
+}
+
+} // namespace
+
+bool run_decode_benchmark(IDataSource* source, const char* label,
+                          const DecodeBenchOptions& options, DecodeBenchResult& result) {
+    memset(&result, 0, sizeof(result));
+    result.format = AudioFormat::UNKNOWN;
+    snprintf(result.label, sizeof(result.label), "%s", label ? label : "");
+
+    if (!source || !source->is_open() || options.frames_per_block == 0) {
+        LOG_ERROR("DecodeBench: invalid source or options");
+        return false;
+    }
+    source->seek(0);
+
+    // Campioni per-blocco dimensionati dalla size della sorgente (caso peggiore ~1 byte
+    // ogni 32 frame), allocati prima della baseline heap così non sporcano il picco del decoder.
+    size_t source_size = source->size();
+    uint32_t sample_capacity = (uint32_t)std::min<size_t>(source_size / 32 / options.frames_per_block + 64,
+                                                          kMaxPresizedSamples);
+    uint32_t* samples = static_cast<uint32_t*>(alloc_work(sample_capacity * sizeof(uint32_t)));
+    int16_t* pcm = static_cast<int16_t*>(alloc_work(options.frames_per_block * 2 * sizeof(int16_t)));
+    if (!samples || !pcm) {
+        LOG_ERROR("DecodeBench: cannot allocate work buffers");
+        heap_caps_free(samples);
+        heap_caps_free(pcm);
+        return false;
+    }
+
+    CountingSource counting(source);
+    HeapProbe heap;
+    heap.begin();
+
+    std::unique_ptr<IAudioDecoder> decoder = AudioDecoderFactory::create_from_source(&counting);
+    if (!decoder) {
+        heap_caps_free(samples);
+        heap_caps_free(pcm);
+        return false;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    bool init_ok = decoder->init(&counting, options.frames_per_block, options.build_seek_table);
+    result.init_us = (uint64_t)(esp_timer_get_time() - t0);
+    heap.sample();
+    if (!init_ok) {
+        LOG_ERROR("DecodeBench: decoder init failed for %s", result.label);
+        decoder.reset();
+        heap_caps_free(samples);
+        heap_caps_free(pcm);
+        return false;
+    }
+
+    result.format = decoder->format();
+    result.sample_rate = decoder->sample_rate();
+    result.channels = decoder->channels();
+    counting.reset_count();
+
+    if (result.channels > 2) {
+        LOG_ERROR("DecodeBench: %u channels not supported", (unsigned)result.channels);
+        decoder.reset();
+        heap_caps_free(samples);
+        heap_caps_free(pcm);
+        return false;
+    }
+
+    while (options.max_blocks == 0 || result.blocks < options.max_blocks) {
+        int64_t start = esp_timer_get_time();
+        uint64_t got = decoder->read_frames(pcm, options.frames_per_block);
+        uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+        if (got == 0) {
+            break;
+        }
+        heap.sample();
+
+        if (result.blocks == sample_capacity) {
+            uint32_t new_capacity = sample_capacity * 2;
+            uint32_t* grown = static_cast<uint32_t*>(
+                heap_caps_realloc(samples, new_capacity * sizeof(uint32_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+            if (!grown) {
+                LOG_WARN("DecodeBench: sample buffer full, stopping at %u blocks", (unsigned)result.blocks);
+                break;
+            }
+            samples = grown;
+            sample_capacity = new_capacity;
+        }
+        samples[result.blocks++] = elapsed;
+        result.decode_us += elapsed;
+        result.frames += got;
+
+        // Lascia respirare idle task / watchdog sul device
+        if ((result.blocks & 63) == 0) {
+            vTaskDelay(1);
+        }
+    }
+
+    result.bitrate_kbps = decoder->bitrate();
+    result.source_bytes = counting.bytes_read();
+    decoder->shutdown();
+    decoder.reset();
+
+    std::sort(samples, samples + result.blocks);
+    result.block_us_p50 = percentile(samples, result.blocks, 50);
+    result.block_us_p99 = percentile(samples, result.blocks, 99);
+    result.block_us_max = result.blocks ? samples[result.blocks - 1] : 0;
+
+    if (result.decode_us > 0 && result.sample_rate > 0) {
+        double audio_us = (double)result.frames * 1000000.0 / result.sample_rate;
+        result.realtime_factor = (float)(audio_us / (double)result.decode_us);
+    }
+    if (result.frames > 0) {
+        result.bytes_per_frame = (float)result.source_bytes / (float)result.frames;
+    }
+    result.heap_peak_internal = heap.base_internal - heap.min_internal;
+    result.heap_peak_psram = heap.base_psram - heap.min_psram;
+    result.ok = result.frames > 0;
+
+    heap_caps_free(samples);
+    heap_caps_free(pcm);
+    return result.ok;
+}
+
+bool run_decode_benchmark(const char* uri, const DecodeBenchOptions& options, DecodeBenchResult& result) {
+    std::unique_ptr<IDataSource> source;
+    if (uri && strncmp(uri, "/sd/", 4) == 0) {
+        source.reset(new SDCardSource());
+    } else {
+        source.reset(new LittleFSSource());
+    }
+    if (!uri || !source->open(uri)) {
+        memset(&result, 0, sizeof(result));
+        snprintf(result.label, sizeof(result.label), "%s", uri ? uri : "");
+        LOG_ERROR("DecodeBench: cannot open %s", uri ? uri : "(null)");
+        return false;
+    }
+    bool ok = run_decode_benchmark(source.get(), uri, options, result);
+    source->close();
+    return ok;
+}
+
+bool run_decode_benchmark_on_task(const char* uri, const DecodeBenchOptions& options, DecodeBenchResult& result,
+                                  uint32_t stack_bytes, int core) {
+    BenchTaskContext ctx = {uri, &options, &result, xTaskGetCurrentTaskHandle(), false};
+    ulTaskNotifyTake(pdTRUE, 0);
+    if (xTaskCreatePinnedToCore(bench_task_entry, "DecodeBench", stack_bytes, &ctx,
+                                tskIDLE_PRIORITY + 1, nullptr, core) != pdPASS) {
+        memset(&result, 0, sizeof(result));
+        snprintf(result.label, sizeof(result.label), "%s", uri ? uri : "");
+        LOG_ERROR("DecodeBench: cannot create benchmark task");
+        return false;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return ctx.ok;
+}
+
+const char* decode_bench_csv_header() {
+    return "label,format,sample_rate,channels,bitrate_kbps,frames,blocks,init_us,decode_us,"
+           "block_us_p50,block_us_p99,block_us_max,realtime_factor,bytes_per_frame,"
+           "heap_peak_internal,heap_peak_psram,ok";
+}
+
+int format_decode_bench(const DecodeBenchResult& r, DecodeBenchFormat format, char* buf, size_t len) {
+    if (format == DecodeBenchFormat::CSV) {
+        return snprintf(buf, len,
+                        "%s,%s,%u,%u,%u,%llu,%u,%llu,%llu,%u,%u,%u,%.2f,%.3f,%u,%u,%d",
+                        r.label, audio_format_to_string(r.format),
+                        (unsigned)r.sample_rate, (unsigned)r.channels, (unsigned)r.bitrate_kbps,
+                        (unsigned long long)r.frames, (unsigned)r.blocks,
+                        (unsigned long long)r.init_us, (unsigned long long)r.decode_us,
+                        (unsigned)r.block_us_p50, (unsigned)r.block_us_p99, (unsigned)r.block_us_max,
+                        r.realtime_factor, r.bytes_per_frame,
+                        (unsigned)r.heap_peak_internal, (unsigned)r.heap_peak_psram, r.ok ? 1 : 0);
+    }
+    return snprintf(buf, len,
+                    "{\"label\":\"%s\",\"format\":\"%s\",\"sample_rate\":%u,\"channels\":%u,"
+                    "\"bitrate_kbps\":%u,\"frames\":%llu,\"blocks\":%u,\"init_us\":%llu,"
+                    "\"decode_us\":%llu,\"block_us_p50\":%u,\"block_us_p99\":%u,\"block_us_max\":%u,"
+                    "\"realtime_factor\":%.2f,\"bytes_per_frame\":%.3f,"
+                    "\"heap_peak_internal\":%u,\"heap_peak_psram\":%u,\"ok\":%s}",
+                    r.label, audio_format_to_string(r.format),
+                    (unsigned)r.sample_rate, (unsigned)r.channels, (unsigned)r.bitrate_kbps,
+                    (unsigned long long)r.frames, (unsigned)r.blocks,
+                    (unsigned long long)r.init_us, (unsigned long long)r.decode_us,
+                    (unsigned)r.block_us_p50, (unsigned)r.block_us_p99, (unsigned)r.block_us_max,
+                    r.realtime_factor, r.bytes_per_frame,
+                    (unsigned)r.heap_peak_internal, (unsigned)r.heap_peak_psram, r.ok ? "true" : "false");
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "audio_decoder.h"
+#include "data_source.h"
+
+// Benchmark di throughput dei decoder (Mp3Decoder, WavDecoder) su una sorgente.
+// Decodifica a blocchi di frames_per_block senza output I2S e misura:
+//  - tempo per blocco (p50/p99/max) e realtime factor (durata audio / tempo di decodifica)
+//  - byte letti dalla sorgente per frame PCM prodotto
+//  - picco di heap interna/PSRAM rispetto allo stato prima dell'init del decoder
+// Gira identico su device (comando CLI 'b') e nel build host (openespaudio_decode_bench).
+
+struct DecodeBenchOptions {
+    size_t frames_per_block = 2048;
+    uint32_t max_blocks = 0;          // 0 = fino a EOF
+    bool build_seek_table = false;    // Include il costo della seek table nell'init
+};
+
+struct DecodeBenchResult {
+    char label[96];
+    bool ok;
+    AudioFormat format;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t bitrate_kbps;
+
+    uint64_t frames;
+    uint32_t blocks;
+    uint64_t source_bytes;            // Byte letti dalla sorgente durante la decodifica
+    uint64_t init_us;                 // init() del decoder (probe + eventuale seek table)
+    uint64_t decode_us;               // Somma dei tempi di read_frames()
+
+    uint32_t block_us_p50;
+    uint32_t block_us_p99;
+    uint32_t block_us_max;
+
+    float realtime_factor;            // >1 = più veloce del tempo reale
+    float bytes_per_frame;
+
+    size_t heap_peak_internal;
+    size_t heap_peak_psram;
+};
+
+enum class DecodeBenchFormat {
+    JSON,
+    CSV
+};
+
+// Esegue il benchmark sulla sorgente (già aperta; viene riportata all'inizio).
+// label finisce nel report (tipicamente l'URI). Ritorna false se il decoder non si inizializza.
+bool run_decode_benchmark(IDataSource* source, const char* label,
+                          const DecodeBenchOptions& options, DecodeBenchResult& result);
+
+// Come sopra, aprendo l'URI con LittleFS o SD (prefisso "/sd/").
+bool run_decode_benchmark(const char* uri, const DecodeBenchOptions& options, DecodeBenchResult& result);
+
+// Come sopra, ma su un task dedicato (il decoder MP3 richiede ~32 KB di stack, più
+// del loopTask Arduino). Blocca il chiamante fino al termine.
+bool run_decode_benchmark_on_task(const char* uri, const DecodeBenchOptions& options, DecodeBenchResult& result,
+                                  uint32_t stack_bytes = 32768, int core = 0);
+
+// Serializza un risultato in una riga JSON (un oggetto per riga) o CSV.
+// Ritorna i caratteri scritti (snprintf semantics, troncato a len).
+int format_decode_bench(const DecodeBenchResult& result, DecodeBenchFormat format, char* buf, size_t len);
+const char* decode_bench_csv_header();
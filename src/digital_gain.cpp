@@ -0,0 +1,93 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "digital_gain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+inline int16_t scale_sample(int16_t s, int32_t g) {
+    // g <= kUnity: il prodotto sta in int32 e il risultato in int16, niente clamp
+    return (int16_t)(((int32_t)s * g + (1 << 14)) >> 15);
+}
+
+} // namespace
+
+int32_t DigitalGain::volume_to_q15(int vol_pct) {
+    if (vol_pct <= 0) return 0;
+    if (vol_pct >= 100) return kUnity;
+    // Stessa curva della mappa hardware del codec (radice di [0,1] → -26..0 dB)
+    float normalized = (float)(vol_pct - 1) / 99.0f;
+    float gain_db = -kVolumeRangeDb * (1.0f - sqrtf(normalized));
+    return (int32_t)lrintf((float)kUnity * powf(10.0f, gain_db / 20.0f));
+}
+
+void DigitalGain::set_target(int32_t gain_q15, uint32_t ramp_frames) {
+    gain_q15 = std::max<int32_t>(0, std::min<int32_t>(kUnity, gain_q15));
+    target_.store(gain_q15);
+    ramp_frames_.store(ramp_frames);
+    // Pubblicato per ultimo: il task audio rilegge target e durata dopo averlo visto
+    request_seq_.fetch_add(1, std::memory_order_release);
+}
+
+void DigitalGain::adopt_request() {
+    uint32_t seq = request_seq_.load(std::memory_order_acquire);
+    if (seq == seen_seq_) {
+        return;
+    }
+    seen_seq_ = seq;
+    target_q30_ = target_.load() << 15;
+    uint32_t ramp = ramp_frames_.load();
+    if (ramp == 0 || target_q30_ == current_) {
+        current_ = target_q30_;
+        remaining_ = 0;
+    } else {
+        remaining_ = ramp;
+        step_ = (int32_t)(((int64_t)target_q30_ - current_) / (int64_t)ramp);
+    }
+}
+
+void DigitalGain::snap() {
+    adopt_request();
+    current_ = target_q30_;
+    remaining_ = 0;
+    current_q15_.store(current_ >> 15);
+}
+
+void DigitalGain::process(int16_t* pcm, size_t frames, uint32_t channels) {
+    adopt_request();
+
+    if (remaining_ > 0) {
+        const size_t n = std::min<size_t>(frames, remaining_);
+        int32_t g = current_;
+        for (size_t f = 0; f < n; ++f) {
+            g += step_;
+            const int32_t q = g >> 15;
+            for (uint32_t c = 0; c < channels; ++c) {
+                pcm[c] = scale_sample(pcm[c], q);
+            }
+            pcm += channels;
+        }
+        remaining_ -= (uint32_t)n;
+        // Fine rampa esatta sul target (il passo intero tronca il resto della divisione)
+        current_ = remaining_ ? g : target_q30_;
+        frames -= n;
+    }
+
+    const int32_t q = current_ >> 15;
+    current_q15_.store(q);
+    if (frames == 0 || q == kUnity) {
+        return;
+    }
+    const size_t samples = frames * channels;
+    if (q == 0) {
+        memset(pcm, 0, samples * sizeof(int16_t));
+        return;
+    }
+    for (size_t i = 0; i < samples; ++i) {
+        pcm[i] = scale_sample(pcm[i], q);
+    }
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Guadagno digitale Q15 sul PCM int16, applicato dall'output task subito prima di
+// AudioOutput::write(). Sostituisce il volume del codec nel percorso volume/pausa/seek:
+// niente transazioni I2C né pow() a ogni comando, e ogni cambio è una rampa lineare
+// per frame invece di un gradino (niente click).
+//
+// Il target e la durata della rampa si impostano da qualsiasi task; il task audio li
+// adotta al blocco successivo. Internamente il guadagno è in Q30, così anche rampe
+// lunghe hanno un passo per frame non nullo.
+class DigitalGain {
+public:
+    static constexpr int32_t kUnity = 32768;        // 1.0 in Q15
+    static constexpr float kVolumeRangeDb = 26.0f;  // 1% → -26 dB (vecchia mappa hw 55..75)
+
+    // Volume utente 0..100 → guadagno Q15, con la curva del vecchio volume hardware (0 = muto)
+    static int32_t volume_to_q15(int vol_pct);
+
+    // Qualsiasi task: porta il guadagno a gain_q15 in ramp_frames frame (0 = subito)
+    void set_target(int32_t gain_q15, uint32_t ramp_frames);
+    int32_t target() const { return target_.load(); }
+    // Guadagno all'ultimo frame processato (Q15)
+    int32_t current() const { return current_q15_.load(); }
+    // Target muto e rampa completata: l'uscita è silenzio
+    bool silent() const { return target_.load() == 0 && current_q15_.load() == 0; }
+
+    // Task audio
+    void process(int16_t* pcm, size_t frames, uint32_t channels);
+    // Adotta subito il target, interrompendo la rampa (es. nessun audio da sfumare)
+    void snap();
+
+private:
+    std::atomic<int32_t> target_{kUnity};
+    std::atomic<uint32_t> ramp_frames_{0};
+    std::atomic<uint32_t> request_seq_{0};
+    std::atomic<int32_t> current_q15_{kUnity};
+
+    // Stato del task audio
+    uint32_t seen_seq_ = 0;
+    int32_t current_ = kUnity << 15;   // Q30
+    int32_t target_q30_ = kUnity << 15;
+    int32_t step_ = 0;
+    uint32_t remaining_ = 0;
+
+    void adopt_request();
+};
@@ -0,0 +1,67 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "drift_compensator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float clampf(float v, float limit) {
+    return std::max(-limit, std::min(limit, v));
+}
+
+} // namespace
+
+void DriftCompensator::reset() {
+    relock();
+    integral_ppm_ = 0.0f;
+    ppm_ = 0.0f;
+}
+
+void DriftCompensator::relock() {
+    started_ = false;
+    locked_ = false;
+    ppm_ = integral_ppm_;
+}
+
+float DriftCompensator::update(int32_t distance_ms, uint32_t now_ms) {
+    if (distance_ms < 0) {
+        return ppm_;
+    }
+    if (!started_) {
+        started_ = true;
+        start_ms_ = now_ms;
+        last_ms_ = now_ms;
+        samples_ = 1;
+        filtered_ms_ = (float)distance_ms;
+        return ppm_;
+    }
+
+    const float dt = (float)(now_ms - last_ms_) * 0.001f;
+    if (dt <= 0.0f) {
+        return ppm_;
+    }
+    last_ms_ = now_ms;
+    // Media semplice finché ha meno campioni della costante di tempo, poi esponenziale:
+    // all'aggancio il target non dipende dal singolo burst dell'avvio
+    float alpha = 1.0f - expf(-dt / std::max(0.1f, params_.filter_tau_s));
+    ++samples_;
+    alpha = std::max(alpha, 1.0f / (float)samples_);
+    filtered_ms_ += ((float)distance_ms - filtered_ms_) * alpha;
+
+    if (!locked_) {
+        if (now_ms - start_ms_ < params_.settle_ms) {
+            return ppm_;
+        }
+        target_ms_ = params_.target_ms ? (float)params_.target_ms : filtered_ms_;
+        locked_ = true;
+    }
+
+    // Errore positivo: il buffer cresce, il produttore è più veloce → consuma di più
+    const float error = filtered_ms_ - target_ms_;
+    integral_ppm_ = clampf(integral_ppm_ + params_.ki_ppm_per_ms_s * error * dt, params_.max_ppm);
+    ppm_ = clampf(params_.kp_ppm_per_ms * error + integral_ppm_, params_.max_ppm);
+    return ppm_;
+}
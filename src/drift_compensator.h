@@ -0,0 +1,56 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <cstdint>
+
+struct DriftParams {
+    uint32_t target_ms = 0;           // 0 = aggancia la distanza misurata (avvio, seek, ripresa)
+    float max_ppm = 1000.0f;          // Trim massimo del resampler (±0.1%)
+    float kp_ppm_per_ms = 4.0f;
+    float ki_ppm_per_ms_s = 0.004f;   // kp^2 * 1e-3 / 4: smorzamento critico
+    float filter_tau_s = 30.0f;       // Media della distanza: assorbe i burst di rete
+    uint32_t settle_ms = 5000;        // Attesa prima di agganciare il target
+};
+
+// Servo PI sulla distanza dal live edge (ms di audio tra la posizione di lettura e la
+// testa del download). Se il clock del broadcaster è più veloce di quello I2S la
+// distanza cresce: il trim positivo fa consumare al resampler un po' più ingresso per
+// frame d'uscita, e viceversa. Ogni ppm di trim sposta la distanza di 1 ms ogni 1000 s,
+// quindi la correzione è lenta e continua: niente salti né attese.
+//
+// Non thread-safe: update() e relock() vanno chiamati dallo stesso task (output task).
+class DriftCompensator {
+public:
+    void set_params(const DriftParams& params) { params_ = params; }
+    const DriftParams& params() const { return params_; }
+
+    // Azzera tutto, integratore compreso (nuova sorgente)
+    void reset();
+    // Ri-aggancia il target dopo un salto voluto della distanza (seek, pausa): filtro e
+    // target ripartono, l'integratore conserva la deriva già stimata
+    void relock();
+
+    // Nuova misura al tempo now_ms; distance_ms < 0 (sorgente non live) mantiene il trim.
+    // Restituisce il trim in ppm da passare a Resampler::set_ratio_trim()
+    float update(int32_t distance_ms, uint32_t now_ms);
+
+    float ppm() const { return ppm_; }
+    float filtered_ms() const { return filtered_ms_; }
+    float target_ms() const { return target_ms_; }
+    bool locked() const { return locked_; }
+
+private:
+    DriftParams params_;
+    bool started_ = false;
+    bool locked_ = false;
+    uint32_t start_ms_ = 0;
+    uint32_t last_ms_ = 0;
+    uint32_t samples_ = 0;
+    float filtered_ms_ = 0.0f;
+    float target_ms_ = 0.0f;
+    float integral_ppm_ = 0.0f;
+    float ppm_ = 0.0f;
+};
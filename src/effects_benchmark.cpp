@@ -0,0 +1,493 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#include "effects_benchmark.h"
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "audio_effects.h"
+#include "logger.h"
+#include "parametric_eq.h"
+#include "resampler.h"
+
+namespace {
+
+uint32_t percentile(uint32_t* sorted, uint32_t count, uint32_t pct) {
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t idx = (uint32_t)(((uint64_t)(count - 1) * pct + 50) / 100);
+    return sorted[idx];
+}
+
+// Segnale di prova: due sinusoidi (bassi + medi) e rumore LCG, ~-6 dBFS di picco
+void fill_signal(int16_t* pcm, size_t frames, uint32_t channels, uint32_t sample_rate) {
+    const float two_pi = 6.2831853f;
+    uint32_t lcg = 12345;
+    for (size_t i = 0; i < frames; ++i) {
+        float t = (float)i / (float)sample_rate;
+        lcg = lcg * 1664525u + 1013904223u;
+        float noise = ((float)(lcg >> 16) / 32768.0f - 1.0f) * 0.05f;
+        float v = 0.3f * sinf(two_pi * 110.0f * t) + 0.15f * sinf(two_pi * 2500.0f * t) + noise;
+        for (uint32_t ch = 0; ch < channels; ++ch) {
+            pcm[i * channels + ch] = (int16_t)(v * 32767.0f);
+        }
+    }
+}
+
+void make_label(const EffectsBenchOptions& o, char* out, size_t len) {
+    out[0] = '\0';
+    size_t used = 0;
+    const char* names[] = {"eq", "reverb", "echo"};
+    const bool enabled[] = {o.eq, o.reverb, o.echo};
+    for (int i = 0; i < 3; ++i) {
+        if (enabled[i]) {
+            used += snprintf(out + used, used < len ? len - used : 0, "%s%s", used ? "+" : "", names[i]);
+        }
+    }
+    if (used == 0) {
+        snprintf(out, len, "none");
+    }
+}
+
+} // namespace
+
+bool run_effects_benchmark(const EffectsBenchOptions& options, EffectsBenchResult& result) {
+    memset(&result, 0, sizeof(result));
+    make_label(options, result.label, sizeof(result.label));
+    result.sample_rate = options.sample_rate;
+    result.channels = options.channels;
+
+    if (options.sample_rate == 0 || options.frames_per_block == 0 || options.blocks == 0 ||
+        (options.channels != 1 && options.channels != 2)) {
+        LOG_ERROR("EffectsBench: invalid options");
+        return false;
+    }
+
+    // Un secondo di segnale, riletto ciclicamente: la copia nel blocco non è cronometrata
+    size_t source_frames = std::max<size_t>(options.sample_rate, options.frames_per_block);
+    size_t sample_bytes = sizeof(int16_t) * options.channels;
+    int16_t* source = static_cast<int16_t*>(heap_caps_malloc(source_frames * sample_bytes, MALLOC_CAP_SPIRAM));
+    int16_t* block = static_cast<int16_t*>(heap_caps_malloc(options.frames_per_block * sample_bytes, MALLOC_CAP_8BIT));
+    uint32_t* samples = static_cast<uint32_t*>(heap_caps_malloc(options.blocks * sizeof(uint32_t), MALLOC_CAP_8BIT));
+    std::unique_ptr<EffectsChain> chain(new EffectsChain());
+    if (!source || !block || !samples || !chain->configure(options.sample_rate, options.frames_per_block)) {
+        LOG_ERROR("EffectsBench: cannot allocate work buffers");
+        heap_caps_free(source);
+        heap_caps_free(block);
+        heap_caps_free(samples);
+        return false;
+    }
+    fill_signal(source, source_frames, options.channels, options.sample_rate);
+
+    // Parametri "pesanti" (guadagni != 1, mix > 0) per non sottostimare i percorsi
+    EQParams eq;
+    eq.bass_gain = 1.5f;
+    eq.treble_gain = 1.2f;
+    chain->setEQParams(eq);
+    chain->setEQEnabled(options.eq);
+    chain->setReverbEnabled(options.reverb);
+    chain->setEchoEnabled(options.echo);
+
+    size_t cursor = 0;
+    for (uint32_t b = 0; b < options.blocks; ++b) {
+        size_t n = options.frames_per_block;
+        if (cursor + n > source_frames) {
+            cursor = 0;
+        }
+        memcpy(block, source + cursor * options.channels, n * sample_bytes);
+        cursor += n;
+
+        int64_t start = esp_timer_get_time();
+        chain->process(block, n, options.channels);
+        uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+        samples[b] = elapsed;
+        result.process_us += elapsed;
+        result.frames += n;
+        result.blocks++;
+
+        if ((b & 63) == 63) {
+            vTaskDelay(1);
+        }
+    }
+
+    std::sort(samples, samples + result.blocks);
+    result.block_us_p50 = percentile(samples, result.blocks, 50);
+    result.block_us_p99 = percentile(samples, result.blocks, 99);
+    result.block_us_max = samples[result.blocks - 1];
+
+    result.ns_per_frame = (float)((double)result.process_us * 1000.0 / (double)result.frames);
+    result.cpu_mhz = getCpuFrequencyMhz();
+    result.cycles_per_frame = result.ns_per_frame * (float)result.cpu_mhz / 1000.0f;
+    double block_audio_us = (double)options.frames_per_block * 1000000.0 / options.sample_rate;
+    result.budget_pct = (float)(result.block_us_p99 * 100.0 / block_audio_us);
+
+    EffectNodeStats stats[EffectsBenchResult::kMaxNodes];
+    size_t count = chain->getStats(stats, EffectsBenchResult::kMaxNodes);
+    for (size_t i = 0; i < count; ++i) {
+        if (!stats[i].enabled || stats[i].frames == 0) {
+            continue;
+        }
+        EffectsBenchResult::Node& node = result.nodes[result.node_count++];
+        snprintf(node.name, sizeof(node.name), "%s", stats[i].name);
+        node.ns_per_frame = (float)((double)stats[i].total_us * 1000.0 / (double)stats[i].frames);
+        node.max_us = stats[i].max_us;
+    }
+    result.ok = true;
+
+    heap_caps_free(source);
+    heap_caps_free(block);
+    heap_caps_free(samples);
+    return true;
+}
+
+const char* effects_bench_csv_header() {
+    return "label,sample_rate,channels,frames,blocks,process_us,block_us_p50,block_us_p99,block_us_max,"
+           "ns_per_frame,cpu_mhz,cycles_per_frame,budget_pct,ok";
+}
+
+int format_effects_bench(const EffectsBenchResult& r, EffectsBenchFormat format, char* buf, size_t len) {
+    if (format == EffectsBenchFormat::CSV) {
+        return snprintf(buf, len, "%s,%u,%u,%llu,%u,%llu,%u,%u,%u,%.2f,%u,%.1f,%.2f,%d",
+                        r.label, (unsigned)r.sample_rate, (unsigned)r.channels,
+                        (unsigned long long)r.frames, (unsigned)r.blocks, (unsigned long long)r.process_us,
+                        (unsigned)r.block_us_p50, (unsigned)r.block_us_p99, (unsigned)r.block_us_max,
+                        r.ns_per_frame, (unsigned)r.cpu_mhz, r.cycles_per_frame, r.budget_pct, r.ok ? 1 : 0);
+    }
+
+    char nodes[384];
+    size_t used = 0;
+    nodes[0] = '\0';
+    for (uint32_t i = 0; i < r.node_count && used < sizeof(nodes); ++i) {
+        used += snprintf(nodes + used, sizeof(nodes) - used,
+                         "%s{\"name\":\"%s\",\"ns_per_frame\":%.2f,\"max_us\":%u}",
+                         i ? "," : "", r.nodes[i].name, r.nodes[i].ns_per_frame, (unsigned)r.nodes[i].max_us);
+    }
+    return snprintf(buf, len,
+                    "{\"label\":\"%s\",\"sample_rate\":%u,\"channels\":%u,\"frames\":%llu,\"blocks\":%u,"
+                    "\"process_us\":%llu,\"block_us_p50\":%u,\"block_us_p99\":%u,\"block_us_max\":%u,"
+                    "\"ns_per_frame\":%.2f,\"cpu_mhz\":%u,\"cycles_per_frame\":%.1f,\"budget_pct\":%.2f,"
+                    "\"nodes\":[%s],\"ok\":%s}",
+                    r.label, (unsigned)r.sample_rate, (unsigned)r.channels,
+                    (unsigned long long)r.frames, (unsigned)r.blocks, (unsigned long long)r.process_us,
+                    (unsigned)r.block_us_p50, (unsigned)r.block_us_p99, (unsigned)r.block_us_max,
+                    r.ns_per_frame, (unsigned)r.cpu_mhz, r.cycles_per_frame, r.budget_pct,
+                    nodes, r.ok ? "true" : "false");
+}
+
+bool run_eq_kernel_benchmark(const EffectsBenchOptions& options, uint32_t bands, EqKernelBenchResult& result) {
+    memset(&result, 0, sizeof(result));
+    result.sample_rate = options.sample_rate;
+    result.bands = std::min<uint32_t>(bands, ParametricEqEffect::kMaxBands);
+    if (options.sample_rate == 0 || options.frames_per_block == 0 || options.blocks == 0 || result.bands == 0) {
+        LOG_ERROR("EqKernelBench: invalid options");
+        return false;
+    }
+
+    // Cascata tipica: shelf agli estremi, peaking distribuiti in scala logaritmica
+    EqBand config[ParametricEqEffect::kMaxBands];
+    for (uint32_t i = 0; i < result.bands; ++i) {
+        EqBand& b = config[i];
+        b.freq_hz = 60.0f * powf(2.0f, (float)i * 1.3f);
+        b.gain_db = (i & 1) ? -4.5f : 6.0f;
+        b.q = 1.2f;
+        b.type = EqBandType::PEAKING;
+    }
+    config[0].type = EqBandType::LOW_SHELF;
+    if (result.bands > 1) {
+        config[result.bands - 1].type = EqBandType::HIGH_SHELF;
+    }
+
+    const size_t n = options.frames_per_block;
+    size_t source_frames = std::max<size_t>(options.sample_rate, n);
+    int16_t* source = static_cast<int16_t*>(heap_caps_malloc(source_frames * sizeof(int16_t), MALLOC_CAP_SPIRAM));
+    float* work = static_cast<float*>(heap_caps_malloc(4 * n * sizeof(float), MALLOC_CAP_8BIT));
+    std::unique_ptr<ParametricEqEffect> ref(new ParametricEqEffect());
+    std::unique_ptr<ParametricEqEffect> fast(new ParametricEqEffect());
+    if (!source || !work) {
+        LOG_ERROR("EqKernelBench: cannot allocate work buffers");
+        heap_caps_free(source);
+        heap_caps_free(work);
+        return false;
+    }
+    fill_signal(source, source_frames, 1, options.sample_rate);
+    ref->setBands(config, result.bands);
+    fast->setBands(config, result.bands);
+    ref->setReferenceKernel(true);
+    ref->prepare(options.sample_rate, n);
+    fast->prepare(options.sample_rate, n);
+
+    float* ref_l = work;
+    float* ref_r = work + n;
+    float* fast_l = work + 2 * n;
+    float* fast_r = work + 3 * n;
+    uint64_t ref_us = 0;
+    uint64_t fast_us = 0;
+    size_t cursor = 0;
+    for (uint32_t b = 0; b < options.blocks; ++b) {
+        if (cursor + n > source_frames) {
+            cursor = 0;
+        }
+        // Canale destro sfasato per non avere due lane identiche
+        for (size_t i = 0; i < n; ++i) {
+            ref_l[i] = fast_l[i] = source[cursor + i] / 32768.0f;
+            ref_r[i] = fast_r[i] = source[source_frames - 1 - cursor - i] / 32768.0f;
+        }
+        cursor += n;
+
+        AudioBlock ref_block = {ref_l, ref_r, n, 2, options.sample_rate};
+        AudioBlock fast_block = {fast_l, fast_r, n, 2, options.sample_rate};
+        int64_t t0 = esp_timer_get_time();
+        ref->process(ref_block);
+        int64_t t1 = esp_timer_get_time();
+        fast->process(fast_block);
+        int64_t t2 = esp_timer_get_time();
+        ref_us += (uint64_t)(t1 - t0);
+        fast_us += (uint64_t)(t2 - t1);
+
+        for (size_t i = 0; i < 2 * n; ++i) {
+            float a = ref_l[i];
+            float c = fast_l[i];   // ref_r/fast_r seguono in memoria
+            if (memcmp(&a, &c, sizeof(float)) != 0) {
+                result.mismatches++;
+                result.max_abs_diff = std::max(result.max_abs_diff, fabsf(a - c));
+            }
+        }
+        result.frames += n;
+
+        if ((b & 63) == 63) {
+            vTaskDelay(1);
+        }
+    }
+
+    result.ref_ns_per_frame = (float)((double)ref_us * 1000.0 / (double)result.frames);
+    result.fast_ns_per_frame = (float)((double)fast_us * 1000.0 / (double)result.frames);
+    result.speedup = result.fast_ns_per_frame > 0.0f ? result.ref_ns_per_frame / result.fast_ns_per_frame : 0.0f;
+    result.ok = result.mismatches == 0;
+    if (!result.ok) {
+        LOG_ERROR("EqKernelBench: %llu samples differ (max %g)", (unsigned long long)result.mismatches,
+                  (double)result.max_abs_diff);
+    }
+
+    heap_caps_free(source);
+    heap_caps_free(work);
+    return result.ok;
+}
+
+const char* eq_kernel_bench_csv_header() {
+    return "sample_rate,bands,frames,ref_ns_per_frame,fast_ns_per_frame,speedup,mismatches,max_abs_diff,ok";
+}
+
+int format_eq_kernel_bench(const EqKernelBenchResult& r, EffectsBenchFormat format, char* buf, size_t len) {
+    if (format == EffectsBenchFormat::CSV) {
+        return snprintf(buf, len, "%u,%u,%llu,%.2f,%.2f,%.2f,%llu,%g,%d",
+                        (unsigned)r.sample_rate, (unsigned)r.bands, (unsigned long long)r.frames,
+                        r.ref_ns_per_frame, r.fast_ns_per_frame, r.speedup,
+                        (unsigned long long)r.mismatches, (double)r.max_abs_diff, r.ok ? 1 : 0);
+    }
+    return snprintf(buf, len,
+                    "{\"label\":\"eq-kernel\",\"sample_rate\":%u,\"bands\":%u,\"frames\":%llu,"
+                    "\"ref_ns_per_frame\":%.2f,\"fast_ns_per_frame\":%.2f,\"speedup\":%.2f,"
+                    "\"mismatches\":%llu,\"max_abs_diff\":%g,\"ok\":%s}",
+                    (unsigned)r.sample_rate, (unsigned)r.bands, (unsigned long long)r.frames,
+                    r.ref_ns_per_frame, r.fast_ns_per_frame, r.speedup,
+                    (unsigned long long)r.mismatches, (double)r.max_abs_diff, r.ok ? "true" : "false");
+}
+
+namespace {
+
+struct ResamplerLimits {
+    float thdn_db;
+    float ripple_db;
+    float stopband_db;
+};
+
+// Limiti per preset (FAST, BALANCED, BEST), con margine sull'attenuazione nominale
+const ResamplerLimits kResamplerLimits[] = {
+    {-50.0f, 0.1f, -50.0f},
+    {-70.0f, 0.05f, -70.0f},
+    {-85.0f, 0.05f, -85.0f},
+};
+const char* const kQualityNames[] = {"fast", "balanced", "best"};
+
+constexpr double kToneAmplitude = 0.5 * 32767.0;   // -6 dBFS
+
+// Tono stereo al rate d'ingresso, ricampionato a blocchi come nell'output task
+size_t resample_tone(Resampler& rs, double freq, int16_t* in, size_t in_frames,
+                     int16_t* out, size_t out_capacity, size_t block) {
+    const double w = 2.0 * M_PI * freq / (double)rs.in_rate();
+    for (size_t i = 0; i < in_frames; ++i) {
+        int16_t v = (int16_t)lrint(kToneAmplitude * sin(w * (double)i));
+        in[2 * i] = v;
+        in[2 * i + 1] = v;
+    }
+    rs.reset();
+    size_t produced = 0;
+    for (size_t done = 0; done < in_frames;) {
+        size_t n = std::min(block, in_frames - done);
+        produced += rs.process(in + 2 * done, n, out + 2 * produced, out_capacity - produced);
+        done += n;
+    }
+    return produced;
+}
+
+// Fit ai minimi quadri di a*sin + b*cos + dc alla frequenza attesa (canale sinistro);
+// restituisce l'ampiezza e il residuo rispetto al segnale (dB)
+void fit_tone(const int16_t* pcm, size_t first, size_t frames, double freq, double rate,
+              double& amplitude, double& residual_db) {
+    double m[3][4] = {};
+    const double w = 2.0 * M_PI * freq / rate;
+    for (size_t n = first; n < frames; ++n) {
+        const double v[3] = {sin(w * (double)n), cos(w * (double)n), 1.0};
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) m[i][j] += v[i] * v[j];
+            m[i][3] += v[i] * pcm[2 * n];
+        }
+    }
+    // Eliminazione di Gauss-Jordan (sistema 3x3 ben condizionato)
+    for (int i = 0; i < 3; ++i) {
+        for (int r = 0; r < 3; ++r) {
+            if (r == i) continue;
+            double k = m[r][i] / m[i][i];
+            for (int c = i; c < 4; ++c) m[r][c] -= k * m[i][c];
+        }
+    }
+    const double a = m[0][3] / m[0][0];
+    const double b = m[1][3] / m[1][1];
+    const double dc = m[2][3] / m[2][2];
+    double residual = 0.0, signal = 0.0;
+    for (size_t n = first; n < frames; ++n) {
+        double model = a * sin(w * (double)n) + b * cos(w * (double)n) + dc;
+        double e = pcm[2 * n] - model;
+        residual += e * e;
+        signal += model * model;
+    }
+    amplitude = sqrt(a * a + b * b);
+    residual_db = 10.0 * log10((residual + 1e-20) / (signal + 1e-20));
+}
+
+} // namespace
+
+bool run_resampler_benchmark(const EffectsBenchOptions& options, uint32_t in_rate, ResamplerQuality quality,
+                             ResamplerBenchResult& result) {
+    memset(&result, 0, sizeof(result));
+    const size_t q = static_cast<size_t>(quality);
+    result.quality = q < 3 ? kQualityNames[q] : "?";
+    result.in_rate = in_rate;
+    result.out_rate = options.sample_rate;
+
+    std::unique_ptr<Resampler> rs(new Resampler());
+    if (options.frames_per_block == 0 || !rs->configure(in_rate, options.sample_rate, 2, quality)) {
+        LOG_ERROR("ResamplerBench: invalid options");
+        return false;
+    }
+    result.taps = (uint32_t)rs->taps();
+    result.memory_bytes = (uint32_t)rs->memory_bytes();
+    result.passband_hz = (float)rs->passband_hz();
+
+    // 250 ms di tono per misura; il primo quarto dell'uscita (transitorio) non si misura
+    const size_t in_frames = std::max<size_t>(in_rate / 4, options.frames_per_block);
+    const size_t out_capacity = rs->max_output_frames(in_frames);
+    int16_t* in = static_cast<int16_t*>(heap_caps_malloc(in_frames * 2 * sizeof(int16_t), MALLOC_CAP_SPIRAM));
+    int16_t* out = static_cast<int16_t*>(heap_caps_malloc(out_capacity * 2 * sizeof(int16_t), MALLOC_CAP_SPIRAM));
+    if (!in || !out) {
+        LOG_ERROR("ResamplerBench: cannot allocate work buffers");
+        heap_caps_free(in);
+        heap_caps_free(out);
+        return false;
+    }
+    const double out_rate = (double)options.sample_rate;
+    const size_t block = options.frames_per_block;
+    double amplitude = 0.0, residual_db = 0.0;
+
+    size_t frames = resample_tone(*rs, 1000.0, in, in_frames, out, out_capacity, block);
+    fit_tone(out, frames / 4, frames, 1000.0, out_rate, amplitude, residual_db);
+    result.thdn_db = (float)residual_db;
+
+    double lo = 1e9, hi = -1e9;
+    const int kRipplePoints = 16;
+    for (int i = 0; i <= kRipplePoints; ++i) {
+        double freq = 50.0 + (result.passband_hz - 50.0) * i / kRipplePoints;
+        frames = resample_tone(*rs, freq, in, in_frames, out, out_capacity, block);
+        fit_tone(out, frames / 4, frames, freq, out_rate, amplitude, residual_db);
+        double gain_db = 20.0 * log10(amplitude / kToneAmplitude);
+        lo = std::min(lo, gain_db);
+        hi = std::max(hi, gain_db);
+        vTaskDelay(1);
+    }
+    result.ripple_db = (float)(hi - lo);
+
+    if (in_rate > options.sample_rate) {
+        // Tono appena oltre il Nyquist d'uscita: tutto ciò che esce è alias
+        double freq = std::min(0.55 * out_rate, 0.45 * in_rate);
+        frames = resample_tone(*rs, freq, in, in_frames, out, out_capacity, block);
+        double energy = 0.0;
+        for (size_t n = frames / 4; n < frames; ++n) energy += (double)out[2 * n] * out[2 * n];
+        double rms = sqrt(energy / (double)(frames - frames / 4) + 1e-20);
+        // Sotto mezzo LSB l'uscita int16 è zero: il limite della misura è -120 dB
+        result.stopband_db = (float)std::max(-120.0, 20.0 * log10(rms / (kToneAmplitude / sqrt(2.0))));
+    } else {
+        frames = resample_tone(*rs, result.passband_hz, in, in_frames, out, out_capacity, block);
+        fit_tone(out, frames / 4, frames, result.passband_hz, out_rate, amplitude, residual_db);
+        result.stopband_db = (float)residual_db;
+    }
+
+    // Costo: blocchi da frames_per_block frame d'ingresso, uscita nello stesso buffer
+    uint64_t process_us = 0;
+    uint64_t produced = 0;
+    rs->reset();
+    size_t cursor = 0;
+    for (uint32_t b = 0; b < options.blocks; ++b) {
+        if (cursor + block > in_frames) {
+            cursor = 0;
+        }
+        int64_t start = esp_timer_get_time();
+        produced += rs->process(in + 2 * cursor, block, out, out_capacity);
+        process_us += (uint64_t)(esp_timer_get_time() - start);
+        cursor += block;
+        if ((b & 63) == 63) {
+            vTaskDelay(1);
+        }
+    }
+    if (produced > 0) {
+        result.ns_per_frame = (float)((double)process_us * 1000.0 / (double)produced);
+        result.budget_pct = (float)((double)process_us * 100.0 / ((double)produced * 1000000.0 / out_rate));
+    }
+
+    const ResamplerLimits& limits = kResamplerLimits[q < 3 ? q : 1];
+    result.ok = result.thdn_db <= limits.thdn_db && result.ripple_db <= limits.ripple_db &&
+                result.stopband_db <= limits.stopband_db;
+
+    heap_caps_free(in);
+    heap_caps_free(out);
+    return result.ok;
+}
+
+const char* resampler_bench_csv_header() {
+    return "quality,in_rate,out_rate,taps,memory_bytes,passband_hz,thdn_db,ripple_db,stopband_db,"
+           "ns_per_frame,budget_pct,ok";
+}
+
+int format_resampler_bench(const ResamplerBenchResult& r, EffectsBenchFormat format, char* buf, size_t len) {
+    if (format == EffectsBenchFormat::CSV) {
+        return snprintf(buf, len, "%s,%u,%u,%u,%u,%.0f,%.1f,%.4f,%.1f,%.2f,%.2f,%d",
+                        r.quality, (unsigned)r.in_rate, (unsigned)r.out_rate, (unsigned)r.taps,
+                        (unsigned)r.memory_bytes, r.passband_hz, r.thdn_db, r.ripple_db, r.stopband_db,
+                        r.ns_per_frame, r.budget_pct, r.ok ? 1 : 0);
+    }
+    return snprintf(buf, len,
+                    "{\"label\":\"resampler\",\"quality\":\"%s\",\"in_rate\":%u,\"out_rate\":%u,\"taps\":%u,"
+                    "\"memory_bytes\":%u,\"passband_hz\":%.0f,\"thdn_db\":%.1f,\"ripple_db\":%.4f,"
+                    "\"stopband_db\":%.1f,\"ns_per_frame\":%.2f,\"budget_pct\":%.2f,\"ok\":%s}",
+                    r.quality, (unsigned)r.in_rate, (unsigned)r.out_rate, (unsigned)r.taps,
+                    (unsigned)r.memory_bytes, r.passband_hz, r.thdn_db, r.ripple_db, r.stopband_db,
+                    r.ns_per_frame, r.budget_pct, r.ok ? "true" : "false");
+}
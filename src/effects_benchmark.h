@@ -0,0 +1,112 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_types.h"
+
+// Benchmark CPU della EffectsChain: blocchi di segnale sintetico (sinusoidi + rumore)
+// elaborati come nell'output task, senza I2S. Misura tempo per blocco (p50/p99/max),
+// ns e cicli per frame, quota del budget real-time del blocco e costo di ogni nodo
+// abilitato (statistiche della EffectsChain).
+// Gira identico su device e nel build host (openespaudio_effects_bench).
+
+struct EffectsBenchOptions {
+    uint32_t sample_rate = 48000;
+    uint32_t channels = 2;
+    size_t frames_per_block = 2048;
+    uint32_t blocks = 256;
+    bool eq = false;
+    bool reverb = false;
+    bool echo = false;
+};
+
+struct EffectsBenchResult {
+    char label[48];                   // Effetti attivi, es. "eq+reverb"
+    bool ok;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint64_t frames;
+    uint32_t blocks;
+    uint64_t process_us;              // Somma dei tempi di process()
+
+    uint32_t block_us_p50;
+    uint32_t block_us_p99;
+    uint32_t block_us_max;
+
+    float ns_per_frame;
+    uint32_t cpu_mhz;                 // 0 se sconosciuta (host)
+    float cycles_per_frame;           // ns_per_frame * cpu_mhz / 1000 (0 sull'host)
+    float budget_pct;                 // p99 del blocco / durata audio del blocco
+
+    static constexpr size_t kMaxNodes = 8;
+    struct Node {
+        char name[16];
+        float ns_per_frame;
+        uint32_t max_us;
+    };
+    uint32_t node_count;              // Nodi abilitati, nell'ordine della catena
+    Node nodes[kMaxNodes];
+};
+
+enum class EffectsBenchFormat {
+    JSON,
+    CSV
+};
+
+bool run_effects_benchmark(const EffectsBenchOptions& options, EffectsBenchResult& result);
+
+// Serializza un risultato in una riga JSON o CSV (snprintf semantics, troncato a len).
+// Il dettaglio per nodo è solo nel JSON.
+int format_effects_bench(const EffectsBenchResult& result, EffectsBenchFormat format, char* buf, size_t len);
+const char* effects_bench_csv_header();
+
+// Confronto dei kernel biquad del ParametricEqEffect sulla stessa cascata di bande:
+// riferimento scalare (un canale per volta) contro kernel a due lane. Le uscite devono
+// coincidere bit a bit; ok = false se anche un solo campione differisce.
+struct EqKernelBenchResult {
+    bool ok;
+    uint32_t sample_rate;
+    uint32_t bands;
+    uint64_t frames;
+    float ref_ns_per_frame;
+    float fast_ns_per_frame;
+    float speedup;                    // ref / fast
+    uint64_t mismatches;              // Campioni diversi tra i due kernel
+    float max_abs_diff;
+};
+
+bool run_eq_kernel_benchmark(const EffectsBenchOptions& options, uint32_t bands, EqKernelBenchResult& result);
+int format_eq_kernel_bench(const EqKernelBenchResult& result, EffectsBenchFormat format, char* buf, size_t len);
+const char* eq_kernel_bench_csv_header();
+
+// Qualità e costo del Resampler per un preset e una coppia di rate. Qualità misurata
+// su sinusoidi stereo a -6 dBFS, fit ai minimi quadri della sinusoide attesa:
+// - thdn_db: residuo (armoniche + rumore + immagini) rispetto al segnale, tono a 1 kHz
+// - ripple_db: escursione del guadagno da 50 Hz alla fine della banda passante
+// - stopband_db: in downsampling il livello dell'alias di un tono oltre il Nyquist
+//   d'uscita, in upsampling il THD+N di un tono a fine banda (le immagini cadono in
+//   banda di stop)
+// ok = false se una misura supera i limiti del preset.
+struct ResamplerBenchResult {
+    bool ok;
+    const char* quality;
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint32_t taps;
+    uint32_t memory_bytes;
+    float passband_hz;
+    float thdn_db;
+    float ripple_db;
+    float stopband_db;
+    float ns_per_frame;               // Per frame d'uscita stereo
+    float budget_pct;                 // Tempo di process() / durata dell'audio prodotto
+};
+
+bool run_resampler_benchmark(const EffectsBenchOptions& options, uint32_t in_rate, ResamplerQuality quality,
+                             ResamplerBenchResult& result);
+int format_resampler_bench(const ResamplerBenchResult& result, EffectsBenchFormat format, char* buf, size_t len);
+const char* resampler_bench_csv_header();
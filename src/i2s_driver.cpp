@@ -61,7 +61,9 @@ void I2sDriver::init(uint32_t sample_rate,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
         .dma_buf_count = static_cast<int>(dma_buf_count_active_),
         .dma_buf_len = static_cast<int>(dma_buf_len_active_),
-        .use_apll = cfg.i2s_use_apll};
+        .use_apll = cfg.i2s_use_apll,
+        // Senza nuovi dati (pausa, underrun) il DMA emette zeri invece di ripetere i buffer
+        .tx_desc_auto_clear = true};
 
     i2s_pin_config_t pin_config = {
         .mck_io_num = I2S_PIN_NO_CHANGE,
@@ -10,6 +10,7 @@
 #include <esp_heap_caps.h>
 #include <memory>
 #include "timeshift_manager.h"
+#include "decode_benchmark.h"
 
 // WiFi credentials - CONFIGURA QUI LE TUE CREDENZIALI
 static const char *kWiFiSSID = "FASTWEB-2";
@@ -60,16 +61,17 @@ void start_timeshift_radio(const char* stream_url = kRadioStreamURL) {
 
     LOG_INFO("Timeshift download started, waiting for first chunk...");
 
-    // Wait for at least one READY chunk before starting playback (max 10 seconds)
+    // Wait for playable data before starting playback: with the live head the first
+    // downloaded bytes are enough, otherwise the first READY chunk
     const uint32_t MAX_WAIT_MS = 100000;
     uint32_t start_wait = millis();
-    while (ts->buffered_bytes() == 0) {
+    while (ts->playable_bytes() == 0) {
         if (millis() - start_wait > MAX_WAIT_MS) {
             LOG_ERROR("Timeout waiting for first chunk to be ready");
             delete ts;
             return;
         }
-        delay(100);
+        delay(10);
 
         // Log progress every second
         if ((millis() - start_wait) % 1000 == 0) {
@@ -173,6 +175,26 @@ static void list_sd_files(const char *path)
     }
 }
 
+static void run_decode_bench(const char *path)
+{
+    if (player.is_playing() || player.state() == PlayerState::PLAYING || player.state() == PlayerState::PAUSED)
+    {
+        LOG_INFO("Stopping playback before decode benchmark...");
+        player.stop();
+        delay(300);
+    }
+
+    DecodeBenchOptions options;
+    DecodeBenchResult result;
+    LOG_INFO("Decode benchmark: %s", path);
+    run_decode_benchmark_on_task(path, options, result);
+
+    // Riga JSON grezza (senza prefisso di log) per poterla estrarre dal monitor seriale
+    char line[512];
+    format_decode_bench(result, DecodeBenchFormat::JSON, line, sizeof(line));
+    Serial.printf("BENCH %s\n", line);
+}
+
 static void select_source_path(const char *path)
 {
     player.select_source(path);
@@ -220,6 +242,7 @@ static void handle_command_string(String cmd)
             LOG_INFO("");
             LOG_INFO("DEBUG:");
             LOG_INFO("  m - Memory stats");
+            LOG_INFO("  b - Benchmark decoder su test/sample file (b<path> per un file specifico)");
             LOG_INFO("  h - Mostra questo help");
             break;
         case 'l':
@@ -287,6 +310,11 @@ static void handle_command_string(String cmd)
         case 'I':
             player.print_status();
             break;
+        case 'b':
+        case 'B':
+            run_decode_bench(kTestFilePath);
+            run_decode_bench(kSampleFilePath);
+            break;
         case 'm':
         case 'M':
             // Memory stats now printed in status; keep quick log
@@ -338,8 +366,7 @@ static void handle_command_string(String cmd)
             {
                 const IDataSource* source = player.data_source();
                 if (source && source->type() == SourceType::HTTP_STREAM) {
-                    // RTTI disabled; we already validated the type, so use static_cast after const_cast.
-                    TimeshiftManager* ts_manager = static_cast<TimeshiftManager*>(const_cast<IDataSource*>(source));
+                    TimeshiftManager* ts_manager = source->timeshift();
                     if (ts_manager) {
                         StorageMode current_mode = ts_manager->getStorageMode();
                         StorageMode new_mode = (current_mode == StorageMode::SD_CARD) ? StorageMode::PSRAM_ONLY : StorageMode::SD_CARD;
@@ -454,6 +481,16 @@ static void handle_command_string(String cmd)
             player.select_source(new_path.c_str());
             LOG_INFO("Source selected: %s (use 'l' to load)", new_path.c_str());
         }
+        else if (first_char == 'b' || first_char == 'B')
+        {
+            String path = cmd.substring(1);
+            path.trim();
+            if (path.charAt(0) != '/')
+            {
+                path = "/" + path;
+            }
+            run_decode_bench(path.c_str());
+        }
         else if (first_char == 'u' || first_char == 'U')
         {
             String url = cmd.substring(1);
@@ -9,10 +9,23 @@
 #include <cstring>
 #include <esp_heap_caps.h>
 #include "logger.h"
+#include "timeshift_manager.h"
 
 namespace {
 constexpr uint32_t kBytesPerSample = sizeof(int16_t);
 constexpr uint32_t kDefaultChannels = 2;
+
+// Indicizzazione in background: blocchi piccoli, priorità minima, core del decoder
+constexpr size_t kIndexReadBytes = 4096;
+// Byte già nel buffer di dr_mp3 che bastano per il prossimo frame (free format al massimo 2304,
+// più l'header del successivo): sul live edge non si aspetta la rete per leggerne altri
+constexpr size_t kLiveDecodeAheadBytes = 2560;
+constexpr uint32_t kLiveReadWaitMs = 1000;   // Giro di attesa dei byte sul live edge
+constexpr uint32_t kIndexTaskStack = 6144;   // include la scrittura della seek cache su SD/LittleFS
+constexpr UBaseType_t kIndexTaskPriority = tskIDLE_PRIORITY + 1;
+constexpr BaseType_t kIndexTaskCore = 0;
+constexpr uint32_t kIndexYieldEveryBlocks = 8;
+constexpr TickType_t kIndexStopTimeoutTicks = pdMS_TO_TICKS(2000);
 }
 
 Mp3Decoder::~Mp3Decoder() {
@@ -44,6 +57,25 @@ bool Mp3Decoder::init(IDataSource* source, size_t frames_per_chunk, bool build_s
     stream_base_offset_ = 0;
     stream_size_ = source_->size();
 
+    // Header Xing/Info/VBRI: durata, TOC e gapless senza scansionare il file. dr_mp3 parte
+    // dal primo frame audio, così l'asse dei frame coincide con quello della seek table
+    memset(&stream_info_, 0, sizeof(stream_info_));
+    audio_base_ = 0;
+    // Sorgente live (timeshift, seekable ma senza fine): un frame Info/Xing in testa allo
+    // stream descrive il file da cui la radio trasmette, non lo stream. Durata, TOC e trim
+    // gapless fermerebbero la decodifica al frame_count dell'header. La decodifica parte da
+    // dove la sorgente è posizionata, che non è per forza il byte 0 (storia ripresa dal journal)
+    live_ = source_->timeshift() != nullptr || source_->live_edge_distance_ms() >= 0;
+    if (live_) {
+        audio_base_ = source_->tell();
+    } else if (source_->is_seekable()) {
+        if (parse_mp3_stream_info(source_, &stream_info_)) {
+            audio_base_ = stream_info_.audio_offset;
+        }
+        source_->seek(0);
+    }
+    stream_base_offset_ = audio_base_;
+
     if (!ensure_buffers(frames_per_chunk)) {
         LOG_ERROR("Failed to allocate PCM buffer (%u frames)", static_cast<unsigned>(frames_per_chunk));
         return false;
@@ -62,52 +94,33 @@ bool Mp3Decoder::init(IDataSource* source, size_t frames_per_chunk, bool build_s
         mp3_ = nullptr;
         return false;
     }
+    apply_stream_info(0);
 
     initialized_ = true;
 
-    LOG_INFO("Mp3Decoder initialized: %u Hz, %u ch, seekable=%s",
+    LOG_INFO("Mp3Decoder initialized: %u Hz, %u ch, seekable=%s, header=%s, frames=%llu, delay/padding=%u/%u",
              sample_rate(), channels(),
-             source_->is_seekable() ? "yes" : "no");
-
-    // Build seek table se richiesto e source è seekable
+             source_->is_seekable() ? "yes" : "no",
+             stream_info_.kind == Mp3VbrKind::XING ? "Xing" :
+             stream_info_.kind == Mp3VbrKind::INFO ? "Info" :
+             stream_info_.kind == Mp3VbrKind::VBRI ? "VBRI" : "none",
+             total_frames(),
+             (unsigned)stream_info_.delay_frames, (unsigned)stream_info_.padding_frames);
+
+    // Seek table costruita in streaming da un task a bassa priorità, avviato alla prima
+    // read_frames() così non ritarda il primo audio. Nessun limite di dimensione file.
     if (build_seek_table && source_->is_seekable() && source_->size() > 0) {
-        mp3_file_size_ = source_->size();
-
-        // Alloca cache per file MP3 (solo se non troppo grande)
-        if (mp3_file_size_ < 10 * 1024 * 1024) {  // Max 10MB
-            mp3_file_cache_ = static_cast<uint8_t*>(
-                heap_caps_malloc(mp3_file_size_, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
-            );
-
-            if (mp3_file_cache_) {
-                // Leggi file intero in cache
-                source_->seek(0);
-                size_t read = source_->read(mp3_file_cache_, mp3_file_size_);
-
-                if (read == mp3_file_size_) {
-                    // Build seek table
-                    uint32_t frames_per_entry = sample_rate() / 10;  // Entry ogni 100ms
-                    if (seek_table_.build(mp3_file_cache_, mp3_file_size_, sample_rate(), frames_per_entry)) {
-                        LOG_INFO("Seek table ready: %u entries (%u KB)",
-                                 (unsigned)seek_table_.size(),
-                                 (unsigned)(seek_table_.memory_bytes() / 1024));
-                    } else {
-                        LOG_WARN("Failed to build seek table");
-                    }
-                } else {
-                    LOG_WARN("Failed to read MP3 file for seek table");
-                }
-
-                // Torna all'inizio dopo il build
-                source_->seek(0);
-                drmp3_seek_to_pcm_frame(mp3_, 0);
-            } else {
-                LOG_WARN("Not enough memory for MP3 cache (%u bytes), skip seek table",
-                         (unsigned)mp3_file_size_);
-            }
+        // Riproduzioni successive: table esatta dalla cache su disco, nessuna scansione
+        cache_key_ = Mp3SeekCache::make_key(source_);
+        if (Mp3SeekCache::load(cache_key_, seek_table_)) {
+            return true;
+        }
+        index_source_ = source_->duplicate();
+        if (index_source_) {
+            seek_table_.begin(sample_rate(), sample_rate() / 10, audio_base_);  // Entry ogni 100ms
+            index_pending_ = true;
         } else {
-            LOG_INFO("File too large for seek table (%u bytes), using dr_mp3 seek",
-                     (unsigned)mp3_file_size_);
+            LOG_INFO("Source cannot be duplicated, using dr_mp3 seek");
         }
     }
 
@@ -115,6 +128,7 @@ bool Mp3Decoder::init(IDataSource* source, size_t frames_per_chunk, bool build_s
 }
 
 void Mp3Decoder::shutdown() {
+    stop_index_task();
     if (mp3_ && initialized_) {
         drmp3_uninit(mp3_);
     }
@@ -126,15 +140,13 @@ void Mp3Decoder::shutdown() {
         heap_caps_free(buffers_.pcm);
         buffers_.pcm = nullptr;
     }
-    if (mp3_file_cache_) {
-        heap_caps_free(mp3_file_cache_);
-        mp3_file_cache_ = nullptr;
-    }
     buffers_.pcm_capacity_frames = 0;
-    mp3_file_size_ = 0;
     seek_table_.clear();
+    cache_key_ = Mp3SeekCache::Key();
     source_ = nullptr;
     initialized_ = false;
+    memset(&stream_info_, 0, sizeof(stream_info_));
+    audio_base_ = 0;
     stream_base_offset_ = 0;
     stream_size_ = 0;
 }
@@ -143,6 +155,16 @@ drmp3_uint64 Mp3Decoder::read_frames(int16_t *dst, drmp3_uint64 frames) {
     if (!mp3_ || !initialized_) {
         return 0;
     }
+    if (index_pending_) {
+        index_pending_ = false;
+        start_index_task();
+    }
+    // dr_mp3 marca la fine dello stream alla prima read a vuoto e non la azzera più: su una
+    // sorgente live ancora in registrazione è solo un momento senza byte nuovi
+    const TimeshiftManager* live = source_ ? source_->timeshift() : nullptr;
+    if (mp3_->atEnd && live && live->is_running() && !live->is_stop_requested()) {
+        mp3_->atEnd = DRMP3_FALSE;
+    }
     return drmp3_read_pcm_frames_s16(mp3_, frames, dst);
 }
 
@@ -160,8 +182,10 @@ bool Mp3Decoder::seek_to_frame(drmp3_uint64 frame_index) {
     // Always refresh stream_size_ as it might change for live streams (Timeshift)
     stream_size_ = source_->size(); // Update cached size
 
-    // Usa seek table: re-inizializza dr_mp3 facendo credere che l'offset sia l'inizio del file
-    
+    // Usa seek table: re-inizializza dr_mp3 facendo credere che l'offset sia l'inizio del file.
+    // Table e TOC lavorano sull'asse "untrimmed" (encoder delay incluso), il chiamante su quello riprodotto
+    uint64_t target = frame_index + delay_frames();
+
     // Check if source provides a seek table (e.g. TimeshiftManager), otherwise use internal one
     const Mp3SeekTable* table_ptr = source_->get_seek_table();
     bool use_table = (table_ptr && table_ptr->is_ready());
@@ -170,57 +194,30 @@ bool Mp3Decoder::seek_to_frame(drmp3_uint64 frame_index) {
         use_table = seek_table_.is_ready();
     }
 
-    if (use_table) {
-        uint64_t byte_offset = 0;
-        uint64_t nearest_frame = 0;
-
-        if (table_ptr->find_seek_point(frame_index, &byte_offset, &nearest_frame) && nearest_frame <= frame_index) {
-            stream_base_offset_ = static_cast<size_t>(byte_offset);
+    // frame 0: il fallback dr_mp3 è già esatto e immediato
+    bool rewind = (frame_index == 0);
 
-            if (!reinit_decoder()) {
-                stream_base_offset_ = 0;
-                return false;
+    if (use_table && !rewind) {
+        // Table interna ancora in costruzione e target oltre la parte indicizzata:
+        // posizione stimata (TOC o bitrate medio già misurato), il task continua in background
+        if (table_ptr == &seek_table_ && !seek_table_.is_complete() &&
+            target >= seek_table_.covered_frames()) {
+            if (seek_coarse(target, seek_start)) {
+                return true;
             }
-
-            uint64_t frames_to_skip = frame_index - nearest_frame;
-            
-            // Optimization: if skippint is huge (> 5 sec), maybe just use byte seek inaccuracy?
-            // But precision is good.
-
-            if (frames_to_skip > 0) {
-                int16_t temp_buf[2048];
-                uint64_t total_skipped = 0;
-
-                while (total_skipped < frames_to_skip) {
-                    uint64_t skip_now = (frames_to_skip - total_skipped > 1024)
-                        ? 1024
-                        : (frames_to_skip - total_skipped);
-                    uint64_t skipped = drmp3_read_pcm_frames_s16(mp3_, skip_now, temp_buf);
-
-                    if (skipped == 0) {
-                        LOG_WARN("Unexpected EOF while skipping frames (skipped %llu/%llu)",
-                                 total_skipped, frames_to_skip);
-                        break;
-                    }
-
-                    total_skipped += skipped;
-                }
-
-                LOG_DEBUG("Skipped %llu frames to reach target", total_skipped);
-            }
-
-            uint32_t seek_end = millis();
-            LOG_INFO("SEEK TABLE used: %u ms (target frame=%llu)",
-                     seek_end - seek_start, frame_index);
+        } else if (seek_with_table(*table_ptr, target, seek_start)) {
             return true;
         }
         LOG_DEBUG("Seek table does not cover target frame %llu, using dr_mp3 seek", frame_index);
+    } else if (!rewind && stream_info_.has_toc && seek_coarse(target, seek_start)) {
+        // Nessuna table (build_seek_table=false): TOC Xing/VBRI, precisione ~1% della durata
+        return true;
     }
 
-    // Fallback a dr_mp3 seek standard
-    stream_base_offset_ = 0;
+    // Fallback a dr_mp3 seek standard (decodifica dall'inizio, esatta)
+    stream_base_offset_ = audio_base_;
 
-    if (!reinit_decoder()) {
+    if (!reinit_decoder(0)) {
         return false;
     }
 
@@ -238,10 +235,121 @@ bool Mp3Decoder::seek_to_frame(drmp3_uint64 frame_index) {
     }
 }
 
+bool Mp3Decoder::seek_with_table(const Mp3SeekTable& table, uint64_t target, uint32_t seek_start) {
+    uint64_t byte_offset = 0;
+    uint64_t nearest_frame = 0;
+
+    if (!table.find_seek_point(target, &byte_offset, &nearest_frame) || nearest_frame > target) {
+        return false;
+    }
+    // Pre-roll dalla entry precedente: riempie il bit reservoir, altrimenti dr_mp3 scarta in
+    // silenzio i primi frame dopo il salto e la posizione resta avanti di 1-2 frame MPEG
+    uint64_t preroll_offset = byte_offset;
+    uint64_t preroll_frame = nearest_frame;
+    if (nearest_frame > 0) {
+        table.find_seek_point(nearest_frame - 1, &preroll_offset, &preroll_frame);
+    }
+
+    // Sorgenti a finestra (timeshift): la entry del pre-roll può essere già stata riciclata
+    if (!restart_at_frame(preroll_offset, byte_offset, nearest_frame) &&
+        (preroll_offset == byte_offset || !restart_at_frame(byte_offset, byte_offset, nearest_frame))) {
+        stream_base_offset_ = audio_base_;
+        return false;
+    }
+
+    // dr_mp3 scarta da solo i frame prima dell'encoder delay: si salta solo il resto
+    uint64_t skip_from = (nearest_frame > delay_frames()) ? nearest_frame : delay_frames();
+    uint64_t frames_to_skip = target - skip_from;
+
+    if (frames_to_skip > 0) {
+        int16_t temp_buf[2048];
+        uint64_t total_skipped = 0;
+
+        while (total_skipped < frames_to_skip) {
+            uint64_t skip_now = (frames_to_skip - total_skipped > 1024)
+                ? 1024
+                : (frames_to_skip - total_skipped);
+            uint64_t skipped = drmp3_read_pcm_frames_s16(mp3_, skip_now, temp_buf);
+
+            if (skipped == 0) {
+                LOG_WARN("Unexpected EOF while skipping frames (skipped %llu/%llu)",
+                         total_skipped, frames_to_skip);
+                break;
+            }
+
+            total_skipped += skipped;
+        }
+
+        LOG_DEBUG("Skipped %llu frames to reach target", total_skipped);
+    }
+
+    uint32_t seek_end = millis();
+    LOG_INFO("SEEK TABLE used: %u ms (target frame=%llu)",
+             seek_end - seek_start, target - delay_frames());
+    return true;
+}
+
+bool Mp3Decoder::seek_coarse(uint64_t target, uint32_t seek_start) {
+    size_t estimate = 0;
+    const char* how = nullptr;
+
+    if (stream_info_.toc_offset_for_frame(target, &estimate)) {
+        how = "TOC";
+    } else {
+        // Interpola dal punto più lontano indicizzato con i byte/frame medi misurati finora
+        uint64_t covered_frames = seek_table_.covered_frames();
+        uint64_t covered_bytes = seek_table_.covered_bytes() - seek_table_.byte_base();
+        if (covered_frames == 0 || covered_bytes == 0) {
+            return false;
+        }
+        uint64_t anchor_offset = 0;
+        uint64_t anchor_frame = 0;
+        seek_table_.find_seek_point(target, &anchor_offset, &anchor_frame);
+        estimate = static_cast<size_t>(anchor_offset +
+            (uint64_t)((double)(target - anchor_frame) * (double)covered_bytes / (double)covered_frames));
+        how = "bitrate";
+    }
+    if (stream_size_ > 0 && estimate >= stream_size_) {
+        return false;
+    }
+
+    // Posizione approssimata: currentPCMFrame = target mantiene coerente il taglio del padding finale
+    stream_base_offset_ = estimate;
+    if (!reinit_decoder(target)) {
+        stream_base_offset_ = audio_base_;
+        return false;
+    }
+
+    LOG_INFO("Seek estimated (%s, table %llu%% built): %u ms, byte %u for frame %llu",
+             how,
+             stream_size_ ? (seek_table_.covered_bytes() * 100 / stream_size_) : 0ULL,
+             millis() - seek_start, (unsigned)estimate, target - delay_frames());
+    return true;
+}
+
 drmp3_uint64 Mp3Decoder::total_frames() const {
     if (!mp3_ || !initialized_) {
         return 0;
     }
+    // Durata esatta dall'header Xing/Info/VBRI (già al netto di delay/padding)
+    if (stream_info_.frame_count > 0) {
+        return stream_info_.trimmed_total_frames();
+    }
+    // Nessun frame_count: conteggio esatto quando l'indicizzazione è terminata. La table conta
+    // i frame untrimmed, il delay/padding di un eventuale tag LAME va tolto come sopra...
+    if (seek_table_.is_complete()) {
+        return stream_info_.trimmed_frames(seek_table_.covered_frames());
+    }
+    // Stream live (dimensione ignota) senza header: durata ignota. drmp3_get_pcm_frame_count
+    // decodificherebbe fino alla fine dello stream, cioè per sempre
+    if (stream_size_ == 0) {
+        return 0;
+    }
+    // ...altrimenti stima CBR dal primo frame, invece di decodificare tutto il file
+    if (stream_info_.valid && stream_info_.first_frame_kbps > 0 && stream_size_ > audio_base_) {
+        return (uint64_t)(stream_size_ - audio_base_) * 8 * stream_info_.sample_rate /
+               ((uint64_t)stream_info_.first_frame_kbps * 1000);
+    }
     return drmp3_get_pcm_frame_count(mp3_);
 }
 
@@ -249,6 +357,9 @@ uint32_t Mp3Decoder::bitrate() const {
     if (!mp3_ || !initialized_ || !source_) {
         return 0;
     }
+    if (stream_info_.frame_count > 0 && stream_info_.byte_count > 0) {
+        return stream_info_.average_kbps();
+    }
 
     // Calculate average bitrate: (file_size_bytes * 8) / duration_seconds / 1000
     uint64_t total = total_frames();
@@ -303,8 +414,37 @@ size_t Mp3Decoder::do_read(void* buffer, size_t bytes_to_read) {
         return 0;
     }
 
+    // dr_mp3 rilegge prima di ogni frame finché non ha 16 KB: su uno stream live (1 s a
+    // 128 kbps) ogni frame aspetterebbe la rete. Con un frame intero già nel buffer e nessun
+    // byte nuovo la read a vuoto è tollerata e si decodifica quello che c'è. Se dr_mp3 la
+    // prende per la fine dello stream, read_frames() azzera atEnd alla chiamata successiva
+    if (mp3_ && mp3_->dataSize >= kLiveDecodeAheadBytes && source_->live_edge_distance_ms() == 0) {
+        return 0;
+    }
+
     // Leggi direttamente da DataSource - NESSUN ring buffer!
-    return source_->read(buffer, bytes_to_read);
+    size_t got = source_->read(buffer, bytes_to_read);
+
+    // Sorgente live in registrazione senza byte pronti: si aspetta che arrivino invece di
+    // restituire 0, che per dr_mp3 è la fine dello stream. Esce allo stop del reader o del download
+    TimeshiftManager* live = source_->timeshift();
+    while (got == 0 && live && live->is_running() && !live->is_stop_requested()) {
+        live->wait_for_data(kLiveReadWaitMs);
+        got = source_->read(buffer, bytes_to_read);
+    }
+
+    // Sul live edge una read può restituire poche centinaia di byte: minimp3 scarta un buffer
+    // senza un frame intero più l'header del successivo e non aggancerebbe mai il sync.
+    // Si completa almeno un frame; per le altre sorgenti una read corta è la fine dello stream
+    size_t buffered = mp3_ ? mp3_->dataSize : 0;
+    while (got > 0 && got < bytes_to_read && buffered + got < kLiveDecodeAheadBytes) {
+        size_t more = source_->read(static_cast<uint8_t*>(buffer) + got, bytes_to_read - got);
+        if (more == 0) {
+            break;
+        }
+        got += more;
+    }
+    return got;
 }
 
 bool Mp3Decoder::do_seek(int offset, drmp3_seek_origin origin) {
@@ -398,7 +538,7 @@ drmp3_int64 Mp3Decoder::do_tell() {
     return static_cast<drmp3_int64>(abs_pos - stream_base_offset_);
 }
 
-bool Mp3Decoder::reinit_decoder() {
+bool Mp3Decoder::reinit_decoder(uint64_t untrimmed_frame) {
     if (!mp3_) {
         return false;
     }
@@ -408,14 +548,148 @@ bool Mp3Decoder::reinit_decoder() {
 
     if (!drmp3_init(mp3_, on_read_cb, current_seek_cb(), current_tell_cb(), NULL, this, NULL)) {
         LOG_ERROR("Failed to reinitialize dr_mp3");
+        // dr_mp3 libera già i suoi buffer ma lascia i puntatori: evita il double free nel prossimo uninit
+        memset(mp3_, 0, sizeof(drmp3));
         initialized_ = false;
         return false;
     }
+    apply_stream_info(untrimmed_frame);
 
     initialized_ = true;
     return true;
 }
 
+bool Mp3Decoder::restart_at_frame(uint64_t preroll_offset, uint64_t frame_offset, uint64_t untrimmed_frame) {
+    stream_base_offset_ = static_cast<size_t>(preroll_offset);
+    if (!reinit_decoder(untrimmed_frame)) {
+        return false;
+    }
+    if (preroll_offset >= frame_offset) {
+        return true;
+    }
+
+    // drmp3_init ha già decodificato il primo frame: si prosegue (con sintesi, per lo stato
+    // del filterbank) finché il prossimo frame da decodificare è quello a frame_offset
+    while (source_->tell() - mp3_->dataSize < frame_offset) {
+        if (drmp3_decode_next_frame_ex(mp3_, reinterpret_cast<drmp3d_sample_t*>(mp3_->pcmFrames), NULL, NULL) == 0) {
+            LOG_WARN("Seek pre-roll hit EOF before byte %llu", frame_offset);
+            return false;
+        }
+    }
+    mp3_->pcmFramesConsumedInMP3Frame = 0;
+    mp3_->pcmFramesRemainingInMP3Frame = 0;
+    mp3_->currentPCMFrame = untrimmed_frame;
+    return true;
+}
+
+void Mp3Decoder::apply_stream_info(uint64_t untrimmed_frame) {
+    // dr_mp3 legge Xing/LAME solo se inizializzato a inizio file: da un offset intermedio
+    // (o dal primo frame audio) delay, padding e durata vanno reimpostati a mano
+    if (live_) {
+        // Sullo stream live quelli letti da dr_mp3 nel primo frame non valgono
+        mp3_->delayInPCMFrames = 0;
+        mp3_->paddingInPCMFrames = 0;
+        mp3_->totalPCMFrameCount = DRMP3_UINT64_MAX;
+        mp3_->currentPCMFrame = untrimmed_frame;
+        return;
+    }
+    if (!stream_info_.valid) {
+        return;
+    }
+    mp3_->delayInPCMFrames = stream_info_.delay_frames;
+    mp3_->paddingInPCMFrames = stream_info_.padding_frames;
+    mp3_->totalPCMFrameCount = stream_info_.frame_count > 0
+        ? stream_info_.untrimmed_total_frames() : DRMP3_UINT64_MAX;
+    mp3_->currentPCMFrame = untrimmed_frame;
+}
+
+// ========== INDICIZZAZIONE IN BACKGROUND ==========
+
+bool Mp3Decoder::start_index_task() {
+    if (!index_source_ || index_task_handle_) {
+        return false;
+    }
+    if (!index_done_) {
+        index_done_ = xSemaphoreCreateBinary();
+        if (!index_done_) {
+            LOG_WARN("Seek index: cannot create semaphore, using dr_mp3 seek");
+            index_source_.reset();
+            return false;
+        }
+    }
+    index_stop_ = false;
+    if (xTaskCreatePinnedToCore(index_task_entry, "Mp3SeekIdx", kIndexTaskStack, this,
+                                kIndexTaskPriority, &index_task_handle_, kIndexTaskCore) != pdPASS) {
+        LOG_WARN("Seek index: cannot create task, using dr_mp3 seek");
+        index_task_handle_ = nullptr;
+        index_source_.reset();
+        return false;
+    }
+    return true;
+}
+
+void Mp3Decoder::stop_index_task() {
+    index_pending_ = false;
+    if (index_task_handle_) {
+        index_stop_ = true;
+        // Il task usa seek_table_ e index_source_: va atteso comunque prima di liberarli
+        while (xSemaphoreTake(index_done_, kIndexStopTimeoutTicks) != pdTRUE) {
+            LOG_WARN("Waiting for seek index task to stop...");
+        }
+        index_task_handle_ = nullptr;
+    }
+    if (index_done_) {
+        vSemaphoreDelete(index_done_);
+        index_done_ = nullptr;
+    }
+    index_source_.reset();
+}
+
+void Mp3Decoder::index_task_entry(void* arg) {
+    Mp3Decoder* self = static_cast<Mp3Decoder*>(arg);
+    self->index_task();
+    xSemaphoreGive(self->index_done_);
+    vTaskDelete(NULL);
+}
+
+void Mp3Decoder::index_task() {
+    uint8_t* block = static_cast<uint8_t*>(heap_caps_malloc(kIndexReadBytes, MALLOC_CAP_8BIT));
+    if (!block) {
+        LOG_WARN("Seek index: no memory for read buffer");
+        return;
+    }
+
+    uint32_t start_ms = millis();
+    uint32_t blocks = 0;
+    bool ok = index_source_->seek(audio_base_);
+    while (ok && !index_stop_) {
+        size_t got = index_source_->read(block, kIndexReadBytes);
+        if (got == 0) {
+            break;
+        }
+        ok = seek_table_.append_chunk(block, got);
+        if (++blocks % kIndexYieldEveryBlocks == 0) {
+            vTaskDelay(1);
+        }
+    }
+    heap_caps_free(block);
+    index_source_->close();
+
+    if (index_stop_) {
+        return;
+    }
+    if (!ok) {
+        LOG_WARN("Seek index aborted at byte %llu", seek_table_.covered_bytes());
+        return;
+    }
+    seek_table_.finish();
+    LOG_INFO("Seek table ready: %u entries (%u KB), %u ms in background",
+             (unsigned)seek_table_.size(),
+             (unsigned)(seek_table_.memory_bytes() / 1024),
+             millis() - start_ms);
+    Mp3SeekCache::store(cache_key_, seek_table_);
+}
+
 drmp3_seek_proc Mp3Decoder::current_seek_cb() const {
     return (source_ && source_->is_seekable()) ? on_seek_cb : nullptr;
 }
@@ -6,9 +6,15 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 #include "dr_mp3.h"
 #include "data_source.h"
 #include "mp3_seek_table.h"
+#include "mp3_seek_cache.h"
+#include "mp3_vbr_header.h"
 
 class Mp3Decoder {
 public:
@@ -26,11 +32,15 @@ public:
     void shutdown();
 
     bool has_seek_table() const { return seek_table_.is_ready(); }
+    // true quando l'indicizzazione in background ha coperto tutto il file
+    bool seek_table_complete() const { return seek_table_.is_complete(); }
 
     uint32_t sample_rate() const { return mp3_ ? mp3_->sampleRate : 0; }
     uint32_t channels() const { return mp3_ ? mp3_->channels : 0; }
     drmp3_uint64 total_frames() const;
     uint32_t bitrate() const;  // Bitrate in kbps
+    // Header Xing/Info/VBRI + LAME letto all'init (valid=false su sorgenti non seekable)
+    const Mp3StreamInfo& stream_info() const { return stream_info_; }
     Buffers &buffers() { return buffers_; }
     bool initialized() const { return initialized_; }
     drmp3* mp3() { return mp3_; }
@@ -44,7 +54,20 @@ private:
     bool do_seek(int offset, drmp3_seek_origin origin);
     drmp3_int64 do_tell();
     bool ensure_buffers(size_t pcm_frames);
-    bool reinit_decoder();
+    // Riparte da stream_base_offset_; untrimmed_frame = posizione del primo frame decodificato
+    bool reinit_decoder(uint64_t untrimmed_frame = 0);
+    // Come reinit_decoder, ma decodifica da preroll_offset fino al frame a frame_offset
+    bool restart_at_frame(uint64_t preroll_offset, uint64_t frame_offset, uint64_t untrimmed_frame);
+    void apply_stream_info(uint64_t untrimmed_frame);
+    uint32_t delay_frames() const { return stream_info_.delay_frames; }
+    bool seek_with_table(const Mp3SeekTable& table, uint64_t target, uint32_t seek_start);
+    bool seek_coarse(uint64_t target, uint32_t seek_start);
+
+    // Indicizzazione seek table in background (secondo handle sulla sorgente)
+    static void index_task_entry(void* arg);
+    void index_task();
+    bool start_index_task();
+    void stop_index_task();
     drmp3_seek_proc current_seek_cb() const;
     drmp3_tell_proc current_tell_cb() const;
 
@@ -53,8 +76,15 @@ private:
     Buffers buffers_;
     bool initialized_ = false;
     Mp3SeekTable seek_table_;
-    uint8_t* mp3_file_cache_ = nullptr;  // Cache del file MP3 per seek table
-    size_t mp3_file_size_ = 0;
+    Mp3SeekCache::Key cache_key_ = {};    // Identità del file per la seek cache su disco
+    std::unique_ptr<IDataSource> index_source_;  // Handle dedicato al task di indicizzazione
+    TaskHandle_t index_task_handle_ = nullptr;
+    SemaphoreHandle_t index_done_ = nullptr;
+    volatile bool index_stop_ = false;
+    bool index_pending_ = false;          // Avvio rimandato alla prima read_frames()
+    Mp3StreamInfo stream_info_ = {};
+    size_t audio_base_ = 0;              // Primo frame audio (dopo ID3v2 e frame Xing/Info/VBRI)
+    bool live_ = false;                  // Sorgente live: niente durata, TOC e gapless dall'header
     size_t stream_base_offset_ = 0;      // Offset di base usato come "inizio" logico per dr_mp3
     size_t stream_size_ = 0;             // Cache della size() della sorgente per SEEK_END
 };
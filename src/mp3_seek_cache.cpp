@@ -0,0 +1,275 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#include "mp3_seek_cache.h"
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <SD_MMC.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "logger.h"
+
+namespace {
+
+constexpr uint32_t kMagic = 0x314B534D;   // "MSK1"
+constexpr uint16_t kVersion = 3;        // v3: frame_quantum per la table compatta
+constexpr size_t kHeadHashBytes = 4096;
+constexpr size_t kEntriesPerIo = 64;     // 512 byte sullo stack (store gira nel task di indicizzazione)
+
+struct __attribute__((packed)) CacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t path_hash;
+    uint32_t head_hash;
+    uint64_t file_size;
+    uint32_t mtime;
+    uint32_t sample_rate;
+    uint32_t frames_per_entry;
+    uint32_t entry_count;
+    uint64_t total_frames;
+    uint64_t total_bytes;
+    uint64_t byte_base;
+    uint32_t frame_quantum;
+    uint32_t entries_crc;
+};
+
+struct __attribute__((packed)) CacheEntry {
+    uint32_t pcm_frame;
+    uint32_t byte_offset;
+};
+
+uint32_t fnv1a(const void* data, size_t len, uint32_t hash = 2166136261u) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Impostati da set_location() prima del playback, poi solo letti
+fs::FS* g_cache_fs = nullptr;
+char g_cache_dir[Mp3SeekCache::kMaxDirLength + 1] = "/.seekcache";
+
+fs::FS* cache_fs(SourceType type) {
+    if (g_cache_dir[0] == '\0') {
+        return nullptr; // Cache disabilitata
+    }
+    if (g_cache_fs) {
+        return g_cache_fs;
+    }
+    switch (type) {
+        case SourceType::SD_CARD: return &SD_MMC;
+        case SourceType::LITTLEFS: return &LittleFS;
+        default: return nullptr;
+    }
+}
+
+void cache_path(const Mp3SeekCache::Key& key, char* out, size_t len, bool tmp) {
+    snprintf(out, len, "%s/%08x%s", g_cache_dir, (unsigned)key.path_hash, tmp ? ".tmp" : ".idx");
+}
+
+} // namespace
+
+bool Mp3SeekCache::set_location(fs::FS* filesystem, const char* dir) {
+    if (dir && strlen(dir) > kMaxDirLength) {
+        LOG_WARN("Seek cache: directory too long, keeping %s", g_cache_dir);
+        return false;
+    }
+    g_cache_fs = filesystem;
+    snprintf(g_cache_dir, sizeof(g_cache_dir), "%s", dir ? dir : "");
+    LOG_INFO("Seek cache: %s", g_cache_dir[0] ? g_cache_dir : "disabled");
+    return true;
+}
+
+const char* Mp3SeekCache::directory() {
+    return g_cache_dir;
+}
+
+Mp3SeekCache::Key Mp3SeekCache::make_key(const IDataSource* source) {
+    Key key;
+    memset(&key, 0, sizeof(key));
+    if (!source || !source->is_seekable() || !cache_fs(source->type()) || source->size() == 0) {
+        return key;
+    }
+
+    std::unique_ptr<IDataSource> probe = source->duplicate();
+    if (!probe) {
+        return key;
+    }
+    uint8_t* head = static_cast<uint8_t*>(malloc(kHeadHashBytes));
+    if (!head) {
+        return key;
+    }
+    size_t got = probe->read(head, kHeadHashBytes);
+    key.head_hash = fnv1a(head, got);
+    free(head);
+    probe->close();
+
+    const char* uri = source->uri();
+    key.path_hash = fnv1a(uri, strlen(uri));
+    key.file_size = source->size();
+    key.mtime = source->last_modified();
+    key.fs = source->type();
+    key.valid = got > 0;
+    return key;
+}
+
+bool Mp3SeekCache::load(const Key& key, Mp3SeekTable& table) {
+    fs::FS* fs = key.valid ? cache_fs(key.fs) : nullptr;
+    if (!fs) {
+        return false;
+    }
+    char path[kMaxDirLength + 16];
+    cache_path(key, path, sizeof(path), false);
+    if (!fs->exists(path)) {
+        return false;
+    }
+    File f = fs->open(path, FILE_READ);
+    if (!f) {
+        return false;
+    }
+
+    uint32_t start_ms = millis();
+    CacheHeader hdr;
+    bool ok = f.read(reinterpret_cast<uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr) &&
+              hdr.magic == kMagic && hdr.version == kVersion && hdr.header_size == sizeof(hdr) &&
+              hdr.path_hash == key.path_hash && hdr.head_hash == key.head_hash &&
+              hdr.file_size == key.file_size && hdr.mtime == key.mtime &&
+              hdr.entry_count > 0 && hdr.sample_rate > 0;
+    if (!ok) {
+        f.close();
+        LOG_INFO("Seek cache stale or incompatible, removing %s", path);
+        fs->remove(path);
+        return false;
+    }
+
+    table.begin(hdr.sample_rate, hdr.frames_per_entry, hdr.byte_base, hdr.frame_quantum);
+    CacheEntry batch[kEntriesPerIo];
+    uint32_t crc = 2166136261u;
+    uint32_t remaining = hdr.entry_count;
+    while (ok && remaining > 0) {
+        size_t n = remaining < kEntriesPerIo ? remaining : kEntriesPerIo;
+        size_t bytes = n * sizeof(CacheEntry);
+        if (f.read(reinterpret_cast<uint8_t*>(batch), bytes) != bytes) {
+            ok = false;
+            break;
+        }
+        crc = fnv1a(batch, bytes, crc);
+        for (size_t i = 0; i < n && ok; ++i) {
+            ok = table.add_entry(batch[i].pcm_frame, batch[i].byte_offset);
+        }
+        remaining -= n;
+    }
+    f.close();
+
+    if (!ok || crc != hdr.entries_crc) {
+        LOG_WARN("Seek cache corrupted, removing %s", path);
+        table.clear();
+        fs->remove(path);
+        return false;
+    }
+
+    table.set_coverage(hdr.total_frames, hdr.total_bytes);
+    table.finish();
+    LOG_INFO("Seek table loaded from cache: %u entries in %u ms",
+             (unsigned)hdr.entry_count, millis() - start_ms);
+    return true;
+}
+
+bool Mp3SeekCache::store(const Key& key, const Mp3SeekTable& table) {
+    fs::FS* fs = key.valid ? cache_fs(key.fs) : nullptr;
+    if (!fs || !table.is_complete() || table.size() == 0) {
+        return false;
+    }
+    // Il formato su disco usa 32 bit: file > 4GB non vengono messi in cache
+    if (key.file_size > UINT32_MAX || table.covered_frames() > UINT32_MAX) {
+        return false;
+    }
+    if (!fs->exists(g_cache_dir) && !fs->mkdir(g_cache_dir)) {
+        LOG_WARN("Seek cache: cannot create %s", g_cache_dir);
+        return false;
+    }
+
+    char tmp_path[kMaxDirLength + 16];
+    char final_path[kMaxDirLength + 16];
+    cache_path(key, tmp_path, sizeof(tmp_path), true);
+    cache_path(key, final_path, sizeof(final_path), false);
+
+    File f = fs->open(tmp_path, FILE_WRITE);
+    if (!f) {
+        LOG_WARN("Seek cache: cannot open %s", tmp_path);
+        return false;
+    }
+
+    CacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = kMagic;
+    hdr.version = kVersion;
+    hdr.header_size = sizeof(hdr);
+    hdr.path_hash = key.path_hash;
+    hdr.head_hash = key.head_hash;
+    hdr.file_size = key.file_size;
+    hdr.mtime = key.mtime;
+    hdr.sample_rate = table.sample_rate();
+    hdr.frames_per_entry = table.frames_per_entry();
+    hdr.entry_count = table.size();
+    hdr.total_frames = table.covered_frames();
+    hdr.total_bytes = table.covered_bytes();
+    hdr.byte_base = table.byte_base();
+    hdr.frame_quantum = table.frame_quantum();
+
+    // Header provvisorio, riscritto col CRC a fine file
+    bool ok = f.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr);
+    CacheEntry batch[kEntriesPerIo];
+    uint32_t crc = 2166136261u;
+    size_t index = 0;
+    while (ok && index < hdr.entry_count) {
+        size_t n = 0;
+        for (; n < kEntriesPerIo && index < hdr.entry_count; ++n, ++index) {
+            uint64_t frame = 0;
+            uint64_t offset = 0;
+            table.get_entry(index, &frame, &offset);
+            batch[n].pcm_frame = static_cast<uint32_t>(frame);
+            batch[n].byte_offset = static_cast<uint32_t>(offset);
+        }
+        size_t bytes = n * sizeof(CacheEntry);
+        crc = fnv1a(batch, bytes, crc);
+        ok = f.write(reinterpret_cast<const uint8_t*>(batch), bytes) == bytes;
+    }
+    hdr.entries_crc = crc;
+    ok = ok && f.seek(0) && f.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr);
+    f.close();
+
+    if (!ok) {
+        LOG_WARN("Seek cache: write failed for %s", tmp_path);
+        fs->remove(tmp_path);
+        return false;
+    }
+    if (fs->exists(final_path)) {
+        fs->remove(final_path);
+    }
+    if (!fs->rename(tmp_path, final_path)) {
+        fs->remove(tmp_path);
+        return false;
+    }
+    LOG_INFO("Seek table cached: %s (%u entries)", final_path, (unsigned)hdr.entry_count);
+    return true;
+}
+
+void Mp3SeekCache::remove(const Key& key) {
+    fs::FS* fs = key.valid ? cache_fs(key.fs) : nullptr;
+    if (!fs) {
+        return;
+    }
+    char path[kMaxDirLength + 16];
+    cache_path(key, path, sizeof(path), false);
+    if (fs->exists(path)) {
+        fs->remove(path);
+    }
+}
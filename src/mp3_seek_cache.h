@@ -0,0 +1,52 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "data_source.h"
+#include "mp3_seek_table.h"
+
+namespace fs { class FS; }
+
+// Cache persistente delle seek table MP3 (sidecar in /.seekcache sullo stesso
+// filesystem del file: SD per "/sd/...", altrimenti LittleFS). Directory e filesystem
+// si cambiano con set_location(): i tool host la spostano nella cache dell'host, fuori
+// dalle directory dei media.
+//
+// Identità del file: hash del path + size + mtime + hash dei primi 4KB, così un file
+// sostituito con lo stesso nome (o su FS senza mtime) invalida comunque la entry.
+// Formato: header versionato + coppie (frame, offset) a 32 bit, CRC sulle entry.
+// Entry non valide o di versione diversa vengono rimosse al primo accesso.
+class Mp3SeekCache {
+public:
+    struct Key {
+        uint32_t path_hash;
+        uint32_t head_hash;
+        uint64_t file_size;
+        uint32_t mtime;
+        SourceType fs;
+        bool valid;
+    };
+
+    // Calcola l'identità leggendo i primi byte da un handle duplicato (la posizione
+    // di `source` non viene toccata). valid=false per sorgenti non cacheabili.
+    static Key make_key(const IDataSource* source);
+
+    // Carica la table se presente e coerente con la chiave; in caso di successo la table
+    // è completa (finish() già chiamato).
+    static bool load(const Key& key, Mp3SeekTable& table);
+
+    // Salva una table completa (scrittura su file temporaneo + rename).
+    static bool store(const Key& key, const Mp3SeekTable& table);
+
+    static void remove(const Key& key);
+
+    // Dove scrivere i sidecar: filesystem (nullptr = quello del file) e directory di primo
+    // livello (default "/.seekcache", max kMaxDirLength; nullptr o "" disabilita la cache).
+    // Da chiamare prima di avviare il playback.
+    static constexpr size_t kMaxDirLength = 47;
+    static bool set_location(fs::FS* filesystem, const char* dir);
+    static const char* directory();
+};
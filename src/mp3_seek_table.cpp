@@ -6,27 +6,66 @@
 #include "logger.h"
 #include "data_source.h"
 #include "dr_mp3.h"
+#include "mp3_vbr_header.h"
 #include <Arduino.h>
 #include <esp_heap_caps.h>
 #include <cstring>
 
+namespace {
+class TableLock {
+public:
+    explicit TableLock(SemaphoreHandle_t mutex) : mutex_(mutex) {
+        if (mutex_) xSemaphoreTake(mutex_, portMAX_DELAY);
+    }
+    ~TableLock() {
+        if (mutex_) xSemaphoreGive(mutex_);
+    }
+private:
+    SemaphoreHandle_t mutex_;
+};
+} // namespace
+
+Mp3SeekTable::Mp3SeekTable() {
+    mutex_ = xSemaphoreCreateMutex();
+}
+
 Mp3SeekTable::~Mp3SeekTable() {
     clear();
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
 }
 
 void Mp3SeekTable::clear() {
-    if (entries_) {
-        heap_caps_free(entries_);
-        entries_ = nullptr;
+    TableLock lock(mutex_);
+    clear_locked();
+}
+
+void Mp3SeekTable::clear_locked() {
+    if (deltas_) {
+        heap_caps_free(deltas_);
+        deltas_ = nullptr;
+    }
+    if (anchors_) {
+        heap_caps_free(anchors_);
+        anchors_ = nullptr;
     }
     entry_count_ = 0;
     entry_capacity_ = 0;
+    anchor_count_ = 0;
+    anchor_capacity_ = 0;
     frames_per_entry_ = 0;
+    frame_quantum_ = 0;
     current_pcm_frame_ = 0;
     last_entry_frame_ = 0;
+    last_entry_byte_ = 0;
     total_processed_bytes_ = 0;
+    byte_base_ = 0;
     bytes_to_skip_ = 0;
     residue_len_ = 0;
+    complete_ = false;
+    trimmed_ = false;
 }
 
 bool Mp3SeekTable::ensure_capacity(size_t new_capacity) {
@@ -34,81 +73,230 @@ bool Mp3SeekTable::ensure_capacity(size_t new_capacity) {
         return true;
     }
 
-    size_t bytes_needed = new_capacity * sizeof(Entry);
-    Entry* new_entries = static_cast<Entry*>(
-        heap_caps_realloc(entries_, bytes_needed, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+    size_t bytes_needed = new_capacity * kDeltaBytes;
+    uint8_t* new_deltas = static_cast<uint8_t*>(
+        heap_caps_realloc(deltas_, bytes_needed, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
     );
 
-    if (!new_entries) {
+    if (!new_deltas) {
         LOG_ERROR("Failed to allocate seek table: %u bytes", (unsigned)bytes_needed);
         return false;
     }
 
-    entries_ = new_entries;
+    deltas_ = new_deltas;
     entry_capacity_ = new_capacity;
     return true;
 }
 
-bool Mp3SeekTable::parse_header(const uint8_t* header, uint32_t* frame_size, uint32_t* samples_per_frame) {
-    uint8_t b1 = header[1];
-    uint8_t b2 = header[2];
-    // uint8_t b3 = header[3]; // Not used
-
-    int version_id = (b1 >> 3) & 0x03;      // MPEG version
-    int layer_idx = (b1 >> 1) & 0x03;       // Layer
-    int bitrate_idx = (b2 >> 4) & 0x0F;     // Bitrate index
-    int sr_idx = (b2 >> 2) & 0x03;          // Sample rate index
-    int padding = (b2 >> 1) & 0x01;         // Padding bit
-
-    // Valida header
-    if (layer_idx == 0 || bitrate_idx == 0x0F || sr_idx == 0x03) {
-        return false;
+bool Mp3SeekTable::ensure_anchor_capacity(size_t new_capacity) {
+    if (new_capacity <= anchor_capacity_) {
+        return true;
     }
 
-    // Tabelle bitrate (kbps) e sample rate
-    static const uint16_t bitrate_table[2][16] = {
-        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},  // MPEG1
-        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}       // MPEG2/2.5
-    };
-    static const uint32_t sr_table[3][3] = {
-        {44100, 48000, 32000},  // MPEG1
-        {22050, 24000, 16000},  // MPEG2
-        {11025, 12000, 8000}    // MPEG2.5
-    };
+    size_t bytes_needed = new_capacity * sizeof(Anchor);
+    Anchor* new_anchors = static_cast<Anchor*>(
+        heap_caps_realloc(anchors_, bytes_needed, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+    );
+
+    if (!new_anchors) {
+        LOG_ERROR("Failed to allocate seek table anchors: %u bytes", (unsigned)bytes_needed);
+        return false;
+    }
 
-    int version_row = (version_id == 0x03) ? 0 : 1;  // MPEG1 vs MPEG2/2.5
-    uint32_t bitrate_kbps = bitrate_table[version_row][bitrate_idx];
-    uint32_t sample_rate_hz = sr_table[(version_id == 0x03) ? 0 : (version_id == 0x02) ? 1 : 2][sr_idx];
+    anchors_ = new_anchors;
+    anchor_capacity_ = new_capacity;
+    return true;
+}
 
-    if (bitrate_kbps == 0 || sample_rate_hz == 0) {
+bool Mp3SeekTable::push_entry_locked(uint64_t pcm_frame, uint64_t byte_offset) {
+    if (entry_count_ > 0 && (pcm_frame <= last_entry_frame_ || byte_offset < last_entry_byte_)) {
+        return false;
+    }
+    if (entry_count_ >= entry_capacity_ && !ensure_capacity(entry_capacity_ + kEntryGrowth)) {
         return false;
     }
 
-    // Calcola frame size: FrameSize = 144 * BitRate / SampleRate + Padding
-    // Note: For Layer 1 it is different but we focus on L3 mostly. L2 similar.
-    // Simplified for Layer 2 & 3:
-    *frame_size = (144 * bitrate_kbps * 1000) / sample_rate_hz + padding;
+    // Delta rappresentabile (passi interi di frame_quantum_ in 8 bit, byte in 16 bit) e
+    // blocco non troppo lungo: altrimenti la entry diventa una nuova ancora assoluta
+    uint64_t frame_delta = pcm_frame - last_entry_frame_;
+    uint64_t byte_delta = byte_offset - last_entry_byte_;
+    bool anchor = anchor_count_ == 0 ||
+                  entry_count_ - anchors_[anchor_count_ - 1].first_index >= kMaxAnchorSpan ||
+                  frame_quantum_ == 0 || frame_delta % frame_quantum_ != 0 ||
+                  frame_delta / frame_quantum_ > 0xFF || byte_delta > 0xFFFF;
+
+    uint8_t* slot = deltas_ + entry_count_ * kDeltaBytes;
+    if (anchor) {
+        if (anchor_count_ >= anchor_capacity_ && !ensure_anchor_capacity(anchor_capacity_ + kAnchorGrowth)) {
+            return false;
+        }
+        anchors_[anchor_count_++] = {pcm_frame, byte_offset, static_cast<uint32_t>(entry_count_)};
+        slot[0] = slot[1] = slot[2] = 0;
+    } else {
+        slot[0] = static_cast<uint8_t>(frame_delta / frame_quantum_);
+        slot[1] = static_cast<uint8_t>(byte_delta & 0xFF);
+        slot[2] = static_cast<uint8_t>(byte_delta >> 8);
+    }
+
+    entry_count_++;
+    last_entry_frame_ = pcm_frame;
+    last_entry_byte_ = byte_offset;
+    return true;
+}
 
-    // Calcola samples per frame
-    *samples_per_frame = (layer_idx == 0x01) ? 1152 : 576;  // Layer 3 = 1152, others 576/384. Simplified.
-    if (layer_idx == 3) *samples_per_frame = 384; // Layer 1
-    else if (layer_idx == 2) *samples_per_frame = 1152; // Layer 2
-    else *samples_per_frame = ((version_id == 0x03) ? 1152 : 576); // Layer 3 (MPEG1 vs 2/2.5)
+void Mp3SeekTable::decode_delta(size_t index, uint64_t* pcm_frame, uint64_t* byte_offset) const {
+    const uint8_t* slot = deltas_ + index * kDeltaBytes;
+    *pcm_frame += static_cast<uint64_t>(slot[0]) * frame_quantum_;
+    *byte_offset += static_cast<uint64_t>(slot[1]) | (static_cast<uint64_t>(slot[2]) << 8);
+}
 
+bool Mp3SeekTable::parse_header(const uint8_t* header, uint32_t* frame_size, uint32_t* samples_per_frame) {
+    // Stesso parser del probe Xing/VBRI: lunghezze e campioni corretti anche per MPEG2/2.5 e Layer 1
+    Mp3FrameHeader fh;
+    if (!parse_mp3_frame_header(header, &fh)) {
+        return false;
+    }
+    if (sample_rate_ == 0) {
+        // Build live (begin con sample_rate 0): rate, e passo delle entry, dal primo header
+        sample_rate_ = fh.sample_rate;
+        if (frames_per_entry_ == 0) {
+            frames_per_entry_ = fh.sample_rate;
+        }
+    }
+    *frame_size = fh.length;
+    *samples_per_frame = fh.samples;
     return true;
 }
 
-void Mp3SeekTable::begin(uint32_t sample_rate, uint32_t frames_per_entry) {
-    clear();
+void Mp3SeekTable::begin(uint32_t sample_rate, uint32_t frames_per_entry, uint64_t byte_base,
+                         uint32_t frame_quantum) {
+    TableLock lock(mutex_);
+    clear_locked();
     sample_rate_ = sample_rate;
+    byte_base_ = byte_base;
+    frame_quantum_ = frame_quantum;
+    total_processed_bytes_ = byte_base;
     frames_per_entry_ = frames_per_entry;
-    frames_per_entry_ = (frames_per_entry_ > 0) ? frames_per_entry_ : 4800; // safety default
+    if (frames_per_entry_ == 0 && sample_rate > 0) {
+        frames_per_entry_ = 4800; // safety default (rate ignoto: un'entry al secondo, vedi parse_header)
+    }
 
     // Alloc initial capacity
-    ensure_capacity(500);
+    ensure_capacity(kEntryGrowth);
+    ensure_anchor_capacity(kAnchorGrowth);
 }
 
 bool Mp3SeekTable::append_chunk(const uint8_t* data, size_t size) {
+    TableLock lock(mutex_);
+    return append_chunk_locked(data, size);
+}
+
+void Mp3SeekTable::finish() {
+    TableLock lock(mutex_);
+    complete_ = true;
+}
+
+bool Mp3SeekTable::add_entry(uint64_t pcm_frame, uint64_t byte_offset) {
+    TableLock lock(mutex_);
+    return push_entry_locked(pcm_frame, byte_offset);
+}
+
+void Mp3SeekTable::set_coverage(uint64_t total_frames, uint64_t total_bytes) {
+    TableLock lock(mutex_);
+    current_pcm_frame_ = total_frames;
+    total_processed_bytes_ = total_bytes;
+}
+
+bool Mp3SeekTable::get_entry(size_t index, uint64_t* pcm_frame, uint64_t* byte_offset) const {
+    TableLock lock(mutex_);
+    if (index >= entry_count_ || !pcm_frame || !byte_offset) {
+        return false;
+    }
+    // Ultima ancora con first_index <= index, poi somma dei delta fino a index
+    size_t left = 0;
+    size_t right = anchor_count_;
+    while (right - left > 1) {
+        size_t mid = left + (right - left) / 2;
+        if (anchors_[mid].first_index <= index) {
+            left = mid;
+        } else {
+            right = mid;
+        }
+    }
+    const Anchor& a = anchors_[left];
+    *pcm_frame = a.pcm_frame;
+    *byte_offset = a.byte_offset;
+    for (size_t i = a.first_index + 1; i <= index; ++i) {
+        decode_delta(i, pcm_frame, byte_offset);
+    }
+    return true;
+}
+
+size_t Mp3SeekTable::drop_before(uint64_t byte_offset) {
+    TableLock lock(mutex_);
+    if (entry_count_ == 0) {
+        return 0;
+    }
+
+    // Ultima ancora con offset < byte_offset, poi scansione del blocco fino alla prima
+    // entry da tenere: gli offset crescono con l'indice
+    size_t a = 0;
+    size_t right = anchor_count_;
+    while (right - a > 1) {
+        size_t mid = a + (right - a) / 2;
+        if (anchors_[mid].byte_offset < byte_offset) {
+            a = mid;
+        } else {
+            right = mid;
+        }
+    }
+    if (anchors_[a].byte_offset >= byte_offset) {
+        return 0;
+    }
+    size_t end = (a + 1 < anchor_count_) ? anchors_[a + 1].first_index : entry_count_;
+    uint64_t frame = anchors_[a].pcm_frame;
+    uint64_t offset = anchors_[a].byte_offset;
+    size_t keep = anchors_[a].first_index;
+    while (offset < byte_offset && ++keep < end) {
+        decode_delta(keep, &frame, &offset);
+    }
+
+    trimmed_ = true;
+    if (keep >= entry_count_) {
+        // Tutta la table è fuori finestra: la prossima entry aprirà una nuova ancora
+        entry_count_ = 0;
+        anchor_count_ = 0;
+        return keep;
+    }
+
+    // La entry keep diventa l'ancora del suo blocco (o è già la prima del blocco successivo)
+    if (keep < end) {
+        anchors_[a] = {frame, offset, static_cast<uint32_t>(keep)};
+    } else {
+        ++a;
+    }
+    memmove(deltas_, deltas_ + keep * kDeltaBytes, (entry_count_ - keep) * kDeltaBytes);
+    deltas_[0] = deltas_[1] = deltas_[2] = 0;
+    memmove(anchors_, anchors_ + a, (anchor_count_ - a) * sizeof(Anchor));
+    anchor_count_ -= a;
+    for (size_t i = 0; i < anchor_count_; ++i) {
+        anchors_[i].first_index -= static_cast<uint32_t>(keep);
+    }
+    entry_count_ -= keep;
+    return keep;
+}
+
+uint64_t Mp3SeekTable::covered_frames() const {
+    TableLock lock(mutex_);
+    return current_pcm_frame_;
+}
+
+uint64_t Mp3SeekTable::covered_bytes() const {
+    TableLock lock(mutex_);
+    return total_processed_bytes_;
+}
+
+bool Mp3SeekTable::append_chunk_locked(const uint8_t* data, size_t size) {
     if (!data || size == 0) return true;
 
     size_t pos = 0;
@@ -136,16 +324,14 @@ bool Mp3SeekTable::append_chunk(const uint8_t* data, size_t size) {
                     } else {
                         bytes_to_skip_ = frame_size - 4; // skipped header already
                         
+                        if (frame_quantum_ == 0) {
+                            frame_quantum_ = samples;
+                        }
                         // Add entry if needed
                         if (current_pcm_frame_ - last_entry_frame_ >= frames_per_entry_) {
-                             if (entry_count_ >= entry_capacity_) {
-                                if (!ensure_capacity(entry_capacity_ + 500)) return false;
-                             }
                              // The offset is where the frame STARTED.
                              // Frame start was: total_processed_bytes_ - residue_len_
-                             entries_[entry_count_] = {current_pcm_frame_, total_processed_bytes_ - residue_len_};
-                             entry_count_++;
-                             last_entry_frame_ = current_pcm_frame_;
+                             if (!push_entry_locked(current_pcm_frame_, total_processed_bytes_ - residue_len_)) return false;
                         }
                         
                         current_pcm_frame_ += samples;
@@ -201,14 +387,12 @@ bool Mp3SeekTable::append_chunk(const uint8_t* data, size_t size) {
             uint32_t frame_size = 0;
             uint32_t samples = 0;
             if (parse_header(data + pos, &frame_size, &samples)) {
+                if (frame_quantum_ == 0) {
+                    frame_quantum_ = samples;
+                }
                 // Add Entry
                  if (current_pcm_frame_ - last_entry_frame_ >= frames_per_entry_) {
-                     if (entry_count_ >= entry_capacity_) {
-                        if (!ensure_capacity(entry_capacity_ + 500)) return false;
-                     }
-                     entries_[entry_count_] = {current_pcm_frame_, total_processed_bytes_ + pos};
-                     entry_count_++;
-                     last_entry_frame_ = current_pcm_frame_;
+                     if (!push_entry_locked(current_pcm_frame_, total_processed_bytes_ + pos)) return false;
                  }
 
                  current_pcm_frame_ += samples;
@@ -242,10 +426,12 @@ bool Mp3SeekTable::build(const uint8_t* mp3_data, size_t mp3_size, uint32_t samp
     LOG_INFO("Building seek table (entry every %u frames)...", frames_per_entry);
 
     bool res = append_chunk(mp3_data, mp3_size);
+    finish();
 
     uint32_t build_time = millis() - build_start;
-    LOG_INFO("Seek table built: %u entries, %u bytes, %u ms (total frames: %llu)",
+    LOG_INFO("Seek table built: %u entries (%u anchors), %u bytes, %u ms (total frames: %llu)",
              (unsigned)entry_count_,
+             (unsigned)anchor_count_,
              (unsigned)memory_bytes(),
              build_time,
              current_pcm_frame_);
@@ -254,21 +440,21 @@ bool Mp3SeekTable::build(const uint8_t* mp3_data, size_t mp3_size, uint32_t samp
 }
 
 bool Mp3SeekTable::find_seek_point(uint64_t target_frame, uint64_t* byte_offset, uint64_t* nearest_frame) const {
+    TableLock lock(mutex_);
     if (!is_ready() || !byte_offset || !nearest_frame) {
         return false;
     }
 
-    // Binary search upper_bound-ish
-    // We want the entry s.t. entry.pcm_frame <= target_frame
-    
+    // Ricerca binaria sulle ancore (ultima con pcm_frame <= target), poi scansione
+    // lineare dei delta del blocco (al massimo kMaxAnchorSpan entry)
     size_t left = 0;
-    size_t right = entry_count_;
+    size_t right = anchor_count_;
     intptr_t best = -1;
 
     while (left < right) {
         size_t mid = left + (right - left) / 2;
 
-        if (entries_[mid].pcm_frame <= target_frame) {
+        if (anchors_[mid].pcm_frame <= target_frame) {
             best = mid;
             left = mid + 1;
         } else {
@@ -277,14 +463,35 @@ bool Mp3SeekTable::find_seek_point(uint64_t target_frame, uint64_t* byte_offset,
     }
 
     if (best != -1) {
-        *byte_offset = entries_[best].byte_offset;
-        *nearest_frame = entries_[best].pcm_frame;
+        const Anchor& a = anchors_[best];
+        size_t end = (static_cast<size_t>(best) + 1 < anchor_count_) ? anchors_[best + 1].first_index : entry_count_;
+        uint64_t frame = a.pcm_frame;
+        uint64_t offset = a.byte_offset;
+        for (size_t i = a.first_index + 1; i < end; ++i) {
+            uint64_t next_frame = frame;
+            uint64_t next_offset = offset;
+            decode_delta(i, &next_frame, &next_offset);
+            if (next_frame > target_frame) {
+                break;
+            }
+            frame = next_frame;
+            offset = next_offset;
+        }
+        *byte_offset = offset;
+        *nearest_frame = frame;
         return true;
     }
     
+    // Table accorciata da drop_before(): l'inizio non è più coperto, si atterra sulla prima entry
+    if (trimmed_) {
+        *byte_offset = anchors_[0].byte_offset;
+        *nearest_frame = anchors_[0].pcm_frame;
+        return true;
+    }
+
     // If target is before first entry (should be rare given entry 0 is usually frame 0)
     // fallback to start
-    *byte_offset = 0;
+    *byte_offset = byte_base_;
     *nearest_frame = 0;
     return true;
 }
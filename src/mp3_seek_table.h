@@ -6,52 +6,110 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // Seek table per MP3: mappa frame PCM → byte offset nel file
 // Permette seek istantanei (<10ms) invece di scansione lineare (secondi)
+//
+// Formato compatto: ogni entry è un delta di 3 byte rispetto alla precedente (passi da
+// frame_quantum, cioè campioni per frame MPEG, in 8 bit + byte in 16 bit). Ogni
+// kMaxAnchorSpan entry, o quando un delta non entra, c'è un'ancora con valori assoluti:
+// ricerca binaria sulle ancore + scansione del blocco. ~3.4 byte/entry invece di 16.
+//
+// Thread-safety: append_chunk()/finish() (task di indicizzazione) e find_seek_point()
+// (decode task) possono girare in parallelo; lo stato è protetto da un mutex interno.
 class Mp3SeekTable {
 public:
-    Mp3SeekTable() = default;
+    Mp3SeekTable();
     ~Mp3SeekTable();
 
+    Mp3SeekTable(const Mp3SeekTable&) = delete;
+    Mp3SeekTable& operator=(const Mp3SeekTable&) = delete;
+
     // Costruisce la seek table scansionando il file (One-shot)
     bool build(const uint8_t* mp3_data, size_t mp3_size, uint32_t sample_rate, uint32_t frames_per_entry = 4800);
 
     // --- Incremental Build API ---
-    // Inizializza il processo di costruzione incrementale
-    void begin(uint32_t sample_rate, uint32_t frames_per_entry = 4800);
+    // Inizializza il processo di costruzione incrementale. byte_base = offset nel file del
+    // primo chunk (primo frame audio, dopo ID3v2 e frame Xing/Info): gli offset restano assoluti
+    // frame_quantum = campioni per frame MPEG (0 = ricavato dal primo header scansionato)
+    // sample_rate = 0: ricavato dal primo header (stream live); con frames_per_entry = 0
+    // le entry sono allora una al secondo
+    void begin(uint32_t sample_rate, uint32_t frames_per_entry = 4800, uint64_t byte_base = 0,
+               uint32_t frame_quantum = 0);
 
     // Processa un chunk di dati MP3. Assumiamo che i chunk siano contigui.
     // Ritorna true se ok, false se errore critico (allocazione memoria)
     bool append_chunk(const uint8_t* data, size_t size);
 
+    // Segnala che tutto il file è stato processato: da qui la table copre ogni frame
+    void finish();
+
+    // --- Serializzazione (cache su disco) ---
+    // Ripristino: begin() + add_entry() in ordine crescente + set_coverage() + finish()
+    bool add_entry(uint64_t pcm_frame, uint64_t byte_offset);
+    void set_coverage(uint64_t total_frames, uint64_t total_bytes);
+    bool get_entry(size_t index, uint64_t* pcm_frame, uint64_t* byte_offset) const;
+    uint32_t sample_rate() const { return sample_rate_; }
+    uint32_t frames_per_entry() const { return frames_per_entry_; }
+    uint64_t byte_base() const { return byte_base_; }
+    uint32_t frame_quantum() const { return frame_quantum_; }
+
+    // Scarta le entry con offset < byte_offset (finestra timeshift che ricicla i chunk): la
+    // prima entry rimasta diventa un'ancora, le successive restano delta. Ritorna quante entry
+    // sono state tolte, per riallineare gli indici usati con get_entry()
+    size_t drop_before(uint64_t byte_offset);
+
     // Trova il seek point più vicino al target frame
     // Ritorna: true se trovato, false se table vuota
     // Output: byte_offset = posizione byte nel file, nearest_frame = frame del seek point
+    // (dopo drop_before() un target anteriore alla prima entry restituisce la prima entry)
     bool find_seek_point(uint64_t target_frame, uint64_t* byte_offset, uint64_t* nearest_frame) const;
 
-    bool is_ready() const { return entries_ != nullptr && entry_count_ > 0; }
+    bool is_ready() const { return anchors_ != nullptr && entry_count_ > 0; }
+    bool is_complete() const { return complete_; }
     size_t size() const { return entry_count_; }
-    size_t memory_bytes() const { return entry_count_ * sizeof(Entry); }
+    // Frame PCM scansionati e offset assoluto raggiunto (durante il build incrementale).
+    // I frame partono da 0 al byte_base, senza taglio gapless (encoder delay incluso)
+    uint64_t covered_frames() const;
+    uint64_t covered_bytes() const;
+    // Footprint reale: capacità allocata di delta e ancore
+    size_t memory_bytes() const { return entry_capacity_ * kDeltaBytes + anchor_capacity_ * sizeof(Anchor); }
 
     void clear();
 
 private:
-    struct Entry {
+    struct Anchor {
         uint64_t pcm_frame;      // Numero frame PCM
         uint64_t byte_offset;    // Offset byte nel file MP3
+        uint32_t first_index;    // Indice della entry corrispondente all'ancora
     };
 
-    Entry* entries_ = nullptr;         // Array dinamico allocato con heap_caps_malloc
+    static constexpr size_t kDeltaBytes = 3;
+    static constexpr size_t kMaxAnchorSpan = 64;
+    static constexpr size_t kEntryGrowth = 512;
+    static constexpr size_t kAnchorGrowth = 16;
+
+    uint8_t* deltas_ = nullptr;        // kDeltaBytes per entry (slot dell'ancora inutilizzato)
+    Anchor* anchors_ = nullptr;
     size_t entry_count_ = 0;           // Numero di entry nella table
-    size_t entry_capacity_ = 0;        // Capacità allocata
+    size_t entry_capacity_ = 0;        // Capacità allocata (entry)
+    size_t anchor_count_ = 0;
+    size_t anchor_capacity_ = 0;
     uint32_t frames_per_entry_ = 0;    // Frame tra ogni entry
+    uint32_t frame_quantum_ = 0;       // Unità dei delta di frame
+    volatile bool complete_ = false;
+    bool trimmed_ = false;             // drop_before() ha tolto l'inizio: byte_base_ non è più coperto
+    SemaphoreHandle_t mutex_ = nullptr;
 
     // Stato build incrementale
     uint32_t sample_rate_ = 44100;
     uint64_t current_pcm_frame_ = 0;
     uint64_t last_entry_frame_ = 0;
+    uint64_t last_entry_byte_ = 0;
     uint64_t total_processed_bytes_ = 0;
+    uint64_t byte_base_ = 0;
     
     // Gestione frame a cavallo di chunk
     size_t bytes_to_skip_ = 0;         // Byte del frame corrente che continuano nel prossimo chunk
@@ -60,6 +118,11 @@ private:
     uint8_t residue_buf_[4];
     size_t residue_len_ = 0;
 
+    bool append_chunk_locked(const uint8_t* data, size_t size);
+    void clear_locked();
     bool ensure_capacity(size_t new_capacity);
+    bool ensure_anchor_capacity(size_t new_capacity);
+    bool push_entry_locked(uint64_t pcm_frame, uint64_t byte_offset);
+    void decode_delta(size_t index, uint64_t* pcm_frame, uint64_t* byte_offset) const;
     bool parse_header(const uint8_t* header, uint32_t* frame_size, uint32_t* samples_per_frame);
 };
@@ -0,0 +1,291 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#include "mp3_vbr_header.h"
+
+#include <cstdlib>
+#include <cstring>
+#include "logger.h"
+
+namespace {
+
+constexpr size_t kProbeBytes = 8192;        // Finestra dopo l'ID3v2 in cui cercare il primo frame
+constexpr uint32_t kDecoderDelay = 528 + 1; // Ritardo del filtro di sintesi (convenzione LAME/dr_mp3)
+
+} // namespace
+
+bool parse_mp3_frame_header(const uint8_t* h, Mp3FrameHeader* out) {
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+    uint32_t version_id = (h[1] >> 3) & 0x03;
+    uint32_t layer_id = (h[1] >> 1) & 0x03;
+    uint32_t bitrate_idx = (h[2] >> 4) & 0x0F;
+    uint32_t sr_idx = (h[2] >> 2) & 0x03;
+    uint32_t padding = (h[2] >> 1) & 0x01;
+    if (version_id == 0x01 || layer_id == 0 || bitrate_idx == 0 || bitrate_idx == 0x0F || sr_idx == 0x03) {
+        return false;  // Versione riservata, free-format o valori invalidi
+    }
+
+    static const uint16_t kBitrates[2][3][15] = {
+        {   // MPEG1: Layer 1, 2, 3
+            {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+            {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+            {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+        },
+        {   // MPEG2/2.5: Layer 1, 2, 3
+            {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+        },
+    };
+    static const uint32_t kSampleRates[3][3] = {
+        {44100, 48000, 32000},
+        {22050, 24000, 16000},
+        {11025, 12000, 8000},
+    };
+
+    out->version = (version_id == 0x03) ? 1 : (version_id == 0x02) ? 2 : 25;
+    out->layer = 4 - layer_id;
+    bool mpeg1 = out->version == 1;
+    out->bitrate_kbps = kBitrates[mpeg1 ? 0 : 1][out->layer - 1][bitrate_idx];
+    out->sample_rate = kSampleRates[mpeg1 ? 0 : (out->version == 2 ? 1 : 2)][sr_idx];
+    out->channels = (((h[3] >> 6) & 0x03) == 0x03) ? 1 : 2;
+    out->crc = (h[1] & 0x01) == 0;
+
+    uint32_t br = out->bitrate_kbps * 1000;
+    if (out->layer == 1) {
+        out->samples = 384;
+        out->length = (12 * br / out->sample_rate + padding) * 4;
+    } else if (out->layer == 2 || mpeg1) {
+        out->samples = 1152;
+        out->length = 144 * br / out->sample_rate + padding;
+    } else {
+        out->samples = 576;
+        out->length = 72 * br / out->sample_rate + padding;
+    }
+    return out->length > 4;
+}
+
+namespace {
+
+uint32_t be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint16_t be16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Xing/Info + eventuale estensione LAME (delay/padding)
+void parse_xing(const uint8_t* frame, const Mp3FrameHeader& fh, Mp3StreamInfo* info) {
+    uint32_t side = (fh.version == 1) ? (fh.channels == 1 ? 17 : 32) : (fh.channels == 1 ? 9 : 17);
+    size_t pos = 4 + (fh.crc ? 2 : 0) + side;
+    if (pos + 8 > fh.length) {
+        return;
+    }
+    const uint8_t* p = frame + pos;
+    bool xing = memcmp(p, "Xing", 4) == 0;
+    bool inf = memcmp(p, "Info", 4) == 0;
+    if (!xing && !inf) {
+        return;
+    }
+    const uint8_t* end = frame + fh.length;
+    uint32_t flags = be32(p + 4);
+    p += 8;
+
+    info->kind = xing ? Mp3VbrKind::XING : Mp3VbrKind::INFO;
+    if ((flags & 0x01) && p + 4 <= end) {
+        info->frame_count = be32(p);
+        p += 4;
+    }
+    if ((flags & 0x02) && p + 4 <= end) {
+        info->byte_count = be32(p);
+        p += 4;
+    }
+    if ((flags & 0x04) && p + 100 <= end) {
+        memcpy(info->toc, p, 100);
+        info->has_toc = true;
+        p += 100;
+    }
+    if (flags & 0x08) {
+        p += 4;  // Quality
+    }
+
+    // Tag LAME: encoder (9 byte) ... delay/padding 12+12 bit a +21
+    if (p + 24 <= end && p[0] != 0) {
+        const uint8_t* d = p + 21;
+        uint32_t enc_delay = ((uint32_t)d[0] << 4) | (d[1] >> 4);
+        uint32_t enc_padding = ((uint32_t)(d[1] & 0x0F) << 8) | d[2];
+        info->has_gapless = true;
+        info->delay_frames = enc_delay + kDecoderDelay;
+        info->padding_frames = enc_padding > kDecoderDelay ? enc_padding - kDecoderDelay : 0;
+    }
+}
+
+// VBRI (Fraunhofer): sempre a 32 byte dopo l'header; la tabella viene ricampionata
+// in una TOC a 100 punti stile Xing
+void parse_vbri(const uint8_t* frame, const Mp3FrameHeader& fh, Mp3StreamInfo* info) {
+    const size_t pos = 4 + 32;
+    if (pos + 26 > fh.length || memcmp(frame + pos, "VBRI", 4) != 0) {
+        return;
+    }
+    const uint8_t* p = frame + pos;
+    const uint8_t* end = frame + fh.length;
+    info->kind = Mp3VbrKind::VBRI;
+    info->byte_count = be32(p + 10);
+    info->frame_count = be32(p + 14);
+    uint16_t entries = be16(p + 18);
+    uint16_t scale = be16(p + 20);
+    uint16_t entry_bytes = be16(p + 22);
+    uint16_t frames_per_entry = be16(p + 24);
+    p += 26;
+
+    if (entries == 0 || frames_per_entry == 0 || entry_bytes == 0 || entry_bytes > 4 ||
+        p + (size_t)entries * entry_bytes > end || info->frame_count == 0 || info->byte_count == 0) {
+        return;
+    }
+
+    // Offset cumulativi dall'inizio del frame VBRI, campionati a ogni punto percentuale
+    uint64_t cumulative = fh.length;
+    uint32_t entry = 0;
+    for (int pct = 0; pct < 100; ++pct) {
+        uint64_t target = (uint64_t)info->frame_count * pct / 100;
+        while (entry < entries && (uint64_t)(entry + 1) * frames_per_entry <= target) {
+            uint32_t v = 0;
+            for (uint16_t b = 0; b < entry_bytes; ++b) {
+                v = (v << 8) | p[(size_t)entry * entry_bytes + b];
+            }
+            cumulative += (uint64_t)v * scale;
+            ++entry;
+        }
+        uint64_t toc = cumulative * 256 / info->byte_count;
+        info->toc[pct] = (uint8_t)(toc > 255 ? 255 : toc);
+    }
+    info->has_toc = true;
+}
+
+} // namespace
+
+uint64_t Mp3StreamInfo::trimmed_total_frames() const {
+    return trimmed_frames(untrimmed_total_frames());
+}
+
+uint64_t Mp3StreamInfo::trimmed_frames(uint64_t untrimmed) const {
+    if (untrimmed == 0) {
+        return 0;
+    }
+    uint64_t trim = (uint64_t)delay_frames + padding_frames;
+    return untrimmed > trim ? untrimmed - trim : 0;
+}
+
+uint32_t Mp3StreamInfo::average_kbps() const {
+    if (frame_count > 0 && byte_count > 0 && sample_rate > 0) {
+        uint64_t bits = (uint64_t)byte_count * 8 * sample_rate;
+        return (uint32_t)(bits / untrimmed_total_frames() / 1000);
+    }
+    return first_frame_kbps;
+}
+
+bool Mp3StreamInfo::toc_offset_for_frame(uint64_t untrimmed_frame, size_t* byte_offset) const {
+    uint64_t total = untrimmed_total_frames();
+    if (!has_toc || total == 0 || byte_count == 0 || !byte_offset) {
+        return false;
+    }
+    double pct = (double)untrimmed_frame * 100.0 / (double)total;
+    if (pct < 0.0) pct = 0.0;
+    if (pct > 99.999) pct = 99.999;
+    int idx = (int)pct;
+    double a = toc[idx];
+    double b = (idx < 99) ? toc[idx + 1] : 256.0;
+    double x = a + (b - a) * (pct - idx);
+    size_t offset = first_frame_offset + (size_t)(x / 256.0 * byte_count);
+    *byte_offset = offset < audio_offset ? audio_offset : offset;
+    return true;
+}
+
+bool parse_mp3_stream_info(IDataSource* source, Mp3StreamInfo* info) {
+    if (!source || !info) {
+        return false;
+    }
+    memset(info, 0, sizeof(*info));
+    info->kind = Mp3VbrKind::NONE;
+
+    // ID3v2 (eventualmente ripetuti)
+    size_t offset = 0;
+    uint8_t id3[10];
+    for (;;) {
+        if (!source->seek(offset) || source->read(id3, sizeof(id3)) != sizeof(id3)) {
+            return false;
+        }
+        if (memcmp(id3, "ID3", 3) != 0) {
+            break;
+        }
+        uint32_t size = ((uint32_t)(id3[6] & 0x7F) << 21) | ((uint32_t)(id3[7] & 0x7F) << 14) |
+                        ((uint32_t)(id3[8] & 0x7F) << 7) | (id3[9] & 0x7F);
+        offset += 10 + size + ((id3[5] & 0x10) ? 10 : 0);  // Footer opzionale
+    }
+
+    uint8_t* buf = static_cast<uint8_t*>(malloc(kProbeBytes));
+    if (!buf) {
+        return false;
+    }
+    source->seek(offset);
+    size_t got = source->read(buf, kProbeBytes);
+
+    // Primo frame valido il cui successore è coerente (evita falsi sync nei dati)
+    Mp3FrameHeader fh;
+    size_t pos = 0;
+    bool found = false;
+    for (; pos + 4 <= got; ++pos) {
+        if (!parse_mp3_frame_header(buf + pos, &fh)) {
+            continue;
+        }
+        Mp3FrameHeader next;
+        size_t next_pos = pos + fh.length;
+        if (next_pos + 4 > got) {
+            // Nessun successore nella finestra: accettato solo se il file finisce lì
+            if (offset + next_pos >= source->size() && next_pos <= got) {
+                found = true;
+                break;
+            }
+            continue;
+        }
+        if (parse_mp3_frame_header(buf + next_pos, &next) && next.version == fh.version &&
+            next.layer == fh.layer && next.sample_rate == fh.sample_rate) {
+            found = true;
+            break;
+        }
+    }
+    if (!found || pos + fh.length > got) {
+        free(buf);
+        return false;
+    }
+
+    info->sample_rate = fh.sample_rate;
+    info->channels = fh.channels;
+    info->samples_per_frame = fh.samples;
+    info->first_frame_kbps = fh.bitrate_kbps;
+    info->first_frame_offset = offset + pos;
+    info->audio_offset = info->first_frame_offset;
+
+    if (fh.layer == 3) {
+        parse_xing(buf + pos, fh, info);
+        if (info->kind == Mp3VbrKind::NONE) {
+            parse_vbri(buf + pos, fh, info);
+        }
+    }
+    if (info->kind != Mp3VbrKind::NONE) {
+        info->audio_offset = info->first_frame_offset + fh.length;
+    }
+    free(buf);
+
+    info->valid = true;
+    LOG_DEBUG("MP3 stream info: %s, %u Hz, %u ch, frames=%u bytes=%u toc=%d delay=%u padding=%u, audio @%u",
+              info->kind == Mp3VbrKind::XING ? "Xing" : info->kind == Mp3VbrKind::INFO ? "Info" :
+              info->kind == Mp3VbrKind::VBRI ? "VBRI" : "none",
+              (unsigned)info->sample_rate, (unsigned)info->channels,
+              (unsigned)info->frame_count, (unsigned)info->byte_count, info->has_toc ? 1 : 0,
+              (unsigned)info->delay_frames, (unsigned)info->padding_frames, (unsigned)info->audio_offset);
+    return true;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "data_source.h"
+
+// Header di un frame MPEG audio (Layer 1/2/3, MPEG1/2/2.5)
+struct Mp3FrameHeader {
+    uint32_t version;        // 1 = MPEG1, 2 = MPEG2, 25 = MPEG2.5
+    uint32_t layer;          // 1..3
+    uint32_t bitrate_kbps;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t samples;        // Frame PCM per frame MPEG
+    uint32_t length;         // Byte del frame, header incluso
+    bool crc;
+};
+
+// Valida i 4 byte di header (sync incluso). Free-format e valori riservati → false.
+bool parse_mp3_frame_header(const uint8_t* header, Mp3FrameHeader* out);
+
+enum class Mp3VbrKind {
+    NONE,   // Nessun header: solo info dal primo frame (CBR presunto)
+    XING,   // "Xing" (VBR)
+    INFO,   // "Info" (CBR scritto da LAME/ffmpeg)
+    VBRI    // Fraunhofer
+};
+
+// Informazioni sul flusso MP3 ricavate dal primo frame e dall'eventuale header
+// Xing/Info/VBRI (+ tag LAME), senza scansionare il file.
+//
+// Assi temporali:
+//  - "untrimmed": frame PCM dal primo frame audio (escluso il frame header), come li
+//    produce il decoder prima del taglio gapless; è l'asse della Mp3SeekTable.
+//  - "trimmed": frame riprodotti, cioè untrimmed - encoder_delay (e senza padding finale).
+struct Mp3StreamInfo {
+    bool valid;
+    Mp3VbrKind kind;
+
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t samples_per_frame;
+    uint32_t first_frame_kbps;      // Bitrate del primo frame (header incluso)
+
+    size_t first_frame_offset;      // Primo frame MPEG dopo l'ID3v2 (header VBR se presente)
+    size_t audio_offset;            // Primo frame audio (dopo il frame header VBR)
+
+    uint32_t frame_count;           // Frame audio dichiarati (0 = sconosciuto)
+    uint32_t byte_count;            // Byte dichiarati dal frame header in poi (0 = sconosciuto)
+    bool has_toc;
+    uint8_t toc[100];               // Xing-style: toc[p] * byte_count / 256 = offset al p% della durata
+
+    bool has_gapless;
+    uint32_t delay_frames;          // Frame da scartare all'inizio (encoder delay + 529 decoder delay)
+    uint32_t padding_frames;        // Frame da scartare alla fine
+
+    // Durata riprodotta nota dall'header (0 se frame_count sconosciuto)
+    uint64_t trimmed_total_frames() const;
+    uint64_t untrimmed_total_frames() const { return (uint64_t)frame_count * samples_per_frame; }
+    // Frame riprodotti di un conteggio untrimmed (es. seek table completa): meno delay e padding
+    uint64_t trimmed_frames(uint64_t untrimmed) const;
+    // Bitrate medio (kbps): da frame/byte dell'header, altrimenti quello del primo frame
+    uint32_t average_kbps() const;
+    // Offset in byte per il frame "untrimmed" dato, interpolando la TOC (false se assente)
+    bool toc_offset_for_frame(uint64_t untrimmed_frame, size_t* byte_offset) const;
+};
+
+// Legge ID3v2 + primo frame dalla posizione 0 della sorgente (che resta spostata:
+// il chiamante deve riposizionarla). Ritorna false se non trova un frame MPEG valido.
+bool parse_mp3_stream_info(IDataSource* source, Mp3StreamInfo* info);
@@ -24,6 +24,8 @@
 
 // Timeshift manager for streaming
 #include "timeshift_manager.h"
+#include "station_preset_manager.h"
+#include "recording_hub.h"
 
 // Data sources
 #include "data_source.h"
@@ -0,0 +1,256 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "output_limiter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include "logger.h"
+
+namespace {
+
+constexpr float kRmsWindowSec = 0.010f;      // Finestra del detector RMS
+constexpr float kMeterThresholdDb = 0.1f;
+
+float clampf(float v, float lo, float hi) {
+    return std::max(lo, std::min(hi, v));
+}
+
+float one_pole_coef(float step_sec, float time_ms) {
+    return 1.0f - expf(-step_sec / (std::max(0.1f, time_ms) * 0.001f));
+}
+
+} // namespace
+
+OutputLimiter::~OutputLimiter() {
+    releaseMemory();
+}
+
+void OutputLimiter::releaseMemory() {
+    if (memory_) {
+        heap_caps_free(memory_);
+    }
+    memory_ = nullptr;
+    delay_l_ = delay_r_ = env_history_ = min_values_ = nullptr;
+    min_times_ = nullptr;
+    lookahead_ = 0;
+}
+
+bool OutputLimiter::prepare(uint32_t sample_rate, size_t max_block_frames) {
+    (void)max_block_frames;
+    if (sample_rate == 0) {
+        return false;
+    }
+    size_t lookahead = std::max<size_t>(1, (size_t)(kLookaheadMs * sample_rate / 1000.0f + 0.5f));
+    if (lookahead != lookahead_ || !memory_) {
+        releaseMemory();
+        // delay L/R + storia inviluppo (D) + coda del minimo (D + 1 valori, D + 1 tempi)
+        size_t bytes = (3 * lookahead + 2 * (lookahead + 1)) * sizeof(float);
+        memory_ = static_cast<float*>(heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+        if (!memory_) {
+            memory_ = static_cast<float*>(heap_caps_malloc(bytes, MALLOC_CAP_8BIT));
+        }
+        if (!memory_) {
+            LOG_ERROR("OutputLimiter: cannot allocate look-ahead (%u frames)", (unsigned)lookahead);
+            return false;
+        }
+        lookahead_ = lookahead;
+        delay_l_ = memory_;
+        delay_r_ = delay_l_ + lookahead;
+        env_history_ = delay_r_ + lookahead;
+        min_values_ = env_history_ + lookahead;
+        min_times_ = reinterpret_cast<uint32_t*>(min_values_ + lookahead + 1);
+    }
+    sample_rate_ = sample_rate;
+    reset();
+    return true;
+}
+
+void OutputLimiter::reset() {
+    if (!memory_) {
+        return;
+    }
+    memset(delay_l_, 0, lookahead_ * sizeof(float));
+    memset(delay_r_, 0, lookahead_ * sizeof(float));
+    for (size_t i = 0; i < lookahead_; ++i) {
+        env_history_[i] = 1.0f;
+    }
+    delay_pos_ = 0;
+    min_head_ = 0;
+    min_count_ = 0;
+    time_ = 0;
+    envelope_ = 1.0f;
+    comp_ms_ = 0.0f;
+    comp_gr_db_ = 0.0f;
+    comp_gain_ = 1.0f;
+}
+
+LimiterMeter OutputLimiter::meter() const {
+    LimiterMeter m;
+    m.gain_reduction_db = meter_gr_db_.load();
+    m.peak_reduction_db = meter_peak_db_.load();
+    m.comp_reduction_db = meter_comp_db_.load();
+    m.limited_blocks = meter_limited_blocks_.load();
+    m.clipped_samples = meter_clipped_.load();
+    return m;
+}
+
+void OutputLimiter::processCompressor(float* left, float* right, size_t frames, bool stereo,
+                                      const LimiterParams& p) {
+    const float step_sec = (float)kCompStepFrames / (float)sample_rate_;
+    const float attack = one_pole_coef(step_sec, p.comp_attack_ms);
+    const float release = one_pole_coef(step_sec, p.comp_release_ms);
+    const float rms_coef = 1.0f - expf(-step_sec / kRmsWindowSec);
+    const float slope = 1.0f - 1.0f / std::max(1.0f, p.comp_ratio);
+    const float threshold = p.comp_threshold_db;
+    float max_gr = 0.0f;
+
+    size_t done = 0;
+    while (done < frames) {
+        const size_t n = std::min(kCompStepFrames, frames - done);
+        float* l = left + done;
+        float* r = right + done;
+
+        // Detector: potenza media del passo, poi media esponenziale su ~10 ms
+        float sum = 0.0f;
+        if (stereo) {
+            for (size_t k = 0; k < n; ++k) sum += l[k] * l[k] + r[k] * r[k];
+            sum *= 0.5f;
+        } else {
+            for (size_t k = 0; k < n; ++k) sum += l[k] * l[k];
+        }
+        comp_ms_ += (sum / (float)n - comp_ms_) * rms_coef;
+        float level_db = 10.0f * log10f(comp_ms_ + 1e-12f);
+        float target = level_db > threshold ? (level_db - threshold) * slope : 0.0f;
+        comp_gr_db_ += (target - comp_gr_db_) * (target > comp_gr_db_ ? attack : release);
+        max_gr = std::max(max_gr, comp_gr_db_);
+
+        // Guadagno interpolato linearmente dal passo precedente: niente gradini
+        float g_end = powf(10.0f, (p.comp_makeup_db - comp_gr_db_) / 20.0f);
+        float g = comp_gain_;
+        float inc = (g_end - g) / (float)n;
+        for (size_t k = 0; k < n; ++k) {
+            g += inc;
+            l[k] *= g;
+            r[k] *= g;
+        }
+        comp_gain_ = g_end;
+        done += n;
+    }
+    meter_comp_db_.store(max_gr);
+}
+
+void OutputLimiter::process(AudioBlock& block) {
+    if (!memory_ || sample_rate_ == 0) {
+        return;
+    }
+    if (meter_reset_requested_.exchange(false)) {
+        meter_peak_db_.store(0.0f);
+        meter_limited_blocks_.store(0);
+        meter_clipped_.store(0);
+    }
+
+    const LimiterParams p = params_;
+    const bool stereo = block.channels != 1;
+    float* left = block.left;
+    float* right = block.right;
+    const size_t frames = block.frames;
+    // Disabilitato: solo ritardo, l'inviluppo resta aggiornato per la riabilitazione
+    const bool limiting = isEnabled();
+
+    if (limiting && p.compressor_enabled) {
+        processCompressor(left, right, frames, stereo, p);
+    } else if (comp_gain_ != 1.0f || comp_gr_db_ != 0.0f) {
+        comp_gain_ = 1.0f;
+        comp_gr_db_ = 0.0f;
+        meter_comp_db_.store(0.0f);
+    }
+
+    const float ceiling = powf(10.0f, clampf(p.threshold_db, -40.0f, 0.0f) / 20.0f);
+    const float clip_level = ceiling * 1.0001f;
+    const size_t D = lookahead_;
+    const size_t window = D + 1;
+    const size_t attack = std::max<size_t>(1, std::min(D, (size_t)(p.attack_ms * sample_rate_ / 1000.0f + 0.5f)));
+    const float inv_attack = 1.0f / (float)attack;
+    const float release = one_pole_coef(1.0f / (float)sample_rate_, p.release_ms);
+
+    size_t pos = delay_pos_;
+    size_t old = (pos + D - attack) % D;
+    // Somma della media mobile ricalcolata dalla storia a ogni blocco: niente deriva e
+    // attack_ms può cambiare tra un blocco e l'altro
+    float box_sum = 0.0f;
+    for (size_t k = 1; k <= attack; ++k) {
+        box_sum += env_history_[(pos + D - k) % D];
+    }
+
+    float envelope = envelope_;
+    float min_gain = 1.0f;
+    uint32_t clipped = 0;
+    for (size_t i = 0; i < frames; ++i) {
+        const float xl = left[i];
+        const float xr = stereo ? right[i] : xl;
+        const float peak = std::max(fabsf(xl), fabsf(xr));
+        const float required = peak > ceiling ? ceiling / peak : 1.0f;
+
+        // Minimo di required sugli ultimi D + 1 frame (coda monotona)
+        while (min_count_ > 0) {
+            size_t back = min_head_ + min_count_ - 1;
+            if (back >= window) back -= window;
+            if (min_values_[back] < required) break;
+            --min_count_;
+        }
+        size_t slot = min_head_ + min_count_;
+        if (slot >= window) slot -= window;
+        min_values_[slot] = required;
+        min_times_[slot] = time_;
+        ++min_count_;
+        if (time_ - min_times_[min_head_] >= window) {
+            if (++min_head_ == window) min_head_ = 0;
+            --min_count_;
+        }
+        const float held = min_values_[min_head_];
+
+        // Discesa immediata sul minimo, risalita esponenziale; la media mobile su attack
+        // frame smussa la discesa restando sotto il minimo della finestra
+        envelope = held < envelope ? held : envelope + (held - envelope) * release;
+        box_sum += envelope - env_history_[old];
+        env_history_[pos] = envelope;
+        const float gain = limiting ? box_sum * inv_attack : 1.0f;
+        min_gain = std::min(min_gain, gain);
+
+        float yl = delay_l_[pos] * gain;
+        float yr = delay_r_[pos] * gain;
+        delay_l_[pos] = xl;
+        delay_r_[pos] = xr;
+        if (++pos == D) pos = 0;
+        if (++old == D) old = 0;
+        ++time_;
+
+        if (!limiting) {
+            left[i] = yl;
+            right[i] = yr;
+            continue;
+        }
+        if (fabsf(yl) > clip_level || fabsf(yr) > clip_level) {
+            ++clipped;
+        }
+        left[i] = clampf(yl, -ceiling, ceiling);
+        right[i] = clampf(yr, -ceiling, ceiling);
+    }
+    delay_pos_ = pos;
+    envelope_ = envelope;
+
+    const float gr_db = min_gain < 1.0f ? -20.0f * log10f(std::max(min_gain, 1e-6f)) : 0.0f;
+    meter_gr_db_.store(gr_db);
+    if (gr_db > meter_peak_db_.load()) {
+        meter_peak_db_.store(gr_db);
+    }
+    if (gr_db > kMeterThresholdDb) {
+        meter_limited_blocks_.fetch_add(1);
+    }
+    if (clipped) {
+        meter_clipped_.fetch_add(clipped);
+    }
+}
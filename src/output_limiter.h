@@ -0,0 +1,102 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_effect_node.h"
+
+struct LimiterParams {
+    float threshold_db = -1.0f;        // Ceiling del limiter (dBFS, <= 0)
+    float attack_ms = 5.0f;            // Rampa di discesa, limitata al look-ahead
+    float release_ms = 80.0f;
+
+    // Compressore RMS opzionale prima del limiter
+    bool compressor_enabled = false;
+    float comp_threshold_db = -18.0f;
+    float comp_ratio = 3.0f;
+    float comp_attack_ms = 10.0f;
+    float comp_release_ms = 150.0f;
+    float comp_makeup_db = 0.0f;
+};
+
+// Riduzione di guadagno, aggiornata dal task audio a ogni blocco
+struct LimiterMeter {
+    float gain_reduction_db;           // Limiter, massimo nell'ultimo blocco (>= 0)
+    float peak_reduction_db;           // Limiter, massimo dall'ultimo resetMeter()
+    float comp_reduction_db;           // Compressore, ultimo blocco
+    uint32_t limited_blocks;           // Blocchi con riduzione > 0.1 dB
+    uint32_t clipped_samples;          // Campioni rimasti oltre il ceiling (atteso 0)
+};
+
+// Stadio finale della EffectsChain: compressore RMS opzionale + limiter di picco con
+// look-ahead fisso (kLookaheadMs), al posto del clamp int16 che tagliava i boost dell'EQ.
+//
+// Limiter: guadagno richiesto per frame (ceiling / picco L-R), minimo su finestra mobile
+// lunga quanto il look-ahead, release esponenziale e media mobile di attack_ms; l'audio
+// esce ritardato del look-ahead, quindi il guadagno è già sceso quando il picco arriva e
+// l'uscita non supera il ceiling. Il compressore calcola l'inviluppo a passi di
+// kCompStepFrames (log/exp una volta per passo) e interpola il guadagno nel passo.
+//
+// Disabilitato (setEnabled(false)) resta solo ritardo: la EffectsChain lo chiama comunque,
+// analisi e linea di ritardo continuano e l'audio esce ritardato senza guadagno.
+class OutputLimiter : public IAudioEffect {
+public:
+    static constexpr float kLookaheadMs = 5.0f;
+    static constexpr size_t kCompStepFrames = 32;
+
+    ~OutputLimiter() override;
+
+    const char* name() const override { return "limiter"; }
+    bool prepare(uint32_t sample_rate, size_t max_block_frames) override;
+    void process(AudioBlock& block) override;
+    void reset() override;
+
+    void setParams(const LimiterParams& params) { params_ = params; }
+    const LimiterParams& params() const { return params_; }
+
+    // Latenza introdotta (frame)
+    size_t latencyFrames() const { return lookahead_; }
+
+    LimiterMeter meter() const;
+    // Azzeramento di picco e contatori, eseguito dal task audio al blocco successivo
+    void resetMeter() { meter_reset_requested_.store(true); }
+
+private:
+    LimiterParams params_;
+    uint32_t sample_rate_ = 0;
+    size_t lookahead_ = 0;             // D frame
+
+    // Un'unica allocazione: delay L, delay R, storia dell'inviluppo (D ciascuno) e coda
+    // monotona del minimo (D + 1 valori + D + 1 indici)
+    float* memory_ = nullptr;
+    float* delay_l_ = nullptr;
+    float* delay_r_ = nullptr;
+    float* env_history_ = nullptr;
+    float* min_values_ = nullptr;
+    uint32_t* min_times_ = nullptr;
+    size_t delay_pos_ = 0;
+    size_t min_head_ = 0;
+    size_t min_count_ = 0;
+    uint32_t time_ = 0;
+    float envelope_ = 1.0f;
+
+    // Compressore
+    float comp_ms_ = 0.0f;             // Media quadratica (one-pole)
+    float comp_gr_db_ = 0.0f;
+    float comp_gain_ = 1.0f;
+
+    std::atomic<float> meter_gr_db_{0.0f};
+    std::atomic<float> meter_peak_db_{0.0f};
+    std::atomic<float> meter_comp_db_{0.0f};
+    std::atomic<uint32_t> meter_limited_blocks_{0};
+    std::atomic<uint32_t> meter_clipped_{0};
+    std::atomic<bool> meter_reset_requested_{false};
+
+    void processCompressor(float* left, float* right, size_t frames, bool stereo, const LimiterParams& p);
+    void releaseMemory();
+};
@@ -0,0 +1,94 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_effect_node.h"
+
+enum class EqBandType : uint8_t {
+    PEAKING,
+    LOW_SHELF,
+    HIGH_SHELF
+};
+
+struct EqBand {
+    EqBandType type = EqBandType::PEAKING;
+    float freq_hz = 1000.0f;
+    float gain_db = 0.0f;      // Clamp a ±24 dB
+    float q = 0.707f;          // Per gli shelf fa da pendenza (0.707 = Butterworth)
+    bool enabled = true;
+};
+
+// Coefficienti biquad normalizzati (a0 = 1)
+struct BiquadCoeffs {
+    float b0, b1, b2, a1, a2;
+};
+
+// Stato transposed direct-form II di un canale
+struct BiquadState {
+    float s1, s2;
+};
+
+// Coefficienti RBJ (Audio EQ Cookbook) per la banda al sample rate dato, calcolati in
+// double. Ritorna false se la banda è un'identità (disabilitata o 0 dB) e può essere saltata.
+bool compute_biquad(const EqBand& band, uint32_t sample_rate, BiquadCoeffs* out);
+
+// Kernel TDF-II in-place su un canale planare: riferimento scalare
+void biquad_process_ref(const BiquadCoeffs& c, BiquadState& state, float* x, size_t frames);
+// Kernel a due lane: L e R nello stesso loop, stato e coefficienti nei registri. Stesse
+// operazioni nello stesso ordine del riferimento, quindi confrontabile bit a bit.
+void biquad_process_stereo(const BiquadCoeffs& c, BiquadState& left_state, BiquadState& right_state,
+                           float* left, float* right, size_t frames);
+
+// EQ parametrico a N bande (shelf + peaking) in cascata, nodo della EffectsChain.
+// Le bande si modificano da un task di controllo (uno alla volta): i coefficienti vengono
+// ricalcolati subito e pubblicati con un seqlock; il task audio li adotta all'inizio del
+// blocco successivo senza mai attendere. Le bande a 0 dB non costano nulla.
+class ParametricEqEffect : public IAudioEffect {
+public:
+    static constexpr size_t kMaxBands = 8;
+
+    const char* name() const override { return "eq"; }
+    bool prepare(uint32_t sample_rate, size_t max_block_frames) override;
+    void process(AudioBlock& block) override;
+    void reset() override;
+
+    bool setBand(size_t index, const EqBand& band);
+    // Sostituisce tutte le bande; quelle oltre count vengono disattivate
+    bool setBands(const EqBand* bands, size_t count);
+    EqBand band(size_t index) const;
+    size_t bandCount() const { return band_count_; }
+
+    // Usa il kernel scalare invece di quello a due lane (confronto/benchmark)
+    void setReferenceKernel(bool enabled) { reference_kernel_.store(enabled); }
+
+private:
+    struct CoeffSet {
+        BiquadCoeffs coeffs[kMaxBands];
+        uint32_t active_mask;   // Bande non identiche
+    };
+
+    EqBand bands_[kMaxBands];
+    size_t band_count_ = 0;
+    uint32_t sample_rate_ = 0;
+
+    // Scritti dal task di controllo, letti dal task audio (seq dispari = scrittura in corso)
+    CoeffSet pending_ = {};
+    std::atomic<uint32_t> pending_seq_{0};
+
+    // Solo task audio
+    CoeffSet active_ = {};
+    uint32_t active_seq_ = 0;
+    BiquadState state_l_[kMaxBands] = {};
+    BiquadState state_r_[kMaxBands] = {};
+
+    std::atomic<bool> reference_kernel_{false};
+
+    void publishCoefficients();
+    void adoptCoefficients();
+};
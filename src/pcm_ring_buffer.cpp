@@ -0,0 +1,163 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+#include "pcm_ring_buffer.h"
+
+#include <esp_heap_caps.h>
+#include <cstring>
+
+PcmRingBuffer::~PcmRingBuffer() {
+    release();
+}
+
+bool PcmRingBuffer::allocate(size_t bytes, uint32_t caps) {
+    release();
+    bytes &= ~static_cast<size_t>(3);
+    if (bytes == 0) {
+        return false;
+    }
+    buffer_ = static_cast<uint8_t*>(heap_caps_malloc(bytes, caps));
+    if (!buffer_) {
+        return false;
+    }
+    capacity_ = bytes;
+    reset();
+    return true;
+}
+
+void PcmRingBuffer::release() {
+    if (buffer_) {
+        heap_caps_free(buffer_);
+        buffer_ = nullptr;
+    }
+    capacity_ = 0;
+    reset();
+}
+
+void PcmRingBuffer::reset() {
+    used_.store(0);
+    write_pos_ = 0;
+    read_pos_ = 0;
+    producer_blocked_ = false;
+    buffering_ = true;
+    producer_waiting_.store(false);
+    consumer_waiting_.store(false);
+    underruns_.store(0);
+}
+
+void PcmRingBuffer::configure_watermarks(size_t start_threshold_bytes, size_t resume_free_bytes) {
+    start_threshold_ = (start_threshold_bytes > capacity_) ? capacity_ : start_threshold_bytes;
+    resume_free_bytes_ = (resume_free_bytes > capacity_) ? capacity_ : resume_free_bytes;
+}
+
+size_t PcmRingBuffer::write(const void* data, size_t bytes) {
+    if (!buffer_ || bytes == 0) {
+        return 0;
+    }
+    size_t free_space = capacity_ - used_.load();
+    if (bytes > free_space) {
+        bytes = free_space;
+    }
+    if (bytes == 0) {
+        return 0;
+    }
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    size_t first = capacity_ - write_pos_;
+    if (first > bytes) {
+        first = bytes;
+    }
+    memcpy(buffer_ + write_pos_, src, first);
+    if (bytes > first) {
+        memcpy(buffer_, src + first, bytes - first);
+    }
+    write_pos_ = (write_pos_ + bytes) % capacity_;
+
+    // Pubblica i dati solo dopo la copia
+    used_.fetch_add(bytes);
+    return bytes;
+}
+
+bool PcmRingBuffer::producer_has_room(size_t block_bytes) {
+    size_t free_space = free_bytes();
+    if (producer_blocked_) {
+        size_t resume = (resume_free_bytes_ > block_bytes) ? resume_free_bytes_ : block_bytes;
+        if (free_space < resume) {
+            return false;
+        }
+        producer_blocked_ = false;
+        return true;
+    }
+    if (free_space < block_bytes) {
+        producer_blocked_ = true;
+        return false;
+    }
+    return true;
+}
+
+size_t PcmRingBuffer::read(void* dst, size_t bytes) {
+    if (!buffer_ || bytes == 0) {
+        return 0;
+    }
+    size_t available = used_.load();
+    if (bytes > available) {
+        bytes = available;
+    }
+    if (bytes == 0) {
+        return 0;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    size_t first = capacity_ - read_pos_;
+    if (first > bytes) {
+        first = bytes;
+    }
+    memcpy(out, buffer_ + read_pos_, first);
+    if (bytes > first) {
+        memcpy(out + first, buffer_, bytes - first);
+    }
+    read_pos_ = (read_pos_ + bytes) % capacity_;
+
+    // Libera lo spazio solo dopo la copia
+    used_.fetch_sub(bytes);
+    return bytes;
+}
+
+size_t PcmRingBuffer::discard_all() {
+    if (!buffer_) {
+        return 0;
+    }
+    size_t available = used_.load();
+    read_pos_ = (read_pos_ + available) % capacity_;
+    used_.fetch_sub(available);
+    return available;
+}
+
+bool PcmRingBuffer::consumer_has_data(size_t min_bytes, bool producer_done) {
+    size_t available = used_.load();
+    if (buffering_) {
+        if (available < start_threshold_ && !producer_done) {
+            return false;
+        }
+        buffering_ = false;
+    }
+    if (available < min_bytes || available == 0) {
+        if (!producer_done) {
+            // Il producer non ha tenuto il passo: torna in prefill
+            buffering_ = true;
+            underruns_.fetch_add(1);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool PcmRingBuffer::consumer_should_wake_producer() {
+    if (!producer_waiting_.load()) {
+        return false;
+    }
+    if (free_bytes() < resume_free_bytes_) {
+        return false;
+    }
+    return producer_waiting_.exchange(false);
+}
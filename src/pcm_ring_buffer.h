@@ -0,0 +1,84 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Ring PCM single-producer/single-consumer lock-free.
+// Il decode task scrive blocchi di frame interi, l'output task li consuma verso I2S.
+// Gli indici di lettura/scrittura appartengono ciascuno a un solo lato; l'unico
+// stato condiviso è il contatore atomico dei byte occupati (+ i flag di attesa).
+//
+// Watermark con isteresi:
+//  - producer: quando lo spazio libero scende sotto un blocco si ferma e riparte
+//    solo quando il consumer ha liberato almeno `resume_free_bytes`.
+//  - consumer: dopo reset/flush o underrun resta in "buffering" finché il fill
+//    non raggiunge `start_threshold_bytes` (o il producer ha finito).
+class PcmRingBuffer {
+public:
+    PcmRingBuffer() = default;
+    ~PcmRingBuffer();
+
+    PcmRingBuffer(const PcmRingBuffer&) = delete;
+    PcmRingBuffer& operator=(const PcmRingBuffer&) = delete;
+
+    // Alloca lo storage con heap_caps_malloc(caps). La capacità viene arrotondata
+    // a multipli di 4 byte (frame stereo 16 bit). Ritorna false se l'allocazione fallisce.
+    bool allocate(size_t bytes, uint32_t caps);
+    void release();
+
+    // Solo con producer e consumer fermi.
+    void reset();
+
+    void configure_watermarks(size_t start_threshold_bytes, size_t resume_free_bytes);
+
+    size_t capacity() const { return capacity_; }
+    bool allocated() const { return buffer_ != nullptr; }
+    size_t used_bytes() const { return used_.load(); }
+    size_t free_bytes() const { return capacity_ - used_.load(); }
+    size_t start_threshold() const { return start_threshold_; }
+    size_t resume_free_bytes() const { return resume_free_bytes_; }
+    uint32_t underruns() const { return underruns_.load(); }
+
+    // --- Producer side ---
+    // Copia fino a `bytes` (limitato allo spazio libero). Ritorna i byte scritti.
+    size_t write(const void* data, size_t bytes);
+    // Latch con isteresi: true se c'è spazio per `block_bytes`.
+    bool producer_has_room(size_t block_bytes);
+    void set_producer_waiting(bool waiting) { producer_waiting_.store(waiting); }
+    bool consumer_waiting() const { return consumer_waiting_.load(); }
+
+    // --- Consumer side ---
+    // Copia fino a `bytes` (limitato ai byte disponibili). Ritorna i byte letti.
+    size_t read(void* dst, size_t bytes);
+    // Scarta tutto il contenuto (flush dal lato consumer, sicuro con producer attivo).
+    size_t discard_all();
+    // Latch con isteresi: true se si può consumare almeno `min_bytes`.
+    bool consumer_has_data(size_t min_bytes, bool producer_done);
+    // Torna in buffering (es. dopo un flush per seek) senza contare underrun.
+    void rearm_consumer() { buffering_ = true; }
+    void set_consumer_waiting(bool waiting) { consumer_waiting_.store(waiting); }
+    // True (una volta) se il producer è in attesa e lo spazio libero ha superato la soglia di ripresa.
+    bool consumer_should_wake_producer();
+
+private:
+    uint8_t* buffer_ = nullptr;
+    size_t capacity_ = 0;
+
+    std::atomic<size_t> used_{0};
+    size_t write_pos_ = 0;   // Owned by producer
+    size_t read_pos_ = 0;    // Owned by consumer
+
+    size_t start_threshold_ = 0;
+    size_t resume_free_bytes_ = 0;
+
+    bool producer_blocked_ = false;   // Owned by producer
+    bool buffering_ = true;           // Owned by consumer
+    std::atomic<bool> producer_waiting_{false};
+    std::atomic<bool> consumer_waiting_{false};
+    std::atomic<uint32_t> underruns_{0};
+};
@@ -0,0 +1,312 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "recording_hub.h"
+#include <Arduino.h>
+#include "logger.h"
+#include "timeshift_manager.h"
+
+namespace {
+// Come il writer task di un TimeshiftManager da solo
+constexpr uint32_t kWriterTaskStack = 12288;
+constexpr UBaseType_t kWriterTaskPriority = 4;
+
+// IDataSource sulla lettura di una registrazione che non possiede: close() del player non
+// tocca la registrazione, request_stop() sblocca solo il reader
+class RecorderReader : public IDataSource {
+public:
+    explicit RecorderReader(TimeshiftManager& recorder) : recorder_(recorder) { recorder_.attach_reader(); }
+
+    size_t read(void* buffer, size_t size) override { return recorder_.read(buffer, size); }
+    bool seek(size_t position) override { return recorder_.seek(position); }
+    size_t tell() const override { return recorder_.tell(); }
+    size_t size() const override { return recorder_.size(); }
+    bool open(const char*) override { return recorder_.is_open(); }
+    void close() override {}
+    bool is_open() const override { return recorder_.is_open(); }
+    bool is_seekable() const override { return recorder_.is_seekable(); }
+    SourceType type() const override { return recorder_.type(); }
+    const char* uri() const override { return recorder_.uri(); }
+    const Mp3SeekTable* get_seek_table() const override { return recorder_.get_seek_table(); }
+    size_t seek_to_time(uint32_t target_ms, TimeSeekPoint* point) override {
+        return recorder_.seek_to_time(target_ms, point);
+    }
+    bool window_start_frame(uint64_t* frame) const override { return recorder_.window_start_frame(frame); }
+    bool read_start_frame(uint64_t* frame) const override { return recorder_.read_start_frame(frame); }
+    void request_stop() override { recorder_.request_stop(); }
+    uint32_t current_position_ms() const override { return recorder_.current_position_ms(); }
+    uint32_t total_duration_ms() const override { return recorder_.total_duration_ms(); }
+    int32_t live_edge_distance_ms() const override { return recorder_.live_edge_distance_ms(); }
+    TimeshiftManager* timeshift() const override { return &recorder_; }
+
+private:
+    TimeshiftManager& recorder_;
+};
+}
+
+RecordingHub::RecordingHub(const RecordingHubConfig& cfg) : cfg_(cfg) {
+    if (cfg_.max_recorders == 0) {
+        cfg_.max_recorders = 1;
+    }
+    mutex_ = xSemaphoreCreateMutex();
+    work_sem_ = xSemaphoreCreateBinary();
+    slots_.resize(cfg_.max_recorders);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        slots_[i].stats.slot = (int)i;
+    }
+}
+
+RecordingHub::~RecordingHub() {
+    end();
+    if (work_sem_) {
+        vSemaphoreDelete(work_sem_);
+        work_sem_ = nullptr;
+    }
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
+}
+
+bool RecordingHub::begin() {
+    if (task_handle_) {
+        return true;
+    }
+    if (!mutex_ || !work_sem_) {
+        LOG_ERROR("Recording hub: cannot create semaphores");
+        return false;
+    }
+    begin_ms_ = millis();
+    running_ = true;
+    if (xTaskCreate(task_trampoline, "rec_writer", kWriterTaskStack, this, kWriterTaskPriority, &task_handle_) !=
+        pdPASS) {
+        LOG_ERROR("Failed to create recording hub writer task");
+        running_ = false;
+        task_handle_ = nullptr;
+        return false;
+    }
+    LOG_INFO("Recording hub: %u recorder(s), PSRAM %u KB and SD ring %u MB each",
+             (unsigned)cfg_.max_recorders, (unsigned)(psram_share_bytes() / 1024),
+             (unsigned)(sd_share_bytes() / (1024 * 1024)));
+    return true;
+}
+
+void RecordingHub::end() {
+    if (!task_handle_) {
+        return;
+    }
+    // Le registrazioni collegate vanno fermate prima: le code rimaste le svuota il loro stop()
+    running_ = false;
+    xSemaphoreGive(work_sem_);
+    uint32_t wait_start = millis();
+    while (task_handle_ && millis() - wait_start < 2000) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (task_handle_) {
+        LOG_WARN("Recording hub writer did not stop in time");
+    }
+}
+
+int RecordingHub::register_recorder(TimeshiftManager* recorder) {
+    if (!recorder || !mutex_) {
+        return -1;
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int slot = find_slot_locked(recorder);
+    if (slot < 0) {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (!slots_[i].recorder) {
+                slots_[i] = Slot();
+                slots_[i].recorder = recorder;
+                slots_[i].stats.slot = (int)i;
+                slot = (int)i;
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(mutex_);
+    if (slot < 0) {
+        LOG_WARN("Recording hub full (%u recorders)", (unsigned)cfg_.max_recorders);
+    }
+    return slot;
+}
+
+void RecordingHub::unregister_recorder(TimeshiftManager* recorder) {
+    detach(recorder, 0);
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int slot = find_slot_locked(recorder);
+    if (slot >= 0) {
+        slots_[slot].recorder = nullptr;
+    }
+    xSemaphoreGive(mutex_);
+}
+
+bool RecordingHub::attach(TimeshiftManager* recorder) {
+    if (!task_handle_) {
+        LOG_ERROR("Recording hub not started");
+        return false;
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int slot = find_slot_locked(recorder);
+    if (slot >= 0) {
+        slots_[slot].attached = true;
+        slots_[slot].deferred = false;
+        slots_[slot].stats.uri = recorder->uri();
+    }
+    xSemaphoreGive(mutex_);
+    return slot >= 0;
+}
+
+void RecordingHub::detach(TimeshiftManager* recorder, uint32_t drain_timeout_ms) {
+    if (!mutex_) {
+        return;
+    }
+    // Con il download fermo il writer finisce i chunk in coda (scartati se la ring è piena)
+    uint32_t wait_start = millis();
+    while (task_handle_ && recorder->queued_write_chunks() > 0 && millis() - wait_start < drain_timeout_ms) {
+        xSemaphoreGive(work_sem_);
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int slot = find_slot_locked(recorder);
+    if (slot >= 0) {
+        slots_[slot].attached = false;
+    }
+    while (slot >= 0 && busy_slot_ == slot) {
+        xSemaphoreGive(mutex_);
+        vTaskDelay(pdMS_TO_TICKS(5));
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+    }
+    xSemaphoreGive(mutex_);
+}
+
+void RecordingHub::notify() {
+    if (work_sem_) {
+        xSemaphoreGive(work_sem_);
+    }
+}
+
+size_t RecordingHub::psram_share_bytes() const {
+    return cfg_.psram_budget_bytes / cfg_.max_recorders;
+}
+
+size_t RecordingHub::sd_share_bytes() const {
+    return cfg_.sd_budget_bytes / cfg_.max_recorders;
+}
+
+RecordingHubStats RecordingHub::stats() const {
+    RecordingHubStats out;
+    const uint32_t now = millis();
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    out.bytes_written = bytes_written_;
+    out.chunks_written = chunks_written_;
+    out.busy_ms = (uint32_t)(busy_us_ / 1000);
+    out.elapsed_ms = task_handle_ ? now - begin_ms_ : 0;
+    for (const auto& slot : slots_) {
+        if (!slot.recorder) {
+            continue;
+        }
+        RecorderLagStats s = slot.stats;
+        if (slot.attached) {
+            s.queued_chunks = slot.recorder->queued_write_chunks();
+            s.lag_ms = slot.recorder->write_queue_age_ms();
+            s.unwritten_bytes = slot.recorder->unwritten_bytes();
+        }
+        out.recorders.push_back(s);
+    }
+    xSemaphoreGive(mutex_);
+    if (out.elapsed_ms > 0) {
+        out.throughput_kbps = (uint32_t)(out.bytes_written * 8 / out.elapsed_ms);
+    }
+    if (busy_us_ > 0) {
+        out.write_kbps = (uint32_t)(out.bytes_written * 8000 / busy_us_);
+    }
+    return out;
+}
+
+std::unique_ptr<IDataSource> RecordingHub::make_reader(TimeshiftManager& recorder) {
+    return std::unique_ptr<IDataSource>(new RecorderReader(recorder));
+}
+
+void RecordingHub::task_trampoline(void* arg) {
+    static_cast<RecordingHub*>(arg)->task_loop();
+}
+
+int RecordingHub::find_slot_locked(const TimeshiftManager* recorder) const {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].recorder == recorder) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int RecordingHub::pick_slot_locked(uint32_t now, bool* any_deferred) {
+    *any_deferred = false;
+    const size_t n = slots_.size();
+    for (size_t k = 0; k < n; ++k) {
+        size_t i = (next_slot_ + k) % n;
+        Slot& slot = slots_[i];
+        if (!slot.recorder || !slot.attached || slot.recorder->queued_write_chunks() == 0) {
+            continue;
+        }
+        if (slot.deferred && (int32_t)(now - slot.retry_at_ms) < 0) {
+            *any_deferred = true;
+            continue;
+        }
+        next_slot_ = (i + 1) % n;
+        return (int)i;
+    }
+    return -1;
+}
+
+void RecordingHub::task_loop() {
+    LOG_INFO("Recording hub writer task started");
+    while (running_) {
+        bool any_deferred = false;
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        int slot = pick_slot_locked(millis(), &any_deferred);
+        busy_slot_ = slot;
+        TimeshiftManager* recorder = slot >= 0 ? slots_[slot].recorder : nullptr;
+        xSemaphoreGive(mutex_);
+
+        if (!recorder) {
+            xSemaphoreTake(work_sem_, pdMS_TO_TICKS(any_deferred ? kRetryMs : kIdleWaitMs));
+            continue;
+        }
+
+        // Scrittura fuori dal mutex: detach() aspetta che busy_slot_ cambi
+        bool deferred = false;
+        uint32_t lag_ms = 0;
+        uint32_t t0 = micros();
+        size_t bytes = recorder->write_queued_chunk(&deferred, &lag_ms);
+        uint32_t elapsed_us = micros() - t0;
+
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        Slot& s = slots_[slot];
+        busy_slot_ = -1;
+        if (deferred) {
+            if (!s.deferred) {
+                LOG_WARN("Recorder %d: SD ring full, writes deferred until playback releases regions", slot);
+            }
+            s.deferred = true;
+            s.retry_at_ms = millis() + kRetryMs;
+            s.stats.deferrals++;
+        } else if (bytes > 0) {
+            s.deferred = false;
+            s.stats.chunks_written++;
+            s.stats.bytes_written += bytes;
+            if (lag_ms > s.stats.max_lag_ms) {
+                s.stats.max_lag_ms = lag_ms;
+            }
+            chunks_written_++;
+            bytes_written_ += bytes;
+            busy_us_ += elapsed_us;
+        }
+        xSemaphoreGive(mutex_);
+    }
+    LOG_INFO("Recording hub writer task stopped");
+    task_handle_ = nullptr;
+    vTaskDelete(nullptr);
+}
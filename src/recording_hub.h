@@ -0,0 +1,121 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "data_source.h"
+
+class TimeshiftManager;
+
+// Budget globale delle registrazioni, diviso in parti uguali tra gli slot: ogni
+// TimeshiftManager collegato riceve psram_budget / max_recorders di chunk READY in PSRAM
+// e una ring SD da sd_budget / max_recorders
+struct RecordingHubConfig {
+    uint8_t max_recorders = 2;
+    size_t psram_budget_bytes = 3 * 1024 * 1024;     // Come MAX_PSRAM_POOL_MB di un manager da solo
+    size_t sd_budget_bytes = 128 * 1024 * 1024;      // Somma delle ring SD
+};
+
+struct RecorderLagStats {
+    int slot = -1;
+    std::string uri;
+    uint32_t chunks_written = 0;
+    uint64_t bytes_written = 0;
+    uint32_t queued_chunks = 0;      // In coda al writer
+    uint32_t lag_ms = 0;             // Età del chunk in testa alla coda (0 = coda vuota)
+    uint32_t max_lag_ms = 0;         // Chiusura del chunk → READY, massimo
+    uint32_t deferrals = 0;          // Scritture rimandate con la ring SD piena
+    size_t unwritten_bytes = 0;      // Download head - fine dell'ultimo chunk READY
+};
+
+struct RecordingHubStats {
+    uint64_t bytes_written = 0;
+    uint32_t chunks_written = 0;
+    uint32_t elapsed_ms = 0;         // Da begin()
+    uint32_t busy_ms = 0;            // Tempo del writer dentro le scritture
+    uint32_t throughput_kbps = 0;    // Aggregato sul tempo reale
+    uint32_t write_kbps = 0;         // Sul tempo di scrittura: capacità residua dello storage
+    std::vector<RecorderLagStats> recorders;
+};
+
+// Lato registrazione condiviso tra più TimeshiftManager: un solo writer task serve le code
+// di tutti i manager collegati a turno (un chunk per registrazione a giro, i chunk durano
+// tutti pochi secondi quindi il turno è equo nel tempo anche con bitrate diversi), e il
+// budget di storage è unico. Una registrazione con la ring SD piena viene rimandata senza
+// fermare le altre.
+//
+//   RecordingHub hub;
+//   hub.begin();
+//   rec.set_recording_hub(&hub);   // Prima di open()
+//   rec.open(uri); rec.start();
+//   player.select_source(RecordingHub::make_reader(rec));
+class RecordingHub {
+public:
+    explicit RecordingHub(const RecordingHubConfig& cfg = RecordingHubConfig());
+    ~RecordingHub();
+    RecordingHub(const RecordingHub&) = delete;
+    RecordingHub& operator=(const RecordingHub&) = delete;
+
+    bool begin();
+    void end();
+
+    // Chiamati da TimeshiftManager: slot (nomi della ring SD, quota di budget) alla
+    // set_recording_hub(), coda servita dal writer tra start() e stop()
+    int register_recorder(TimeshiftManager* recorder);
+    void unregister_recorder(TimeshiftManager* recorder);
+    bool attach(TimeshiftManager* recorder);
+    // Lascia al writer fino a drain_timeout_ms per svuotare la coda, poi la stacca. Al ritorno
+    // il writer non sta scrivendo per questo manager
+    void detach(TimeshiftManager* recorder, uint32_t drain_timeout_ms);
+    void notify();                                   // Nuovo chunk in coda
+
+    size_t psram_share_bytes() const;
+    size_t sd_share_bytes() const;
+    uint8_t max_recorders() const { return cfg_.max_recorders; }
+    RecordingHubStats stats() const;
+
+    // Vista di playback non proprietaria su una registrazione: il player la chiude allo stop
+    // senza fermare la registrazione, che resta del chiamante
+    static std::unique_ptr<IDataSource> make_reader(TimeshiftManager& recorder);
+
+private:
+    struct Slot {
+        TimeshiftManager* recorder = nullptr;        // nullptr = libero
+        bool attached = false;
+        uint32_t retry_at_ms = 0;                    // Ring piena: prossimo tentativo
+        bool deferred = false;
+        RecorderLagStats stats;
+    };
+
+    static constexpr uint32_t kIdleWaitMs = 1000;
+    static constexpr uint32_t kRetryMs = 100;        // Come l'attesa del writer con la ring piena
+
+    RecordingHubConfig cfg_;
+    SemaphoreHandle_t mutex_ = nullptr;
+    SemaphoreHandle_t work_sem_ = nullptr;           // Binario: chunk in coda o slot staccato
+    TaskHandle_t task_handle_ = nullptr;
+    volatile bool running_ = false;
+    std::vector<Slot> slots_;                        // max_recorders, fissi
+    size_t next_slot_ = 0;                           // Round-robin
+    int busy_slot_ = -1;                             // Slot in scrittura fuori dal mutex
+
+    uint32_t begin_ms_ = 0;
+    uint64_t bytes_written_ = 0;
+    uint32_t chunks_written_ = 0;
+    uint64_t busy_us_ = 0;
+
+    static void task_trampoline(void* arg);
+    void task_loop();
+    int find_slot_locked(const TimeshiftManager* recorder) const;
+    // Col mutex preso: prossimo slot collegato con lavoro e non in attesa di spazio
+    int pick_slot_locked(uint32_t now, bool* any_deferred);
+};
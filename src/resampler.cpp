@@ -0,0 +1,292 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include "logger.h"
+
+namespace {
+
+const Resampler::Preset kPresets[] = {
+    {16, 64, 5.0f},     // FAST
+    {48, 128, 7.0f},    // BALANCED
+    {96, 256, 9.5f},    // BEST
+};
+
+// Bessel modificata di ordine 0 (serie), per la finestra di Kaiser
+double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 64; ++k) {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+// Larghezza della transizione di Kaiser, in cicli/campione al rate più basso
+double transition_width(const Resampler::Preset& p) {
+    const double atten_db = p.beta / 0.1102 + 8.7;
+    return (atten_db - 7.95) / (14.36 * p.taps);
+}
+
+float* alloc_floats(size_t count) {
+    size_t bytes = count * sizeof(float);
+    float* p = static_cast<float*>(heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (!p) {
+        p = static_cast<float*>(heap_caps_malloc(bytes, MALLOC_CAP_8BIT));
+    }
+    return p;
+}
+
+inline int16_t to_pcm(float v) {
+    v = std::max(-32768.0f, std::min(32767.0f, v));
+    return (int16_t)lrintf(v);
+}
+
+} // namespace
+
+const Resampler::Preset& Resampler::preset(ResamplerQuality quality) {
+    size_t index = static_cast<size_t>(quality);
+    if (index >= sizeof(kPresets) / sizeof(kPresets[0])) {
+        index = static_cast<size_t>(ResamplerQuality::BALANCED);
+    }
+    return kPresets[index];
+}
+
+Resampler::~Resampler() {
+    release();
+}
+
+void Resampler::release() {
+    if (table_) {
+        heap_caps_free(table_);
+        table_ = nullptr;
+    }
+    if (history_) {
+        heap_caps_free(history_);
+        history_ = nullptr;
+    }
+    taps_ = 0;
+    phases_ = 0;
+    history_capacity_ = 0;
+    in_rate_ = out_rate_ = 0;
+}
+
+double Resampler::passband_hz() const {
+    const double lower = (double)std::min(in_rate_, out_rate_);
+    return lower * (0.5 - transition_width(preset(quality_)));
+}
+
+size_t Resampler::memory_bytes() const {
+    return ((phases_ + 1) * taps_ + 2 * history_capacity_) * sizeof(float);
+}
+
+bool Resampler::configure(uint32_t in_rate, uint32_t out_rate, uint32_t channels, ResamplerQuality quality) {
+    if (in_rate == 0 || out_rate == 0 || channels == 0 || channels > 2) {
+        return false;
+    }
+    if ((uint64_t)in_rate > 4ull * out_rate || (uint64_t)out_rate > 8ull * in_rate) {
+        LOG_ERROR("Resampler: ratio %u -> %u Hz not supported", (unsigned)in_rate, (unsigned)out_rate);
+        return false;
+    }
+
+    bool rebuild = !table_ || in_rate != in_rate_ || out_rate != out_rate_ || quality != quality_;
+    in_rate_ = in_rate;
+    out_rate_ = out_rate;
+    channels_ = channels;
+    quality_ = quality;
+    if (rebuild && !build_table()) {
+        release();
+        return false;
+    }
+    update_step();
+    reset();
+    return true;
+}
+
+void Resampler::set_ratio_trim(float ppm) {
+    ppm = std::max(-kMaxTrimPpm, std::min(kMaxTrimPpm, ppm));
+    if (ppm != trim_ppm_) {
+        trim_ppm_ = ppm;
+        update_step();
+    }
+}
+
+void Resampler::update_step() {
+    if (out_rate_ == 0) {
+        step_ = 0;
+        return;
+    }
+    double ratio = (double)in_rate_ / (double)out_rate_ * (1.0 + (double)trim_ppm_ * 1e-6);
+    step_ = (uint64_t)llround(ratio * 4294967296.0);
+}
+
+bool Resampler::build_table() {
+    const Preset& p = preset(quality_);
+    const double ratio = std::min(1.0, (double)out_rate_ / (double)in_rate_);
+
+    // In downsampling la finestra copre taps frame del rate d'uscita
+    size_t taps = (size_t)ceil(p.taps / ratio);
+    taps = (taps + 1) & ~(size_t)1;
+
+    if (table_) {
+        heap_caps_free(table_);
+        table_ = nullptr;
+    }
+    if (history_) {
+        heap_caps_free(history_);
+        history_ = nullptr;
+    }
+    taps_ = taps;
+    phases_ = p.phases;
+    table_ = alloc_floats((phases_ + 1) * taps_);
+    history_capacity_ = taps_ + kChunkFrames;
+    history_ = alloc_floats(2 * history_capacity_);
+    if (!table_ || !history_) {
+        LOG_ERROR("Resampler: cannot allocate %u taps x %u phases", (unsigned)taps_, (unsigned)phases_);
+        return false;
+    }
+
+    // La banda di stop inizia al Nyquist del rate più basso, il taglio a -6 dB sta a metà
+    // transizione
+    const double cutoff = ratio * (0.5 - transition_width(p) / 2.0);
+    const double half = (double)(taps_ / 2);
+    const double i0_beta = bessel_i0(p.beta);
+
+    for (uint32_t ph = 0; ph <= phases_; ++ph) {
+        float* row = table_ + ph * taps_;
+        const double frac = (double)ph / (double)phases_;
+        double sum = 0.0;
+        for (size_t k = 0; k < taps_; ++k) {
+            // Distanza tra il tap k e la posizione d'uscita (pos + half - 1 + frac)
+            double t = (double)k - (half - 1.0) - frac;
+            double x = t / half;
+            double window = (x <= -1.0 || x >= 1.0) ? 0.0 : bessel_i0(p.beta * sqrt(1.0 - x * x)) / i0_beta;
+            double arg = 2.0 * cutoff * t;
+            double sinc = fabs(arg) < 1e-12 ? 1.0 : sin(M_PI * arg) / (M_PI * arg);
+            double h = 2.0 * cutoff * sinc * window;
+            row[k] = (float)h;
+            sum += h;
+        }
+        // Guadagno DC unitario per ogni fase
+        for (size_t k = 0; k < taps_; ++k) {
+            row[k] = (float)(row[k] / sum);
+        }
+    }
+
+    LOG_INFO("Resampler: %u -> %u Hz, %u taps x %u phases (%u KB)",
+             (unsigned)in_rate_, (unsigned)out_rate_, (unsigned)taps_, (unsigned)phases_,
+             (unsigned)(memory_bytes() / 1024));
+    return true;
+}
+
+void Resampler::reset() {
+    if (!history_) {
+        return;
+    }
+    // half - 1 frame di silenzio: la prima uscita cade sul primo frame d'ingresso
+    fill_ = taps_ / 2 - 1;
+    memset(history_, 0, fill_ * sizeof(float));
+    memset(history_ + history_capacity_, 0, fill_ * sizeof(float));
+    pos_ = 0;
+    frac_ = 0;
+}
+
+size_t Resampler::max_output_frames(size_t in_frames) const {
+    if (in_rate_ == 0) {
+        return in_frames;
+    }
+    // Margine per il trim massimo e per l'arrotondamento
+    return (size_t)(((uint64_t)in_frames * out_rate_ + in_rate_ - 1) / in_rate_) * 1001 / 1000 + 3;
+}
+
+size_t Resampler::process(const int16_t* in, size_t in_frames, int16_t* out, size_t out_capacity) {
+    if (!table_ || !history_) {
+        return 0;
+    }
+    const bool stereo = channels_ == 2;
+    float* hist_l = history_;
+    float* hist_r = history_ + history_capacity_;
+    size_t produced = 0;
+
+    for (;;) {
+        // Ingresso convertito in float nella storia planare
+        size_t n = std::min(in_frames, history_capacity_ - fill_);
+        if (stereo) {
+            for (size_t i = 0; i < n; ++i) {
+                hist_l[fill_ + i] = in[2 * i];
+                hist_r[fill_ + i] = in[2 * i + 1];
+            }
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                hist_l[fill_ + i] = in[i];
+            }
+        }
+        fill_ += n;
+        in += n * channels_;
+        in_frames -= n;
+
+        while (pos_ + taps_ <= fill_ && produced < out_capacity) {
+            // Fase = parte alta di frac_ * phases_, interpolazione dalla parte bassa
+            const uint64_t scaled = (uint64_t)frac_ * phases_;
+            const uint32_t p = (uint32_t)(scaled >> 32);
+            const float f = (float)(uint32_t)scaled * (1.0f / 4294967296.0f);
+            const float* c0 = table_ + p * taps_;
+            const float* c1 = c0 + taps_;
+            const float* xl = hist_l + pos_;
+            if (stereo) {
+                const float* xr = hist_r + pos_;
+                float sl = 0.0f, sr = 0.0f;
+                for (size_t k = 0; k < taps_; ++k) {
+                    float c = c0[k] + f * (c1[k] - c0[k]);
+                    sl += c * xl[k];
+                    sr += c * xr[k];
+                }
+                out[0] = to_pcm(sl);
+                out[1] = to_pcm(sr);
+                out += 2;
+            } else {
+                float s = 0.0f;
+                for (size_t k = 0; k < taps_; ++k) {
+                    s += (c0[k] + f * (c1[k] - c0[k])) * xl[k];
+                }
+                *out++ = to_pcm(s);
+            }
+            ++produced;
+
+            const uint64_t next = (uint64_t)frac_ + step_;
+            pos_ += (size_t)(next >> 32);
+            frac_ = (uint32_t)next;
+        }
+
+        // Scarta la storia già superata; in downsampling pos_ può andare oltre fill_
+        if (pos_ > 0) {
+            size_t drop = std::min(pos_, fill_);
+            size_t keep = fill_ - drop;
+            memmove(hist_l, hist_l + drop, keep * sizeof(float));
+            if (stereo) {
+                memmove(hist_r, hist_r + drop, keep * sizeof(float));
+            }
+            fill_ = keep;
+            pos_ -= drop;
+        }
+
+        if (in_frames == 0) {
+            break;
+        }
+        if (fill_ == history_capacity_) {
+            // Uscita piena (out_capacity < max_output_frames): il resto va perso
+            break;
+        }
+    }
+    return produced;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_types.h"
+
+// Convertitore di sample rate polifase a sinc finestrato (Kaiser) per PCM int16
+// interleaved, mono o stereo, con rapporto qualsiasi tra 1/4 e 8.
+//
+// La tabella contiene phases + 1 fasi del filtro da taps coefficienti; il coefficiente
+// alla posizione frazionaria esatta si interpola linearmente tra due fasi adiacenti e si
+// usa per entrambi i canali. La posizione avanza in virgola fissa 32.32 (errore sotto
+// 1e-9 del rapporto), con un trim fine opzionale del rapporto per la compensazione della
+// deriva di clock sugli stream live. Il passa-basso ha la banda
+// di stop al Nyquist del rate più basso; in downsampling la finestra si allarga di
+// in_rate / out_rate per mantenere la stessa transizione.
+class Resampler {
+public:
+    struct Preset {
+        uint16_t taps;        // Coefficienti per fase (rate più basso)
+        uint16_t phases;      // Risoluzione della tabella
+        float beta;           // Kaiser: attenuazione ≈ beta / 0.1102 + 8.7 dB
+    };
+    static const Preset& preset(ResamplerQuality quality);
+
+    Resampler() = default;
+    ~Resampler();
+    Resampler(const Resampler&) = delete;
+    Resampler& operator=(const Resampler&) = delete;
+
+    // Prepara tabella e storia; la tabella si ricalcola solo se cambiano rate o qualità
+    bool configure(uint32_t in_rate, uint32_t out_rate, uint32_t channels, ResamplerQuality quality);
+    // Svuota la storia (seek/flush) senza toccare la tabella
+    void reset();
+    void release();
+
+    bool configured() const { return table_ != nullptr; }
+    uint32_t in_rate() const { return in_rate_; }
+    uint32_t out_rate() const { return out_rate_; }
+    size_t taps() const { return taps_; }
+    // Ritardo introdotto, in frame di ingresso
+    size_t latency_frames() const { return taps_ / 2; }
+    size_t memory_bytes() const;
+    // Fine della banda passante (Hz)
+    double passband_hz() const;
+
+    // Frame d'uscita massimi prodotti da in_frames frame d'ingresso
+    size_t max_output_frames(size_t in_frames) const;
+
+    // Trim del rapporto in ppm (positivo = consuma più ingresso per frame d'uscita),
+    // limitato a ±kMaxTrimPpm; effetto dal frame successivo, senza toccare la storia
+    static constexpr float kMaxTrimPpm = 1000.0f;
+    void set_ratio_trim(float ppm);
+    float ratio_trim() const { return trim_ppm_; }
+
+    // Consuma tutti gli in_frames e scrive al più out_capacity frame; out_capacity deve
+    // valere almeno max_output_frames(in_frames). Restituisce i frame scritti.
+    size_t process(const int16_t* in, size_t in_frames, int16_t* out, size_t out_capacity);
+
+private:
+    static constexpr size_t kChunkFrames = 256;   // Ingresso convertito a float per giro
+
+    uint32_t in_rate_ = 0;
+    uint32_t out_rate_ = 0;
+    uint32_t channels_ = 0;
+    ResamplerQuality quality_ = ResamplerQuality::BALANCED;
+
+    // Tabella (phases_ + 1) x taps_
+    float* table_ = nullptr;
+    size_t taps_ = 0;
+    uint32_t phases_ = 0;
+
+    // Storia planare: taps_ + kChunkFrames frame per canale
+    float* history_ = nullptr;
+    size_t history_capacity_ = 0;
+    size_t fill_ = 0;                   // Frame validi nella storia
+    size_t pos_ = 0;                    // Indice intero della prossima uscita
+    uint32_t frac_ = 0;                 // Parte frazionaria (Q32)
+    uint64_t step_ = 0;                 // in_rate / out_rate in 32.32, trim incluso
+    float trim_ppm_ = 0.0f;
+
+    void update_step();
+
+    bool build_table();
+};
@@ -0,0 +1,291 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "reverb_effect.h"
+#include <algorithm>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include "logger.h"
+
+namespace {
+
+// Lunghezze Freeverb (campioni a 44.1 kHz)
+const uint16_t kCombTuning[ReverbEffect::kCombs] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617};
+const uint16_t kAllpassTuning[ReverbEffect::kAllpasses] = {556, 441, 341, 225};
+constexpr uint32_t kStereoSpread = 23;
+constexpr uint32_t kTuningRate = 44100;
+
+constexpr float kInputGain = 0.015f;       // Somma di 8 comb con feedback fino a 0.98
+constexpr float kScaleWet = 2.0f;          // Wet ≈ livello dell'input con room_size 0.5
+constexpr float kScaleDamp = 0.4f;
+constexpr float kScaleRoom = 0.28f;
+constexpr float kOffsetRoom = 0.7f;
+constexpr float kAllpassFeedback = 0.5f;
+// Offset DC minimo sull'input: le code che decadono non scendono nei denormali
+constexpr float kDenormalGuard = 1e-15f;
+
+uint32_t scaled_length(uint32_t tuning, uint32_t sample_rate) {
+    uint64_t len = ((uint64_t)tuning * sample_rate + kTuningRate / 2) / kTuningRate;
+    return len ? (uint32_t)len : 1;
+}
+
+void comb_block(float* buf, uint32_t len, uint32_t& pos_io, float& store_io, const float* in, float* out,
+                size_t frames, float feedback, float damp1, float damp2) {
+    uint32_t pos = pos_io;
+    float store = store_io;
+    size_t i = 0;
+    while (i < frames) {
+        // Tratto contiguo fino alla fine della linea: niente wrap nel loop interno
+        size_t run = std::min<size_t>(frames - i, len - pos);
+        float* line = buf + pos;
+        const float* x = in + i;
+        float* y = out + i;
+        for (size_t k = 0; k < run; ++k) {
+            float delayed = line[k];
+            store = delayed * damp2 + store * damp1;
+            line[k] = x[k] + store * feedback;
+            y[k] += delayed;
+        }
+        i += run;
+        pos += (uint32_t)run;
+        if (pos == len) pos = 0;
+    }
+    pos_io = pos;
+    store_io = store;
+}
+
+// Comb i del canale sinistro e del destro nello stesso loop: le due ricorrenze del
+// passa-basso sono indipendenti e si sovrappongono in pipeline. Le linee hanno lunghezze
+// diverse, quindi il tratto contiguo si ferma al primo dei due wrap.
+void comb_pair_block(float* buf_l, uint32_t len_l, uint32_t& pos_l_io, float& store_l_io,
+                     float* buf_r, uint32_t len_r, uint32_t& pos_r_io, float& store_r_io,
+                     const float* in, float* out_l, float* out_r, size_t frames,
+                     float feedback, float damp1, float damp2) {
+    uint32_t pos_l = pos_l_io, pos_r = pos_r_io;
+    float store_l = store_l_io, store_r = store_r_io;
+    size_t i = 0;
+    while (i < frames) {
+        size_t run = std::min<size_t>(frames - i, std::min(len_l - pos_l, len_r - pos_r));
+        float* line_l = buf_l + pos_l;
+        float* line_r = buf_r + pos_r;
+        const float* x = in + i;
+        float* yl = out_l + i;
+        float* yr = out_r + i;
+        for (size_t k = 0; k < run; ++k) {
+            float dl = line_l[k];
+            float dr = line_r[k];
+            store_l = dl * damp2 + store_l * damp1;
+            store_r = dr * damp2 + store_r * damp1;
+            line_l[k] = x[k] + store_l * feedback;
+            line_r[k] = x[k] + store_r * feedback;
+            yl[k] += dl;
+            yr[k] += dr;
+        }
+        i += run;
+        pos_l += (uint32_t)run;
+        pos_r += (uint32_t)run;
+        if (pos_l == len_l) pos_l = 0;
+        if (pos_r == len_r) pos_r = 0;
+    }
+    pos_l_io = pos_l;
+    pos_r_io = pos_r;
+    store_l_io = store_l;
+    store_r_io = store_r;
+}
+
+void allpass_block(float* buf, uint32_t len, uint32_t& pos_io, float* io, size_t frames) {
+    uint32_t pos = pos_io;
+    size_t i = 0;
+    while (i < frames) {
+        size_t run = std::min<size_t>(frames - i, len - pos);
+        float* line = buf + pos;
+        float* x = io + i;
+        for (size_t k = 0; k < run; ++k) {
+            float delayed = line[k];
+            float in = x[k];
+            x[k] = delayed - in;
+            line[k] = in + delayed * kAllpassFeedback;
+        }
+        i += run;
+        pos += (uint32_t)run;
+        if (pos == len) pos = 0;
+    }
+    pos_io = pos;
+}
+
+} // namespace
+
+ReverbEffect::~ReverbEffect() {
+    if (lines_) {
+        heap_caps_free(lines_);
+        lines_ = nullptr;
+    }
+    if (scratch_) {
+        heap_caps_free(scratch_);
+        scratch_ = nullptr;
+    }
+}
+
+bool ReverbEffect::prepare(uint32_t sample_rate, size_t max_block_frames) {
+    (void)max_block_frames;
+    if (sample_rate == 0) {
+        return false;
+    }
+
+    if (!scratch_) {
+        size_t bytes = 3 * kSubBlockFrames * sizeof(float);
+        scratch_ = static_cast<float*>(heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+        if (!scratch_) {
+            scratch_ = static_cast<float*>(heap_caps_malloc(bytes, MALLOC_CAP_8BIT));
+        }
+        if (!scratch_) {
+            LOG_ERROR("ReverbEffect: cannot allocate scratch");
+            return false;
+        }
+    }
+
+    size_t needed = 0;
+    for (int ch = 0; ch < 2; ++ch) {
+        uint32_t spread = ch ? kStereoSpread : 0;
+        for (size_t i = 0; i < kCombs; ++i) needed += scaled_length(kCombTuning[i] + spread, sample_rate);
+        for (size_t i = 0; i < kAllpasses; ++i) needed += scaled_length(kAllpassTuning[i] + spread, sample_rate);
+    }
+
+    // Un solo blocco per tutte le linee; si rialloca solo se il rate ne chiede di più
+    if (needed > line_capacity_) {
+        if (lines_) {
+            heap_caps_free(lines_);
+        }
+        line_capacity_ = 0;
+        lines_ = static_cast<float*>(heap_caps_malloc(needed * sizeof(float), MALLOC_CAP_SPIRAM));
+        if (!lines_) {
+            lines_ = static_cast<float*>(heap_caps_malloc(needed * sizeof(float), MALLOC_CAP_8BIT));
+        }
+        if (!lines_) {
+            LOG_ERROR("ReverbEffect: cannot allocate delay lines (%u bytes)", (unsigned)(needed * sizeof(float)));
+            sample_rate_ = 0;
+            return false;
+        }
+        line_capacity_ = needed;
+    }
+
+    float* cursor = lines_;
+    for (int ch = 0; ch < 2; ++ch) {
+        uint32_t spread = ch ? kStereoSpread : 0;
+        for (size_t i = 0; i < kCombs; ++i) {
+            Comb& c = combs_[ch][i];
+            c.buf = cursor;
+            c.len = scaled_length(kCombTuning[i] + spread, sample_rate);
+            cursor += c.len;
+        }
+        for (size_t i = 0; i < kAllpasses; ++i) {
+            Allpass& a = allpasses_[ch][i];
+            a.buf = cursor;
+            a.len = scaled_length(kAllpassTuning[i] + spread, sample_rate);
+            cursor += a.len;
+        }
+    }
+    line_used_ = needed;
+    sample_rate_ = sample_rate;
+    reset();
+    LOG_DEBUG("ReverbEffect: %u Hz, %u KB delay lines", (unsigned)sample_rate, (unsigned)(needed * sizeof(float) / 1024));
+    return true;
+}
+
+void ReverbEffect::reset() {
+    if (lines_) {
+        memset(lines_, 0, line_used_ * sizeof(float));
+    }
+    for (int ch = 0; ch < 2; ++ch) {
+        for (size_t i = 0; i < kCombs; ++i) {
+            combs_[ch][i].pos = 0;
+            combs_[ch][i].store = 0.0f;
+        }
+        for (size_t i = 0; i < kAllpasses; ++i) {
+            allpasses_[ch][i].pos = 0;
+        }
+    }
+}
+
+void ReverbEffect::process(AudioBlock& block) {
+    if (!lines_ || !scratch_ || sample_rate_ == 0) {
+        return;
+    }
+    // Con sorgente mono l'uscita usa solo left: il banco destro non serve
+    const bool stereo = block.channels != 1;
+    size_t done = 0;
+    while (done < block.frames) {
+        size_t n = std::min(kSubBlockFrames, block.frames - done);
+        processSubBlock(block.left + done, block.right + done, n, stereo);
+        done += n;
+    }
+}
+
+void ReverbEffect::processSubBlock(float* left, float* right, size_t frames, bool stereo) {
+    const ReverbParams p = params_;
+    const float room = std::max(0.0f, std::min(1.0f, p.room_size));
+    const float damping = std::max(0.0f, std::min(1.0f, p.damping));
+    const float width = std::max(0.0f, std::min(1.0f, p.width));
+    const float mix = std::max(0.0f, std::min(1.0f, p.mix));
+
+    const float feedback = room * kScaleRoom + kOffsetRoom;
+    const float damp1 = damping * kScaleDamp;
+    const float damp2 = 1.0f - damp1;
+    const float wet = mix * kScaleWet;
+    const float wet1 = wet * (width * 0.5f + 0.5f);
+    const float wet2 = wet * ((1.0f - width) * 0.5f);
+    const float dry = 1.0f - mix;
+
+    float* input = scratch_;
+    float* wet_l = scratch_ + kSubBlockFrames;
+    float* wet_r = scratch_ + 2 * kSubBlockFrames;
+
+    if (stereo) {
+        for (size_t i = 0; i < frames; ++i) {
+            input[i] = (left[i] + right[i]) * kInputGain + kDenormalGuard;
+        }
+    } else {
+        for (size_t i = 0; i < frames; ++i) {
+            input[i] = left[i] * (2.0f * kInputGain) + kDenormalGuard;
+        }
+    }
+
+    memset(wet_l, 0, frames * sizeof(float));
+    if (stereo) {
+        memset(wet_r, 0, frames * sizeof(float));
+        for (size_t i = 0; i < kCombs; ++i) {
+            Comb& l = combs_[0][i];
+            Comb& r = combs_[1][i];
+            comb_pair_block(l.buf, l.len, l.pos, l.store, r.buf, r.len, r.pos, r.store,
+                            input, wet_l, wet_r, frames, feedback, damp1, damp2);
+        }
+    } else {
+        for (size_t i = 0; i < kCombs; ++i) {
+            Comb& c = combs_[0][i];
+            comb_block(c.buf, c.len, c.pos, c.store, input, wet_l, frames, feedback, damp1, damp2);
+        }
+    }
+
+    const int channels = stereo ? 2 : 1;
+    for (int ch = 0; ch < channels; ++ch) {
+        float* out = ch ? wet_r : wet_l;
+        for (size_t i = 0; i < kAllpasses; ++i) {
+            Allpass& a = allpasses_[ch][i];
+            allpass_block(a.buf, a.len, a.pos, out, frames);
+        }
+    }
+
+    if (stereo) {
+        for (size_t i = 0; i < frames; ++i) {
+            float wl = wet_l[i];
+            float wr = wet_r[i];
+            left[i] = wl * wet1 + wr * wet2 + left[i] * dry;
+            right[i] = wr * wet1 + wl * wet2 + right[i] * dry;
+        }
+    } else {
+        for (size_t i = 0; i < frames; ++i) {
+            left[i] = wet_l[i] * wet + left[i] * dry;
+        }
+    }
+}
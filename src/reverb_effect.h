@@ -0,0 +1,73 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_effect_node.h"
+
+struct ReverbParams {
+    float room_size = 0.5f;   // 0..1 → feedback dei comb 0.70..0.98
+    float damping = 0.5f;     // 0..1 → smorzamento delle alte nel feedback
+    float width = 1.0f;       // 0 = wet mono, 1 = stereo pieno
+    float mix = 0.3f;         // 0 = solo dry, 1 = solo wet
+};
+
+// Riverbero Schroeder/Freeverb: per canale 8 comb in parallelo con filtro passa-basso
+// nel feedback, seguiti da 4 allpass in serie; il canale destro usa linee più lunghe di
+// 23 campioni (a 44.1 kHz) per decorrelare. Le lunghezze sono quelle di Freeverb scalate
+// al sample rate attivo; tutte le linee stanno in un unico blocco PSRAM allocato in
+// prepare() e riusato se il nuovo rate non richiede più memoria.
+//
+// process() lavora a sotto-blocchi di kSubBlockFrames: ogni comb/allpass scorre il
+// sotto-blocco con stato nei registri e accesso sequenziale alla propria linea (le
+// letture PSRAM restano in cache), invece di saltare tra 12 linee a ogni campione.
+class ReverbEffect : public IAudioEffect {
+public:
+    static constexpr size_t kCombs = 8;
+    static constexpr size_t kAllpasses = 4;
+    static constexpr size_t kSubBlockFrames = 256;
+
+    ~ReverbEffect() override;
+
+    const char* name() const override { return "reverb"; }
+    bool prepare(uint32_t sample_rate, size_t max_block_frames) override;
+    void process(AudioBlock& block) override;
+    void reset() override;
+
+    void setParams(const ReverbParams& params) { params_ = params; }
+    const ReverbParams& params() const { return params_; }
+
+    // Byte di PSRAM occupati dalle linee
+    size_t memoryBytes() const { return line_capacity_ * sizeof(float); }
+
+private:
+    struct Comb {
+        float* buf;
+        uint32_t len;
+        uint32_t pos;
+        float store;          // Stato del passa-basso nel feedback
+    };
+    struct Allpass {
+        float* buf;
+        uint32_t len;
+        uint32_t pos;
+    };
+
+    ReverbParams params_;
+    uint32_t sample_rate_ = 0;
+
+    Comb combs_[2][kCombs] = {};
+    Allpass allpasses_[2][kAllpasses] = {};
+    float* lines_ = nullptr;
+    size_t line_capacity_ = 0;     // float allocati in lines_
+    size_t line_used_ = 0;         // float usati al rate corrente
+
+    // input mono, wet L, wet R (kSubBlockFrames ciascuno, RAM interna se disponibile)
+    float* scratch_ = nullptr;
+
+    void processSubBlock(float* left, float* right, size_t frames, bool stereo);
+};
@@ -0,0 +1,284 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "sd_chunk_ring.h"
+#include "logger.h"
+
+SdChunkRing::~SdChunkRing() {
+    close();
+    if (lock_) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+}
+
+bool SdChunkRing::ensure_lock() {
+    if (!lock_) {
+        lock_ = xSemaphoreCreateMutex();
+    }
+    return lock_ != nullptr;
+}
+
+bool SdChunkRing::open(fs::FS& fs, const char* path, size_t capacity_bytes) {
+    close();
+    capacity_bytes = capacity_bytes / kAlignBytes * kAlignBytes;
+    if (capacity_bytes == 0 || capacity_bytes > UINT32_MAX || !ensure_lock()) {
+        LOG_ERROR("SdChunkRing: invalid capacity %u", (unsigned)capacity_bytes);
+        return false;
+    }
+
+    size_t existing = 0;
+    if (fs.exists(path)) {
+        File probe = fs.open(path, FILE_READ);
+        existing = probe ? probe.size() : 0;
+        probe.close();
+        if (existing > capacity_bytes) {
+            // Ring ridimensionata da config: ricrea il file per non sprecare spazio
+            fs.remove(path);
+            existing = 0;
+        }
+    }
+    if (existing == 0) {
+        File created = fs.open(path, FILE_WRITE);
+        if (!created) {
+            LOG_ERROR("SdChunkRing: cannot create %s", path);
+            return false;
+        }
+        created.close();
+    }
+
+    File file = fs.open(path, "r+");
+    if (!file) {
+        LOG_ERROR("SdChunkRing: cannot open %s", path);
+        return false;
+    }
+    if (existing < capacity_bytes) {
+        // Seek oltre la fine + un byte: FAT alloca tutta la catena di cluster adesso, una volta
+        const uint8_t zero = 0;
+        if (!file.seek((uint32_t)(capacity_bytes - 1)) || file.write(&zero, 1) != 1) {
+            LOG_ERROR("SdChunkRing: cannot preallocate %u MB in %s",
+                      (unsigned)(capacity_bytes / (1024 * 1024)), path);
+            file.close();
+            fs.remove(path);
+            return false;
+        }
+        file.flush();
+    }
+
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    file_ = file;
+    capacity_ = capacity_bytes;
+    reused_ = existing == capacity_bytes;
+    regions_.clear();
+    head_ = 0;
+    used_ = 0;
+    xSemaphoreGive(lock_);
+
+    LOG_INFO("SdChunkRing: %s %s, %u MB (%u KB regions)", path, existing == capacity_bytes ? "reused" : "preallocated",
+             (unsigned)(capacity_bytes / (1024 * 1024)), (unsigned)(kAlignBytes / 1024));
+    return true;
+}
+
+void SdChunkRing::close() {
+    if (!lock_) {
+        return;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (file_) {
+        file_.close();
+    }
+    file_ = File();
+    capacity_ = 0;
+    reused_ = false;
+    regions_.clear();
+    head_ = 0;
+    used_ = 0;
+    xSemaphoreGive(lock_);
+}
+
+bool SdChunkRing::place_locked(uint32_t span, uint32_t& out_offset) const {
+    if (span == 0 || span > capacity_) {
+        return false;
+    }
+    if (regions_.empty()) {
+        out_offset = 0;
+        return true;
+    }
+    const uint32_t tail = regions_.front().offset;
+    if (head_ > tail) {
+        // Occupato [tail, head_): libero in fondo al file e prima della coda
+        if ((size_t)head_ + span <= capacity_) {
+            out_offset = head_;
+            return true;
+        }
+        if (span <= tail) {
+            out_offset = 0;
+            return true;
+        }
+        return false;
+    }
+    // Già riavvolta: libero solo [head_, tail)
+    if ((size_t)head_ + span <= tail) {
+        out_offset = head_;
+        return true;
+    }
+    return false;
+}
+
+bool SdChunkRing::fits(size_t len) const {
+    if (!lock_ || len == 0) {
+        return false;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    uint32_t offset = 0;
+    const bool ok = place_locked((uint32_t)span_for(len), offset);
+    xSemaphoreGive(lock_);
+    return ok;
+}
+
+bool SdChunkRing::reserve(size_t len, uint32_t& out_offset) {
+    if (!lock_ || len == 0) {
+        return false;
+    }
+    const uint32_t span = (uint32_t)span_for(len);
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const bool ok = place_locked(span, out_offset);
+    if (ok) {
+        Region region = {out_offset, span, true};
+        regions_.push_back(region);
+        head_ = out_offset + span;
+        used_ += span;
+    }
+    xSemaphoreGive(lock_);
+    return ok;
+}
+
+bool SdChunkRing::adopt(uint32_t offset, size_t len) {
+    if (!lock_ || len == 0 || offset % kAlignBytes != 0) {
+        return false;
+    }
+    const uint32_t span = (uint32_t)span_for(len);
+    const size_t end = (size_t)offset + span;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    bool ok = end <= capacity_;
+    if (ok && !regions_.empty()) {
+        const uint32_t tail = regions_.front().offset;
+        if (head_ > tail) {
+            // Dopo la testa, oppure riavvolta prima della coda
+            ok = offset >= head_ || end <= tail;
+        } else {
+            ok = offset >= head_ && end <= tail;
+        }
+    }
+    if (ok) {
+        Region region = {offset, span, true};
+        regions_.push_back(region);
+        head_ = (uint32_t)end;
+        used_ += span;
+    }
+    xSemaphoreGive(lock_);
+    return ok;
+}
+
+void SdChunkRing::live_offsets(std::vector<uint32_t>& out) const {
+    out.clear();
+    if (!lock_) {
+        return;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    out.reserve(regions_.size());
+    for (const Region& region : regions_) {
+        if (region.live) {
+            out.push_back(region.offset);
+        }
+    }
+    xSemaphoreGive(lock_);
+}
+
+void SdChunkRing::release(uint32_t offset) {
+    if (!lock_) {
+        return;
+    }
+    bool found = false;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    for (Region& region : regions_) {
+        if (region.live && region.offset == offset) {
+            region.live = false;
+            found = true;
+            break;
+        }
+    }
+    while (!regions_.empty() && !regions_.front().live) {
+        used_ -= regions_.front().span;
+        regions_.pop_front();
+    }
+    if (regions_.empty()) {
+        head_ = 0;
+    }
+    xSemaphoreGive(lock_);
+    if (!found) {
+        LOG_WARN("SdChunkRing: release of unknown region @%u", (unsigned)offset);
+    }
+}
+
+void SdChunkRing::reset() {
+    if (!lock_) {
+        return;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    regions_.clear();
+    head_ = 0;
+    used_ = 0;
+    xSemaphoreGive(lock_);
+}
+
+bool SdChunkRing::write(uint32_t offset, const uint8_t* data, size_t len) {
+    if (!lock_ || !data || (size_t)offset + len > capacity_) {
+        return false;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    bool ok = file_ && file_.seek(offset) && file_.write(data, len) == len;
+    if (ok) {
+        // I reader leggono dallo stesso handle: niente dati nel buffer stdio
+        file_.flush();
+    }
+    xSemaphoreGive(lock_);
+    if (!ok) {
+        LOG_ERROR("SdChunkRing: write of %u bytes @%u failed", (unsigned)len, (unsigned)offset);
+    }
+    return ok;
+}
+
+bool SdChunkRing::read(uint32_t offset, uint8_t* dest, size_t len) {
+    if (!lock_ || !dest || (size_t)offset + len > capacity_) {
+        return false;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const bool ok = file_ && file_.seek(offset) && file_.read(dest, len) == len;
+    xSemaphoreGive(lock_);
+    if (!ok) {
+        LOG_ERROR("SdChunkRing: read of %u bytes @%u failed", (unsigned)len, (unsigned)offset);
+    }
+    return ok;
+}
+
+size_t SdChunkRing::used_bytes() const {
+    if (!lock_) {
+        return 0;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const size_t n = used_;
+    xSemaphoreGive(lock_);
+    return n;
+}
+
+size_t SdChunkRing::region_count() const {
+    if (!lock_) {
+        return 0;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const size_t n = regions_.size();
+    xSemaphoreGive(lock_);
+    return n;
+}
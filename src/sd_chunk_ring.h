@@ -0,0 +1,81 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Storage SD del timeshift: un unico file ring preallocato una volta sola, aperto per
+// tutta la sessione. Ogni chunk occupa una regione allineata al cluster; allocare e
+// liberare una regione tocca solo l'indice in memoria, quindi su SD restano solo seek,
+// write e read: niente create/close/unlink per chunk né aggiornamenti di directory e FAT.
+//
+// Le regioni si allocano in ordine (testa) e si recuperano dalla più vecchia (coda), come
+// i chunk del timeshift. Una regione che non entra prima della fine del file riparte da 0.
+// Un rilascio fuori ordine lascia un buco che si recupera quando la coda lo raggiunge.
+//
+// Tutti i metodi sono thread-safe (un mutex interno serializza anche l'I/O sul file).
+class SdChunkRing {
+public:
+    static constexpr size_t kAlignBytes = 32 * 1024;   // Cluster FAT32 tipico di SD > 32 GB
+
+    SdChunkRing() = default;
+    ~SdChunkRing();
+    SdChunkRing(const SdChunkRing&) = delete;
+    SdChunkRing& operator=(const SdChunkRing&) = delete;
+
+    // Apre (o crea ed espande) il file ring; riusa il file esistente se è già grande
+    // abbastanza. L'indice riparte vuoto.
+    bool open(fs::FS& fs, const char* path, size_t capacity_bytes);
+    void close();
+    bool is_open() const { return capacity_ > 0; }
+    // true se open() ha trovato il file già della capacità richiesta (contenuto intatto)
+    bool reused() const { return reused_; }
+
+    // Ripristino da journal: reinserisce una regione già scritta, in ordine di allocazione.
+    // false se non è allineata o non è coerente con le regioni già adottate.
+    bool adopt(uint32_t offset, size_t len);
+    // Offset delle regioni vive in ordine di allocazione (per compattare il journal)
+    void live_offsets(std::vector<uint32_t>& out) const;
+
+    // Riserva una regione per len byte; false se la ring è piena (serve un release)
+    bool reserve(size_t len, uint32_t& out_offset);
+    // true se reserve(len) riuscirebbe adesso
+    bool fits(size_t len) const;
+    void release(uint32_t offset);
+    // Dimentica tutte le regioni (il file resta allocato)
+    void reset();
+
+    bool write(uint32_t offset, const uint8_t* data, size_t len);
+    bool read(uint32_t offset, uint8_t* dest, size_t len);
+
+    size_t capacity() const { return capacity_; }
+    size_t used_bytes() const;
+    size_t region_count() const;
+    static size_t span_for(size_t len) { return (len + kAlignBytes - 1) / kAlignBytes * kAlignBytes; }
+
+private:
+    struct Region {
+        uint32_t offset;
+        uint32_t span;      // Lunghezza allineata
+        bool live;
+    };
+
+    mutable SemaphoreHandle_t lock_ = nullptr;
+    fs::File file_;
+    size_t capacity_ = 0;
+    bool reused_ = false;
+    uint32_t head_ = 0;               // Prossimo offset libero dopo l'ultima regione
+    size_t used_ = 0;                  // Span delle regioni in indice (buchi compresi)
+    std::deque<Region> regions_;       // In ordine di allocazione
+
+    bool place_locked(uint32_t span, uint32_t& out_offset) const;
+    bool ensure_lock();
+};
@@ -0,0 +1,440 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "station_preset_manager.h"
+#include <HTTPClient.h>
+#include <algorithm>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include "audio_player.h"
+#include "logger.h"
+#include "mp3_vbr_header.h"
+#include "timeshift_manager.h"
+
+namespace {
+constexpr uint32_t kStandbyConnectTimeoutMs = 5000;
+// Come il download task del TimeshiftManager: HTTPClient + TLS
+constexpr uint32_t kStandbyTaskStack = 24576;
+constexpr UBaseType_t kStandbyTaskPriority = 2;   // Sotto download (5) e writer (4) del timeshift
+}
+
+StationPresetManager::StationPresetManager(AudioPlayer& player, const StationStandbyConfig& cfg)
+    : player_(player), cfg_(cfg) {
+    mutex_ = xSemaphoreCreateMutex();
+}
+
+StationPresetManager::~StationPresetManager() {
+    end();
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
+}
+
+size_t StationPresetManager::add_preset(const char* name, const char* uri) {
+    if (task_handle_) {
+        LOG_WARN("Station presets cannot change after begin()");
+        return SIZE_MAX;
+    }
+    StationPreset preset;
+    preset.name = name ? name : "";
+    preset.uri = uri ? uri : "";
+    presets_.push_back(preset);
+    return presets_.size() - 1;
+}
+
+bool StationPresetManager::begin() {
+    if (task_handle_) {
+        return true;
+    }
+    if (presets_.empty() || !mutex_) {
+        LOG_WARN("Station standby: no presets");
+        return false;
+    }
+
+    // Slot fissati qui: il task tiene puntatori agli elementi, il vector non cresce più
+    size_t by_memory = cfg_.preroll_bytes ? cfg_.memory_budget_bytes / cfg_.preroll_bytes : 0;
+    size_t count = std::min<size_t>(cfg_.max_sockets, by_memory);
+    slots_.clear();
+    slots_.resize(count);
+    retry_at_ms_.assign(presets_.size(), 0);
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    update_wanted_locked();
+    xSemaphoreGive(mutex_);
+
+    LOG_INFO("Station standby: %u slot(s) x %u KB pre-roll (budget %u KB, %u socket(s), %u neighbor(s))",
+             (unsigned)count, (unsigned)(cfg_.preroll_bytes / 1024), (unsigned)(cfg_.memory_budget_bytes / 1024),
+             (unsigned)cfg_.max_sockets, (unsigned)cfg_.neighbors);
+    if (count == 0) {
+        return true; // Budget nullo: solo avvii a freddo
+    }
+
+    running_ = true;
+    if (xTaskCreate(task_trampoline, "station_standby", kStandbyTaskStack, this, kStandbyTaskPriority,
+                    &task_handle_) != pdPASS) {
+        LOG_ERROR("Failed to create station standby task");
+        running_ = false;
+        task_handle_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void StationPresetManager::end() {
+    if (task_handle_) {
+        running_ = false;
+        // Una GET in corso può tenere il task fino al suo timeout
+        uint32_t wait_start = millis();
+        while (task_handle_ && millis() - wait_start < kStartTimeoutMs) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        if (task_handle_) {
+            LOG_WARN("Station standby task did not stop in time");
+        }
+    }
+    if (!mutex_) {
+        return;
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (auto& slot : slots_) {
+        release_locked(slot);
+    }
+    wanted_.clear();
+    xSemaphoreGive(mutex_);
+}
+
+bool StationPresetManager::play(size_t index) {
+    if (index >= presets_.size()) {
+        return false;
+    }
+    const StationPreset& preset = presets_[index];
+    switch_started_ms_ = millis();
+
+    // Il vecchio TimeshiftManager (task, pool, storage) si chiude con lo stream del player
+    player_.stop();
+
+    std::unique_ptr<TimeshiftManager> ts(new TimeshiftManager());
+    if (timeshift_setup_) {
+        timeshift_setup_(*ts);
+    }
+    if (!ts->open(preset.uri.c_str())) {
+        LOG_ERROR("Station %u: cannot open %s", (unsigned)index, preset.uri.c_str());
+        return false;
+    }
+
+    // Standby connesso: socket e pre-roll passano al manager, lo slot torna libero
+    bool warm = false;
+    size_t preroll = 0;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    current_ = (int)index;
+    for (auto& slot : slots_) {
+        if (slot.preset != (int)index || !slot.http || slot.connecting) {
+            continue;
+        }
+        drain_locked(slot);
+        if (slot.http) {
+            size_t start = align_preroll_locked(slot);
+            size_t len = slot.filled - start;
+            warm = ts->adopt_stream(std::move(slot.http), slot.ring + start, len);
+            preroll = warm ? len : 0;
+        }
+        release_locked(slot);
+        break;
+    }
+    update_wanted_locked();
+    xSemaphoreGive(mutex_);
+
+    if (!ts->start()) {
+        LOG_ERROR("Station %u: cannot start timeshift", (unsigned)index);
+        return false;
+    }
+    uint32_t wait_start = millis();
+    while (ts->playable_bytes() == 0 && ts->is_running() && millis() - wait_start < kStartTimeoutMs) {
+        delay(5);
+    }
+    if (ts->playable_bytes() == 0) {
+        LOG_ERROR("Station %u: no data from %s", (unsigned)index, preset.uri.c_str());
+        return false;
+    }
+
+    player_.select_source(std::unique_ptr<IDataSource>(ts.release()));
+    if (!player_.arm_source()) {
+        return false;
+    }
+    player_.start();
+
+    uint32_t ready_ms = millis() - switch_started_ms_;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    stats_.switches++;
+    if (warm) {
+        stats_.warm_switches++;
+    }
+    stats_.last_warm = warm;
+    stats_.last_preroll_bytes = (uint32_t)preroll;
+    stats_.last_ready_ms = ready_ms;
+    xSemaphoreGive(mutex_);
+
+    LOG_INFO("Station %u \"%s\": %s start, player ready in %u ms (%u KB pre-roll)", (unsigned)index,
+             preset.name.c_str(), warm ? "warm" : "cold", (unsigned)ready_ms, (unsigned)(preroll / 1024));
+    return true;
+}
+
+bool StationPresetManager::next() {
+    if (presets_.empty()) {
+        return false;
+    }
+    return play(current_ < 0 ? 0 : (size_t)(current_ + 1) % presets_.size());
+}
+
+bool StationPresetManager::previous() {
+    if (presets_.empty()) {
+        return false;
+    }
+    const int n = (int)presets_.size();
+    return play(current_ < 0 ? (size_t)(n - 1) : (size_t)((current_ - 1 + n) % n));
+}
+
+bool StationPresetManager::is_warm(size_t index) const {
+    bool warm = false;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (const auto& slot : slots_) {
+        if (slot.preset == (int)index && slot.http && !slot.connecting) {
+            warm = true;
+            break;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return warm;
+}
+
+size_t StationPresetManager::warm_count() const {
+    size_t count = 0;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (const auto& slot : slots_) {
+        if (slot.http && !slot.connecting) {
+            ++count;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return count;
+}
+
+size_t StationPresetManager::standby_memory_bytes() const {
+    size_t bytes = 0;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (const auto& slot : slots_) {
+        if (slot.ring) {
+            bytes += cfg_.preroll_bytes;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return bytes;
+}
+
+StationSwitchStats StationPresetManager::switch_stats() const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    StationSwitchStats stats = stats_;
+    xSemaphoreGive(mutex_);
+    // Primo campione dell'ultimo start() del player, se successivo al cambio
+    uint32_t first_audio = player_.first_audio_at_ms();
+    if (stats.switches > 0 && first_audio != 0 && (int32_t)(first_audio - switch_started_ms_) >= 0) {
+        stats.last_first_audio_ms = first_audio - switch_started_ms_;
+    }
+    return stats;
+}
+
+void StationPresetManager::task_trampoline(void* arg) {
+    static_cast<StationPresetManager*>(arg)->task_loop();
+}
+
+void StationPresetManager::task_loop() {
+    LOG_INFO("Station standby task started");
+    while (running_) {
+        Standby* slot = nullptr;
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        int preset = reconcile_locked(&slot);
+        for (auto& s : slots_) {
+            drain_locked(s);
+        }
+        xSemaphoreGive(mutex_);
+
+        if (preset >= 0) {
+            connect_standby(slot, preset);
+        }
+        vTaskDelay(pdMS_TO_TICKS(kPollMs));
+    }
+    LOG_INFO("Station standby task stopped");
+    task_handle_ = nullptr;
+    vTaskDelete(nullptr);
+}
+
+int StationPresetManager::reconcile_locked(Standby** out) {
+    // Stazioni uscite dalla finestra (o diventate la corrente): socket chiuso, ring liberato
+    for (auto& slot : slots_) {
+        if (slot.preset >= 0 && !slot.connecting &&
+            std::find(wanted_.begin(), wanted_.end(), slot.preset) == wanted_.end()) {
+            release_locked(slot);
+        }
+    }
+
+    // Una sola connessione per giro: la GET blocca il task
+    const uint32_t now = millis();
+    for (int preset : wanted_) {
+        bool assigned = false;
+        for (const auto& slot : slots_) {
+            if (slot.preset == preset) {
+                assigned = true;
+                break;
+            }
+        }
+        if (assigned || (int32_t)(now - retry_at_ms_[preset]) < 0) {
+            continue;
+        }
+        for (auto& slot : slots_) {
+            if (slot.preset < 0) {
+                slot.preset = preset;
+                slot.connecting = true;
+                *out = &slot;
+                return preset;
+            }
+        }
+        break;
+    }
+    return -1;
+}
+
+void StationPresetManager::connect_standby(Standby* slot, int preset) {
+    // Presets immutabili dopo begin(): lettura senza mutex
+    const StationPreset& station = presets_[preset];
+    std::unique_ptr<HTTPClient> http(new HTTPClient());
+    http->begin(station.uri.c_str());
+    http->setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
+    http->setTimeout(kStandbyConnectTimeoutMs);
+    http->setUserAgent("ESP32-Audio/1.0");
+    int code = http->GET();
+    WiFiClient* stream = code == HTTP_CODE_OK ? http->getStreamPtr() : nullptr;
+    uint8_t* ring = nullptr;
+    if (stream) {
+        ring = static_cast<uint8_t*>(heap_caps_malloc(cfg_.preroll_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    slot->connecting = false;
+    const bool wanted = running_ && std::find(wanted_.begin(), wanted_.end(), preset) != wanted_.end();
+    if (!stream || !ring || !wanted) {
+        if (wanted) {
+            stats_.standby_failures++;
+            retry_at_ms_[preset] = millis() + cfg_.retry_ms;
+        }
+        slot->preset = -1;
+        xSemaphoreGive(mutex_);
+        if (wanted) {
+            LOG_WARN("Standby for \"%s\" failed (HTTP %d%s), retry in %u ms", station.name.c_str(), code,
+                     stream && !ring ? ", no PSRAM for pre-roll" : "", (unsigned)cfg_.retry_ms);
+        }
+        http->end();
+        if (ring) {
+            heap_caps_free(ring);
+        }
+        return;
+    }
+    slot->http = std::move(http);
+    slot->stream = stream;
+    slot->ring = ring;
+    slot->head = 0;
+    slot->filled = 0;
+    stats_.standby_connects++;
+    xSemaphoreGive(mutex_);
+    LOG_INFO("Standby connected: \"%s\" (%u KB pre-roll)", station.name.c_str(),
+             (unsigned)(cfg_.preroll_bytes / 1024));
+}
+
+void StationPresetManager::drain_locked(Standby& slot) {
+    if (!slot.stream || slot.connecting) {
+        return;
+    }
+    if (!slot.stream->connected()) {
+        LOG_WARN("Standby \"%s\" disconnected, reconnecting", presets_[slot.preset].name.c_str());
+        release_locked(slot); // Resta nella finestra: il prossimo giro lo riconnette
+        return;
+    }
+
+    // Il ring tiene solo gli ultimi preroll_bytes: i più vecchi vengono sovrascritti
+    int available = slot.stream->available();
+    while (available > 0) {
+        size_t to_read = std::min((size_t)available, cfg_.preroll_bytes - slot.head);
+        size_t got = slot.stream->readBytes(slot.ring + slot.head, to_read);
+        if (got == 0) {
+            break;
+        }
+        slot.head = (slot.head + got) % cfg_.preroll_bytes;
+        slot.filled = std::min(cfg_.preroll_bytes, slot.filled + got);
+        available -= (int)got;
+    }
+}
+
+void StationPresetManager::release_locked(Standby& slot) {
+    if (slot.http) {
+        slot.http->end();
+        slot.http.reset();
+    }
+    if (slot.ring) {
+        heap_caps_free(slot.ring);
+        slot.ring = nullptr;
+    }
+    slot.stream = nullptr;
+    slot.preset = -1;
+    slot.head = 0;
+    slot.filled = 0;
+}
+
+void StationPresetManager::update_wanted_locked() {
+    // Prima le vicine più strette, alternando successiva e precedente (next/previous)
+    wanted_.clear();
+    const int n = (int)presets_.size();
+    if (n == 0 || slots_.empty()) {
+        return;
+    }
+    const int center = current_ >= 0 ? current_ : 0;
+    if (current_ < 0) {
+        wanted_.push_back(0); // Nessuna stazione ancora: la prima è la più probabile
+    }
+    for (int d = 1; d <= cfg_.neighbors; ++d) {
+        const int candidates[2] = {(center + d) % n, ((center - d) % n + n) % n};
+        for (int preset : candidates) {
+            if (wanted_.size() >= slots_.size()) {
+                return;
+            }
+            if (preset != current_ && std::find(wanted_.begin(), wanted_.end(), preset) == wanted_.end()) {
+                wanted_.push_back(preset);
+            }
+        }
+    }
+}
+
+size_t StationPresetManager::align_preroll_locked(Standby& slot) {
+    // Ring pieno: i byte più vecchi partono da head
+    if (slot.filled == cfg_.preroll_bytes && slot.head != 0) {
+        std::rotate(slot.ring, slot.ring + slot.head, slot.ring + cfg_.preroll_bytes);
+        slot.head = 0;
+    }
+
+    // Il ring ha sovrascritto a metà frame: si parte dal primo header seguito da un altro
+    // header compatibile, come il sync di minimp3
+    const uint8_t* data = slot.ring;
+    for (size_t pos = 0; pos + 4 <= slot.filled; ++pos) {
+        Mp3FrameHeader hdr;
+        if (data[pos] != 0xFF || !parse_mp3_frame_header(data + pos, &hdr)) {
+            continue;
+        }
+        size_t next = pos + hdr.length;
+        Mp3FrameHeader next_hdr;
+        if (next + 4 <= slot.filled && parse_mp3_frame_header(data + next, &next_hdr) &&
+            next_hdr.sample_rate == hdr.sample_rate && next_hdr.layer == hdr.layer) {
+            return pos;
+        }
+    }
+    return 0; // Nessun frame riconosciuto: il decoder si sincronizza da solo
+}
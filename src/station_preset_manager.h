@@ -0,0 +1,125 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class AudioPlayer;
+class HTTPClient;
+class WiFiClient;
+class TimeshiftManager;
+
+struct StationPreset {
+    std::string name;
+    std::string uri;
+};
+
+// Budget degli standby: ogni stazione calda tiene aperto un socket e un pre-roll in PSRAM
+// con gli ultimi byte ricevuti. Gli slot sono min(max_sockets, memory_budget / preroll)
+struct StationStandbyConfig {
+    uint8_t neighbors = 1;                    // Stazioni calde per lato: successive e precedenti
+    uint8_t max_sockets = 2;                  // Connessioni standby contemporanee
+    size_t preroll_bytes = 48 * 1024;         // Pre-roll per stazione (~3 s a 128 kbps)
+    size_t memory_budget_bytes = 128 * 1024;  // Tetto PSRAM di tutti i pre-roll
+    uint32_t retry_ms = 5000;                 // Attesa prima di ritentare uno standby fallito
+};
+
+struct StationSwitchStats {
+    uint32_t switches = 0;
+    uint32_t warm_switches = 0;        // Partiti da uno standby connesso
+    bool last_warm = false;
+    uint32_t last_preroll_bytes = 0;   // Pre-roll consegnato al TimeshiftManager
+    uint32_t last_ready_ms = 0;        // play() → player avviato (stop del vecchio incluso)
+    uint32_t last_first_audio_ms = 0;  // play() → primo campione su I2S (0 = non ancora)
+    uint32_t standby_connects = 0;
+    uint32_t standby_failures = 0;
+};
+
+// Preset di stazioni con standby caldi: le N stazioni prima e dopo la corrente restano
+// connesse in background, un solo task legge tutti i socket in piccoli ring PSRAM. Al
+// cambio il player riparte da un TimeshiftManager che adotta socket e pre-roll
+// (adopt_stream): niente connessione né attesa del primo byte, il live head decodifica
+// subito gli ultimi secondi ricevuti. Le stazioni fredde seguono il percorso normale.
+//
+// play()/next()/previous() vanno chiamati dal task dell'applicazione (loop).
+class StationPresetManager {
+public:
+    explicit StationPresetManager(AudioPlayer& player, const StationStandbyConfig& cfg = StationStandbyConfig());
+    ~StationPresetManager();
+    StationPresetManager(const StationPresetManager&) = delete;
+    StationPresetManager& operator=(const StationPresetManager&) = delete;
+
+    // Preset modificabili solo prima di begin()
+    size_t add_preset(const char* name, const char* uri);
+    size_t preset_count() const { return presets_.size(); }
+    const StationPreset& preset(size_t index) const { return presets_[index]; }
+
+    // Configurazione di ogni nuovo TimeshiftManager (storage mode, auto-pausa...) prima di open()
+    void set_timeshift_setup(std::function<void(TimeshiftManager&)> setup) { timeshift_setup_ = setup; }
+
+    // Avvia il task degli standby: scalda le prime stazioni finché non si sceglie la corrente
+    bool begin();
+    void end();
+
+    bool play(size_t index);
+    bool next();
+    bool previous();
+    int current_index() const { return current_; }
+
+    bool is_warm(size_t index) const;        // Standby connesso con pre-roll
+    size_t warm_count() const;
+    size_t standby_memory_bytes() const;     // PSRAM dei ring allocati
+    size_t standby_slots() const { return slots_.size(); }
+    StationSwitchStats switch_stats() const;
+
+private:
+    struct Standby {
+        int preset = -1;                     // -1 = slot libero
+        bool connecting = false;             // GET in corso fuori dal mutex
+        std::unique_ptr<HTTPClient> http;
+        WiFiClient* stream = nullptr;
+        uint8_t* ring = nullptr;             // preroll_bytes, sovrascritto in circolo
+        size_t head = 0;                     // Prossima scrittura
+        size_t filled = 0;
+    };
+
+    static constexpr uint32_t kPollMs = 20;          // Giro del task sui socket standby
+    static constexpr uint32_t kStartTimeoutMs = 10000;
+
+    AudioPlayer& player_;
+    StationStandbyConfig cfg_;
+    std::vector<StationPreset> presets_;
+    std::function<void(TimeshiftManager&)> timeshift_setup_;
+
+    SemaphoreHandle_t mutex_ = nullptr;
+    TaskHandle_t task_handle_ = nullptr;
+    volatile bool running_ = false;
+    std::vector<Standby> slots_;
+    std::vector<int> wanted_;                // Preset da tenere caldi, in ordine di priorità
+    std::vector<uint32_t> retry_at_ms_;      // Per preset: prossimo tentativo dopo un errore
+    int current_ = -1;
+
+    StationSwitchStats stats_;
+    uint32_t switch_started_ms_ = 0;
+
+    static void task_trampoline(void* arg);
+    void task_loop();
+    // Col mutex preso: libera gli slot non più voluti, ritorna il preset da connettere (-1 nessuno)
+    int reconcile_locked(Standby** slot);
+    void connect_standby(Standby* slot, int preset);
+    void drain_locked(Standby& slot);
+    void release_locked(Standby& slot);
+    void update_wanted_locked();
+    // Col mutex preso: linearizza il ring e restituisce l'inizio del primo frame MPEG
+    size_t align_preroll_locked(Standby& slot);
+};
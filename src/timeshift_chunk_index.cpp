@@ -0,0 +1,142 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "timeshift_chunk_index.h"
+
+#include <esp_heap_caps.h>
+#include <new>
+
+#include "logger.h"
+
+TimeshiftChunkIndex::~TimeshiftChunkIndex() {
+    release();
+}
+
+bool TimeshiftChunkIndex::init(size_t capacity) {
+    if (capacity == 0) {
+        return false;
+    }
+    if (capacity != capacity_) {
+        release();
+        const size_t bytes = capacity * sizeof(Slot);
+        slots_ = static_cast<Slot*>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM));
+        if (!slots_) {
+            slots_ = static_cast<Slot*>(heap_caps_malloc(bytes, MALLOC_CAP_8BIT));
+        }
+        if (!slots_) {
+            LOG_ERROR("TimeshiftChunkIndex: cannot allocate %u slots (%u KB)", (unsigned)capacity,
+                      (unsigned)(bytes / 1024));
+            return false;
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            new (&slots_[i]) Slot();
+        }
+        capacity_ = capacity;
+    }
+    clear();
+    return true;
+}
+
+void TimeshiftChunkIndex::release() {
+    if (slots_) {
+        heap_caps_free(slots_);
+        slots_ = nullptr;
+    }
+    capacity_ = 0;
+    clear();
+}
+
+void TimeshiftChunkIndex::clear() {
+    head_ = 0;
+    count_ = 0;
+    pushed_ms_ = 0;
+    pushed_bytes_ = 0;
+}
+
+bool TimeshiftChunkIndex::push_back(const TimeshiftChunk& chunk) {
+    if (full() || (count_ > 0 && chunk.id <= back().id)) {
+        return false;
+    }
+    Slot& slot = slots_[physical(count_)];
+    slot.chunk = chunk;
+    slot.ms_before = pushed_ms_;
+    slot.bytes_before = pushed_bytes_;
+    pushed_ms_ += chunk.duration_ms;
+    pushed_bytes_ += chunk.length;
+    ++count_;
+    return true;
+}
+
+void TimeshiftChunkIndex::pop_front() {
+    if (count_ == 0) {
+        return;
+    }
+    head_ = physical(1);
+    --count_;
+    if (count_ == 0) {
+        clear();
+    }
+}
+
+size_t TimeshiftChunkIndex::index_of_id(uint32_t id) const {
+    if (count_ == 0 || id < front().id || id > back().id) {
+        return npos;
+    }
+    // Id contigui (caso normale): posizione = distanza dal più vecchio
+    const size_t guess = id - front().id;
+    if (guess < count_ && (*this)[guess].id == id) {
+        return guess;
+    }
+    size_t low = 0;
+    size_t high = count_;
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        const uint32_t mid_id = (*this)[mid].id;
+        if (mid_id == id) {
+            return mid;
+        }
+        if (mid_id < id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return npos;
+}
+
+size_t TimeshiftChunkIndex::index_of_offset(size_t offset) const {
+    size_t low = 0;
+    size_t high = count_;
+    size_t best = npos;
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if ((*this)[mid].start_offset > offset) {
+            high = mid;
+        } else {
+            best = mid;
+            low = mid + 1;
+        }
+    }
+    return best;
+}
+
+size_t TimeshiftChunkIndex::index_of_time(uint64_t ms) const {
+    if (ms >= total_duration_ms()) {
+        return npos;
+    }
+    // Ultimo chunk che inizia entro ms (i chunk senza durata vengono saltati)
+    size_t low = 0;
+    size_t high = count_;
+    size_t best = 0;
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (ms_before(mid) > ms) {
+            high = mid;
+        } else {
+            best = mid;
+            low = mid + 1;
+        }
+    }
+    return best;
+}
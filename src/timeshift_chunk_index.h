@@ -0,0 +1,131 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class TimeshiftChunkState {
+    PENDING,    // In scrittura su SD/PSRAM
+    READY,      // Completo e disponibile per playback
+    INVALID     // Errore di scrittura/validazione
+};
+
+// Descrittore POD di un chunk del timeshift: lo storage si ricava dall'id e dai campi
+// (regione nella ring SD o slab PSRAM), niente stringhe né allocazioni
+struct TimeshiftChunk {
+    uint32_t id = 0;
+    size_t start_offset = 0; // Offset globale di inizio
+    size_t end_offset = 0;   // Offset globale di fine
+    size_t length = 0;       // Lunghezza effettiva
+    bool on_sd = false;      // Regione nel file ring SD (SD_CARD mode)
+    uint32_t sd_offset = 0;  // Offset della regione nel file ring
+    uint8_t* psram_ptr = nullptr; // Used only in PSRAM_ONLY mode
+    TimeshiftChunkState state = TimeshiftChunkState::INVALID; // Non ancora scritto
+    uint32_t crc32 = 0;      // Per validazione (opzionale)
+
+    // Temporal information
+    uint32_t start_time_ms = 0;    // Timestamp inizio chunk (millisecondi)
+    uint32_t duration_ms = 0;      // Durata chunk in millisecondi
+    uint32_t total_frames = 0;     // Frame PCM totali nel chunk
+    uint64_t end_frames = 0;       // Frame PCM scansionati a fine chunk (journal)
+    bool export_marked_for_move = false; // Whether chunk file should be exported instead of deleted
+};
+
+// Indice dei chunk READY: ring a capacità fissa allocata una volta in init(), in ordine di
+// id (push in coda, eviction dalla testa in O(1)). Ogni slot tiene le somme prefisse di
+// durata e byte dei chunk inseriti prima, così durata totale e posizione relativa di un
+// chunk sono O(1), la ricerca per tempo o per offset è una binaria e quella per id è
+// aritmetica (id contigui; con un buco ricade sulla binaria).
+//
+// Durata e lunghezza di un chunk non vanno modificate dopo push_back(): le somme prefisse
+// non verrebbero aggiornate. Non thread-safe: lo protegge il mutex del manager.
+class TimeshiftChunkIndex {
+public:
+    static constexpr size_t npos = SIZE_MAX;
+
+    TimeshiftChunkIndex() = default;
+    ~TimeshiftChunkIndex();
+    TimeshiftChunkIndex(const TimeshiftChunkIndex&) = delete;
+    TimeshiftChunkIndex& operator=(const TimeshiftChunkIndex&) = delete;
+
+    // Alloca capacity slot (PSRAM se c'è); l'indice riparte vuoto
+    bool init(size_t capacity);
+    void release();
+    void clear();
+
+    size_t capacity() const { return capacity_; }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    bool full() const { return count_ == capacity_; }
+
+    // i = posizione logica, 0 = chunk più vecchio
+    TimeshiftChunk& operator[](size_t i) { return slots_[physical(i)].chunk; }
+    const TimeshiftChunk& operator[](size_t i) const { return slots_[physical(i)].chunk; }
+    TimeshiftChunk& front() { return (*this)[0]; }
+    const TimeshiftChunk& front() const { return (*this)[0]; }
+    TimeshiftChunk& back() { return (*this)[count_ - 1]; }
+    const TimeshiftChunk& back() const { return (*this)[count_ - 1]; }
+
+    // false se pieno o se l'id non è successivo all'ultimo
+    bool push_back(const TimeshiftChunk& chunk);
+    void pop_front();
+
+    size_t index_of_id(uint32_t id) const;
+    // Ultimo chunk con start_offset <= offset (npos se prima del primo)
+    size_t index_of_offset(size_t offset) const;
+    // Chunk che contiene l'istante ms dall'inizio del buffer (npos oltre la fine)
+    size_t index_of_time(uint64_t ms) const;
+
+    // Durata e byte dall'inizio del chunk più vecchio all'inizio del chunk i
+    uint64_t ms_before(size_t i) const { return slots_[physical(i)].ms_before - slots_[head_].ms_before; }
+    uint64_t bytes_before(size_t i) const { return slots_[physical(i)].bytes_before - slots_[head_].bytes_before; }
+    uint64_t total_duration_ms() const { return count_ ? pushed_ms_ - slots_[head_].ms_before : 0; }
+    uint64_t total_bytes() const { return count_ ? pushed_bytes_ - slots_[head_].bytes_before : 0; }
+
+    // Iterazione in ordine di id (range-for)
+    template <typename Index, typename Chunk>
+    class Iter {
+    public:
+        Iter(Index* index, size_t i) : index_(index), i_(i) {}
+        Chunk& operator*() const { return (*index_)[i_]; }
+        Chunk* operator->() const { return &(*index_)[i_]; }
+        Iter& operator++() {
+            ++i_;
+            return *this;
+        }
+        bool operator!=(const Iter& other) const { return i_ != other.i_; }
+
+    private:
+        Index* index_;
+        size_t i_;
+    };
+    typedef Iter<TimeshiftChunkIndex, TimeshiftChunk> iterator;
+    typedef Iter<const TimeshiftChunkIndex, const TimeshiftChunk> const_iterator;
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, count_); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count_); }
+
+private:
+    struct Slot {
+        TimeshiftChunk chunk;
+        uint64_t ms_before;      // Somma delle durate dei chunk inseriti prima (dal clear)
+        uint64_t bytes_before;   // Idem per le lunghezze
+    };
+
+    Slot* slots_ = nullptr;
+    size_t capacity_ = 0;
+    size_t head_ = 0;            // Slot del chunk più vecchio
+    size_t count_ = 0;
+    uint64_t pushed_ms_ = 0;     // Somme fino all'ultimo chunk inserito
+    uint64_t pushed_bytes_ = 0;
+
+    size_t physical(size_t i) const {
+        size_t p = head_ + i;
+        return p < capacity_ ? p : p - capacity_;
+    }
+};
@@ -0,0 +1,445 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#include "timeshift_journal.h"
+
+#include <Arduino.h>
+#include <cstring>
+#include <deque>
+
+#include "logger.h"
+
+namespace {
+
+constexpr uint32_t kHeaderMagic = 0x31484A54;   // "TJH1"
+constexpr uint32_t kTagChunk = 0x31434A54;      // "TJC1"
+constexpr uint32_t kTagEvict = 0x31454A54;      // "TJE1"
+constexpr uint32_t kTagParams = 0x31504A54;     // "TJP1"
+constexpr uint32_t kTagSeek = 0x31534A54;       // "TJS1"
+constexpr uint16_t kVersion = 1;
+constexpr size_t kReadBlock = 4096;
+constexpr size_t kMaxSeekPerChunk = 16;          // Entry per scrittura (buffer sullo stack del writer)
+
+struct __attribute__((packed)) HeaderRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t uri_hash;
+    uint32_t ring_capacity;
+    uint32_t check;
+};
+
+struct __attribute__((packed)) ChunkRecord {
+    uint32_t tag;
+    uint32_t id;
+    uint32_t start_offset;
+    uint32_t length;
+    uint32_t sd_offset;
+    uint32_t start_time_ms;
+    uint32_t duration_ms;
+    uint32_t total_frames;
+    uint64_t end_frames;
+    uint32_t check;
+};
+
+struct __attribute__((packed)) EvictRecord {
+    uint32_t tag;
+    uint32_t id;
+    uint32_t check;
+};
+
+struct __attribute__((packed)) ParamsRecord {
+    uint32_t tag;
+    uint32_t sample_rate;
+    uint32_t frames_per_entry;
+    uint32_t frame_quantum;
+    uint32_t check;
+};
+
+struct __attribute__((packed)) SeekRecord {
+    uint32_t tag;
+    uint64_t pcm_frame;
+    uint64_t byte_offset;
+    uint32_t check;
+};
+
+uint32_t fnv1a(const void* data, size_t len, uint32_t hash = 2166136261u) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Il checksum copre tutto il record tranne l'ultimo campo (check stesso)
+template <typename T>
+void seal(T& record) {
+    record.check = fnv1a(&record, sizeof(T) - sizeof(uint32_t));
+}
+
+template <typename T>
+bool intact(const T& record) {
+    return record.check == fnv1a(&record, sizeof(T) - sizeof(uint32_t));
+}
+
+ChunkRecord make_chunk_record(const TimeshiftJournal::Chunk& chunk) {
+    ChunkRecord rec;
+    rec.tag = kTagChunk;
+    rec.id = chunk.id;
+    rec.start_offset = chunk.start_offset;
+    rec.length = chunk.length;
+    rec.sd_offset = chunk.sd_offset;
+    rec.start_time_ms = chunk.start_time_ms;
+    rec.duration_ms = chunk.duration_ms;
+    rec.total_frames = chunk.total_frames;
+    rec.end_frames = chunk.end_frames;
+    seal(rec);
+    return rec;
+}
+
+SeekRecord make_seek_record(const TimeshiftJournal::SeekPoint& point) {
+    SeekRecord rec;
+    rec.tag = kTagSeek;
+    rec.pcm_frame = point.pcm_frame;
+    rec.byte_offset = point.byte_offset;
+    seal(rec);
+    return rec;
+}
+
+// Lettura sequenziale a blocchi: un record alla volta senza una read() su SD per record
+class BlockReader {
+public:
+    explicit BlockReader(File& file) : file_(file), buf_(kReadBlock) {}
+
+    bool read(void* dest, size_t len) {
+        uint8_t* out = static_cast<uint8_t*>(dest);
+        while (len > 0) {
+            if (pos_ == fill_) {
+                fill_ = file_.read(buf_.data(), buf_.size());
+                pos_ = 0;
+                if (fill_ == 0) {
+                    return false;
+                }
+            }
+            size_t n = fill_ - pos_ < len ? fill_ - pos_ : len;
+            memcpy(out, buf_.data() + pos_, n);
+            pos_ += n;
+            out += n;
+            len -= n;
+        }
+        return true;
+    }
+
+private:
+    File& file_;
+    std::vector<uint8_t> buf_;
+    size_t fill_ = 0;
+    size_t pos_ = 0;
+};
+
+// Legge il resto di un record di cui è già stato letto il tag
+template <typename T>
+bool read_record(BlockReader& reader, uint32_t tag, T& out) {
+    out.tag = tag;
+    return reader.read(reinterpret_cast<uint8_t*>(&out) + sizeof(uint32_t), sizeof(T) - sizeof(uint32_t)) &&
+           intact(out);
+}
+
+} // namespace
+
+TimeshiftJournal::~TimeshiftJournal() {
+    close();
+    if (lock_) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+}
+
+bool TimeshiftJournal::ensure_lock() {
+    if (!lock_) {
+        lock_ = xSemaphoreCreateMutex();
+    }
+    return lock_ != nullptr;
+}
+
+uint32_t TimeshiftJournal::hash_uri(const char* uri) {
+    return uri ? fnv1a(uri, strlen(uri)) : 0;
+}
+
+bool TimeshiftJournal::load(fs::FS& fs, const char* path, State& out) {
+    out = State();
+    if (!fs.exists(path)) {
+        return false;
+    }
+    File f = fs.open(path, FILE_READ);
+    if (!f) {
+        return false;
+    }
+
+    uint32_t start_ms = millis();
+    BlockReader reader(f);
+    HeaderRecord hdr;
+    if (!reader.read(&hdr, sizeof(hdr)) || hdr.magic != kHeaderMagic || hdr.version != kVersion ||
+        hdr.header_size != sizeof(hdr) || !intact(hdr)) {
+        f.close();
+        LOG_WARN("Timeshift journal %s incompatible, ignoring it", path);
+        return false;
+    }
+    out.uri_hash = hdr.uri_hash;
+    out.ring_capacity = hdr.ring_capacity;
+    out.saved_at = (uint32_t)f.getLastWrite();
+
+    std::deque<Chunk> live;
+    size_t records = 0;
+    bool torn = false;
+    uint32_t tag = 0;
+    while (reader.read(&tag, sizeof(tag))) {
+        bool ok = false;
+        if (tag == kTagChunk) {
+            ChunkRecord rec;
+            ok = read_record(reader, tag, rec);
+            if (ok) {
+                Chunk chunk = {rec.id, rec.start_offset, rec.length, rec.sd_offset,
+                               rec.start_time_ms, rec.duration_ms, rec.total_frames, rec.end_frames};
+                live.push_back(chunk);
+            }
+        } else if (tag == kTagEvict) {
+            EvictRecord rec;
+            ok = read_record(reader, tag, rec);
+            // Le eviction arrivano quasi sempre dalla coda: la ricerca si ferma subito
+            for (auto it = live.begin(); ok && it != live.end(); ++it) {
+                if (it->id == rec.id) {
+                    live.erase(it);
+                    break;
+                }
+            }
+        } else if (tag == kTagParams) {
+            ParamsRecord rec;
+            ok = read_record(reader, tag, rec);
+            if (ok) {
+                out.sample_rate = rec.sample_rate;
+                out.frames_per_entry = rec.frames_per_entry;
+                out.frame_quantum = rec.frame_quantum;
+            }
+        } else if (tag == kTagSeek) {
+            SeekRecord rec;
+            ok = read_record(reader, tag, rec);
+            if (ok && (out.seek.empty() || (rec.pcm_frame > out.seek.back().pcm_frame &&
+                                            rec.byte_offset > out.seek.back().byte_offset))) {
+                SeekPoint point = {rec.pcm_frame, rec.byte_offset};
+                out.seek.push_back(point);
+            }
+        }
+        if (!ok) {
+            // Record troncato da un reset durante l'append (o coda illeggibile): ci si ferma qui
+            torn = true;
+            break;
+        }
+        ++records;
+    }
+    f.close();
+
+    out.chunks.assign(live.begin(), live.end());
+    // Tiene solo le entry della seek table dentro i chunk vivi: sotto il più vecchio sono
+    // state recuperate, oltre l'ultimo sono orfane di un record chunk troncato
+    if (!out.chunks.empty()) {
+        uint64_t oldest = out.chunks.front().start_offset;
+        uint64_t newest_end = 0;
+        for (const Chunk& chunk : out.chunks) {
+            oldest = chunk.start_offset < oldest ? chunk.start_offset : oldest;
+            const uint64_t end = (uint64_t)chunk.start_offset + chunk.length;
+            newest_end = end > newest_end ? end : newest_end;
+        }
+        size_t drop = 0;
+        while (drop < out.seek.size() && out.seek[drop].byte_offset < oldest) {
+            ++drop;
+        }
+        out.seek.erase(out.seek.begin(), out.seek.begin() + drop);
+        while (!out.seek.empty() && out.seek.back().byte_offset >= newest_end) {
+            out.seek.pop_back();
+        }
+    } else {
+        out.seek.clear();
+    }
+
+    LOG_INFO("Timeshift journal replayed: %u records, %u live chunks, %u seek entries in %u ms%s",
+             (unsigned)records, (unsigned)out.chunks.size(), (unsigned)out.seek.size(),
+             (unsigned)(millis() - start_ms), torn ? " (torn tail dropped)" : "");
+    return true;
+}
+
+bool TimeshiftJournal::start(fs::FS& fs, const char* path, const State& state) {
+    close();
+    if (!ensure_lock()) {
+        return false;
+    }
+
+    std::string tmp_path = std::string(path) + ".tmp";
+    File f = fs.open(tmp_path.c_str(), FILE_WRITE);
+    if (!f) {
+        LOG_WARN("Timeshift journal: cannot open %s", tmp_path.c_str());
+        return false;
+    }
+
+    HeaderRecord hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = kHeaderMagic;
+    hdr.version = kVersion;
+    hdr.header_size = sizeof(hdr);
+    hdr.uri_hash = state.uri_hash;
+    hdr.ring_capacity = state.ring_capacity;
+    seal(hdr);
+    size_t bytes = sizeof(hdr);
+    bool ok = f.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr);
+
+    if (ok && state.sample_rate > 0) {
+        ParamsRecord params = {kTagParams, state.sample_rate, state.frames_per_entry, state.frame_quantum, 0};
+        seal(params);
+        ok = f.write(reinterpret_cast<const uint8_t*>(&params), sizeof(params)) == sizeof(params);
+        bytes += sizeof(params);
+    }
+    for (size_t i = 0; ok && i < state.chunks.size(); ++i) {
+        ChunkRecord rec = make_chunk_record(state.chunks[i]);
+        ok = f.write(reinterpret_cast<const uint8_t*>(&rec), sizeof(rec)) == sizeof(rec);
+        bytes += sizeof(rec);
+    }
+    for (size_t i = 0; ok && i < state.seek.size(); ++i) {
+        SeekRecord rec = make_seek_record(state.seek[i]);
+        ok = f.write(reinterpret_cast<const uint8_t*>(&rec), sizeof(rec)) == sizeof(rec);
+        bytes += sizeof(rec);
+    }
+    f.close();
+
+    if (!ok) {
+        LOG_WARN("Timeshift journal: write failed for %s", tmp_path.c_str());
+        fs.remove(tmp_path.c_str());
+        return false;
+    }
+    if (fs.exists(path)) {
+        fs.remove(path);
+    }
+    if (!fs.rename(tmp_path.c_str(), path)) {
+        fs.remove(tmp_path.c_str());
+        LOG_WARN("Timeshift journal: cannot rename %s", tmp_path.c_str());
+        return false;
+    }
+
+    File appender = fs.open(path, FILE_APPEND);
+    if (!appender) {
+        LOG_WARN("Timeshift journal: cannot reopen %s", path);
+        return false;
+    }
+
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    fs_ = &fs;
+    path_ = path;
+    file_ = appender;
+    open_ = true;
+    seek_params_ = state.sample_rate > 0;
+    bytes_ = bytes;
+    xSemaphoreGive(lock_);
+
+    LOG_DEBUG("Timeshift journal started: %s (%u chunks, %u seek entries, %u bytes)", path,
+              (unsigned)state.chunks.size(), (unsigned)state.seek.size(), (unsigned)bytes);
+    return true;
+}
+
+void TimeshiftJournal::close() {
+    if (!lock_) {
+        return;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (file_) {
+        file_.close();
+    }
+    file_ = File();
+    open_ = false;
+    seek_params_ = false;
+    bytes_ = 0;
+    xSemaphoreGive(lock_);
+}
+
+void TimeshiftJournal::discard() {
+    fs::FS* fs = fs_;
+    std::string path = path_;
+    close();
+    if (fs && !path.empty() && fs->exists(path.c_str())) {
+        fs->remove(path.c_str());
+    }
+    fs_ = nullptr;
+    path_.clear();
+}
+
+bool TimeshiftJournal::write_locked(const uint8_t* data, size_t len) {
+    if (!open_ || !file_) {
+        return false;
+    }
+    if (file_.write(data, len) != len) {
+        // Journal inaffidabile da qui in poi: meglio smettere e ripartire da zero al riavvio
+        LOG_WARN("Timeshift journal: append failed, journaling disabled for this session");
+        file_.close();
+        file_ = File();
+        open_ = false;
+        if (fs_) {
+            fs_->remove(path_.c_str());
+        }
+        return false;
+    }
+    file_.flush();
+    bytes_ += len;
+    return true;
+}
+
+bool TimeshiftJournal::append_chunk(const Chunk& chunk, const SeekPoint* points, size_t count) {
+    if (!lock_) {
+        return false;
+    }
+    // Entry prima del chunk: se il record del chunk si tronca, le entry orfane sono innocue
+    uint8_t buf[kMaxSeekPerChunk * sizeof(SeekRecord) + sizeof(ChunkRecord)];
+    bool ok = true;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    size_t done = 0;
+    do {
+        size_t len = 0;
+        for (; done < count && len + sizeof(SeekRecord) <= kMaxSeekPerChunk * sizeof(SeekRecord); ++done) {
+            SeekRecord rec = make_seek_record(points[done]);
+            memcpy(buf + len, &rec, sizeof(rec));
+            len += sizeof(rec);
+        }
+        if (done == count) {
+            ChunkRecord rec = make_chunk_record(chunk);
+            memcpy(buf + len, &rec, sizeof(rec));
+            len += sizeof(rec);
+        }
+        ok = write_locked(buf, len);
+    } while (ok && done < count);
+    xSemaphoreGive(lock_);
+    return ok;
+}
+
+bool TimeshiftJournal::append_seek_params(uint32_t sample_rate, uint32_t frames_per_entry, uint32_t frame_quantum) {
+    if (!lock_) {
+        return false;
+    }
+    ParamsRecord rec = {kTagParams, sample_rate, frames_per_entry, frame_quantum, 0};
+    seal(rec);
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const bool ok = write_locked(reinterpret_cast<const uint8_t*>(&rec), sizeof(rec));
+    seek_params_ = seek_params_ || ok;
+    xSemaphoreGive(lock_);
+    return ok;
+}
+
+bool TimeshiftJournal::append_evict(uint32_t id) {
+    if (!lock_) {
+        return false;
+    }
+    EvictRecord rec = {kTagEvict, id, 0};
+    seal(rec);
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const bool ok = write_locked(reinterpret_cast<const uint8_t*>(&rec), sizeof(rec));
+    xSemaphoreGive(lock_);
+    return ok;
+}
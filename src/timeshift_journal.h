@@ -0,0 +1,94 @@
+// Copyright (c) 2025 rederyk
+// Licensed under the MIT License. See LICENSE file for details.
+
+
+#pragma once
+
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Journal append-only dell'indice del timeshift su SD (accanto al file ring). Registra
+// ogni chunk promosso nella ring (con le entry della seek table che copre) e ogni regione
+// liberata; all'open() della stessa stazione il replay ricostruisce chunk READY e seek
+// table senza rileggere l'audio, in tempo proporzionale ai chunk vivi.
+//
+// Ogni record è una struct packed con tag e checksum FNV-1a: il replay si ferma al primo
+// record troncato o corrotto (scrittura interrotta da un reset), tenendo tutto quello che
+// precede. start() riscrive il journal compattato (file temporaneo + rename) con solo lo
+// stato vivo, così non cresce oltre il necessario.
+//
+// Ordine di scrittura per la crash-safety: i dati del chunk sono su SD prima del record
+// del chunk, il record di eviction è su SD prima che la regione venga riusata.
+//
+// Thread-safe: un mutex interno serializza gli append.
+class TimeshiftJournal {
+public:
+    struct Chunk {
+        uint32_t id;
+        uint32_t start_offset;
+        uint32_t length;
+        uint32_t sd_offset;
+        uint32_t start_time_ms;
+        uint32_t duration_ms;
+        uint32_t total_frames;
+        uint64_t end_frames;      // Frame scansionati a fine chunk (seek table)
+    };
+
+    struct SeekPoint {
+        uint64_t pcm_frame;
+        uint64_t byte_offset;
+    };
+
+    struct State {
+        uint32_t uri_hash = 0;
+        uint32_t ring_capacity = 0;
+        uint32_t sample_rate = 0;          // Parametri della seek table (0 = non ancora noti)
+        uint32_t frames_per_entry = 0;
+        uint32_t frame_quantum = 0;
+        uint32_t saved_at = 0;             // Ultima scrittura del file (epoch s, dall'orologio della SD)
+        std::vector<Chunk> chunks;         // Vivi, in ordine di allocazione nella ring
+        std::vector<SeekPoint> seek;       // Crescenti
+    };
+
+    TimeshiftJournal() = default;
+    ~TimeshiftJournal();
+    TimeshiftJournal(const TimeshiftJournal&) = delete;
+    TimeshiftJournal& operator=(const TimeshiftJournal&) = delete;
+
+    static uint32_t hash_uri(const char* uri);
+
+    // Replay: false se il journal manca o l'header non è valido
+    static bool load(fs::FS& fs, const char* path, State& out);
+
+    // Riscrive il journal con lo stato dato e lo lascia aperto per gli append
+    bool start(fs::FS& fs, const char* path, const State& state);
+    // Chiude lasciando il file (replay alla prossima open)
+    void close();
+    // Chiude e cancella il file (storia non più valida, es. passaggio a PSRAM)
+    void discard();
+    bool is_open() const { return open_; }
+    size_t size_bytes() const { return bytes_; }
+    bool has_seek_params() const { return seek_params_; }
+
+    // Chunk e le sue entry della seek table in una sola scrittura + flush
+    bool append_chunk(const Chunk& chunk, const SeekPoint* points, size_t count);
+    bool append_seek_params(uint32_t sample_rate, uint32_t frames_per_entry, uint32_t frame_quantum);
+    bool append_evict(uint32_t id);
+
+private:
+    mutable SemaphoreHandle_t lock_ = nullptr;
+    fs::FS* fs_ = nullptr;
+    std::string path_;
+    fs::File file_;
+    bool open_ = false;
+    bool seek_params_ = false;
+    size_t bytes_ = 0;
+
+    bool write_locked(const uint8_t* data, size_t len);
+    bool ensure_lock();
+};
@@ -9,9 +9,11 @@
 #include <WiFi.h>
 #include <esp_heap_caps.h> // For PSRAM allocation
 #include "mp3_seek_table.h"
+#include "recording_hub.h"
 
 #include <algorithm>
 #include <cstdlib>
+#include <ctime>
 
 // ========== ADAPTIVE BUFFER CONFIGURATION ==========
 // Cleanup window
@@ -21,13 +23,31 @@ constexpr const char *TIMESHIFT_ROOT = "/timeshift";
 constexpr const char *EXPORTED_CHUNK_PREFIX = "/timeshift/exportedChunk";
 constexpr const char *EXPORTED_CHUNK_FILENAME = "chunk.bin";
 
+// File ring SD: finestra massima + margine per i chunk in volo e i buchi di allineamento,
+// limitato a una frazione dello spazio libero
+constexpr const char *SD_RING_FILENAME = "ring.bin";
+constexpr const char *SD_RING_PATH = "/timeshift/ring.bin";
+constexpr size_t SD_RING_SLACK_BYTES = 8 * 1024 * 1024;
+constexpr size_t SD_RING_MIN_BYTES = 4 * 1024 * 1024;
+constexpr uint32_t SD_RING_FREE_PERCENT = 90;
+
+// Journal dell'indice accanto alla ring: compattato quando supera la soglia
+constexpr const char *SD_JOURNAL_FILENAME = "journal.bin";
+constexpr const char *SD_JOURNAL_PATH = "/timeshift/journal.bin";
+constexpr size_t SD_JOURNAL_COMPACT_BYTES = 1024 * 1024;
+// Sotto questa epoch (2021-01-01) l'orologio non è stato impostato: età del journal ignota
+constexpr time_t kClockValidEpoch = 1609459200;
+
 // Default bitrate assumption (will be auto-detected from stream)
 constexpr uint32_t DEFAULT_BITRATE_KBPS = 320;
 
 TimeshiftManager::TimeshiftManager()
 {
     mutex_ = xSemaphoreCreateMutex();
+    events_ = xEventGroupCreate();
     is_auto_paused_ = false;
+    sd_ring_path_ = SD_RING_PATH;
+    sd_journal_path_ = SD_JOURNAL_PATH;
     // Initialize with default bitrate, will be adapted after first chunk
     calculate_adaptive_sizes(DEFAULT_BITRATE_KBPS);
 }
@@ -36,13 +56,15 @@ TimeshiftManager::~TimeshiftManager()
 {
     stop();
     close();
+    if (hub_)
+        hub_->unregister_recorder(this);
     if (mutex_)
         vSemaphoreDelete(mutex_);
-    if (recording_buffer_)
-        free(recording_buffer_);
+    if (events_)
+        vEventGroupDelete(events_);
     if (playback_buffer_)
         free(playback_buffer_);
-    free_psram_pool();
+    slab_pool_.release_all();
 }
 
 // ========== ADAPTIVE BITRATE DETECTION ==========
@@ -77,24 +99,21 @@ void TimeshiftManager::calculate_adaptive_sizes(uint32_t bitrate_kbps)
     uint32_t target_duration_sec = get_dynamic_chunk_duration_sec(bitrate_kbps);
     uint32_t target_chunk_bytes = (bitrate_kbps * 1000 / 8) * target_duration_sec;
 
-    // Clamp to reasonable limits (16KB - 512KB)
-    const size_t MIN_CHUNK_SIZE = 32 * 1024;               // 16KB minimum
+    // Clamp to reasonable limits (32KB - 512KB)
+    const size_t MIN_CHUNK_SIZE = MIN_DYNAMIC_CHUNK_BYTES; // 32KB minimum
     const size_t MAX_CHUNK_SIZE = MAX_DYNAMIC_CHUNK_BYTES; // 512KB maximum
 
     dynamic_chunk_size_ = std::max(MIN_CHUNK_SIZE,
                                    std::min(MAX_CHUNK_SIZE, (size_t)target_chunk_bytes));
 
-    // If a PSRAM pool is already allocated, clamp to the slot size to avoid overruns
-    if (psram_slot_size_ > 0 && dynamic_chunk_size_ > psram_slot_size_)
+    // Slab già allocati: il chunk non può superarne la dimensione (registrazione e slot PSRAM)
+    if (slab_pool_.total() > 0 && dynamic_chunk_size_ > slab_pool_.slab_bytes())
     {
-        dynamic_chunk_size_ = psram_slot_size_;
-        LOG_WARN("Adaptive chunk size clamped to PSRAM slot size (%u KB)",
-                 (unsigned)(psram_slot_size_ / 1024));
+        dynamic_chunk_size_ = slab_pool_.slab_bytes();
+        LOG_WARN("Adaptive chunk size clamped to slab size (%u KB)",
+                 (unsigned)(slab_pool_.slab_bytes() / 1024));
     }
 
-    // Recording buffer: 1.5x chunk size (50% safety margin)
-    dynamic_buffer_size_ = dynamic_chunk_size_ + (dynamic_chunk_size_ / 2);
-
     // Playback buffer: 3x chunk size (current + next + safety)
     dynamic_playback_buffer_size_ = dynamic_chunk_size_ * 3;
 
@@ -121,10 +140,9 @@ void TimeshiftManager::calculate_adaptive_sizes(uint32_t bitrate_kbps)
 
     detected_bitrate_kbps_ = bitrate_kbps;
 
-    LOG_INFO("Adaptive sizing for %u kbps (chunk duration %u s): chunk=%u KB, buffer=%u KB, playback=%u KB, download=%u B",
+    LOG_INFO("Adaptive sizing for %u kbps (chunk duration %u s): chunk=%u KB, playback=%u KB, download=%u B",
              bitrate_kbps, target_duration_sec,
              (unsigned)(dynamic_chunk_size_ / 1024),
-             (unsigned)(dynamic_buffer_size_ / 1024),
              (unsigned)(dynamic_playback_buffer_size_ / 1024),
              (unsigned)dynamic_download_chunk_);
 }
@@ -194,8 +212,12 @@ bool TimeshiftManager::open(const char *uri)
     uri_ = uri;
     is_open_ = true;
     current_recording_offset_ = 0;
+    download_head_.store(0);
+    head_duration_ms_.store(0);
     current_read_offset_ = 0;
-    rec_write_head_ = 0;
+    session_start_offset_ = 0;
+    session_start_frames_ = 0;
+    recording_slab_ = nullptr;
     bytes_in_current_chunk_ = 0;
     next_chunk_id_ = 0;
     current_playback_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
@@ -205,6 +227,8 @@ bool TimeshiftManager::open(const char *uri)
     pause_download_ = false;
     is_auto_paused_ = false;
     playback_stop_requested_ = false;
+    reading_live_head_ = false;
+    xEventGroupClearBits(events_, EVT_STOP | EVT_CHUNK_READY | EVT_PRELOAD | EVT_LIVE_DATA);
     backend_switch_in_progress_ = false;
     seek_blocked_for_switch_ = false;
     background_migration_in_progress_ = false;
@@ -218,7 +242,8 @@ bool TimeshiftManager::open(const char *uri)
     switch_cache_cur_len_ = 0;
     switch_cache_next_start_ = 0;
     switch_cache_next_len_ = 0;
-    cumulative_time_ms_ = 0; // Reset temporal tracking
+    chunk_start_frames_ = 0; // Reset temporal tracking
+    seek_table_.begin(0, 0); // Rate e passo delle entry dal primo header dello stream
 
     // Reset bitrate tracking so each stream starts from the default assumption
     bitrate_history_.clear();
@@ -227,49 +252,66 @@ bool TimeshiftManager::open(const char *uri)
     bitrate_adapted_once_ = false;
     calculate_adaptive_sizes(DEFAULT_BITRATE_KBPS);
 
+    // Indice dei chunk READY: tanti slot quanti chunk minimi stanno nella finestra, più
+    // quelli in volo. Allocato una volta (riusato dalle open successive)
+    if (!ready_chunks_.init(MAX_TS_WINDOW / MIN_DYNAMIC_CHUNK_BYTES + SLABS_IN_FLIGHT))
+    {
+        close();
+        return false;
+    }
+
+    // Slab per download e writer: dimensionati sul chunk iniziale, che da qui in poi
+    // calculate_adaptive_sizes() non supera più
+    if (!init_slab_pool())
+    {
+        close();
+        return false;
+    }
+
     // Initialize storage backend based on current mode
     if (storage_mode_ == StorageMode::SD_CARD)
     {
         cleanup_timeshift_directory();
-        LOG_INFO("Timeshift mode: SD_CARD");
+        if (!init_sd_ring())
+        {
+            close();
+            return false;
+        }
+        // Stessa stazione dopo un riavvio: la storia nella ring riparte dal journal
+        bool restored = restore_from_journal();
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        start_journal();
+        xSemaphoreGive(mutex_);
+        LOG_INFO("Timeshift mode: SD_CARD (ring %u MB%s)", (unsigned)(sd_ring_.capacity() / (1024 * 1024)),
+                 restored ? ", history restored" : "");
     }
     else
     {
-        // PSRAM mode: allocate chunk pool
+        // PSRAM mode: i chunk READY tengono i propri slab
         if (!init_psram_pool())
         {
             LOG_ERROR("Failed to initialize PSRAM pool");
             close();
             return false;
         }
-        LOG_INFO("Timeshift mode: PSRAM_ONLY (~%u MB target pool, chunk %u KB, slots %u)",
-                 (unsigned)MAX_PSRAM_POOL_MB,
+        LOG_INFO("Timeshift mode: PSRAM_ONLY (~%u KB target pool, chunk %u KB, slots %u)",
+                 (unsigned)(psram_pool_target_bytes() / 1024),
                  (unsigned)(dynamic_chunk_size_ / 1024),
                  (unsigned)psram_pool_slots_);
     }
 
-    recording_buffer_capacity_ = MAX_RECORDING_BUFFER_CAPACITY;
-    recording_buffer_ = (uint8_t *)malloc(recording_buffer_capacity_);
-    if (!recording_buffer_)
-    {
-        LOG_ERROR("Failed to allocate recording buffer (%u KB)", (unsigned)(recording_buffer_capacity_ / 1024));
-        close();
-        return false;
-    }
-
     playback_buffer_capacity_ = MAX_PLAYBACK_BUFFER_CAPACITY;
     playback_buffer_ = (uint8_t *)malloc(playback_buffer_capacity_);
     if (!playback_buffer_)
     {
         LOG_ERROR("Failed to allocate playback buffer (%u KB)", (unsigned)(playback_buffer_capacity_ / 1024));
-        free(recording_buffer_);
-        recording_buffer_ = nullptr;
         close();
         return false;
     }
 
-    LOG_INFO("Timeshift buffers allocated: rec=%uKB, play=%uKB (adaptive for %u kbps)",
-             (unsigned)(dynamic_buffer_size_ / 1024),
+    LOG_INFO("Timeshift buffers allocated: slabs=%ux%uKB, play=%uKB (adaptive for %u kbps)",
+             (unsigned)slab_pool_.total(),
+             (unsigned)(slab_pool_.slab_bytes() / 1024),
              (unsigned)(dynamic_playback_buffer_size_ / 1024),
              detected_bitrate_kbps_);
     return true;
@@ -279,41 +321,29 @@ void TimeshiftManager::close()
 {
     stop();
     playback_stop_requested_ = false;
+    xEventGroupClearBits(events_, EVT_STOP);
 
-    // Clean up all chunks based on storage mode
-    if (storage_mode_ == StorageMode::SD_CARD)
-    {
-        for (const auto &chunk : pending_chunks_)
-        {
-            SD_MMC.remove(chunk.filename.c_str());
-        }
-        for (const auto &chunk : ready_chunks_)
-        {
-            SD_MMC.remove(chunk.filename.c_str());
-        }
-    }
-    else
-    {
-        // PSRAM mode: pool will be freed, no per-chunk cleanup needed
-    }
+    // Le regioni SD spariscono dall'indice in memoria ma restano nel journal: ring e
+    // journal restano su SD e la prossima open() della stessa URI riprende la storia.
+    // Gli slab PSRAM spariscono con il pool
+    journal_.close();
+    sd_ring_.close();
 
     pending_chunks_.clear();
     ready_chunks_.clear();
 
-    if (recording_buffer_)
-    {
-        free(recording_buffer_);
-        recording_buffer_ = nullptr;
-    }
-
     if (playback_buffer_)
     {
         free(playback_buffer_);
         playback_buffer_ = nullptr;
     }
 
-    // Free PSRAM pool if allocated
-    free_psram_pool();
+    // Task fermi: nessuno slab in volo, si libera tutto il pool
+    recording_slab_ = nullptr;
+    bytes_in_current_chunk_ = 0;
+    slab_pool_.release_all();
+    psram_pool_slots_ = 0;
+    psram_pool_size_ = 0;
     backend_switch_in_progress_ = false;
     seek_blocked_for_switch_ = false;
     background_migration_in_progress_ = false;
@@ -322,10 +352,105 @@ void TimeshiftManager::close()
     using_switch_cache_ = false;
     switch_cache_.clear();
 
+    // Connessione adottata e mai avviata, o già chiusa dal download task
+    adopted_http_.reset();
+    free_preroll();
+
     is_open_ = false;
     seek_table_.clear();
 }
 
+bool TimeshiftManager::adopt_stream(std::unique_ptr<HTTPClient> http, const uint8_t *preroll, size_t preroll_len)
+{
+    if (!is_open_ || is_running_ || !http)
+    {
+        LOG_WARN("TimeshiftManager::adopt_stream() - needs an open, not yet started manager");
+        return false;
+    }
+
+    free_preroll();
+    if (preroll && preroll_len > 0)
+    {
+        preroll_buf_ = (uint8_t *)heap_caps_malloc(preroll_len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (preroll_buf_)
+        {
+            memcpy(preroll_buf_, preroll, preroll_len);
+            preroll_len_ = preroll_len;
+        }
+        else
+        {
+            LOG_WARN("No PSRAM for %u bytes of pre-roll, starting from the live edge", (unsigned)preroll_len);
+        }
+    }
+    adopted_http_ = std::move(http);
+    LOG_INFO("Adopted standby connection for %s (%u bytes of pre-roll)", uri_.c_str(), (unsigned)preroll_len_);
+    return true;
+}
+
+bool TimeshiftManager::set_recording_hub(RecordingHub *hub)
+{
+    if (is_open_)
+    {
+        LOG_WARN("TimeshiftManager::set_recording_hub() - only before open()");
+        return false;
+    }
+    if (hub_ == hub)
+    {
+        return true;
+    }
+    if (hub_)
+    {
+        hub_->unregister_recorder(this);
+        hub_ = nullptr;
+    }
+    sd_ring_path_ = SD_RING_PATH;
+    sd_journal_path_ = SD_JOURNAL_PATH;
+    if (!hub)
+    {
+        return true;
+    }
+
+    int slot = hub->register_recorder(this);
+    if (slot < 0)
+    {
+        return false;
+    }
+    hub_ = hub;
+    if (slot > 0)
+    {
+        // Ogni registrazione ha la propria ring e il proprio journal (preservati dal cleanup)
+        sd_ring_path_ = std::string(TIMESHIFT_ROOT) + "/rec" + std::to_string(slot) + "-" + SD_RING_FILENAME;
+        sd_journal_path_ = std::string(TIMESHIFT_ROOT) + "/rec" + std::to_string(slot) + "-" + SD_JOURNAL_FILENAME;
+    }
+    return true;
+}
+
+void TimeshiftManager::attach_reader()
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    playback_stop_requested_ = false;
+    xEventGroupClearBits(events_, EVT_STOP);
+    // Il nuovo reader parte dall'inizio della finestra: playback buffer e preload da rifare
+    current_read_offset_ = read_start_offset();
+    reading_live_head_ = false;
+    current_playback_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
+    playback_chunk_loaded_size_ = 0;
+    last_preload_check_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
+    preloaded_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
+    xSemaphoreGive(mutex_);
+}
+
+void TimeshiftManager::free_preroll()
+{
+    if (preroll_buf_)
+    {
+        heap_caps_free(preroll_buf_);
+        preroll_buf_ = nullptr;
+    }
+    preroll_len_ = 0;
+    preroll_pos_ = 0;
+}
+
 bool TimeshiftManager::start()
 {
     if (!is_open_ || is_running_)
@@ -335,10 +460,9 @@ bool TimeshiftManager::start()
     }
 
     // Create queue for chunk write jobs (depth 3 to smooth SD latency)
-    const UBaseType_t kQueueDepth = 3;
     if (!write_queue_)
     {
-        write_queue_ = xQueueCreate(kQueueDepth, sizeof(ChunkJob));
+        write_queue_ = xQueueCreate(WRITE_QUEUE_DEPTH, sizeof(ChunkJob));
         if (!write_queue_)
         {
             LOG_ERROR("Failed to create chunk write queue");
@@ -347,6 +471,12 @@ bool TimeshiftManager::start()
     }
 
     is_running_ = true;
+    xEventGroupClearBits(events_, EVT_STOP | EVT_PRELOAD);
+    start_at_ms_ = millis();
+    connect_ms_.store(0);
+    first_byte_ms_.store(0);
+    first_read_ms_.store(0);
+    first_read_live_ = false;
     // CRITICAL FIX: Increased stack from 8KB to 24KB to prevent stack overflow
     // HTTPClient + WiFiClient + TLS + local buffers need substantial stack space
     BaseType_t result = xTaskCreate(download_task_trampoline, "ts_download", 24576, this, 5, &download_task_handle_);
@@ -360,8 +490,16 @@ bool TimeshiftManager::start()
     }
     LOG_INFO("TimeshiftManager download task created successfully");
 
-    // Chunk writer task decouples network reads from storage writes
-    result = xTaskCreate(writer_task_trampoline, "ts_writer", 12288, this, 4, &writer_task_handle_);
+    // Chunk writer task decouples network reads from storage writes. Con l'hub la coda la
+    // serve il suo writer condiviso
+    if (hub_)
+    {
+        result = hub_->attach(this) ? pdPASS : pdFAIL;
+    }
+    else
+    {
+        result = xTaskCreate(writer_task_trampoline, "ts_writer", 12288, this, 4, &writer_task_handle_);
+    }
     if (result != pdPASS)
     {
         LOG_ERROR("Failed to create writer task");
@@ -389,6 +527,13 @@ void TimeshiftManager::stop()
     // Always request a shutdown so tasks can exit cleanly
     playback_stop_requested_ = true;
     is_running_ = false;
+    signal_events(EVT_STOP | EVT_PRELOAD);
+    if (write_queue_ && !hub_)
+    {
+        // Job vuoto: sveglia il writer fermo in xQueueReceive senza aspettarne il timeout
+        ChunkJob wake{};
+        xQueueSend(write_queue_, &wake, 0);
+    }
     backend_switch_in_progress_ = false;
     seek_blocked_for_switch_ = false;
     background_migration_in_progress_ = false;
@@ -422,18 +567,20 @@ void TimeshiftManager::stop()
     // Tasks clear their handles when exiting; wait for them before deleting resources.
     wait_for_task(download_task_handle_, "Download");
     wait_for_task(writer_task_handle_, "Writer");
+    if (hub_)
+    {
+        // Il writer condiviso finisce i chunk in coda come farebbe il writer proprio
+        hub_->detach(this, 2000);
+    }
     wait_for_task(preloader_task_handle_, "Preloader");
 
-    // Drain and destroy queue (free any pending buffers)
+    // Drain and destroy queue (return pending slabs to the pool)
     if (write_queue_)
     {
         ChunkJob job;
         while (xQueueReceive(write_queue_, &job, 0) == pdTRUE)
         {
-            if (job.data)
-            {
-                free(job.data);
-            }
+            slab_pool_.release(job.data);
         }
         vQueueDelete(write_queue_);
         write_queue_ = nullptr;
@@ -449,30 +596,34 @@ size_t TimeshiftManager::read(void *buffer, size_t size)
 
     // --- ROBUSTO BUFFERING INIZIALE ---
     // Causa #5 & #6: Forziamo l'attesa di un buffer sano all'avvio.
-    // Questo si applica solo alla primissima chiamata a read().
-    if (current_read_offset_ == 0)
+    // Questo si applica solo alla primissima chiamata a read(). Con il live head si legge
+    // subito dal chunk in registrazione
+    if (current_read_offset_ == 0 && !live_head_enabled_)
     {
         const size_t MIN_CHUNKS_FOR_START = 2;
         const uint32_t MAX_WAIT_MS = 15000; // Aumentato a 15s per sicurezza
         uint32_t start_wait = millis();
 
+        xSemaphoreTake(mutex_, portMAX_DELAY);
         while (is_running_ && ready_chunks_.size() < MIN_CHUNKS_FOR_START)
         {
-            if (playback_stop_requested_)
-            {
-                return 0;
-            }
-            if (millis() - start_wait > MAX_WAIT_MS)
+            uint32_t waited = millis() - start_wait;
+            if (playback_stop_requested_ || waited >= MAX_WAIT_MS)
             {
-                LOG_ERROR("Timeout waiting for initial buffer (%u chunks)", (unsigned)MIN_CHUNKS_FOR_START);
+                xSemaphoreGive(mutex_);
+                if (!playback_stop_requested_)
+                {
+                    LOG_ERROR("Timeout waiting for initial buffer (%u chunks)", (unsigned)MIN_CHUNKS_FOR_START);
+                }
                 return 0;
             }
-            vTaskDelay(pdMS_TO_TICKS(200));
+            wait_chunk_ready_locked(MAX_WAIT_MS - waited);
         }
+        xSemaphoreGive(mutex_);
     }
 
     // Se, dopo l'attesa, non ci sono chunk, è un errore grave o la fine dello stream.
-    if (ready_chunks_.empty())
+    if (ready_chunks_.empty() && !live_head_enabled_)
     {
         if (playback_stop_requested_)
         {
@@ -483,12 +634,20 @@ size_t TimeshiftManager::read(void *buffer, size_t size)
     }
 
     xSemaphoreTake(mutex_, portMAX_DELAY);
+    xEventGroupClearBits(events_, EVT_CHUNK_READY | EVT_LIVE_DATA); // Vedi wait_for_data()
 
     // Read from playback buffer (will load chunk if needed)
     size_t bytes_read = read_from_playback_buffer(current_read_offset_, buffer, size);
     if (bytes_read > 0)
     {
         current_read_offset_ += bytes_read;
+        if (first_read_ms_.load() == 0)
+        {
+            first_read_live_ = reading_live_head_;
+            first_read_ms_.store(elapsed_since_start_ms());
+            LOG_INFO("First audio bytes to the decoder %u ms after start (%s)", first_read_ms_.load(),
+                     first_read_live_ ? "live head" : "ready chunk");
+        }
     }
 
     xSemaphoreGive(mutex_);
@@ -510,6 +669,27 @@ bool TimeshiftManager::seek(size_t position)
 
     // Reset preload state after seek
     last_preload_check_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
+    reading_live_head_ = false;
+
+    // Live head: oltre l'ultimo chunk READY, fino a un chunk dopo il download head (il probe
+    // del decoder e l'ID3 arrivano qui prima della promozione). read() attende i byte mancanti
+    if (live_head_enabled_ && position >= ready_end_offset() &&
+        position <= download_head_.load() + dynamic_chunk_size_)
+    {
+        current_read_offset_ = position;
+        xSemaphoreGive(mutex_);
+        LOG_DEBUG("Seek to offset %u (live head)", (unsigned)position);
+        return true;
+    }
+
+    // Prima della finestra (chunk già riciclati, o storia ripresa dal journal): il byte
+    // valido più vicino è l'inizio del chunk più vecchio. Il probe del decoder fa seek(0)
+    if (!ready_chunks_.empty() && position < ready_chunks_.front().start_offset)
+    {
+        LOG_DEBUG("Seek to %u before the buffered window, clamped to %u", (unsigned)position,
+                  (unsigned)ready_chunks_.front().start_offset);
+        position = ready_chunks_.front().start_offset;
+    }
 
     // Verify that the offset is in a READY chunk
     uint32_t abs_chunk_id = find_chunk_for_offset(position);
@@ -558,26 +738,103 @@ const char *TimeshiftManager::uri() const
 void TimeshiftManager::request_stop()
 {
     playback_stop_requested_ = true;
+    signal_events(EVT_STOP);
+}
+
+void TimeshiftManager::signal_events(EventBits_t bits)
+{
+    if (events_)
+        xEventGroupSetBits(events_, bits);
+}
+
+bool TimeshiftManager::wait_chunk_ready_locked(uint32_t timeout_ms, EventBits_t extra_bits)
+{
+    // Un chunk promosso dopo il controllo del chiamante deve prendere il mutex, quindi
+    // il suo bit arriva dopo questo clear: nessun risveglio perso. Gli extra_bits (alzati
+    // senza mutex) li azzera il chiamante prima del proprio controllo
+    const EventBits_t wake_bits = EVT_CHUNK_READY | EVT_STOP | extra_bits;
+    xEventGroupClearBits(events_, EVT_CHUNK_READY);
+    xSemaphoreGive(mutex_);
+    stat_reader_waits_++;
+    EventBits_t bits = xEventGroupWaitBits(events_, wake_bits, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool woken = (bits & wake_bits) != 0;
+    if (woken)
+        stat_reader_wakeups_++;
+    else
+        stat_reader_timeouts_++;
+    return woken;
+}
+
+bool TimeshiftManager::wait_for_data(uint32_t timeout_ms)
+{
+    if (!is_open_ || !is_running_ || playback_stop_requested_)
+        return false;
+
+    // read() azzera EVT_CHUNK_READY all'ingresso: un chunk promosso dopo l'ultima lettura
+    // sveglia subito, altrimenti si dorme (anche se la read è fallita con dati presenti).
+    // Il bit si consuma qui: un decoder che non chiama più read() non gira a vuoto.
+    // Con il live head svegliano anche i nuovi byte del chunk in registrazione
+    const EventBits_t data_bits = EVT_CHUNK_READY | (live_head_enabled_ ? EVT_LIVE_DATA : 0);
+    stat_reader_waits_++;
+    EventBits_t bits = xEventGroupWaitBits(events_, data_bits | EVT_STOP, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    if (bits & data_bits)
+        xEventGroupClearBits(events_, data_bits);
+    if (bits & (data_bits | EVT_STOP))
+        stat_reader_wakeups_++;
+    else
+        stat_reader_timeouts_++;
+    return (bits & data_bits) != 0 && !playback_stop_requested_;
+}
+
+TimeshiftWaitStats TimeshiftManager::wait_stats() const
+{
+    TimeshiftWaitStats s;
+    s.chunk_ready_events = stat_chunk_ready_.load();
+    s.preload_events = stat_preload_events_.load();
+    s.preloader_wakeups = stat_preloader_wakeups_.load();
+    s.preloader_timeouts = stat_preloader_timeouts_.load();
+    s.reader_waits = stat_reader_waits_.load();
+    s.reader_wakeups = stat_reader_wakeups_.load();
+    s.reader_timeouts = stat_reader_timeouts_.load();
+    return s;
+}
+
+TimeshiftStartupStats TimeshiftManager::startup_stats() const
+{
+    TimeshiftStartupStats s;
+    s.start_at_ms = start_at_ms_;
+    s.connect_ms = connect_ms_.load();
+    s.first_byte_ms = first_byte_ms_.load();
+    s.first_read_ms = first_read_ms_.load();
+    s.live_head = first_read_live_;
+    return s;
+}
+
+uint32_t TimeshiftManager::elapsed_since_start_ms() const
+{
+    return std::max<uint32_t>(1, millis() - start_at_ms_);
 }
 
 size_t TimeshiftManager::buffered_bytes() const
 {
-    // Calculate available bytes in ready chunks
-    // Safe to access ready_chunks_.size() without mutex (atomic operation)
-    if (ready_chunks_.empty())
+    // Somma prefissa dell'indice: O(1), senza mutex (lettura indicativa per loop())
+    return (size_t)ready_chunks_.total_bytes();
+}
+
+size_t TimeshiftManager::playable_bytes() const
+{
+    // Come buffered_bytes(): indicativo, per l'attesa prima di arm/start
+    size_t bytes = buffered_bytes();
+    if (live_head_enabled_)
     {
-        return 0;
+        size_t head = download_head_.load();
+        size_t recorded = current_recording_offset_;
+        bytes += head > recorded ? head - recorded : 0;
     }
-
-    // Quick estimation without mutex (to avoid blocking in loop())
-    // This is safe because ready_chunks_ only grows (never shrinks during recording)
-    size_t num_ready = ready_chunks_.size();
-    if (num_ready == 0)
-        return 0;
-
-    // Conservative estimate: num_chunks * dynamic_chunk_size_
-    // (actual calculation would need mutex, but this is good enough for "ready?" check)
-    return num_ready * dynamic_chunk_size_;
+    return bytes;
 }
 
 size_t TimeshiftManager::total_downloaded_bytes() const
@@ -587,19 +844,11 @@ size_t TimeshiftManager::total_downloaded_bytes() const
 
 bool TimeshiftManager::copy_chunk_into_buffer(const ChunkInfo &chunk, uint8_t *dest)
 {
-    if (storage_mode_ == StorageMode::SD_CARD)
+    if (storage_mode_ == StorageMode::SD_CARD && chunk.on_sd)
     {
-        File file = SD_MMC.open(chunk.filename.c_str(), FILE_READ);
-        if (!file)
+        if (!read_chunk_from_sd(chunk, dest))
         {
-            LOG_ERROR("Switch cache: cannot open %s", chunk.filename.c_str());
-            return false;
-        }
-        size_t read = file.read(dest, chunk.length);
-        file.close();
-        if (read != chunk.length)
-        {
-            LOG_ERROR("Switch cache: read mismatch for chunk %u (expected %u, got %u)", chunk.id, chunk.length, read);
+            LOG_ERROR("Switch cache: cannot read chunk %u from SD", chunk.id);
             return false;
         }
         return true;
@@ -622,26 +871,9 @@ bool TimeshiftManager::migrate_chunk_psram_to_sd(ChunkInfo &chunk)
         return false;
     }
 
-    if (!SD_MMC.exists("/timeshift"))
-    {
-        SD_MMC.mkdir("/timeshift");
-    }
-
-    chunk.filename = "/timeshift/ready_" + std::to_string(chunk.id) + ".bin";
-
-    File file = SD_MMC.open(chunk.filename.c_str(), FILE_WRITE);
-    if (!file)
-    {
-        LOG_ERROR("Migration: cannot open %s for chunk %u", chunk.filename.c_str(), chunk.id);
-        return false;
-    }
-
-    size_t written = file.write(chunk.psram_ptr, chunk.length);
-    file.close();
-    if (written != chunk.length)
+    if (!write_chunk_to_sd(chunk, chunk.psram_ptr))
     {
-        LOG_ERROR("Migration: write mismatch for chunk %u (expected %u, wrote %u)", chunk.id, chunk.length, written);
-        SD_MMC.remove(chunk.filename.c_str());
+        LOG_ERROR("Migration: cannot copy chunk %u to SD", chunk.id);
         return false;
     }
 
@@ -771,6 +1003,70 @@ bool TimeshiftManager::try_read_from_switch_cache(size_t offset, void *buffer, s
 
     return false;
 }
+size_t TimeshiftManager::ready_end_offset() const
+{
+    return ready_chunks_.empty() ? 0 : ready_chunks_.back().end_offset;
+}
+
+size_t TimeshiftManager::read_start_offset() const
+{
+    // Inizio della finestra, ma non prima della sessione corrente: i chunk ripresi dal journal
+    // restano raggiungibili solo con seek_to_time()
+    size_t start = ready_chunks_.empty() ? current_recording_offset_ : ready_chunks_.front().start_offset;
+    return std::max(start, session_start_offset_);
+}
+
+bool TimeshiftManager::try_read_from_live_head(size_t offset, void *buffer, size_t size, size_t &out_bytes)
+{
+    // Mutex preso. Gestisce solo gli offset oltre l'ultimo chunk READY: quelli già nel chunk
+    // in registrazione si copiano dallo slab, quelli del chunk appena passato al writer
+    // (PENDING) attendono la promozione e tornano al percorso normale
+    out_bytes = 0;
+    if (!live_head_enabled_ || offset < ready_end_offset())
+    {
+        return false;
+    }
+
+    uint32_t wait_start = millis();
+    while (!playback_stop_requested_)
+    {
+        xEventGroupClearBits(events_, EVT_LIVE_DATA); // Prima del controllo: nessun risveglio perso
+        size_t head = download_head_.load();
+        if (offset >= current_recording_offset_ && offset < head && recording_slab_)
+        {
+            out_bytes = std::min(size, head - offset);
+            memcpy(buffer, recording_slab_ + (offset - current_recording_offset_), out_bytes);
+            if (!reading_live_head_)
+            {
+                // Il chunk del playback buffer non è più quello letto: preloader a riposo
+                LOG_DEBUG("Playback on the live head (offset %u, %u bytes behind the download)",
+                         (unsigned)offset, (unsigned)(head - offset));
+                reading_live_head_ = true;
+                current_playback_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
+                playback_chunk_loaded_size_ = 0;
+            }
+            return true;
+        }
+        if (offset < ready_end_offset())
+        {
+            return false; // Chunk promosso durante l'attesa
+        }
+        if (!is_running_)
+        {
+            return false; // Download terminato: nessun byte arriverà più
+        }
+
+        uint32_t waited = millis() - wait_start;
+        if (waited >= LIVE_HEAD_WAIT_MS)
+        {
+            LOG_WARN("No live data for offset %u after %u ms", (unsigned)offset, (unsigned)LIVE_HEAD_WAIT_MS);
+            return true;
+        }
+        wait_chunk_ready_locked(LIVE_HEAD_WAIT_MS - waited, EVT_LIVE_DATA);
+    }
+    return true;
+}
+
 float TimeshiftManager::buffer_duration_seconds() const
 {
     float bitrate_kbps = detected_bitrate_kbps_ != 0 ? (float)detected_bitrate_kbps_ : (float)DEFAULT_BITRATE_KBPS;
@@ -798,25 +1094,40 @@ void TimeshiftManager::preloader_task_loop()
     LOG_INFO("File preloader task started");
     uint32_t last_playback_chunk_abs_id_seen = INVALID_CHUNK_ABS_ID;
     bool next_chunk_preloaded = false;
-    uint32_t failed_preload_attempts_ = 0;
-    const uint32_t MAX_FAILED_ATTEMPTS = 16; // Log warning after consecutive misses //todo log but rewond only if next chunk (in playback) not availble
+    bool next_chunk_missing = false;      // Chunk successivo assente: timer per il rewind
+    uint32_t next_missing_since_ms = 0;
 
     while (is_running_)
     {
-        vTaskDelay(pdMS_TO_TICKS(100)); // Controlla ogni 100ms
+        // Dorme fino a: chunk READY, soglia di preload superata, fine switch backend, stop.
+        // Timeout solo mentre si aspetta un chunk successivo in ritardo (rewind)
+        TickType_t wait_ticks = portMAX_DELAY;
+        if (next_chunk_missing)
+        {
+            uint32_t elapsed = millis() - next_missing_since_ms;
+            wait_ticks = pdMS_TO_TICKS(NEXT_CHUNK_GRACE_MS - std::min(NEXT_CHUNK_GRACE_MS, elapsed));
+        }
+        EventBits_t bits = xEventGroupWaitBits(events_, EVT_PRELOAD, pdTRUE, pdFALSE, wait_ticks);
+        if (bits & EVT_PRELOAD)
+            stat_preloader_wakeups_++;
+        else
+            stat_preloader_timeouts_++;
+        if (!is_running_)
+            break;
 
         xSemaphoreTake(mutex_, portMAX_DELAY);
 
         if (current_playback_chunk_abs_id_ == INVALID_CHUNK_ABS_ID || ready_chunks_.empty())
         {
+            next_chunk_missing = false;
             xSemaphoreGive(mutex_);
             continue;
         }
 
-        // Skip preloading/logging while backend migration is in progress
+        // Skip preloading/logging while backend migration is in progress (EVT_PRELOAD alla fine)
         if (backend_switch_in_progress_)
         {
-            failed_preload_attempts_ = 0;
+            next_chunk_missing = false;
             xSemaphoreGive(mutex_);
             continue;
         }
@@ -826,7 +1137,7 @@ void TimeshiftManager::preloader_task_loop()
         {
             last_playback_chunk_abs_id_seen = current_playback_chunk_abs_id_;
             next_chunk_preloaded = false; // Reset: il nuovo chunk successivo non è ancora stato precaricato
-            failed_preload_attempts_ = 0; // Reset failed attempts counter
+            next_chunk_missing = false;
             LOG_DEBUG("Preloader: switched to chunk abs ID %u, will preload %u when ready",
                       current_playback_chunk_abs_id_,
                       current_playback_chunk_abs_id_ + 1);
@@ -846,9 +1157,20 @@ void TimeshiftManager::preloader_task_loop()
             // Verifica che il chunk successivo esista
             if (current_idx + 1 >= ready_chunks_.size())
             {
-                // Chunk successivo non ancora disponibile
-                failed_preload_attempts_++;
-                if (failed_preload_attempts_ >= MAX_FAILED_ATTEMPTS)
+                // Chunk successivo non ancora disponibile: la promozione sveglia il preloader,
+                // il timeout scatta solo se manca da più di NEXT_CHUNK_GRACE_MS. Con il live
+                // head il reader prosegue sul chunk in registrazione: niente rewind
+                uint32_t now = millis();
+                if (live_head_enabled_)
+                {
+                    next_chunk_missing = false;
+                }
+                else if (!next_chunk_missing)
+                {
+                    next_chunk_missing = true;
+                    next_missing_since_ms = now;
+                }
+                else if (now - next_missing_since_ms >= NEXT_CHUNK_GRACE_MS)
                 {
                     uint32_t original_chunk = current_playback_chunk_abs_id_;
                     uint32_t rewound_chunk_id = INVALID_CHUNK_ABS_ID;
@@ -856,25 +1178,25 @@ void TimeshiftManager::preloader_task_loop()
 
                     if (rewound)
                     {
-                        LOG_WARN("Preloader: Next chunk not ready after %u attempts (current abs ID %u). Rewound to chunk %u",
-                                 MAX_FAILED_ATTEMPTS, original_chunk, rewound_chunk_id);
+                        LOG_WARN("Preloader: Next chunk not ready after %u ms (current abs ID %u). Rewound to chunk %u",
+                                 NEXT_CHUNK_GRACE_MS, original_chunk, rewound_chunk_id);
                         next_chunk_preloaded = false;
                     }
                     else
                     {
-                        LOG_WARN("Preloader: Next chunk not ready after %u attempts (current abs ID %u)",
-                                 MAX_FAILED_ATTEMPTS, original_chunk);
+                        LOG_WARN("Preloader: Next chunk not ready after %u ms (current abs ID %u)",
+                                 NEXT_CHUNK_GRACE_MS, original_chunk);
                     }
 
-                    failed_preload_attempts_ = 0; // Avoid spamming logs
+                    next_missing_since_ms = now; // Avoid spamming logs
                 }
 
                 xSemaphoreGive(mutex_);
                 continue;
             }
 
-            // Reset failed attempts when next chunk becomes available
-            failed_preload_attempts_ = 0;
+            // Reset missing timer when next chunk becomes available
+            next_chunk_missing = false;
 
             // Calcola il progresso nel chunk corrente
             const auto &current_chunk = ready_chunks_[current_idx];
@@ -889,7 +1211,7 @@ void TimeshiftManager::preloader_task_loop()
 
             float progress = (float)offset_in_chunk / (float)current_chunk.length;
 
-            // Trigger di pre-caricamento (al 50% del chunk corrente)
+            // Trigger di pre-caricamento (al 50% del chunk corrente, segnalato da read())
             if (progress >= 0.50f)
             {
                 uint32_t next_abs_id = current_playback_chunk_abs_id_ + 1;
@@ -897,11 +1219,12 @@ void TimeshiftManager::preloader_task_loop()
                 {
                     LOG_DEBUG("Preloader task loaded chunk abs ID %u", next_abs_id);
                     next_chunk_preloaded = true;
-                    failed_preload_attempts_ = 0;
                 }
-                else
+                else if (!next_chunk_missing)
                 {
-                    failed_preload_attempts_++;
+                    // Chunk presente ma non caricabile: ritenta entro il grace
+                    next_chunk_missing = true;
+                    next_missing_since_ms = millis();
                 }
             }
         }
@@ -931,85 +1254,188 @@ void TimeshiftManager::writer_task_loop()
             continue;
         }
 
-        if (!job.data || job.length == 0)
-        {
-            if (job.data)
-            {
-                free(job.data);
-            }
-            continue;
-        }
+        write_chunk_job(job, true);
+    }
 
-        ChunkInfo chunk;
-        chunk.id = job.id;
-        chunk.start_offset = job.start_offset;
-        chunk.length = job.length;
-        chunk.end_offset = job.start_offset + job.length;
-        chunk.state = ChunkState::PENDING;
-        chunk.psram_ptr = nullptr;
-        chunk.filename.clear();
-        chunk.crc32 = 0;
+    LOG_INFO("Chunk writer task terminated");
+    writer_task_handle_ = nullptr;
+    vTaskDelete(nullptr);
+}
 
-        bool write_ok = false;
-        StorageMode target_mode = job.mode;
+size_t TimeshiftManager::write_queued_chunk(bool *deferred, uint32_t *lag_ms)
+{
+    *deferred = false;
+    *lag_ms = 0;
+    ChunkJob job{};
+    if (!write_queue_ || xQueuePeek(write_queue_, &job, 0) != pdTRUE)
+    {
+        return 0;
+    }
+    // Il job resta in coda finché non è scritto: con la ring piena il producer trova la coda
+    // piena come col writer proprio, e al prossimo giro si riprova lo stesso chunk
+    const size_t length = job.length;
+    if (!write_chunk_job(job, false))
+    {
+        *deferred = true;
+        return 0;
+    }
+    ChunkJob done;
+    xQueueReceive(write_queue_, &done, 0);
+    *lag_ms = millis() - job.queued_at_ms;
+    return length;
+}
 
-        if (target_mode == StorageMode::SD_CARD)
-        {
-            chunk.filename = "/timeshift/pending_" + std::to_string(chunk.id) + ".bin";
-            write_ok = write_chunk_to_sd(chunk, job.data);
-        }
-        else
-        {
-            write_ok = write_chunk_to_psram(chunk, job.data);
-        }
+uint32_t TimeshiftManager::queued_write_chunks() const
+{
+    return write_queue_ ? (uint32_t)uxQueueMessagesWaiting(write_queue_) : 0;
+}
+
+uint32_t TimeshiftManager::write_queue_age_ms() const
+{
+    ChunkJob job{};
+    if (!write_queue_ || xQueuePeek(write_queue_, &job, 0) != pdTRUE || !job.data)
+    {
+        return 0;
+    }
+    return millis() - job.queued_at_ms;
+}
+
+size_t TimeshiftManager::unwritten_bytes() const
+{
+    size_t head = download_head_.load();
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    size_t ready_end = ready_end_offset();
+    xSemaphoreGive(mutex_);
+    return head > ready_end ? head - ready_end : 0;
+}
+
+bool TimeshiftManager::write_chunk_job(ChunkJob &job, bool wait_for_space)
+{
+    if (!job.data || job.length == 0)
+    {
+        slab_pool_.release(job.data);
+        return true;
+    }
+
+    ChunkInfo chunk;
+    chunk.id = job.id;
+    chunk.start_offset = job.start_offset;
+    chunk.length = job.length;
+    chunk.end_offset = job.start_offset + job.length;
+    chunk.state = ChunkState::PENDING;
+    chunk.psram_ptr = nullptr;
+    chunk.on_sd = false;
+    chunk.sd_offset = 0;
+    chunk.crc32 = 0;
+    chunk.total_frames = job.total_frames;
+    chunk.start_time_ms = job.start_time_ms;
+    chunk.duration_ms = job.duration_ms;
+    chunk.end_frames = job.end_frames;
 
-        if (write_ok && validate_chunk(chunk))
+    bool write_ok = false;
+    StorageMode target_mode = job.mode;
+    if (target_mode == StorageMode::SD_CARD && !sd_ring_.is_open())
+    {
+        // Switch a PSRAM avvenuto con il chunk in coda: la ring è chiusa, lo slab resta al chunk
+        target_mode = StorageMode::PSRAM_ONLY;
+    }
+
+    if (target_mode == StorageMode::SD_CARD)
+    {
+        bool ring_full = false;
+        while (is_running_ && sd_ring_.is_open() && !sd_ring_.fits(chunk.length))
         {
+            // Ring piena: ricicla le regioni più vecchie fuori dalla zona di playback. Se
+            // il playback le tiene tutte si aspetta: la coda si riempie e il download resta
+            // senza slab, come in PSRAM_ONLY (backpressure invece di perdere il chunk)
             xSemaphoreTake(mutex_, portMAX_DELAY);
-            promote_chunk_to_ready(chunk);
             cleanup_old_chunks();
             xSemaphoreGive(mutex_);
-        }
-        else
-        {
-            LOG_ERROR("Writer task failed for chunk %u", chunk.id);
-            if (!chunk.filename.empty())
+            if (sd_ring_.fits(chunk.length))
+            {
+                break;
+            }
+            if (!wait_for_space)
+            {
+                return false; // Writer condiviso: si passa alle altre registrazioni
+            }
+            if (!ring_full)
             {
-                SD_MMC.remove(chunk.filename.c_str());
+                LOG_WARN("SD ring full (%u MB), writer waiting for playback to release regions",
+                         (unsigned)(sd_ring_.capacity() / (1024 * 1024)));
+                ring_full = true;
             }
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+        if (!is_running_ && sd_ring_.is_open() && !sd_ring_.fits(chunk.length))
+        {
+            // Stop mentre la ring era piena: il chunk in coda non serve più
+            LOG_DEBUG("Stop: chunk %u discarded (SD ring full)", chunk.id);
+            slab_pool_.release(job.data);
+            job.data = nullptr;
+            return true;
+        }
+        write_ok = write_chunk_to_sd(chunk, job.data);
+    }
+    else
+    {
+        // Lo slab diventa lo storage del chunk: niente copia
+        write_ok = write_chunk_to_psram(chunk, job.data);
+        if (write_ok)
+        {
+            job.data = nullptr;
         }
+    }
 
-        free(job.data);
-        job.data = nullptr;
+    if (write_ok && validate_chunk(chunk))
+    {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        promote_chunk_to_ready(chunk);
+        cleanup_old_chunks();
+        xSemaphoreGive(mutex_);
+    }
+    else
+    {
+        LOG_ERROR("Writer task failed for chunk %u", chunk.id);
+        free_chunk_storage(chunk);
     }
 
-    LOG_INFO("Chunk writer task terminated");
-    writer_task_handle_ = nullptr;
-    vTaskDelete(nullptr);
+    // SD: dati già su file, lo slab torna al download task
+    slab_pool_.release(job.data);
+    job.data = nullptr;
+    return true;
 }
 
 void TimeshiftManager::download_task_loop()
 {
     LOG_INFO("TimeshiftManager download task started - connecting to %s", uri_.c_str());
 
-    HTTPClient http;
-    http.begin(uri_.c_str());
-    http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
-    http.setTimeout(10000);
-    http.setUserAgent("ESP32-Audio/1.0");
-
-    int httpCode = http.GET();
+    // Connessione adottata da uno standby: già in streaming, nessuna GET. Resta del manager
+    // (close() la libera) perché vTaskDelete non esegue i distruttori
+    HTTPClient local_http;
+    HTTPClient &http = adopted_http_ ? *adopted_http_ : local_http;
+    int httpCode = HTTP_CODE_OK;
+    if (!adopted_http_)
+    {
+        http.begin(uri_.c_str());
+        http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
+        http.setTimeout(10000);
+        http.setUserAgent("ESP32-Audio/1.0");
+        httpCode = http.GET();
+    }
     if (httpCode != HTTP_CODE_OK)
     {
         LOG_ERROR("HTTP GET failed: %d (%s)", httpCode, http.errorToString(httpCode).c_str());
         is_running_ = false;
+        signal_events(EVT_CHUNK_READY);
         download_task_handle_ = nullptr;
         http.end();
         vTaskDelete(nullptr);
         return;
     }
 
-    LOG_INFO("HTTP connected, code: %d - starting download loop", httpCode);
+    connect_ms_.store(elapsed_since_start_ms());
+    LOG_INFO("HTTP connected in %u ms, code: %d - starting download loop", connect_ms_.load(), httpCode);
     WiFiClient *stream = http.getStreamPtr();
 
     // CRITICAL: Verify stream pointer is valid
@@ -1017,31 +1443,13 @@ void TimeshiftManager::download_task_loop()
     {
         LOG_ERROR("CRITICAL: getStreamPtr() returned NULL!");
         is_running_ = false;
+        signal_events(EVT_CHUNK_READY);
         download_task_handle_ = nullptr;
         http.end();
         vTaskDelete(nullptr);
         return;
     }
 
-    // Usa un buffer di download più grande per massimizzare il throughput.
-    // La dimensione effettiva della lettura sarà limitata dallo spazio disponibile
-    // nel buffer di registrazione, quindi questo è solo un limite superiore.
-    const size_t DOWNLOAD_BUFFER_SIZE = 256 * 1024; // 128KB
-    uint8_t *buf = (uint8_t *)heap_caps_malloc(DOWNLOAD_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
-
-    if (!buf) {
-        LOG_ERROR("Failed to allocate download buffer in PSRAM, trying DRAM...");
-        buf = (uint8_t *)malloc(16 * 1024);
-    }
-
-    if (!buf) {
-        LOG_ERROR("CRITICAL: Failed to allocate any download buffer!");
-        is_running_ = false;
-        download_task_handle_ = nullptr;
-        http.end();
-        vTaskDelete(nullptr);
-        return;
-    }
     size_t total_downloaded = 0;
     uint32_t last_log_time = millis();
 
@@ -1049,6 +1457,7 @@ void TimeshiftManager::download_task_loop()
     uint32_t last_data_time = millis();
     const uint32_t STREAM_TIMEOUT = 30000; // 30 seconds without data = timeout
     const char *exit_reason = "stopped";
+    bool slab_starved = false;
 
     auto finalize_task = [&](const char *reason) {
         const char *tag = reason ? reason : "stopped";
@@ -1056,11 +1465,6 @@ void TimeshiftManager::download_task_loop()
                  tag,
                  (unsigned)(total_downloaded / 1024));
         http.end();
-        if (buf)
-        {
-            free(buf);
-            buf = nullptr;
-        }
         download_task_handle_ = nullptr;
         vTaskDelete(nullptr);
     };
@@ -1090,10 +1494,6 @@ void TimeshiftManager::download_task_loop()
                     {
                         free_psram_pool();
                         retain_psram_until_migrated_ = false;
-                        for (auto &c : ready_chunks_)
-                        {
-                            c.psram_ptr = nullptr;
-                        }
                     }
                     LOG_INFO("Background migration completed");
                 }
@@ -1107,14 +1507,11 @@ void TimeshiftManager::download_task_loop()
                 ChunkInfo snapshot;
                 bool found = false;
                 xSemaphoreTake(mutex_, portMAX_DELAY);
-                for (auto &c : ready_chunks_)
+                size_t idx = find_chunk_index_by_id(chunk_id);
+                if (idx != INVALID_CHUNK_ID)
                 {
-                    if (c.id == chunk_id)
-                    {
-                        snapshot = c;
-                        found = true;
-                        break;
-                    }
+                    snapshot = ready_chunks_[idx];
+                    found = true;
                 }
                 xSemaphoreGive(mutex_);
 
@@ -1130,16 +1527,23 @@ void TimeshiftManager::download_task_loop()
                     return;
                 }
 
+                bool still_ready = false;
                 xSemaphoreTake(mutex_, portMAX_DELAY);
-                for (auto &c : ready_chunks_)
+                idx = find_chunk_index_by_id(chunk_id);
+                if (idx != INVALID_CHUNK_ID)
                 {
-                    if (c.id == chunk_id)
-                    {
-                        c.filename = snapshot.filename;
-                        break;
-                    }
+                    ChunkInfo &c = ready_chunks_[idx];
+                    c.on_sd = true;
+                    c.sd_offset = snapshot.sd_offset;
+                    journal_ready_chunk(c);
+                    still_ready = true;
                 }
                 xSemaphoreGive(mutex_);
+                if (!still_ready)
+                {
+                    // Rimosso dal cleanup durante la copia
+                    sd_ring_.release(snapshot.sd_offset);
+                }
             }
         };
 
@@ -1184,33 +1588,29 @@ void TimeshiftManager::download_task_loop()
                     {
                         xSemaphoreTake(mutex_, portMAX_DELAY);
                         ChunkInfo &chunk = ready_chunks_[i];
-                        std::string filename = chunk.filename;
-                        chunk.psram_ptr = allocate_psram_chunk(chunk.id);
+                        const bool on_sd = chunk.on_sd;
+                        if (!chunk.psram_ptr)
+                        {
+                            chunk.psram_ptr = slab_pool_.acquire();
+                        }
                         uint8_t *dest = chunk.psram_ptr;
-                        size_t length = chunk.length;
+                        ChunkInfo copy = chunk;
                         xSemaphoreGive(mutex_);
 
                         if (!dest)
                         {
-                            LOG_ERROR("PSRAM allocation failed for chunk %u", chunk.id);
+                            LOG_ERROR("PSRAM allocation failed for chunk %u", copy.id);
                             ok = false;
                             break;
                         }
-
-                        File file = SD_MMC.open(filename.c_str(), FILE_READ);
-                        if (!file)
+                        if (!on_sd)
                         {
-                            LOG_ERROR("Cannot open %s while switching to PSRAM", filename.c_str());
-                            ok = false;
-                            break;
+                            continue; // Ancora in PSRAM (migrazione verso SD non completata)
                         }
 
-                        size_t read = file.read(dest, length);
-                        file.close();
-
-                        if (read != length)
+                        if (!read_chunk_from_sd(copy, dest))
                         {
-                            LOG_ERROR("Copy to PSRAM failed for chunk %u (expected %u, got %u)", chunk.id, chunk.length, read);
+                            LOG_ERROR("Copy to PSRAM failed for chunk %u", copy.id);
                             ok = false;
                             break;
                         }
@@ -1218,15 +1618,15 @@ void TimeshiftManager::download_task_loop()
 
                     if (ok)
                     {
+                        // Tutto in PSRAM: le regioni della ring non servono più
                         xSemaphoreTake(mutex_, portMAX_DELAY);
                         for (auto &chunk : ready_chunks_)
                         {
-                            if (!chunk.filename.empty())
-                            {
-                                SD_MMC.remove(chunk.filename.c_str());
-                                chunk.filename.clear();
-                            }
+                            chunk.on_sd = false;
                         }
+                        // Storia solo in PSRAM: il journal descriverebbe regioni non più valide
+                        journal_.discard();
+                        sd_ring_.close();
                         xSemaphoreGive(mutex_);
                     }
                 }
@@ -1234,6 +1634,20 @@ void TimeshiftManager::download_task_loop()
             else // target == SD_CARD
             {
                 cleanup_timeshift_directory();
+                if (!init_sd_ring())
+                {
+                    LOG_ERROR("Switch aborted: cannot open SD ring");
+                    ok = false;
+                }
+                else
+                {
+                    // Journal vuoto: i chunk entrano man mano che la migrazione li porta sulla
+                    // ring, con tutte le entry della seek table fino a loro
+                    xSemaphoreTake(mutex_, portMAX_DELAY);
+                    journal_seek_index_ = 0;
+                    start_journal();
+                    xSemaphoreGive(mutex_);
+                }
 
                 // Fast path: copy only current and next chunk immediately, queue the rest
                 uint32_t cur_id = current_playback_chunk_abs_id_;
@@ -1243,7 +1657,7 @@ void TimeshiftManager::download_task_loop()
                 migration_queue_.clear();
                 xSemaphoreGive(mutex_);
 
-                for (size_t iter = ready_chunks_.size(); iter > 0 && ok; --iter)
+                for (size_t iter = ok ? ready_chunks_.size() : 0; iter > 0 && ok; --iter)
                 {
                     size_t i = iter - 1;
                     xSemaphoreTake(mutex_, portMAX_DELAY);
@@ -1258,6 +1672,9 @@ void TimeshiftManager::download_task_loop()
                             ok = false;
                             break;
                         }
+                        xSemaphoreTake(mutex_, portMAX_DELAY);
+                        journal_ready_chunk(chunk);
+                        xSemaphoreGive(mutex_);
                     }
                     else
                     {
@@ -1285,19 +1702,20 @@ void TimeshiftManager::download_task_loop()
             }
             else if (target == StorageMode::PSRAM_ONLY)
             {
+                xSemaphoreTake(mutex_, portMAX_DELAY);
                 free_psram_pool();
+                xSemaphoreGive(mutex_);
             }
 
             // If no background migration pending and we are in SD mode, we can free PSRAM now
             if (ok && target == StorageMode::SD_CARD)
             {
                 xSemaphoreTake(mutex_, portMAX_DELAY);
-                bool pending_bg = background_migration_in_progress_;
-                xSemaphoreGive(mutex_);
-                if (!pending_bg)
+                if (!background_migration_in_progress_)
                 {
                     free_psram_pool();
                 }
+                xSemaphoreGive(mutex_);
             }
 
             bool reload_current_chunk = false;
@@ -1306,6 +1724,7 @@ void TimeshiftManager::download_task_loop()
             backend_switch_in_progress_ = false;
             seek_blocked_for_switch_ = false;
             last_preload_check_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
+            signal_events(EVT_PRELOAD);
             if (ok && current_playback_chunk_abs_id_ != INVALID_CHUNK_ABS_ID)
             {
                 reload_current_chunk = true;
@@ -1363,10 +1782,12 @@ void TimeshiftManager::download_task_loop()
             continue;
         }
 
-        int available = stream->available();
+        // Il pre-roll dello standby passa per lo stesso percorso dei byte di rete
+        size_t preroll_left = preroll_len_ - preroll_pos_;
+        int available = preroll_left > 0 ? (int)preroll_left : stream->available();
         if (available > 0)
         {
-            // Prevent overflowing the planned chunk size (PSRAM pool is sized to dynamic_chunk_size_)
+            // Prevent overflowing the planned chunk size (slabs are sized to dynamic_chunk_size_)
             if (bytes_in_current_chunk_ >= dynamic_chunk_size_)
             {
                 LOG_WARN("Current chunk reached max size (%u bytes), flushing before reading more",
@@ -1380,60 +1801,101 @@ void TimeshiftManager::download_task_loop()
                 continue; // Start filling the next chunk
             }
 
-            // Calcola lo spazio libero nel buffer di registrazione circolare
-            size_t buffer_space_left = dynamic_buffer_size_ - bytes_in_current_chunk_;
-            size_t chunk_space_left = dynamic_chunk_size_ - bytes_in_current_chunk_;
-            size_t space_left = std::min(buffer_space_left, chunk_space_left);
-
-            // Se non c'è spazio, non leggere nulla e attendi il prossimo ciclo.
-            // Il flush avverrà comunque se la soglia è raggiunta.
-            if (space_left == 0)
+            // Slab del chunk corrente: se sono tutti in coda o READY si aspetta che il
+            // writer o il cleanup ne restituiscano uno (il socket fa da buffer)
+            if (!recording_slab_)
             {
-                vTaskDelay(pdMS_TO_TICKS(20));
-                continue;
+                recording_slab_ = slab_pool_.acquire();
+                if (!recording_slab_ && slab_starved)
+                {
+                    // Slab tutti READY: il cleanup del writer si era fermato sulla safe zone
+                    // del playback, che nel frattempo può essere avanzato
+                    xSemaphoreTake(mutex_, portMAX_DELAY);
+                    cleanup_old_chunks();
+                    xSemaphoreGive(mutex_);
+                    recording_slab_ = slab_pool_.acquire();
+                }
+                if (!recording_slab_)
+                {
+                    if (!slab_starved)
+                    {
+                        LOG_WARN("No free chunk slab (%u in use), waiting for writer/cleanup",
+                                 (unsigned)slab_pool_.total());
+                        slab_starved = true;
+                    }
+                    vTaskDelay(pdMS_TO_TICKS(100));
+                    continue;
+                }
+                if (slab_starved)
+                {
+                    LOG_INFO("Chunk slab available again, recording resumed");
+                    slab_starved = false;
+                }
             }
 
-            // Strategia di download aggressiva: leggi il massimo possibile.
-            // Limita la lettura alla quantità di dati disponibili nel socket,
-            // allo spazio rimanente nel nostro buffer, e alla dimensione del buffer di lettura.
-            size_t to_read = std::min({DOWNLOAD_BUFFER_SIZE, (size_t)available, space_left});
-            int len = stream->readBytes(buf, to_read);
+            // Spazio rimanente nel chunk (mai oltre lo slab: vedi calculate_adaptive_sizes)
+            size_t space_left = dynamic_chunk_size_ - bytes_in_current_chunk_;
+
+            // Strategia di download aggressiva: leggi il massimo possibile, direttamente
+            // nello slab, limitato ai dati disponibili nel socket e allo spazio del chunk.
+            size_t to_read = std::min((size_t)available, space_left);
+            int len;
+            if (preroll_left > 0)
+            {
+                memcpy(recording_slab_ + bytes_in_current_chunk_, preroll_buf_ + preroll_pos_, to_read);
+                preroll_pos_ += to_read;
+                len = (int)to_read;
+            }
+            else
+            {
+                len = stream->readBytes(recording_slab_ + bytes_in_current_chunk_, to_read);
+            }
 
             if (len > 0)
             {
                 uint32_t now = millis();
                 last_data_time = now; // Reset timeout on successful read
 
-                if (bytes_since_rate_sample_ == 0)
+                // Il pre-roll arriva tutto insieme: il bitrate si misura solo sulla rete
+                if (preroll_left == 0)
                 {
-                    bitrate_sample_start_ms_ = now;
-                }
-                bytes_since_rate_sample_ += len;
+                    if (bytes_since_rate_sample_ == 0)
+                    {
+                        bitrate_sample_start_ms_ = now;
+                    }
+                    bytes_since_rate_sample_ += len;
 
-                uint32_t rate_elapsed_ms = now - bitrate_sample_start_ms_;
-                if (rate_elapsed_ms >= BITRATE_SAMPLE_WINDOW_MS)
-                {
-                    uint32_t measured_kbps = (bytes_since_rate_sample_ * 8) / rate_elapsed_ms;
-                    apply_bitrate_measurement(measured_kbps);
-                    bytes_since_rate_sample_ = 0;
-                    bitrate_sample_start_ms_ = 0;
+                    uint32_t rate_elapsed_ms = now - bitrate_sample_start_ms_;
+                    if (rate_elapsed_ms >= BITRATE_SAMPLE_WINDOW_MS)
+                    {
+                        uint32_t measured_kbps = (bytes_since_rate_sample_ * 8) / rate_elapsed_ms;
+                        apply_bitrate_measurement(measured_kbps);
+                        bytes_since_rate_sample_ = 0;
+                        bitrate_sample_start_ms_ = 0;
+                    }
                 }
 
-                // Write to recording_buffer_ (circular) with bounds check
-                for (int i = 0; i < len; i++)
+                // Unica scansione degli header: frame, durata e seek table crescono coi byte
+                if (!seek_table_.append_chunk(recording_slab_ + bytes_in_current_chunk_, len))
                 {
-                    if (bytes_in_current_chunk_ >= dynamic_buffer_size_)
-                    {
-                        // This should NEVER happen due to checks above, but defensive programming
-                        LOG_ERROR("CRITICAL: Buffer overflow prevented! bytes=%u, dynamic_buffer_size_=%u",
-                                  (unsigned)bytes_in_current_chunk_, (unsigned)dynamic_buffer_size_);
-                        break; // Stop writing immediately
-                    }
-                    recording_buffer_[rec_write_head_] = buf[i];
-                    rec_write_head_ = (rec_write_head_ + 1) % dynamic_buffer_size_;
-                    bytes_in_current_chunk_++;
+                    LOG_WARN("Seek table append failed at offset %u",
+                             (unsigned)(current_recording_offset_ + bytes_in_current_chunk_));
                 }
+                bytes_in_current_chunk_ += len;
                 total_downloaded += len;
+                download_head_.store(current_recording_offset_ + bytes_in_current_chunk_);
+                if (seek_table_.sample_rate() > 0)
+                {
+                    head_duration_ms_.store((uint32_t)(seek_table_.covered_frames() * 1000 / seek_table_.sample_rate()));
+                }
+                if (first_byte_ms_.load() == 0)
+                {
+                    first_byte_ms_.store(elapsed_since_start_ms());
+                }
+                if (live_head_enabled_)
+                {
+                    signal_events(EVT_LIVE_DATA); // Reader in attesa sul live head
+                }
 
                 // --- LOGICA DI FLUSH DECOUPLED ---
                 // Controlliamo se è necessario un flush, ma lo eseguiamo *fuori* dal mutex
@@ -1497,115 +1959,126 @@ bool TimeshiftManager::flush_recording_chunk_async()
         return false;
     }
 
+    if (!recording_slab_)
+    {
+        LOG_ERROR("Flush requested without a recording slab");
+        return false;
+    }
+
     ChunkJob job{};
     job.id = next_chunk_id_++;
     job.start_offset = current_recording_offset_;
     job.length = length;
     job.mode = storage_mode_;
 
-    // Allocate linear buffer for the chunk (prefer PSRAM)
-    job.data = (uint8_t *)heap_caps_malloc(length, MALLOC_CAP_SPIRAM);
-    if (!job.data)
-    {
-        job.data = (uint8_t *)malloc(length);
-    }
-    if (!job.data)
-    {
-        LOG_ERROR("Failed to allocate linear buffer for chunk %u (%u bytes)", job.id, (unsigned)length);
-        return false;
-    }
-
-    // Copy from circular recording buffer into linear buffer
-    if (rec_write_head_ >= length)
-    {
-        size_t start_pos = rec_write_head_ - length;
-        memcpy(job.data, recording_buffer_ + start_pos, length);
-    }
-    else
+    // Frame e tempi dal parse fatto durante il download: il writer non rilegge il chunk
+    uint64_t end_frames = seek_table_.covered_frames();
+    uint32_t sample_rate = seek_table_.sample_rate();
+    job.total_frames = (uint32_t)(end_frames - chunk_start_frames_);
+    job.start_time_ms = 0;
+    job.duration_ms = 0;
+    if (sample_rate > 0)
     {
-        size_t remainder = length - rec_write_head_;
-        size_t start_pos = dynamic_buffer_size_ - remainder;
-        memcpy(job.data, recording_buffer_ + start_pos, remainder);
-        memcpy(job.data + remainder, recording_buffer_, rec_write_head_);
+        job.start_time_ms = (uint32_t)(chunk_start_frames_ * 1000 / sample_rate);
+        job.duration_ms = (uint32_t)(end_frames * 1000 / sample_rate) - job.start_time_ms;
     }
+    job.end_frames = end_frames;
+    job.queued_at_ms = millis();
+    chunk_start_frames_ = end_frames;
 
-    // Advance offsets for next chunk
+    // Lo slab passa al writer così com'è: niente copia né allocazione per chunk. Si stacca
+    // col mutex insieme all'avanzamento degli offset: un reader sul live head non lo sta
+    // copiando e da qui non lo vede più (i suoi byte tornano leggibili alla promozione)
     xSemaphoreTake(mutex_, portMAX_DELAY);
+    job.data = recording_slab_;
+    recording_slab_ = nullptr;
     current_recording_offset_ += bytes_in_current_chunk_;
     bytes_in_current_chunk_ = 0;
     xSemaphoreGive(mutex_);
 
-    // Enqueue for writer task (wait up to 1s if SD is slow)
+    // Enqueue for writer task. Coda piena = writer in attesa di spazio nella ring SD:
+    // si aspetta finché il download è attivo (backpressure), si scarta solo allo stop
     BaseType_t res = xQueueSend(write_queue_, &job, pdMS_TO_TICKS(1000));
+    if (res != pdPASS && is_running_)
+    {
+        LOG_WARN("Write queue full, waiting for the writer (chunk %u)", job.id);
+        while (res != pdPASS && is_running_)
+        {
+            res = xQueueSend(write_queue_, &job, pdMS_TO_TICKS(1000));
+        }
+    }
     if (res != pdPASS)
     {
         LOG_ERROR("Write queue full, dropping chunk %u", job.id);
-        free(job.data);
+        slab_pool_.release(job.data);
         return false;
     }
+    if (hub_)
+    {
+        hub_->notify();
+    }
 
     return true;
 }
 
 bool TimeshiftManager::write_chunk_to_sd(ChunkInfo &chunk, const uint8_t *src)
 {
-    File file = SD_MMC.open(chunk.filename.c_str(), FILE_WRITE);
-    if (!file)
+    // Una regione della ring preallocata: solo seek + write, niente create/close su FAT
+    uint32_t offset = 0;
+    if (!sd_ring_.reserve(chunk.length, offset))
     {
-        LOG_ERROR("Failed to open chunk file for write: %s", chunk.filename.c_str());
+        LOG_ERROR("SD ring full: no region for chunk %u (%u KB used of %u MB)", chunk.id,
+                  (unsigned)(sd_ring_.used_bytes() / 1024), (unsigned)(sd_ring_.capacity() / (1024 * 1024)));
         return false;
     }
 
-    size_t written = file.write(src, chunk.length);
-    file.close();
-
-    if (written != chunk.length)
+    if (!sd_ring_.write(offset, src, chunk.length))
     {
-        LOG_ERROR("Chunk write mismatch: expected %u, wrote %u", chunk.length, (unsigned)written);
-        SD_MMC.remove(chunk.filename.c_str());
+        sd_ring_.release(offset);
         return false;
     }
 
-    LOG_DEBUG("Wrote chunk %u: %u KB to %s", chunk.id, chunk.length / 1024, chunk.filename.c_str());
+    chunk.on_sd = true;
+    chunk.sd_offset = offset;
+    LOG_DEBUG("Wrote chunk %u: %u KB to ring @%u KB", chunk.id, chunk.length / 1024, (unsigned)(offset / 1024));
     return true;
 }
 
-bool TimeshiftManager::write_chunk_to_psram(ChunkInfo &chunk, const uint8_t *src)
+bool TimeshiftManager::read_chunk_from_sd(const ChunkInfo &chunk, uint8_t *dest)
 {
-    // Allocate PSRAM chunk from pool (circular)
-    chunk.psram_ptr = allocate_psram_chunk(chunk.id);
-    if (!chunk.psram_ptr)
+    if (!chunk.on_sd)
+    {
+        return false;
+    }
+    return sd_ring_.read(chunk.sd_offset, dest, chunk.length);
+}
+
+bool TimeshiftManager::write_chunk_to_psram(ChunkInfo &chunk, uint8_t *slab)
+{
+    // Il chunk adotta lo slab riempito dal download task; lo rilascia il cleanup
+    if (!slab || chunk.length > slab_pool_.slab_bytes())
     {
-        LOG_ERROR("Failed to allocate PSRAM chunk");
+        LOG_ERROR("Invalid slab for PSRAM chunk %u (%u bytes)", chunk.id, (unsigned)chunk.length);
         return false;
     }
 
-    memcpy(chunk.psram_ptr, src, chunk.length);
+    chunk.psram_ptr = slab;
 
-    LOG_DEBUG("Wrote chunk %u: %u KB to PSRAM (pool index %u)",
-              chunk.id, chunk.length / 1024, (unsigned)(psram_pool_slots_ ? (chunk.id % psram_pool_slots_) : 0));
+    LOG_DEBUG("Wrote chunk %u: %u KB to PSRAM (slab %p, %u free)",
+              chunk.id, chunk.length / 1024, slab, (unsigned)slab_pool_.available());
     return true;
 }
 
 bool TimeshiftManager::validate_chunk(ChunkInfo &chunk)
 {
-    bool chunk_on_sd = !chunk.filename.empty();
-    if (chunk_on_sd)
+    if (chunk.on_sd)
     {
-        // SD mode: check file exists and size matches
-        File file = SD_MMC.open(chunk.filename.c_str(), FILE_READ);
-        if (!file)
-        {
-            LOG_ERROR("Validation failed: cannot open %s", chunk.filename.c_str());
-            return false;
-        }
-
-        size_t file_size = file.size();
-        file.close();
-
-        if (file_size != chunk.length)
+        // SD mode: la write sulla ring ha già verificato i byte scritti, la regione
+        // deve solo stare nel file
+        if ((size_t)chunk.sd_offset + chunk.length > sd_ring_.capacity())
         {
-            LOG_ERROR("Validation failed: size mismatch (%u vs %u)", file_size, chunk.length);
+            LOG_ERROR("Validation failed: region @%u (%u bytes) outside SD ring", (unsigned)chunk.sd_offset,
+                      (unsigned)chunk.length);
             return false;
         }
     }
@@ -1624,236 +2097,28 @@ bool TimeshiftManager::validate_chunk(ChunkInfo &chunk)
     return true;
 }
 
-bool TimeshiftManager::calculate_chunk_duration(const ChunkInfo &chunk,
-                                                uint32_t &out_frames,
-                                                uint32_t &out_duration_ms,
-                                                uint32_t &out_bitrate_kbps)
-{
-    uint8_t header[4];
-    uint32_t total_samples = 0;
-    size_t data_pos = 0;
-    bool header_detected = false;
-    uint32_t detected_sample_rate = 0;
-    uint32_t detected_bitrate_kbps = 0;
-
-    auto read_bytes = [&](uint8_t *buffer, size_t len) -> size_t
-    {
-        if (storage_mode_ == StorageMode::PSRAM_ONLY)
-        {
-            if (data_pos + len > chunk.length)
-            {
-                len = chunk.length - data_pos;
-            }
-            if (len == 0)
-                return 0;
-            memcpy(buffer, chunk.psram_ptr + data_pos, len);
-            data_pos += len;
-            return len;
-        }
-        return 0;
-    };
-
-    File file;
-    if (storage_mode_ == StorageMode::SD_CARD)
-    {
-        file = SD_MMC.open(chunk.filename.c_str(), FILE_READ);
-        if (!file)
-        {
-            LOG_ERROR("Cannot open chunk for duration calculation: %s", chunk.filename.c_str());
-            return false;
-        }
-    }
-    else
-    {
-        if (!chunk.psram_ptr)
-        {
-            LOG_ERROR("Cannot calculate duration: null PSRAM pointer");
-            return false;
-        }
-    }
-
-    while (true)
-    {
-        size_t bytes_read;
-        if (storage_mode_ == StorageMode::SD_CARD)
-        {
-            if (!file.available())
-                break;
-            bytes_read = file.read(header, 4);
-        }
-        else
-        {
-            bytes_read = read_bytes(header, 4);
-        }
-
-        if (bytes_read != 4)
-            break;
-
-        if ((header[0] != 0xFF) || ((header[1] & 0xE0) != 0xE0))
-        {
-            continue;
-        }
-
-        uint8_t b1 = header[1];
-        uint8_t b2 = header[2];
-
-        int version_id = (b1 >> 3) & 0x03;
-        int layer_idx = (b1 >> 1) & 0x03;
-        int bitrate_idx = (b2 >> 4) & 0x0F;
-        int sr_idx = (b2 >> 2) & 0x03;
-        int padding = (b2 >> 1) & 0x01;
-
-        if (layer_idx == 0 || bitrate_idx == 0x0F || sr_idx == 0x03)
-        {
-            continue;
-        }
-
-        static const uint16_t bitrate_table[2][16] = {
-            {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},
-            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}};
-
-        static const uint32_t sr_table[3][3] = {
-            {44100, 48000, 32000},
-            {22050, 24000, 16000},
-            {11025, 12000, 8000}};
-
-        int version_row = (version_id == 0x03) ? 0 : 1;
-        uint32_t bitrate_kbps = bitrate_table[version_row][bitrate_idx];
-
-        int sr_row = (version_id == 0x03) ? 0 : (version_id == 0x02) ? 1
-                                                                     : 2;
-        uint32_t sample_rate = sr_table[sr_row][sr_idx];
-
-        if (bitrate_kbps == 0 || sample_rate == 0)
-        {
-            continue;
-        }
-
-        int frame_size = (144 * bitrate_kbps * 1000) / sample_rate + padding;
-        if (frame_size <= 4 || frame_size > 4096)
-        {
-            continue;
-        }
-
-        uint32_t samples_per_frame = 1152;
-        if (layer_idx == 3)
-        {
-            samples_per_frame = 384;
-        }
-        else if (layer_idx == 2)
-        {
-            samples_per_frame = 1152;
-        }
-        else
-        {
-            samples_per_frame = ((version_id == 0x03) ? 1152 : 576);
-        }
-
-        if (!header_detected)
-        {
-            header_detected = true;
-            detected_sample_rate = sample_rate;
-            detected_bitrate_kbps = bitrate_kbps;
-        }
-
-        total_samples += samples_per_frame;
-
-        if (storage_mode_ == StorageMode::SD_CARD)
-        {
-            size_t current_pos = file.position();
-            if (current_pos + frame_size - 4 <= file.size())
-            {
-                file.seek(current_pos + frame_size - 4);
-            }
-            else
-            {
-                break;
-            }
-        }
-        else
-        {
-            size_t skip_bytes = frame_size - 4;
-            if (data_pos + skip_bytes > chunk.length)
-            {
-                break;
-            }
-            data_pos += skip_bytes;
-        }
-    }
-
-    if (storage_mode_ == StorageMode::SD_CARD && file)
-    {
-        file.close();
-    }
-
-    if (!header_detected || total_samples == 0)
-    {
-        LOG_WARN("Chunk %u: no valid MP3 frames found", chunk.id);
-        return false;
-    }
-
-    out_frames = total_samples;
-    uint32_t rate_for_duration = detected_sample_rate ? detected_sample_rate : 44100;
-    out_duration_ms = (total_samples * 1000) / rate_for_duration;
-    out_bitrate_kbps = detected_bitrate_kbps;
-
-    LOG_DEBUG("Chunk %u: %u samples, %u ms @ %u Hz, bitrate %u kbps",
-              chunk.id, out_frames, out_duration_ms, rate_for_duration, out_bitrate_kbps);
-
-    return true;
-}
-
 void TimeshiftManager::promote_chunk_to_ready(ChunkInfo chunk)
 {
-    if (storage_mode_ == StorageMode::SD_CARD)
-    {
-        // Rename file from pending to ready
-        std::string ready_filename = "/timeshift/ready_" + std::to_string(chunk.id) + ".bin";
-
-        // Remove destination file if it exists (from previous session)
-        if (SD_MMC.exists(ready_filename.c_str()))
-        {
-            SD_MMC.remove(ready_filename.c_str());
-            LOG_DEBUG("Removed existing ready file: %s", ready_filename.c_str());
-        }
+    // Mark as READY (for both SD and PSRAM modes): su SD la regione resta dov'è
 
-        if (!SD_MMC.rename(chunk.filename.c_str(), ready_filename.c_str()))
-        {
-            LOG_ERROR("Failed to rename chunk %u from pending to ready", chunk.id);
-            SD_MMC.remove(chunk.filename.c_str());
-            return;
-        }
-        chunk.filename = ready_filename;
-    }
-
-    // Mark as READY (for both SD and PSRAM modes)
     chunk.state = ChunkState::READY;
 
-    // Calculate chunk duration
-    uint32_t total_frames = 0;
-    uint32_t duration_ms = 0;
-    uint32_t extracted_bitrate_kbps = 0;
-
-    if (calculate_chunk_duration(chunk, total_frames, duration_ms, extracted_bitrate_kbps))
+    // Frame e durata arrivano già dal parse inline del download task: nessuna lettura qui
+    if (chunk.total_frames > 0 && chunk.duration_ms > 0)
     {
-        chunk.total_frames = total_frames;
-        chunk.duration_ms = duration_ms;
-        chunk.start_time_ms = cumulative_time_ms_;
-
-        cumulative_time_ms_ += duration_ms; // Update cumulative time
-
-        // Use extracted bitrate for initial sizing if not yet adapted
-        if (!bitrate_adapted_once_ && extracted_bitrate_kbps > 0)
+        // Bitrate medio del chunk: più affidabile del primo header (frame Xing/Info, VBR)
+        uint32_t chunk_bitrate_kbps = (uint32_t)((uint64_t)chunk.length * 8 / chunk.duration_ms);
+        if (!bitrate_adapted_once_ && chunk_bitrate_kbps > 0)
         {
-            LOG_INFO("Bitrate extracted from first chunk header: %u kbps", extracted_bitrate_kbps);
-            calculate_adaptive_sizes(extracted_bitrate_kbps);
+            LOG_INFO("Bitrate measured on first chunk: %u kbps", chunk_bitrate_kbps);
+            calculate_adaptive_sizes(chunk_bitrate_kbps);
             bitrate_adapted_once_ = true;
         }
 
         LOG_INFO("Chunk %u promoted to READY (%u KB, offset %u-%u, %u ms, %u frames)",
                  chunk.id, chunk.length / 1024,
                  (unsigned)chunk.start_offset, (unsigned)chunk.end_offset,
-                 duration_ms, total_frames);
+                 chunk.duration_ms, chunk.total_frames);
     }
     else
     {
@@ -1862,8 +2127,22 @@ void TimeshiftManager::promote_chunk_to_ready(ChunkInfo chunk)
                  (unsigned)chunk.start_offset, (unsigned)chunk.end_offset);
     }
 
-    // Add to ready_chunks_ (already ordered by ID)
-    ready_chunks_.push_back(chunk);
+    // Add to ready_chunks_ (already ordered by ID). Indice pieno: il cleanup lascia sempre
+    // uno slot libero, qui ci si arriva solo se la zona di playback trattiene tutto
+    if (!ready_chunks_.push_back(chunk))
+    {
+        LOG_ERROR("Chunk index full (%u chunks): dropping chunk %u", (unsigned)ready_chunks_.size(), chunk.id);
+        free_chunk_storage(chunk);
+        return;
+    }
+    if (chunk.on_sd)
+    {
+        journal_ready_chunk(chunk);
+    }
+
+    // Sveglia reader sul live edge e preloader (mutex ancora preso: vedi wait_chunk_ready_locked)
+    stat_chunk_ready_++;
+    signal_events(EVT_CHUNK_READY | EVT_PRELOAD);
 }
 
 void TimeshiftManager::enforce_capacity_limits(size_t max_bytes, size_t max_slots)
@@ -1873,11 +2152,7 @@ void TimeshiftManager::enforce_capacity_limits(size_t max_bytes, size_t max_slot
         return;
     }
 
-    size_t total_ready_bytes = 0;
-    for (const auto &c : ready_chunks_)
-    {
-        total_ready_bytes += c.length;
-    }
+    size_t total_ready_bytes = (size_t)ready_chunks_.total_bytes();
 
     bool removed_any = false;
     bool playback_chunk_removed = false;
@@ -1888,7 +2163,11 @@ void TimeshiftManager::enforce_capacity_limits(size_t max_bytes, size_t max_slot
             (max_slots > 0 && ready_chunks_.back().id - ready_chunks_.front().id + 1 > max_slots)))
     {
         ChunkInfo oldest = ready_chunks_.front();
-        ready_chunks_.erase(ready_chunks_.begin());
+        ready_chunks_.pop_front();
+        if (oldest.psram_ptr)
+        {
+            slab_pool_.release(oldest.psram_ptr);
+        }
 
         if (total_ready_bytes >= oldest.length)
         {
@@ -1899,11 +2178,11 @@ void TimeshiftManager::enforce_capacity_limits(size_t max_bytes, size_t max_slot
             total_ready_bytes = 0;
         }
 
-        if (storage_mode_ == StorageMode::SD_CARD && !oldest.filename.empty())
+        if (oldest.on_sd)
         {
-            SD_MMC.remove(oldest.filename.c_str());
-            LOG_INFO("Dropped chunk abs ID %u while fitting new backend (freed %u KB, file %s)",
-                     oldest.id, oldest.length / 1024, oldest.filename.c_str());
+            release_sd_region(oldest);
+            LOG_INFO("Dropped chunk abs ID %u while fitting new backend (freed %u KB, ring @%u KB)",
+                     oldest.id, oldest.length / 1024, (unsigned)(oldest.sd_offset / 1024));
         }
         else
         {
@@ -1941,6 +2220,11 @@ void TimeshiftManager::enforce_capacity_limits(size_t max_bytes, size_t max_slot
         last_preload_check_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
         LOG_WARN("All chunks dropped while fitting capacity; playback state reset");
     }
+
+    if (removed_any)
+    {
+        trim_seek_table();
+    }
 }
 
 void TimeshiftManager::cleanup_old_chunks()
@@ -1951,8 +2235,8 @@ void TimeshiftManager::cleanup_old_chunks()
               (unsigned)current_recording_offset_);
     if (storage_mode_ == StorageMode::PSRAM_ONLY)
     {
-        size_t pool_limit_bytes = MAX_PSRAM_POOL_MB * 1024 * 1024;
-        LOG_DEBUG("PSRAM pool limit: %u MB (%u bytes)", (unsigned)MAX_PSRAM_POOL_MB, (unsigned)pool_limit_bytes);
+        size_t pool_limit_bytes = psram_pool_target_bytes();
+        LOG_DEBUG("PSRAM pool limit: %u KB (%u bytes)", (unsigned)(pool_limit_bytes / 1024), (unsigned)pool_limit_bytes);
     }
     else
     {
@@ -1974,13 +2258,9 @@ void TimeshiftManager::cleanup_old_chunks()
     size_t total_removed_bytes = 0;
     bool playback_chunk_removed = false;
 
-    size_t total_ready_bytes = 0;
-    for (const auto &c : ready_chunks_)
-    {
-        total_ready_bytes += c.length;
-    }
-    size_t pool_limit_bytes = MAX_PSRAM_POOL_MB * 1024 * 1024;
-
+    size_t total_ready_bytes = (size_t)ready_chunks_.total_bytes();
+    size_t pool_limit_bytes = psram_pool_target_bytes();
+
     while (!ready_chunks_.empty())
     {
         const ChunkInfo &oldest = ready_chunks_.front();
@@ -1993,6 +2273,14 @@ void TimeshiftManager::cleanup_old_chunks()
             pool_overflow = (total_ready_bytes > pool_limit_bytes) ||
                             (psram_pool_slots_ > 0 && ready_chunks_.size() >= psram_pool_slots_);
         }
+        else
+        {
+            // Ring più piccola della finestra (SD quasi piena o da config): il prossimo chunk
+            // deve trovare una regione libera
+            pool_overflow = sd_ring_.is_open() && !sd_ring_.fits(dynamic_chunk_size_);
+        }
+        // L'indice a ring deve avere uno slot per la prossima promozione
+        pool_overflow = pool_overflow || ready_chunks_.size() + 1 >= ready_chunks_.capacity();
 
         if (storage_mode_ == StorageMode::PSRAM_ONLY)
         {
@@ -2027,11 +2315,16 @@ void TimeshiftManager::cleanup_old_chunks()
             break;
         }
 
-        if (pool_overflow)
+        if (pool_overflow && storage_mode_ == StorageMode::PSRAM_ONLY)
         {
             LOG_WARN("CLEANUP: PSRAM pool limit reached (%u KB). Dropping oldest chunk abs ID %u to stay within pool.",
                      (unsigned)(pool_limit_bytes / 1024), oldest.id);
         }
+        else if (pool_overflow)
+        {
+            LOG_INFO("CLEANUP: SD ring full (%u MB). Recycling oldest chunk abs ID %u.",
+                     (unsigned)(sd_ring_.capacity() / (1024 * 1024)), oldest.id);
+        }
         else
         {
             LOG_INFO("CLEANUP: Removing old chunk abs ID %u (age: %u MB > limit: %u MB)",
@@ -2045,68 +2338,39 @@ void TimeshiftManager::cleanup_old_chunks()
             playback_chunk_removed = true;
         }
 
-        bool chunk_on_sd = !oldest.filename.empty();
-        bool removal_done = false;
-        bool file_missing = false;
         bool exported = false;
-
-        if (chunk_on_sd)
+        if (oldest.on_sd)
         {
-            LOG_INFO("   File: %s, Size: %u KB",
-                     oldest.filename.c_str(),
+            LOG_INFO("   Ring region @%u KB, Size: %u KB",
+                     (unsigned)(oldest.sd_offset / 1024),
                      (unsigned)(oldest.length / 1024));
 
             if (oldest.export_marked_for_move)
             {
-                removal_done = move_chunk_to_export_folder(oldest, file_missing);
-                exported = removal_done && !file_missing;
-                if (!removal_done && file_missing)
-                {
-                    LOG_WARN("   Export target missing for chunk %u, stopping cleanup", oldest.id);
-                }
-            }
-
-            if (!removal_done && !file_missing)
-            {
-                if (SD_MMC.exists(oldest.filename.c_str()))
-                {
-                    removal_done = SD_MMC.remove(oldest.filename.c_str());
-                    if (!removal_done)
-                    {
-                        LOG_ERROR("   Failed to delete file: %s", oldest.filename.c_str());
-                    }
-                }
-                else
+                exported = move_chunk_to_export_folder(oldest);
+                if (!exported)
                 {
-                    file_missing = true;
-                    removal_done = true;
-                    LOG_DEBUG("   File does not exist (already deleted): %s", oldest.filename.c_str());
+                    LOG_WARN("   Export failed for chunk %u, dropping it", oldest.id);
                 }
             }
+            release_sd_region(oldest);
         }
         else
         {
-            LOG_DEBUG("   PSRAM chunk slot %u freed (will be reused)",
-                      (unsigned)(psram_pool_slots_ ? (oldest.id % psram_pool_slots_) : 0));
-            removal_done = true;
+            LOG_DEBUG("   PSRAM chunk slab returned to pool");
         }
 
-        if (!removal_done)
+        // Anche un chunk già su SD può avere ancora lo slab (migrazione in background)
+        if (oldest.psram_ptr)
         {
-            LOG_WARN("Cleanup halted: unable to remove chunk %u", oldest.id);
-            break;
+            slab_pool_.release(oldest.psram_ptr);
         }
 
         total_removed_bytes += oldest.length;
         removed_count += 1;
         exported_count += exported ? 1 : 0;
         total_ready_bytes = (total_ready_bytes >= oldest.length) ? (total_ready_bytes - oldest.length) : 0;
-        ready_chunks_.erase(ready_chunks_.begin());
-
-        if (file_missing)
-        {
-            break;
-        }
+        ready_chunks_.pop_front();
     }
 
     if (removed_count > 0)
@@ -2137,6 +2401,7 @@ void TimeshiftManager::cleanup_old_chunks()
 
     if (removed_count > 0)
     {
+        trim_seek_table();
         LOG_INFO("CLEANUP SUMMARY: Removed %u chunks, freed %u MB, exported %u",
                  (unsigned)removed_count,
                  (unsigned)(total_removed_bytes / (1024 * 1024)),
@@ -2158,11 +2423,7 @@ void TimeshiftManager::trim_ready_chunks_for_psram_pool()
         return;
     }
 
-    size_t total_ready_bytes = 0;
-    for (const auto &chunk : ready_chunks_)
-    {
-        total_ready_bytes += chunk.length;
-    }
+    size_t total_ready_bytes = (size_t)ready_chunks_.total_bytes();
 
     size_t removed_count = 0;
     bool playback_chunk_removed = false;
@@ -2173,9 +2434,14 @@ void TimeshiftManager::trim_ready_chunks_for_psram_pool()
     {
         const ChunkInfo &oldest = ready_chunks_.front();
 
-        if (!oldest.filename.empty() && SD_MMC.exists(oldest.filename.c_str()))
+        if (oldest.on_sd)
         {
-            SD_MMC.remove(oldest.filename.c_str());
+            release_sd_region(oldest);
+        }
+
+        if (oldest.psram_ptr)
+        {
+            slab_pool_.release(oldest.psram_ptr);
         }
 
         if (oldest.id == current_playback_chunk_abs_id_)
@@ -2184,12 +2450,13 @@ void TimeshiftManager::trim_ready_chunks_for_psram_pool()
         }
 
         total_ready_bytes = (total_ready_bytes >= oldest.length) ? (total_ready_bytes - oldest.length) : 0;
-        ready_chunks_.erase(ready_chunks_.begin());
+        ready_chunks_.pop_front();
         removed_count++;
     }
 
     if (removed_count > 0)
     {
+        trim_seek_table();
         LOG_INFO("PSRAM trim: removed %u oldest chunks (%u remain)",
                  (unsigned)removed_count,
                  (unsigned)ready_chunks_.size());
@@ -2215,6 +2482,24 @@ void TimeshiftManager::trim_ready_chunks_for_psram_pool()
     }
 }
 
+void TimeshiftManager::trim_seek_table()
+{
+    // La seek table segue la finestra: senza questo crescerebbe di un'entry al secondo per
+    // tutta la registrazione, e start_journal() la scorrerebbe ogni volta dall'inizio.
+    // Finestra vuota: si aspetta la prossima eviction (il live head usa ancora la coda)
+    if (ready_chunks_.empty())
+    {
+        return;
+    }
+    size_t dropped = seek_table_.drop_before(ready_chunks_.front().start_offset);
+    journal_seek_index_ = journal_seek_index_ > dropped ? journal_seek_index_ - dropped : 0;
+    if (dropped > 0)
+    {
+        LOG_DEBUG("Seek table trimmed: %u entries dropped, %u left (%u KB)", (unsigned)dropped,
+                  (unsigned)seek_table_.size(), (unsigned)(seek_table_.memory_bytes() / 1024));
+    }
+}
+
 bool TimeshiftManager::cleanup_timeshift_directory()
 {
     if (!SD_MMC.exists(TIMESHIFT_ROOT))
@@ -2244,7 +2529,10 @@ bool TimeshiftManager::cleanup_timeshift_directory()
         bool is_dir = entry.isDirectory();
         entry.close();
 
-        if (is_dir || name.startsWith("exportedChunk"))
+        // Il file ring si riusa alla prossima apertura: riallocarlo costa molto più che tenerlo.
+        // Il journal serve a riprenderne il contenuto
+        if (is_dir || name.startsWith("exportedChunk") || name.endsWith(SD_RING_FILENAME) ||
+            name.endsWith(SD_JOURNAL_FILENAME))
         {
             preserved++;
             entry = tsDir.openNextFile();
@@ -2287,10 +2575,10 @@ bool TimeshiftManager::mark_chunk_for_export(uint32_t abs_chunk_id)
     }
 
     ChunkInfo &chunk = ready_chunks_[idx];
-    if (chunk.filename.empty())
+    if (!chunk.on_sd)
     {
         xSemaphoreGive(mutex_);
-        LOG_WARN("mark_chunk_for_export(): chunk %u has no SD file", abs_chunk_id);
+        LOG_WARN("mark_chunk_for_export(): chunk %u is not on SD", abs_chunk_id);
         return false;
     }
 
@@ -2309,17 +2597,10 @@ bool TimeshiftManager::mark_chunk_for_export(uint32_t abs_chunk_id)
     return true;
 }
 
-bool TimeshiftManager::move_chunk_to_export_folder(const ChunkInfo &chunk, bool &out_missing_file)
+bool TimeshiftManager::move_chunk_to_export_folder(const ChunkInfo &chunk)
 {
-    out_missing_file = false;
-    if (chunk.filename.empty())
-    {
-        return false;
-    }
-
-    if (!SD_MMC.exists(chunk.filename.c_str()))
+    if (!chunk.on_sd)
     {
-        out_missing_file = true;
         return false;
     }
 
@@ -2334,14 +2615,36 @@ bool TimeshiftManager::move_chunk_to_export_folder(const ChunkInfo &chunk, bool
     }
 
     std::string dest_path = export_dir + "/" + EXPORTED_CHUNK_FILENAME;
-    if (SD_MMC.exists(dest_path.c_str()))
+    File dest = SD_MMC.open(dest_path.c_str(), FILE_WRITE);
+    if (!dest)
     {
-        SD_MMC.remove(dest_path.c_str());
+        LOG_ERROR("   Cannot create %s", dest_path.c_str());
+        return false;
+    }
+
+    // La regione resta nella ring: si copia a blocchi in un file a parte
+    static constexpr size_t EXPORT_COPY_BYTES = 16 * 1024;
+    uint8_t *copy_buf = (uint8_t *)heap_caps_malloc(EXPORT_COPY_BYTES, MALLOC_CAP_SPIRAM);
+    if (!copy_buf)
+    {
+        copy_buf = (uint8_t *)heap_caps_malloc(EXPORT_COPY_BYTES, MALLOC_CAP_8BIT);
+    }
+    bool ok = copy_buf != nullptr;
+    for (size_t pos = 0; ok && pos < chunk.length; pos += EXPORT_COPY_BYTES)
+    {
+        size_t n = std::min(EXPORT_COPY_BYTES, chunk.length - pos);
+        ok = sd_ring_.read(chunk.sd_offset + (uint32_t)pos, copy_buf, n) && dest.write(copy_buf, n) == n;
+    }
+    dest.close();
+    if (copy_buf)
+    {
+        heap_caps_free(copy_buf);
     }
 
-    if (!SD_MMC.rename(chunk.filename.c_str(), dest_path.c_str()))
+    if (!ok)
     {
-        LOG_ERROR("   Failed to move chunk %u to %s", chunk.id, dest_path.c_str());
+        LOG_ERROR("   Failed to export chunk %u to %s", chunk.id, dest_path.c_str());
+        SD_MMC.remove(dest_path.c_str());
         return false;
     }
 
@@ -2357,14 +2660,8 @@ std::string TimeshiftManager::build_export_directory(uint32_t chunk_id) const
 // ========== HELPER: Convert absolute chunk ID to array index ==========
 size_t TimeshiftManager::find_chunk_index_by_id(uint32_t abs_chunk_id)
 {
-    for (size_t i = 0; i < ready_chunks_.size(); i++)
-    {
-        if (ready_chunks_[i].id == abs_chunk_id)
-        {
-            return i;
-        }
-    }
-    return INVALID_CHUNK_ID; // Not found
+    // Id contigui: aritmetica sull'id del chunk più vecchio (INVALID_CHUNK_ID se assente)
+    return ready_chunks_.index_of_id(abs_chunk_id);
 }
 
 bool TimeshiftManager::preload_next_chunk(uint32_t current_abs_chunk_id)
@@ -2373,15 +2670,7 @@ bool TimeshiftManager::preload_next_chunk(uint32_t current_abs_chunk_id)
     uint32_t next_abs_chunk_id = current_abs_chunk_id + 1;
 
     // Find the next chunk in the array
-    size_t next_idx = INVALID_CHUNK_ID;
-    for (size_t i = 0; i < ready_chunks_.size(); i++)
-    {
-        if (ready_chunks_[i].id == next_abs_chunk_id)
-        {
-            next_idx = i;
-            break;
-        }
-    }
+    size_t next_idx = find_chunk_index_by_id(next_abs_chunk_id);
 
     // Il preloader task non attende, controlla solo se il chunk è disponibile
     if (next_idx == INVALID_CHUNK_ID)
@@ -2400,16 +2689,12 @@ bool TimeshiftManager::preload_next_chunk(uint32_t current_abs_chunk_id)
     // Pre-carichiamo il successivo a [128KB-256KB].
     if (storage_mode_ == StorageMode::SD_CARD)
     {
-        File file = SD_MMC.open(next_chunk.filename.c_str(), FILE_READ);
-        if (file)
+        if (next_chunk.on_sd)
         {
             // Carica nella seconda metà del buffer
-            size_t read = file.read(playback_buffer_ + dynamic_chunk_size_, next_chunk.length);
-            file.close();
-
-            if (read != next_chunk.length)
+            if (!read_chunk_from_sd(next_chunk, playback_buffer_ + dynamic_chunk_size_))
             {
-                LOG_ERROR("Preload read mismatch: expected %u, got %u", next_chunk.length, read);
+                LOG_ERROR("Preload read failed for chunk abs ID %u", next_abs_chunk_id);
                 return false;
             }
         }
@@ -2420,7 +2705,7 @@ bool TimeshiftManager::preload_next_chunk(uint32_t current_abs_chunk_id)
         }
         else
         {
-            LOG_ERROR("Preload failed: cannot open %s", next_chunk.filename.c_str());
+            LOG_ERROR("Preload failed: chunk abs ID %u has no storage", next_abs_chunk_id);
             return false;
         }
     }
@@ -2479,23 +2764,8 @@ uint32_t TimeshiftManager::find_chunk_for_offset(size_t offset)
         return INVALID_CHUNK_ABS_ID;
     }
 
-    // Binary search per trovare il primo chunk il cui end_offset è > offset
-    size_t low = 0, high = ready_chunks_.size();
-    size_t best_match_idx = INVALID_CHUNK_ID;
-
-    while (low < high)
-    {
-        size_t mid = low + (high - low) / 2;
-        if (ready_chunks_[mid].start_offset > offset)
-        {
-            high = mid;
-        }
-        else
-        {
-            best_match_idx = mid;
-            low = mid + 1;
-        }
-    }
+    // Binary search: ultimo chunk che inizia entro offset
+    size_t best_match_idx = ready_chunks_.index_of_offset(offset);
 
     if (best_match_idx != INVALID_CHUNK_ID)
     {
@@ -2534,17 +2804,12 @@ bool TimeshiftManager::load_chunk_to_playback(uint32_t abs_chunk_id)
     // Load chunk data based on storage mode
     if (storage_mode_ == StorageMode::SD_CARD)
     {
-        // Open chunk file
-        File file = SD_MMC.open(chunk.filename.c_str(), FILE_READ);
-        if (file)
+        if (chunk.on_sd)
         {
             // Read entire chunk into playback_buffer_
-            size_t read = file.read(playback_buffer_, chunk.length);
-            file.close();
-
-            if (read != chunk.length)
+            if (!read_chunk_from_sd(chunk, playback_buffer_))
             {
-                LOG_ERROR("Chunk read mismatch: expected %u, got %u", chunk.length, read);
+                LOG_ERROR("Chunk read failed for abs ID %u", chunk.id);
                 return false;
             }
         }
@@ -2555,7 +2820,7 @@ bool TimeshiftManager::load_chunk_to_playback(uint32_t abs_chunk_id)
         }
         else
         {
-            LOG_ERROR("Failed to open chunk for playback: %s", chunk.filename.c_str());
+            LOG_ERROR("Chunk abs ID %u has no storage for playback", chunk.id);
             return false;
         }
     }
@@ -2601,6 +2866,12 @@ size_t TimeshiftManager::read_from_playback_buffer(size_t offset, void *buffer,
         return cached_bytes;
     }
 
+    size_t live_bytes = 0;
+    if (try_read_from_live_head(offset, buffer, size, live_bytes))
+    {
+        return live_bytes;
+    }
+
     // Find chunk containing this offset (returns ABSOLUTE chunk ID)
     uint32_t abs_chunk_id = find_chunk_for_offset(offset);
     if (abs_chunk_id == INVALID_CHUNK_ABS_ID)
@@ -2621,15 +2892,13 @@ size_t TimeshiftManager::read_from_playback_buffer(size_t offset, void *buffer,
                 LOG_INFO("Playback catching up to live stream, waiting for %u new ready chunk(s)...",
                          (unsigned)(target_chunk_count - initial_chunk_count));
 
-                // Wait up to 3 seconds for new chunk
+                // Wait up to 3 seconds for new chunk (risveglio alla promozione)
                 uint32_t wait_start = millis();
                 const uint32_t MAX_WAIT_MS = 3000;
 
                 while (!playback_stop_requested_ && is_running_ && (millis() - wait_start) < MAX_WAIT_MS)
                 {
-                    xSemaphoreGive(mutex_);
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                    xSemaphoreTake(mutex_, portMAX_DELAY);
+                    wait_chunk_ready_locked(MAX_WAIT_MS - std::min<uint32_t>(MAX_WAIT_MS, millis() - wait_start));
 
                     // Check if new chunk arrived
                     if (ready_chunks_.size() >= target_chunk_count &&
@@ -2688,6 +2957,19 @@ size_t TimeshiftManager::read_from_playback_buffer(size_t offset, void *buffer,
         last_preload_check_chunk_abs_id_ = INVALID_CHUNK_ABS_ID; // Resetta il tracking per il nuovo chunk
         LOG_DEBUG("Switching to preloaded chunk abs ID %u (seamless)", abs_chunk_id);
     }
+    else if (reading_live_head_)
+    {
+        // Dal live head al chunk appena promosso con gli stessi byte: nessun salto, niente
+        // auto-pausa. Il caricamento (una lettura SD o una memcpy) lo copre il ring PCM
+        if (!load_chunk_to_playback(abs_chunk_id))
+        {
+            LOG_ERROR("Failed to load chunk abs ID %u after the live head", abs_chunk_id);
+            return 0;
+        }
+        reading_live_head_ = false;
+        last_preload_check_chunk_abs_id_ = INVALID_CHUNK_ABS_ID;
+        LOG_DEBUG("Live head -> chunk abs ID %u", abs_chunk_id);
+    }
     else if (current_playback_chunk_abs_id_ != abs_chunk_id)
     {
     // Seek o situazione anomala: carica il chunk richiesto da SD (potrebbe causare stutter)
@@ -2731,8 +3013,9 @@ size_t TimeshiftManager::read_from_playback_buffer(size_t offset, void *buffer,
                 // Rilascia il mutex durante l'attesa per non bloccare il download task
                 if (auto_pause_delay_ms_ > 0)
                 {
+                    // Ritardo voluto, interrotto solo dallo stop
                     xSemaphoreGive(mutex_);
-                    vTaskDelay(pdMS_TO_TICKS(auto_pause_delay_ms_));
+                    xEventGroupWaitBits(events_, EVT_STOP, pdFALSE, pdFALSE, pdMS_TO_TICKS(auto_pause_delay_ms_));
                     xSemaphoreTake(mutex_, portMAX_DELAY);
                     if (playback_stop_requested_)
                     {
@@ -2747,13 +3030,11 @@ size_t TimeshiftManager::read_from_playback_buffer(size_t offset, void *buffer,
                     uint32_t start_wait = millis();
                     size_t target_chunks = ready_chunks_.size() + auto_pause_min_chunks_;
 
-                    while (!playback_stop_requested_ &&
+                    while (!playback_stop_requested_ && is_running_ &&
                            ready_chunks_.size() < target_chunks &&
                            (millis() - start_wait) < MAX_WAIT_MS)
                     {
-                        xSemaphoreGive(mutex_);
-                        vTaskDelay(pdMS_TO_TICKS(100));
-                        xSemaphoreTake(mutex_, portMAX_DELAY);
+                        wait_chunk_ready_locked(MAX_WAIT_MS - std::min<uint32_t>(MAX_WAIT_MS, millis() - start_wait));
                     }
                     if (playback_stop_requested_)
                     {
@@ -2785,12 +3066,20 @@ size_t TimeshiftManager::read_from_playback_buffer(size_t offset, void *buffer,
     // Copia i dati dal buffer di playback
     memcpy(buffer, playback_buffer_ + chunk_offset, to_read);
 
+    // Superata la metà del chunk: il preloader carica il successivo (una volta per chunk)
+    if (last_preload_check_chunk_abs_id_ != abs_chunk_id && chunk_offset + to_read >= chunk.length / 2)
+    {
+        last_preload_check_chunk_abs_id_ = abs_chunk_id;
+        stat_preload_events_++;
+        signal_events(EVT_PRELOAD);
+    }
+
     return to_read;
 }
 
 // ========== TEMPORAL SEEK METHODS ==========
 
-size_t TimeshiftManager::seek_to_time(uint32_t target_ms)
+size_t TimeshiftManager::seek_to_time(uint32_t target_ms, TimeSeekPoint *point)
 {
     // --- NUOVA LOGICA DI SEEK RELATIVO ---
     // Tratta sempre il target_ms come un offset relativo alla durata totale del buffer disponibile.
@@ -2799,18 +3088,35 @@ size_t TimeshiftManager::seek_to_time(uint32_t target_ms)
 
     xSemaphoreTake(mutex_, portMAX_DELAY);
 
-    if (ready_chunks_.empty())
+    // Live head: prima della promozione del primo chunk si può cercare solo nella seek table
+    const bool live_only = ready_chunks_.empty() && live_head_enabled_ && seek_table_.is_ready();
+    if (ready_chunks_.empty() && !live_only)
     {
         xSemaphoreGive(mutex_);
         LOG_WARN("Seek to time failed: no ready chunks available");
         return SIZE_MAX; // Invalid offset
     }
 
-    // 1. Calcola la durata totale del buffer disponibile
-    uint32_t total_duration_ms = 0;
-    for (const auto &c : ready_chunks_)
+    // 1. Durata totale del buffer disponibile (somma prefissa dell'indice), con il live head
+    // anche il tratto già indicizzato del chunk in registrazione
+    uint32_t total_duration_ms = (uint32_t)ready_chunks_.total_duration_ms();
+    uint64_t window_start = 0;
+    size_t window_start_offset = current_recording_offset_;
+    uint64_t window_end_frames = 0;
+    size_t window_end_offset = ready_end_offset();
+    if (!ready_chunks_.empty())
     {
-        total_duration_ms += c.duration_ms;
+        const ChunkInfo &oldest = ready_chunks_.front();
+        window_start = oldest.end_frames - oldest.total_frames;
+        window_start_offset = oldest.start_offset;
+        window_end_frames = ready_chunks_.back().end_frames;
+    }
+    if (live_head_enabled_ && seek_table_.sample_rate() > 0 && seek_table_.covered_frames() > window_end_frames)
+    {
+        window_end_frames = seek_table_.covered_frames();
+        window_end_offset = std::max(window_end_offset, download_head_.load());
+        total_duration_ms = std::max(total_duration_ms,
+                                     (uint32_t)((window_end_frames - window_start) * 1000 / seek_table_.sample_rate()));
     }
 
     // 2. Limita (clampa) il target alla durata disponibile
@@ -2821,49 +3127,145 @@ size_t TimeshiftManager::seek_to_time(uint32_t target_ms)
         target_ms = total_duration_ms > 0 ? total_duration_ms - 1 : 0; // Vai alla fine
     }
 
-    // 3. Itera sui chunk per trovare la posizione corretta
-    uint32_t accumulated_duration_ms = 0;
-    for (const auto &chunk : ready_chunks_)
+    // 3. Seek table: l'entry che precede il target è un confine di frame con il suo indice
+    // esatto. Il decoder riparte da lì e scarta i campioni fino al target
+    const uint32_t sample_rate = seek_table_.sample_rate();
+    if (sample_rate > 0 && seek_table_.is_ready())
     {
-        if (target_ms < accumulated_duration_ms + chunk.duration_ms)
+        uint64_t target = window_start + (uint64_t)target_ms * sample_rate / 1000;
+        uint64_t byte = 0;
+        uint64_t frame = 0;
+        bool found = seek_table_.find_seek_point(target, &byte, &frame);
+        // Entry precedente già riciclata (primo tratto del buffer): si atterra sulla prima
+        // entry dentro il buffer, un po' dopo il target
+        uint64_t probe = target;
+        while (found && byte < window_start_offset && probe < window_end_frames)
         {
-            // Trovato il chunk corretto!
-            uint32_t time_into_chunk = target_ms - accumulated_duration_ms;
-            float progress_in_chunk = (float)time_into_chunk / (float)chunk.duration_ms;
-
-            // Stima l'offset in byte basato sulla progressione temporale (interpolazione lineare)
-            size_t byte_offset_in_chunk = (size_t)(chunk.length * progress_in_chunk);
-            size_t final_offset = chunk.start_offset + byte_offset_in_chunk;
-
-            LOG_INFO("Seek to %u ms (relative) -> chunk %u, byte offset %u (progress %.1f%%)",
-                     target_ms, chunk.id, (unsigned)final_offset, progress_in_chunk * 100.0f);
-
+            probe += seek_table_.frames_per_entry();
+            found = seek_table_.find_seek_point(probe, &byte, &frame);
+        }
+        target = std::max(target, frame);
+        if (found && byte >= window_start_offset && byte < window_end_offset && frame >= window_start &&
+            target < window_end_frames)
+        {
+            const uint64_t landed = target - window_start;
+            const uint32_t landed_ms = (uint32_t)(landed * 1000 / sample_rate);
+            if (point)
+            {
+                point->byte_offset = (size_t)byte;
+                point->stream_frame = target;
+                point->landed_frame = landed;
+                point->landed_ms = landed_ms;
+                point->exact = true;
+            }
             xSemaphoreGive(mutex_);
-            return final_offset;
+            LOG_INFO("Seek to %u ms (relative) -> frame %llu (%u ms), entry at byte %u (frame %llu)",
+                     target_ms, (unsigned long long)target, landed_ms, (unsigned)byte,
+                     (unsigned long long)frame);
+            return (size_t)byte;
         }
-        accumulated_duration_ms += chunk.duration_ms;
+        LOG_DEBUG("Seek table does not cover %u ms, estimating the offset", target_ms);
+    }
+    if (ready_chunks_.empty())
+    {
+        xSemaphoreGive(mutex_);
+        LOG_WARN("Seek to time failed: %u ms not yet indexed on the live head", target_ms);
+        return SIZE_MAX;
     }
+    const ChunkInfo &newest = ready_chunks_.back();
+
+    // 4. Senza seek table: ricerca binaria sulle somme prefisse e interpolazione lineare nel chunk
+    size_t final_offset = newest.start_offset;
+    uint32_t landed_ms = (uint32_t)ready_chunks_.ms_before(ready_chunks_.size() - 1);
+    size_t idx = ready_chunks_.index_of_time(target_ms);
+    if (idx != INVALID_CHUNK_ID)
+    {
+        const ChunkInfo &chunk = ready_chunks_[idx];
+        uint32_t time_into_chunk = target_ms - (uint32_t)ready_chunks_.ms_before(idx);
+        float progress_in_chunk = (float)time_into_chunk / (float)chunk.duration_ms;
 
-    // Fallback: se qualcosa va storto, vai all'inizio dell'ultimo chunk
-    LOG_WARN("Seek failed to find position, falling back to last chunk start.");
-    size_t fallback_offset = ready_chunks_.back().start_offset;
+        // Stima l'offset in byte basato sulla progressione temporale (interpolazione lineare)
+        size_t byte_offset_in_chunk = (size_t)(chunk.length * progress_in_chunk);
+        final_offset = chunk.start_offset + byte_offset_in_chunk;
+        landed_ms = target_ms;
+
+        LOG_INFO("Seek to %u ms (relative) -> chunk %u, byte offset %u (progress %.1f%%, estimated)",
+                 target_ms, chunk.id, (unsigned)final_offset, progress_in_chunk * 100.0f);
+    }
+    else
+    {
+        // Fallback: se qualcosa va storto, vai all'inizio dell'ultimo chunk
+        LOG_WARN("Seek failed to find position, falling back to last chunk start.");
+    }
+    if (point)
+    {
+        point->byte_offset = final_offset;
+        point->stream_frame = 0;
+        point->landed_frame = 0;
+        point->landed_ms = landed_ms;
+        point->exact = false;
+    }
     xSemaphoreGive(mutex_);
-    return fallback_offset;
+    return final_offset;
 }
 
-uint32_t TimeshiftManager::total_duration_ms() const
+bool TimeshiftManager::window_start_frame(uint64_t *frame) const
 {
+    if (!frame || seek_table_.sample_rate() == 0)
+        return false;
     if (ready_chunks_.empty())
-        return 0;
+    {
+        // Live head prima del primo chunk: i dati partono dal primo frame dello stream
+        if (!live_head_enabled_)
+            return false;
+        *frame = 0;
+        return true;
+    }
+
+    const ChunkInfo &oldest = ready_chunks_.front();
+    *frame = oldest.end_frames - oldest.total_frames;
+    return true;
+}
 
-    // Sum all chunk durations
-    uint32_t total = 0;
-    for (const auto &chunk : ready_chunks_)
+bool TimeshiftManager::read_start_frame(uint64_t *frame) const
+{
+    // Reader partito dalla sessione corrente dopo un ripristino (vedi read_start_offset())
+    if (frame && seek_table_.sample_rate() > 0 && session_start_offset_ > 0 &&
+        (ready_chunks_.empty() || ready_chunks_.front().start_offset < session_start_offset_))
     {
-        total += chunk.duration_ms;
+        *frame = session_start_frames_;
+        return true;
     }
+    return window_start_frame(frame);
+}
+
+uint32_t TimeshiftManager::total_duration_ms() const
+{
+    // Somma prefissa: O(1) anche a ogni tick del callback di progresso
+    uint32_t ready_ms = (uint32_t)ready_chunks_.total_duration_ms();
+    if (!live_head_enabled_)
+        return ready_ms;
+
+    // Il live head è riproducibile: la durata arriva fino all'ultimo frame scansionato
+    uint32_t head_ms = head_duration_ms_.load();
+    uint32_t window_start_ms = ready_chunks_.empty() ? 0 : ready_chunks_.front().start_time_ms;
+    return head_ms > window_start_ms ? std::max(ready_ms, head_ms - window_start_ms) : ready_ms;
+}
 
-    return total;
+int32_t TimeshiftManager::live_edge_distance_ms() const
+{
+    if (!is_running_)
+        return -1;
+
+    // Nessun mutex: la chiamano il task audio e il servo di deriva a ogni blocco
+    size_t head = download_head_.load();
+    size_t read = current_read_offset_;
+    if (head <= read)
+        return 0;
+
+    uint32_t kbps = detected_bitrate_kbps_ != 0 ? detected_bitrate_kbps_ : DEFAULT_BITRATE_KBPS;
+    uint64_t ms = (uint64_t)(head - read) * 8 / kbps;
+    return ms > (uint64_t)INT32_MAX ? INT32_MAX : (int32_t)ms;
 }
 
 uint32_t TimeshiftManager::current_position_ms() const
@@ -2871,33 +3273,24 @@ uint32_t TimeshiftManager::current_position_ms() const
     if (ready_chunks_.empty())
         return 0;
 
-    uint32_t base_start_time = ready_chunks_.front().start_time_ms;
-
-    // Find the chunk containing current_read_offset_
-    for (const auto &chunk : ready_chunks_)
+    // Chunk che contiene current_read_offset_ (binaria), tempo dalle somme prefisse
+    size_t idx = ready_chunks_.index_of_offset(current_read_offset_);
+    if (idx != INVALID_CHUNK_ID && current_read_offset_ < ready_chunks_[idx].end_offset)
     {
-        if (current_read_offset_ >= chunk.start_offset &&
-            current_read_offset_ < chunk.end_offset)
-        {
+        const ChunkInfo &chunk = ready_chunks_[idx];
 
-            // Calculate relative offset within chunk
-            size_t offset_in_chunk = current_read_offset_ - chunk.start_offset;
-            float progress = (float)offset_in_chunk / (float)chunk.length;
+        // Calculate relative offset within chunk
+        size_t offset_in_chunk = current_read_offset_ - chunk.start_offset;
+        float progress = (float)offset_in_chunk / (float)chunk.length;
 
-            // Calculate time within chunk
-            uint32_t time_in_chunk = (uint32_t)(chunk.duration_ms * progress);
+        // Calculate time within chunk
+        uint32_t time_in_chunk = (uint32_t)(chunk.duration_ms * progress);
 
-            return (chunk.start_time_ms - base_start_time) + time_in_chunk;
-        }
+        return (uint32_t)ready_chunks_.ms_before(idx) + time_in_chunk;
     }
 
     // Fallback: if not found, assume at end of buffer
-    uint32_t total = 0;
-    for (const auto &chunk : ready_chunks_)
-    {
-        total += chunk.duration_ms;
-    }
-    return total;
+    return (uint32_t)ready_chunks_.total_duration_ms();
 }
 
 // ========== PAUSE/RESUME METHODS ==========
@@ -2941,92 +3334,359 @@ bool TimeshiftManager::switchStorageMode(StorageMode new_mode)
 
 // ========== STORAGE BACKEND HELPERS ==========
 
+bool TimeshiftManager::init_slab_pool()
+{
+    if (!slab_pool_.init(dynamic_chunk_size_, SLABS_IN_FLIGHT))
+    {
+        LOG_ERROR("Failed to allocate chunk slabs (%u x %u KB)",
+                  (unsigned)SLABS_IN_FLIGHT, (unsigned)(dynamic_chunk_size_ / 1024));
+        slab_pool_.release_all();
+        return false;
+    }
+
+    LOG_INFO("Chunk slab pool: %u slabs x %u KB in flight",
+             (unsigned)slab_pool_.total(), (unsigned)(slab_pool_.slab_bytes() / 1024));
+    return true;
+}
+
+size_t TimeshiftManager::psram_pool_target_bytes() const
+{
+    return hub_ ? hub_->psram_share_bytes() : MAX_PSRAM_POOL_MB * 1024 * 1024;
+}
+
 bool TimeshiftManager::init_psram_pool()
 {
-    if (psram_chunk_pool_)
+    if (psram_pool_slots_ > 0)
     {
         LOG_WARN("PSRAM pool already allocated");
         return true;
     }
 
-    // Allocate pool targeting MAX_PSRAM_POOL_MB (derive slots from current chunk size)
-    size_t target_pool_bytes = MAX_PSRAM_POOL_MB * 1024 * 1024;
-    psram_slot_size_ = dynamic_chunk_size_;
-    if (target_pool_bytes < psram_slot_size_)
+    size_t slab_bytes = slab_pool_.slab_bytes();
+    if (slab_bytes == 0)
     {
-        target_pool_bytes = psram_slot_size_;
+        LOG_ERROR("PSRAM pool requested before the chunk slab pool");
+        return false;
     }
 
-    psram_pool_slots_ = std::max<size_t>(2, target_pool_bytes / psram_slot_size_);
-    psram_pool_size_ = psram_pool_slots_ * psram_slot_size_;
-
-    // Try to allocate in PSRAM first (heap_caps_malloc with MALLOC_CAP_SPIRAM)
-    psram_chunk_pool_ = (uint8_t *)heap_caps_malloc(psram_pool_size_, MALLOC_CAP_SPIRAM);
+    // Slot READY derivati da MAX_PSRAM_POOL_MB (o dalla quota dell'hub), in aggiunta agli slab in volo
+    size_t target_pool_bytes = std::max(psram_pool_target_bytes(), slab_bytes);
+    size_t slots = std::max<size_t>(2, target_pool_bytes / slab_bytes);
 
-    if (!psram_chunk_pool_)
+    if (!slab_pool_.grow(slots + SLABS_IN_FLIGHT))
     {
-        LOG_ERROR("Failed to allocate %u KB in PSRAM", psram_pool_size_ / 1024);
-        psram_pool_size_ = 0;
+        LOG_ERROR("Failed to allocate %u KB in PSRAM", (unsigned)(slots * slab_bytes / 1024));
+        slab_pool_.shrink(SLABS_IN_FLIGHT);
         return false;
     }
 
-    LOG_INFO("PSRAM pool allocated: %u KB (%u chunks x %u KB) [target %u MB]",
-             psram_pool_size_ / 1024, (unsigned)psram_pool_slots_, psram_slot_size_ / 1024,
-             (unsigned)MAX_PSRAM_POOL_MB);
+    psram_pool_slots_ = slots;
+    psram_pool_size_ = slots * slab_bytes;
+
+    LOG_INFO("PSRAM pool allocated: %u KB (%u chunks x %u KB + %u in flight) [target %u KB]",
+             (unsigned)(psram_pool_size_ / 1024), (unsigned)psram_pool_slots_, (unsigned)(slab_bytes / 1024),
+             (unsigned)SLABS_IN_FLIGHT, (unsigned)(psram_pool_target_bytes() / 1024));
+
+    return true;
+}
+
+bool TimeshiftManager::init_sd_ring()
+{
+    if (sd_ring_.is_open())
+    {
+        sd_ring_.reset();
+        return true;
+    }
+
+    // Spazio disponibile per la ring: libero + il file ring già presente (si riusa)
+    uint64_t existing = 0;
+    if (SD_MMC.exists(sd_ring_path_.c_str()))
+    {
+        File ring = SD_MMC.open(sd_ring_path_.c_str(), FILE_READ);
+        existing = ring ? ring.size() : 0;
+        ring.close();
+    }
+    uint64_t total = SD_MMC.totalBytes();
+    uint64_t used = SD_MMC.usedBytes();
+    uint64_t available = (total > used ? total - used : 0) + existing;
+    uint64_t limit = available * SD_RING_FREE_PERCENT / 100;
+
+    uint64_t capacity = sd_ring_capacity_bytes_ ? sd_ring_capacity_bytes_ : MAX_TS_WINDOW + SD_RING_SLACK_BYTES;
+    if (!sd_ring_capacity_bytes_ && hub_)
+    {
+        capacity = hub_->sd_share_bytes(); // Quota della ring nel budget SD dell'hub
+    }
+    if (capacity > limit)
+    {
+        LOG_WARN("SD ring limited by free space: %u MB instead of %u MB",
+                 (unsigned)(limit / (1024 * 1024)), (unsigned)(capacity / (1024 * 1024)));
+        capacity = limit;
+    }
+    if (capacity < SD_RING_MIN_BYTES)
+    {
+        LOG_ERROR("Not enough SD space for the timeshift ring (%u KB available)", (unsigned)(available / 1024));
+        return false;
+    }
 
+    if (!sd_ring_.open(SD_MMC, sd_ring_path_.c_str(), (size_t)capacity))
+    {
+        LOG_ERROR("Failed to open SD ring %s", sd_ring_path_.c_str());
+        return false;
+    }
     return true;
 }
 
 void TimeshiftManager::free_psram_pool()
 {
-    if (psram_chunk_pool_)
+    // Gli slab dei chunk READY tornano al pool, poi restano allocati solo quelli in volo
+    for (auto &c : ready_chunks_)
+    {
+        if (c.psram_ptr)
+        {
+            slab_pool_.release(c.psram_ptr);
+            c.psram_ptr = nullptr;
+        }
+    }
+
+    if (psram_pool_slots_ > 0)
     {
-        heap_caps_free(psram_chunk_pool_);
-        psram_chunk_pool_ = nullptr;
         psram_pool_size_ = 0;
         psram_pool_slots_ = 0;
-        psram_slot_size_ = 0;
-        LOG_DEBUG("PSRAM pool freed");
+        slab_pool_.shrink(SLABS_IN_FLIGHT);
+        LOG_DEBUG("PSRAM pool freed (%u slabs left)", (unsigned)slab_pool_.total());
+    }
+}
+
+void TimeshiftManager::free_chunk_storage(ChunkInfo &chunk)
+{
+    if (chunk.on_sd)
+    {
+        release_sd_region(chunk);
+        chunk.on_sd = false;
+        LOG_DEBUG("SD ring region of chunk %u released", chunk.id);
+    }
+    if (chunk.psram_ptr)
+    {
+        slab_pool_.release(chunk.psram_ptr);
+        chunk.psram_ptr = nullptr;
+        LOG_DEBUG("PSRAM chunk %u slab returned to pool", chunk.id);
     }
 }
 
-uint8_t *TimeshiftManager::allocate_psram_chunk(uint32_t chunk_id)
+void TimeshiftManager::release_sd_region(const ChunkInfo &chunk)
 {
-    if (!psram_chunk_pool_)
+    // Prima l'eviction nel journal, poi la regione torna libera: un reset in mezzo non
+    // può far ripristinare un chunk la cui regione è già stata riscritta
+    journal_.append_evict(chunk.id);
+    sd_ring_.release(chunk.sd_offset);
+}
+
+void TimeshiftManager::journal_ready_chunk(const ChunkInfo &chunk)
+{
+    if (!journal_.is_open() || !chunk.on_sd)
+    {
+        return;
+    }
+
+    if (!journal_.has_seek_params() && seek_table_.sample_rate() > 0)
+    {
+        journal_.append_seek_params(seek_table_.sample_rate(), seek_table_.frames_per_entry(),
+                                    seek_table_.frame_quantum());
+    }
+
+    // Entry della seek table fino alla fine del chunk: viaggiano nella stessa scrittura
+    journal_points_.clear();
+    uint64_t frame = 0;
+    uint64_t byte = 0;
+    while (journal_seek_index_ < seek_table_.size() &&
+           seek_table_.get_entry(journal_seek_index_, &frame, &byte) && byte < chunk.end_offset)
+    {
+        TimeshiftJournal::SeekPoint point = {frame, byte};
+        journal_points_.push_back(point);
+        ++journal_seek_index_;
+    }
+
+    TimeshiftJournal::Chunk record = {chunk.id, (uint32_t)chunk.start_offset, (uint32_t)chunk.length,
+                                      chunk.sd_offset, chunk.start_time_ms, chunk.duration_ms,
+                                      chunk.total_frames, chunk.end_frames};
+    journal_.append_chunk(record, journal_points_.data(), journal_points_.size());
+
+    if (journal_.size_bytes() > SD_JOURNAL_COMPACT_BYTES)
     {
-        LOG_ERROR("PSRAM pool not initialized");
-        return nullptr;
+        start_journal();
     }
+}
+
+void TimeshiftManager::start_journal()
+{
+    TimeshiftJournal::State state;
+    state.uri_hash = TimeshiftJournal::hash_uri(uri_.c_str());
+    state.ring_capacity = (uint32_t)sd_ring_.capacity();
+    state.sample_rate = seek_table_.sample_rate();
+    state.frames_per_entry = seek_table_.frames_per_entry();
+    state.frame_quantum = seek_table_.frame_quantum();
 
-    if (psram_pool_slots_ == 0 || psram_slot_size_ == 0)
+    // Chunk nell'ordine di allocazione della ring (il replay li riadotta in quest'ordine)
+    std::vector<size_t> by_offset;
+    for (size_t i = 0; i < ready_chunks_.size(); ++i)
     {
-        LOG_ERROR("PSRAM pool slots not set");
-        return nullptr;
+        if (ready_chunks_[i].on_sd)
+        {
+            by_offset.push_back(i);
+        }
     }
+    std::sort(by_offset.begin(), by_offset.end(), [this](size_t a, size_t b)
+              { return ready_chunks_[a].sd_offset < ready_chunks_[b].sd_offset; });
 
-    // Calculate circular index based on next_chunk_id_
-    size_t pool_index = chunk_id % psram_pool_slots_;
-    uint8_t *chunk_ptr = psram_chunk_pool_ + (pool_index * psram_slot_size_);
+    std::vector<uint32_t> offsets;
+    sd_ring_.live_offsets(offsets);
+    size_t oldest = SIZE_MAX;
+    size_t newest_end = 0;
+    for (uint32_t offset : offsets)
+    {
+        auto it = std::lower_bound(by_offset.begin(), by_offset.end(), offset, [this](size_t idx, uint32_t off)
+                                   { return ready_chunks_[idx].sd_offset < off; });
+        if (it == by_offset.end() || ready_chunks_[*it].sd_offset != offset)
+        {
+            continue; // Regione di un chunk ancora nel writer: entra nel journal alla promozione
+        }
+        const ChunkInfo &c = ready_chunks_[*it];
+        TimeshiftJournal::Chunk record = {c.id, (uint32_t)c.start_offset, (uint32_t)c.length, c.sd_offset,
+                                          c.start_time_ms, c.duration_ms, c.total_frames, c.end_frames};
+        state.chunks.push_back(record);
+        oldest = std::min(oldest, c.start_offset);
+        newest_end = std::max(newest_end, c.end_offset);
+    }
 
-    LOG_DEBUG("Allocated PSRAM chunk at pool index %u (chunk ID %u)",
-              (unsigned)pool_index, chunk_id);
+    // Entry già nel journal che cadono dentro i chunk vivi
+    uint64_t frame = 0;
+    uint64_t byte = 0;
+    for (size_t i = 0; i < journal_seek_index_ && !state.chunks.empty(); ++i)
+    {
+        if (seek_table_.get_entry(i, &frame, &byte) && byte >= oldest && byte < newest_end)
+        {
+            TimeshiftJournal::SeekPoint point = {frame, byte};
+            state.seek.push_back(point);
+        }
+    }
 
-    return chunk_ptr;
+    if (!journal_.start(SD_MMC, sd_journal_path_.c_str(), state))
+    {
+        LOG_WARN("Timeshift journal unavailable: history will not survive a reboot");
+    }
 }
 
-void TimeshiftManager::free_chunk_storage(ChunkInfo &chunk)
+bool TimeshiftManager::restore_from_journal()
 {
-    if (storage_mode_ == StorageMode::SD_CARD)
+    journal_seek_index_ = 0;
+
+    // Il contenuto della ring è valido solo se il file non è stato ricreato o ridimensionato
+    TimeshiftJournal::State state;
+    if (!sd_ring_.reused() || !TimeshiftJournal::load(SD_MMC, sd_journal_path_.c_str(), state))
+    {
+        return false;
+    }
+    if (state.uri_hash != TimeshiftJournal::hash_uri(uri_.c_str()) || state.ring_capacity != sd_ring_.capacity())
+    {
+        LOG_INFO("Timeshift journal belongs to another stream or ring size, starting fresh");
+        return false;
+    }
+    if (state.chunks.empty())
+    {
+        return false;
+    }
+    // Età dal timestamp del file, se l'orologio è impostato (altrimenti epoch ~0 su entrambi)
+    const time_t now = time(nullptr);
+    if (journal_max_age_s_ > 0 && now > kClockValidEpoch && state.saved_at > kClockValidEpoch &&
+        (uint32_t)(now - state.saved_at) > journal_max_age_s_)
+    {
+        LOG_INFO("Timeshift journal is %u s old (max %u s), starting fresh",
+                 (unsigned)(now - state.saved_at), (unsigned)journal_max_age_s_);
+        return false;
+    }
+
+    uint32_t start_ms = millis();
+    for (const auto &c : state.chunks)
     {
-        if (!chunk.filename.empty())
+        if (!sd_ring_.adopt(c.sd_offset, c.length))
         {
-            SD_MMC.remove(chunk.filename.c_str());
-            LOG_DEBUG("Removed SD file: %s", chunk.filename.c_str());
+            LOG_WARN("Timeshift journal: region @%u of chunk %u does not fit the ring, starting fresh",
+                     (unsigned)c.sd_offset, c.id);
+            sd_ring_.reset();
+            return false;
         }
     }
-    else
+
+    // ready_chunks_ è in ordine di stream. Si tiene solo la coda contigua che arriva al chunk
+    // più recente: un buco (chunk perso in scrittura) fermerebbe il playback a metà
+    std::vector<TimeshiftJournal::Chunk> chunks = state.chunks;
+    std::sort(chunks.begin(), chunks.end(), [](const TimeshiftJournal::Chunk &a, const TimeshiftJournal::Chunk &b)
+              { return a.id < b.id; });
+    size_t first = chunks.size() - 1;
+    while (first > 0 && chunks[first - 1].id + 1 == chunks[first].id &&
+           chunks[first - 1].start_offset + chunks[first - 1].length == chunks[first].start_offset)
+    {
+        --first;
+    }
+    // L'indice ha capacità fissa: oltre si tengono solo i chunk più recenti
+    const size_t max_restore = ready_chunks_.capacity() - SLABS_IN_FLIGHT;
+    if (chunks.size() - first > max_restore)
+    {
+        first = chunks.size() - max_restore;
+    }
+    for (size_t i = 0; i < first; ++i)
     {
-        // PSRAM mode: nothing to free (pool is reused circularly)
-        LOG_DEBUG("PSRAM chunk %u freed (slot reusable)", chunk.id);
+        sd_ring_.release(chunks[i].sd_offset);
     }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (size_t i = first; i < chunks.size(); ++i)
+    {
+        const TimeshiftJournal::Chunk &c = chunks[i];
+        ChunkInfo chunk;
+        chunk.id = c.id;
+        chunk.start_offset = c.start_offset;
+        chunk.length = c.length;
+        chunk.end_offset = (size_t)c.start_offset + c.length;
+        chunk.on_sd = true;
+        chunk.sd_offset = c.sd_offset;
+        chunk.psram_ptr = nullptr;
+        chunk.state = ChunkState::READY;
+        chunk.crc32 = 0;
+        chunk.start_time_ms = c.start_time_ms;
+        chunk.duration_ms = c.duration_ms;
+        chunk.total_frames = c.total_frames;
+        chunk.end_frames = c.end_frames;
+        ready_chunks_.push_back(chunk);
+    }
+
+    // La registrazione prosegue dopo l'ultimo chunk: offset, id e frame continuano la storia
+    const ChunkInfo &last = ready_chunks_.back();
+    next_chunk_id_ = last.id + 1;
+    current_recording_offset_ = last.end_offset;
+    download_head_.store(last.end_offset);
+    chunk_start_frames_ = last.end_frames;
+    // La storia è solo rewind: come in una sessione nuova la lettura parte dal download head
+    // (live head), i chunk ripristinati si raggiungono con seek_to_time()
+    session_start_offset_ = last.end_offset;
+    session_start_frames_ = last.end_frames;
+    current_read_offset_ = session_start_offset_;
+
+    seek_table_.begin(state.sample_rate, state.frames_per_entry, 0, state.frame_quantum);
+    for (const auto &point : state.seek)
+    {
+        if (point.byte_offset >= ready_chunks_.front().start_offset)
+        {
+            seek_table_.add_entry(point.pcm_frame, point.byte_offset);
+        }
+    }
+    seek_table_.set_coverage(last.end_frames, last.end_offset);
+    journal_seek_index_ = seek_table_.size();
+
+    const uint32_t history_s = (last.start_time_ms + last.duration_ms - ready_chunks_.front().start_time_ms) / 1000;
+    LOG_INFO("Timeshift history restored from journal: %u chunks (%u-%u, %u s), %u seek entries in %u ms",
+             (unsigned)ready_chunks_.size(), ready_chunks_.front().id, last.id, (unsigned)history_s,
+             (unsigned)seek_table_.size(), (unsigned)(millis() - start_ms));
+    xSemaphoreGive(mutex_);
+    return true;
 }
@@ -6,18 +6,25 @@
 
 #include "data_source.h"
 #include "mp3_seek_table.h"
+#include "chunk_slab_pool.h"
+#include "sd_chunk_ring.h"
+#include "timeshift_journal.h"
+#include "timeshift_chunk_index.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
+#include <freertos/event_groups.h>
 #include <freertos/queue.h>
 #include <vector>
 #include <string>
 #include <memory>
 #include <functional>
 #include <deque>
+#include <atomic>
 
 // Forward declarations
 class HTTPClient;
+class RecordingHub;
 
 // Storage backend selection
 enum class StorageMode {
@@ -25,6 +32,27 @@ enum class StorageMode {
     PSRAM_ONLY  // Keep all chunks in PSRAM (faster, higher memory usage)
 };
 
+// Contatori delle attese di reader e preloader: i risvegli per timeout restano vicini a
+// zero quando lo stream scorre, quindi nessuno dei due fa polling
+struct TimeshiftWaitStats {
+    uint32_t chunk_ready_events = 0;   // Chunk promossi a READY (segnali emessi)
+    uint32_t preload_events = 0;       // Soglia di preload superata dal playback
+    uint32_t preloader_wakeups = 0;    // Risvegli del preloader per evento
+    uint32_t preloader_timeouts = 0;   // ... per timeout (chunk successivo in ritardo, switch backend)
+    uint32_t reader_waits = 0;         // Attese del reader (avvio, live edge, margine, decoder)
+    uint32_t reader_wakeups = 0;       // ... terminate per evento
+    uint32_t reader_timeouts = 0;      // ... terminate per timeout
+};
+
+// Tempi di avvio misurati da start() (0 = non ancora): quanto manca al primo audio di una radio
+struct TimeshiftStartupStats {
+    uint32_t start_at_ms = 0;      // millis() di start(), base per i tempi del player
+    uint32_t connect_ms = 0;       // Risposta HTTP OK
+    uint32_t first_byte_ms = 0;    // Primo byte nel chunk in registrazione
+    uint32_t first_read_ms = 0;    // Primo byte consegnato al decoder
+    bool live_head = false;        // Primo byte letto dal live head (chunk ancora PENDING)
+};
+
 // TimeshiftManager: IDataSource intelligente che gestisce buffer circolare e cache su SD/PSRAM
 class TimeshiftManager : public IDataSource {
 public:
@@ -39,11 +67,13 @@ public:
     bool open(const char* uri) override;
     void close() override;
     bool is_open() const override;
-    bool is_seekable() const override { return !ready_chunks_.empty(); } // Seekable when chunks are available
+    // Seekable when chunks are available (o, con il live head, appena arriva il primo byte)
+    bool is_seekable() const override { return !ready_chunks_.empty() || (live_head_enabled_ && download_head_.load() > 0); }
     SourceType type() const override { return SourceType::HTTP_STREAM; } // Acts as HTTP conceptually
     const char* uri() const override;
     const Mp3SeekTable* get_seek_table() const override { return &seek_table_; }
     void request_stop() override;
+    TimeshiftManager* timeshift() const override { return const_cast<TimeshiftManager*>(this); }
 
     // Timeshift specific control
     bool start();
@@ -53,6 +83,7 @@ public:
     bool switchStorageMode(StorageMode new_mode);  // Runtime switch with chunk migration
     bool is_recording_paused() const { return pause_download_; }
     bool is_running() const { return is_running_; }
+    bool is_stop_requested() const { return playback_stop_requested_; }  // request_stop() del reader
 
     bool cleanup_timeshift_directory();
     bool mark_chunk_for_export(uint32_t abs_chunk_id);
@@ -70,16 +101,58 @@ public:
         }
     }
     StorageMode getStorageMode() const { return storage_mode_; }
-    
+    // Dimensione del file ring su SD (0 = automatica: finestra massima, limitata dallo
+    // spazio libero). Effetto alla prossima apertura in modalità SD_CARD.
+    void setSdRingCapacity(size_t bytes) { sd_ring_capacity_bytes_ = bytes; }
+    // Età massima del journal da riprendere all'open() (0 = nessun limite). Valutata solo con
+    // l'orologio impostato (NTP/RTC): senza, la storia viene ripresa comunque come rewind
+    void setJournalMaxAge(uint32_t seconds) { journal_max_age_s_ = seconds; }
+    // Live head: read() sul live edge legge i byte del chunk ancora in registrazione invece di
+    // aspettarne la promozione a READY (primo audio in meno di un secondo invece di un chunk)
+    void setLiveHeadEnabled(bool enabled) { live_head_enabled_ = enabled; }
+    bool isLiveHeadEnabled() const { return live_head_enabled_; }
+    // Connessione già in streaming aperta da uno standby (StationPresetManager) e byte recenti
+    // già scaricati (pre-roll, copiato): il download task parte da questi invece di fare la
+    // GET. Dopo open(), prima di start()
+    bool adopt_stream(std::unique_ptr<HTTPClient> http, const uint8_t* preroll, size_t preroll_len);
+
+    // Registrazione in un RecordingHub (recording_hub.h): niente writer task proprio, la coda
+    // dei chunk la serve il writer condiviso; pool PSRAM e ring SD vengono dalla quota del
+    // budget dell'hub e ogni slot ha i propri file ring/journal. Prima di open(), nullptr = da solo
+    bool set_recording_hub(RecordingHub* hub);
+    RecordingHub* recording_hub() const { return hub_; }
+    // Nuovo reader dopo un request_stop() (vista di playback dell'hub): la registrazione
+    // non si è mai fermata, riparte solo la lettura
+    void attach_reader();
+
+    // Writer condiviso: scrive il chunk in testa alla coda e ritorna i suoi byte (0 = coda
+    // vuota o rimandato). *deferred = ring SD piena, il chunk resta in coda; *lag_ms = dalla
+    // chiusura del chunk alla promozione a READY
+    size_t write_queued_chunk(bool* deferred, uint32_t* lag_ms);
+    uint32_t queued_write_chunks() const;
+    uint32_t write_queue_age_ms() const;     // Età del chunk in testa alla coda (0 = vuota)
+    size_t unwritten_bytes() const;          // Scaricati ma non ancora in un chunk READY
+
     // Status info
     size_t buffered_bytes() const;
+    size_t playable_bytes() const;           // READY + chunk in registrazione se il live head è attivo
     size_t total_downloaded_bytes() const;
     float buffer_duration_seconds() const;
 
     // Temporal seek (NEW)
-    size_t seek_to_time(uint32_t target_ms) override;     // Seek to timestamp, returns byte offset
+    // Seek to timestamp: risolto sulla seek table al frame esatto, ritorna il byte offset
+    size_t seek_to_time(uint32_t target_ms, TimeSeekPoint* point = nullptr) override;
+    bool window_start_frame(uint64_t* frame) const override;
+    bool read_start_frame(uint64_t* frame) const override;
     uint32_t total_duration_ms() const override;          // Total available duration
     uint32_t current_position_ms() const override;        // Current playback position in ms
+    int32_t live_edge_distance_ms() const override;       // Read position -> download head, no mutex
+
+    // Decoder sul live edge dopo una read() a vuoto: dorme finché un chunk viene promosso
+    // a READY dopo quella read, il download termina o arriva lo stop. true = nuovo chunk
+    bool wait_for_data(uint32_t timeout_ms);
+    TimeshiftWaitStats wait_stats() const;
+    TimeshiftStartupStats startup_stats() const;
 
     // Auto-pause callback for buffering (NEW)
     void set_auto_pause_callback(std::function<void(bool)> callback) { auto_pause_callback_ = callback; }
@@ -90,13 +163,20 @@ public:
 
 private:
     // ADAPTIVE BUFFER SIZING - all values computed dynamically based on detected bitrate
-    static const size_t INVALID_CHUNK_ID = SIZE_MAX;
+    static const size_t INVALID_CHUNK_ID = TimeshiftChunkIndex::npos;
     static const uint32_t INVALID_CHUNK_ABS_ID = UINT32_MAX;
 
+    // Event group: sostituisce i vTaskDelay di reader e preloader
+    static constexpr EventBits_t EVT_STOP = BIT0;          // Stop (sticky fino a open/close)
+    static constexpr EventBits_t EVT_CHUNK_READY = BIT1;   // Chunk READY o download terminato (reader)
+    static constexpr EventBits_t EVT_PRELOAD = BIT2;       // Lavoro per il preloader
+    static constexpr EventBits_t EVT_LIVE_DATA = BIT3;     // Nuovi byte nel chunk in registrazione (live head)
+    static constexpr uint32_t NEXT_CHUNK_GRACE_MS = 1600;  // Chunk successivo assente: rewind
+    static constexpr uint32_t LIVE_HEAD_WAIT_MS = 3000;    // Attesa massima di byte sul live head
+
     // Bitrate detection and adaptive sizing
     uint32_t detected_bitrate_kbps_ = 0;        // Auto-detected stream bitrate
     size_t dynamic_chunk_size_ = 128 * 1024;    // Target chunk size (adaptive)
-    size_t dynamic_buffer_size_ = 192 * 1024;   // Recording buffer (1.5x chunk_size)
     size_t dynamic_playback_buffer_size_ = 384 * 1024;  // Playback buffer (3x chunk_size)
     size_t dynamic_min_flush_size_ = 102 * 1024;        // Flush threshold (0.8x chunk_size)
     size_t dynamic_download_chunk_ = 4096;      // Download block size
@@ -107,40 +187,29 @@ private:
     static const size_t CHUNK_SIZE = 128 * 1024;
     static constexpr size_t MAX_PSRAM_POOL_MB = 3;      // Target PSRAM pool size in MB (limit for cleanup)
 
+    static constexpr size_t MIN_DYNAMIC_CHUNK_BYTES = 32 * 1024;
     static constexpr size_t MAX_DYNAMIC_CHUNK_BYTES = 512 * 1024;
-    static constexpr size_t MAX_RECORDING_BUFFER_CAPACITY = MAX_DYNAMIC_CHUNK_BYTES + (MAX_DYNAMIC_CHUNK_BYTES / 2); // 768 KB
+    static constexpr size_t WRITE_QUEUE_DEPTH = 3;      // Chunk in coda al writer task
+    // Slab fuori dalla lista READY: quello in registrazione, la coda e quello del writer
+    static constexpr size_t SLABS_IN_FLIGHT = WRITE_QUEUE_DEPTH + 2;
     static constexpr size_t MAX_PLAYBACK_BUFFER_CAPACITY = MAX_DYNAMIC_CHUNK_BYTES * 3; // 1.5 MB
 
-    enum class ChunkState {
-        PENDING,    // In scrittura su SD/PSRAM
-        READY,      // Completo e disponibile per playback
-        INVALID     // Errore di scrittura/validazione
-    };
+    // Descrittori POD nell'indice a ring (vedi timeshift_chunk_index.h)
+    using ChunkState = TimeshiftChunkState;
+    using ChunkInfo = TimeshiftChunk;
 
-    struct ChunkInfo {
-        uint32_t id;
-        size_t start_offset;     // Offset globale di inizio
-        size_t end_offset;       // Offset globale di fine
-        size_t length;           // Lunghezza effettiva
-        std::string filename;    // Used only in SD_CARD mode
-        uint8_t* psram_ptr;      // Used only in PSRAM_ONLY mode
-        ChunkState state;
-        uint32_t crc32;          // Per validazione (opzionale)
-
-        // Temporal information
-        uint32_t start_time_ms = 0;    // Timestamp inizio chunk (millisecondi)
-        uint32_t duration_ms = 0;      // Durata chunk in millisecondi
-        uint32_t total_frames = 0;     // Frame PCM totali nel chunk
-        bool export_marked_for_move = false; // Whether chunk file should be exported instead of deleted
-    };
-
-    // RECORDING BUFFER (Write-Only by download task)
-    uint8_t* recording_buffer_ = nullptr;
-    size_t rec_write_head_ = 0;              // Write position in recording buffer (circular)
+    // RECORDING SLAB (Write-Only by download task): i byte di rete finiscono qui senza copie
+    ChunkSlabPool slab_pool_;                // Slab da un chunk: registrazione, coda writer, READY in PSRAM
+    uint8_t* recording_slab_ = nullptr;      // Slab del chunk in registrazione (nullptr = da acquisire)
     size_t bytes_in_current_chunk_ = 0;      // Bytes accumulated for current pending chunk
     size_t current_recording_offset_ = 0;    // Total bytes recorded (global offset)
+    std::atomic<size_t> download_head_{0};   // current_recording_offset_ + pending bytes (lock-free readers)
+    // Live head: lo slab in registrazione si stacca solo col mutex (flush), quindi il reader
+    // che lo tiene può copiare [current_recording_offset_, download_head_) senza altre copie
+    bool live_head_enabled_ = true;
+    bool reading_live_head_ = false;         // Ultima read() servita dal live head
+    std::atomic<uint32_t> head_duration_ms_{0};  // Durata scansionata fino al download head
     uint32_t next_chunk_id_ = 0;             // Next chunk ID to assign
-    size_t recording_buffer_capacity_ = 0;
 
     // PLAYBACK BUFFER (Read-Only by read() method)
     uint8_t* playback_buffer_ = nullptr;
@@ -188,16 +257,53 @@ private:
     static void preloader_task_trampoline(void* arg);
     void preloader_task_loop();
 
+    EventGroupHandle_t events_ = nullptr;
+    std::atomic<uint32_t> stat_chunk_ready_{0};
+    std::atomic<uint32_t> stat_preload_events_{0};
+    std::atomic<uint32_t> stat_preloader_wakeups_{0};
+    std::atomic<uint32_t> stat_preloader_timeouts_{0};
+    std::atomic<uint32_t> stat_reader_waits_{0};
+    std::atomic<uint32_t> stat_reader_wakeups_{0};
+    std::atomic<uint32_t> stat_reader_timeouts_{0};
+    // Da adopt_stream(): connessione usata dal download task al posto della propria e
+    // pre-roll consegnato prima dei byte di rete
+    std::unique_ptr<HTTPClient> adopted_http_;
+    uint8_t* preroll_buf_ = nullptr;
+    size_t preroll_len_ = 0;
+    size_t preroll_pos_ = 0;
+    void free_preroll();
+    uint32_t start_at_ms_ = 0;
+    std::atomic<uint32_t> connect_ms_{0};
+    std::atomic<uint32_t> first_byte_ms_{0};
+    std::atomic<uint32_t> first_read_ms_{0};
+    bool first_read_live_ = false;
+    // Col mutex preso e la condizione già verificata: rilascia il mutex, attende
+    // EVT_CHUNK_READY (o extra_bits) o EVT_STOP e lo riprende. true se svegliato da un evento
+    bool wait_chunk_ready_locked(uint32_t timeout_ms, EventBits_t extra_bits = 0);
+    uint32_t elapsed_since_start_ms() const; // Per i tempi di avvio: mai 0 (0 = non ancora)
+    void signal_events(EventBits_t bits);
+
     // CHUNK MANAGEMENT
     std::vector<ChunkInfo> pending_chunks_;  // Chunks being written (PENDING state)
-    std::vector<ChunkInfo> ready_chunks_;    // Chunks complete and ready for playback (READY state)
+    TimeshiftChunkIndex ready_chunks_;       // Chunk READY in ordine di id: ring fissa allocata all'open()
     size_t current_read_offset_ = 0;         // Current read position (logical offset)
     size_t playback_buffer_capacity_ = 0;
 
-    // PSRAM-only mode: circular chunk pool
-    uint8_t* psram_chunk_pool_ = nullptr;    // Pre-allocated pool for PSRAM mode
-    size_t psram_pool_size_ = 0;             // Total size of PSRAM pool
-    size_t psram_pool_chunks_ = 0;           // Derived slots from MB target
+    // SD_CARD mode: un solo file ring preallocato, una regione per chunk
+    SdChunkRing sd_ring_;
+    size_t sd_ring_capacity_bytes_ = 0;      // 0 = automatica
+    // Journal dell'indice accanto alla ring: all'open() della stessa URI riprende la storia
+    TimeshiftJournal journal_;
+    size_t journal_seek_index_ = 0;          // Entry della seek table già nel journal
+    uint32_t journal_max_age_s_ = 2 * 3600;  // Journal più vecchi: si riparte senza storia
+    // Storia ripresa dal journal: solo per il rewind, la lettura parte dal download head
+    // della sessione nuova (offset e frame della fine dell'ultimo chunk ripristinato)
+    size_t session_start_offset_ = 0;
+    uint64_t session_start_frames_ = 0;
+    std::vector<TimeshiftJournal::SeekPoint> journal_points_;  // Scratch riusato per gli append
+
+    // PSRAM-only mode: i chunk READY tengono il proprio slab del pool
+    size_t psram_pool_size_ = 0;             // Bytes of slabs reserved for READY chunks
 
     // Synchronization
     SemaphoreHandle_t mutex_ = nullptr;
@@ -210,11 +316,11 @@ private:
     uint32_t auto_pause_delay_ms_ = 0;  // Delay before resuming (configurable)
     size_t auto_pause_min_chunks_ = 0;      // Minimum chunks needed before resuming (configurable)
 
-    // Seek Table (built incrementally)
+    // Seek Table (built incrementally by the download task, one parse for frames and entries)
     Mp3SeekTable seek_table_;
 
     // Temporal tracking
-    uint32_t cumulative_time_ms_ = 0;  // Tempo cumulativo di tutti i chunk processati
+    uint64_t chunk_start_frames_ = 0;  // Frame PCM scansionati all'inizio del chunk in registrazione
 
     // Bitrate monitoring helpers
     uint32_t bitrate_sample_start_ms_ = 0;
@@ -233,20 +339,24 @@ private:
         uint32_t id;
         size_t start_offset;
         size_t length;
-        uint8_t* data;
+        uint8_t* data;          // Slab del pool: passa al writer, che lo rilascia o lo cede al chunk
         StorageMode mode;
+        uint32_t total_frames;  // Dal parse inline del download task
+        uint32_t start_time_ms;
+        uint32_t duration_ms;
+        uint64_t end_frames;
+        uint32_t queued_at_ms;  // Ritardo di scrittura (statistiche del RecordingHub)
     };
 
     // RECORDING SIDE (private helpers)
-    bool flush_recording_chunk_async();             // Copy chunk to linear buffer and enqueue for writer
-    bool write_chunk_to_sd(ChunkInfo& chunk, const uint8_t* src);       // Write chunk data to SD file
-    bool write_chunk_to_psram(ChunkInfo& chunk, const uint8_t* src);    // Write chunk data to PSRAM pool
+    bool flush_recording_chunk_async();             // Hand the recording slab to the writer queue
+    // Scrive e promuove il chunk di un job. false solo se wait_for_space è false e la ring SD
+    // è piena: il job resta intatto (writer condiviso, si riprova più tardi)
+    bool write_chunk_job(ChunkJob& job, bool wait_for_space);
+    bool write_chunk_to_sd(ChunkInfo& chunk, const uint8_t* src);       // Write chunk data to a ring region
+    bool write_chunk_to_psram(ChunkInfo& chunk, uint8_t* slab);         // Adopt the slab as PSRAM storage
     bool validate_chunk(ChunkInfo& chunk);          // Validate chunk integrity
     void promote_chunk_to_ready(ChunkInfo chunk);   // Move chunk from PENDING to READY
-    bool calculate_chunk_duration(const ChunkInfo& chunk,
-                                   uint32_t& out_frames,
-                                   uint32_t& out_duration_ms,
-                                   uint32_t& out_bitrate_kbps);  // Calcola durata chunk e estrae bitrate
 
     // PLAYBACK SIDE (private helpers)
     uint32_t find_chunk_for_offset(size_t offset);    // Find absolute chunk ID containing offset
@@ -258,23 +368,38 @@ private:
     bool copy_chunk_into_buffer(const ChunkInfo& chunk, uint8_t* dest); // Switch cache helpers
     bool snapshot_playback_window();
     bool try_read_from_switch_cache(size_t offset, void* buffer, size_t size, size_t& out_bytes);
+    bool try_read_from_live_head(size_t offset, void* buffer, size_t size, size_t& out_bytes);
+    size_t ready_end_offset() const;         // Fine dell'ultimo chunk READY (inizio finestra se vuota)
+    size_t read_start_offset() const;        // Dove parte un reader nuovo (mutex preso)
     bool migrate_chunk_psram_to_sd(ChunkInfo& chunk);
 
     // CLEANUP
     void cleanup_old_chunks();                      // Remove old chunks beyond window
     void enforce_capacity_limits(size_t max_bytes, size_t max_slots); // Drop oldest chunks to fit target capacity
     void trim_ready_chunks_for_psram_pool();         // Keep only the most recent chunks that fit within the PSRAM pool
-    bool move_chunk_to_export_folder(const ChunkInfo& chunk, bool& out_missing_file);
+    void trim_seek_table();                          // Drop seek entries before the oldest READY chunk (mutex held)
+    bool move_chunk_to_export_folder(const ChunkInfo& chunk);     // Copy the ring region to an export file
     std::string build_export_directory(uint32_t chunk_id) const;
 
     // STORAGE BACKEND HELPERS
-    bool init_psram_pool();                         // Initialize PSRAM chunk pool
-    void free_psram_pool();                         // Free PSRAM chunk pool
-    uint8_t* allocate_psram_chunk(uint32_t chunk_id);                // Get next available PSRAM chunk slot
-    void free_chunk_storage(ChunkInfo& chunk);      // Free chunk storage (SD or PSRAM)
+    bool init_slab_pool();                          // Allocate in-flight slabs (and PSRAM slots) at open
+    bool init_psram_pool();                         // Grow the slab pool by the PSRAM READY slots
+    void free_psram_pool();                         // Release READY slabs and shrink to in-flight (mutex held)
+    bool init_sd_ring();                            // Open/preallocate the SD ring file
+    bool read_chunk_from_sd(const ChunkInfo& chunk, uint8_t* dest);     // Whole chunk from its ring region
+    void release_sd_region(const ChunkInfo& chunk); // Journal the eviction, then free the ring region
+    bool restore_from_journal();                    // Rebuild READY chunks and seek table after a reboot
+    void start_journal();                           // Rewrite the journal with the live state (mutex held)
+    void journal_ready_chunk(const ChunkInfo& chunk);  // Append a chunk now READY on SD (mutex held)
+    void free_chunk_storage(ChunkInfo& chunk);      // Free chunk storage (SD region or PSRAM slab)
     // PSRAM pool parameters
-    size_t psram_slot_size_ = 0;                    // Fixed slot size used for pool indexing
-    size_t psram_pool_slots_ = 0;                   // Number of slots derived from slot size and pool size
+    size_t psram_pool_slots_ = 0;                   // READY chunks that fit in the PSRAM target
+    size_t psram_pool_target_bytes() const;         // MAX_PSRAM_POOL_MB o la quota del RecordingHub
+
+    // Writer condiviso e file SD del suo slot (slot 0 = nomi storici ring.bin/journal.bin)
+    RecordingHub* hub_ = nullptr;
+    std::string sd_ring_path_;
+    std::string sd_journal_path_;
     
     // HTTP Handling (basic placeholder logic initially)
     // We might need a real HTTP client member here or in the task